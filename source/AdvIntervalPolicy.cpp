@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2006-2016 Google Inc, All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "AdvIntervalPolicy.h"
+
+AdvIntervalPolicy::AdvIntervalPolicy(const uint16_t *batteryLevelsMvIn,
+                                     const uint16_t *batteryScalesPercentIn,
+                                     uint8_t        numBatteryStepsIn,
+                                     uint16_t       batteryHysteresisMvIn,
+                                     uint16_t       activityScalePercentIn,
+                                     uint32_t       activityDurationMsIn) :
+    numBatterySteps((numBatteryStepsIn > MAX_BATTERY_STEPS) ? MAX_BATTERY_STEPS : numBatteryStepsIn),
+    batteryHysteresisMv(batteryHysteresisMvIn),
+    activityScalePercent(activityScalePercentIn),
+    activityDurationMs(activityDurationMsIn),
+    batteryStep(0),
+    activitySignalled(false),
+    activityEndTimeMs(0)
+{
+    for (uint8_t i = 0; i < numBatterySteps; i++) {
+        batteryLevelsMv[i]      = batteryLevelsMvIn[i];
+        batteryScalesPercent[i] = batteryScalesPercentIn[i];
+    }
+}
+
+void AdvIntervalPolicy::updateBatteryVoltage(uint16_t batteryVoltageMv)
+{
+    if (batteryVoltageMv == 0) {
+        return;
+    }
+    /* Going down a step is immediate */
+    while ((batteryStep < numBatterySteps) && (batteryVoltageMv < batteryLevelsMv[batteryStep])) {
+        batteryStep++;
+    }
+    /* Going back up needs the hysteresis margin, so a sagging battery does not flap */
+    while ((batteryStep > 0) && (batteryVoltageMv >= batteryLevelsMv[batteryStep - 1] + batteryHysteresisMv)) {
+        batteryStep--;
+    }
+}
+
+void AdvIntervalPolicy::signalActivity(uint32_t nowMs)
+{
+    activitySignalled = true;
+    activityEndTimeMs = nowMs + activityDurationMs;
+}
+
+uint16_t AdvIntervalPolicy::getIntervalMs(uint16_t configuredIntervalMs, uint32_t nowMs) const
+{
+    uint32_t interval = configuredIntervalMs;
+    if (batteryStep > 0) {
+        interval = interval * batteryScalesPercent[batteryStep - 1] / 100;
+    }
+    if (isActivityActive(nowMs)) {
+        interval = interval * activityScalePercent / 100;
+    }
+    return (interval > 0xFFFF) ? 0xFFFF : interval;
+}
+
+uint8_t AdvIntervalPolicy::getBatteryStep(void) const
+{
+    return batteryStep;
+}
+
+bool AdvIntervalPolicy::isActivityActive(uint32_t nowMs) const
+{
+    return activitySignalled && ((int32_t)(activityEndTimeMs - nowMs) > 0);
+}
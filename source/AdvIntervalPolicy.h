@@ -0,0 +1,132 @@
+/*
+ * Copyright (c) 2006-2016 Google Inc, All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __ADVINTERVALPOLICY_H__
+#define __ADVINTERVALPOLICY_H__
+
+#include <stdint.h>
+
+/**
+ * Class that adapts the slot advertising intervals to the state of the
+ * beacon: intervals are stretched in steps as the battery voltage drops, and
+ * shortened for a while after an external activity signal (e.g. an
+ * accelerometer interrupt).
+ *
+ * The policy only computes intervals; EddystoneService applies them when it
+ * schedules the next frame of each slot. It has no dependency on mbed so the
+ * host energy simulator (tools/AdvEnergySim) runs the same code.
+ */
+class AdvIntervalPolicy
+{
+public:
+    /**
+     * Maximum number of battery voltage steps.
+     */
+    static const uint8_t MAX_BATTERY_STEPS = 4;
+
+    /**
+     * Construct a new instance of this class.
+     *
+     * @param[in] batteryLevelsMv
+     *              Battery voltage thresholds in mV, in decreasing order.
+     * @param[in] batteryScalesPercent
+     *              The interval scale (in percent of the configured
+     *              interval) applied below each threshold.
+     * @param[in] numBatterySteps
+     *              The number of thresholds (at most MAX_BATTERY_STEPS).
+     * @param[in] batteryHysteresisMv
+     *              How far above a threshold the voltage must rise before
+     *              the step below it is left again.
+     * @param[in] activityScalePercent
+     *              The interval scale applied while activity is signalled.
+     * @param[in] activityDurationMs
+     *              How long an activity signal lasts.
+     */
+    AdvIntervalPolicy(const uint16_t *batteryLevelsMv,
+                      const uint16_t *batteryScalesPercent,
+                      uint8_t        numBatterySteps,
+                      uint16_t       batteryHysteresisMv,
+                      uint16_t       activityScalePercent,
+                      uint32_t       activityDurationMs);
+
+    /**
+     * Feed a new battery voltage measurement.
+     *
+     * @param[in] batteryVoltageMv
+     *              The battery voltage in mV. 0 (unknown) is ignored.
+     */
+    void updateBatteryVoltage(uint16_t batteryVoltageMv);
+
+    /**
+     * Signal external activity, shortening the intervals until
+     * activityDurationMs after @p nowMs.
+     *
+     * @param[in] nowMs
+     *              The current time in ms.
+     */
+    void signalActivity(uint32_t nowMs);
+
+    /**
+     * Compute the interval to use for a slot.
+     *
+     * @param[in] configuredIntervalMs
+     *              The interval configured for the slot.
+     * @param[in] nowMs
+     *              The current time in ms.
+     *
+     * @return The adapted interval in ms (not corrected for the limits of
+     *         the BLE stack).
+     */
+    uint16_t getIntervalMs(uint16_t configuredIntervalMs, uint32_t nowMs) const;
+
+    /**
+     * Get the current battery step.
+     *
+     * @return 0 when the battery is above every threshold, up to
+     *         numBatterySteps when it is below the last one.
+     */
+    uint8_t getBatteryStep(void) const;
+
+    /**
+     * Test whether an activity signal is in effect.
+     *
+     * @param[in] nowMs
+     *              The current time in ms.
+     */
+    bool isActivityActive(uint32_t nowMs) const;
+
+private:
+    uint16_t    batteryLevelsMv[MAX_BATTERY_STEPS];
+    uint16_t    batteryScalesPercent[MAX_BATTERY_STEPS];
+    uint8_t     numBatterySteps;
+    uint16_t    batteryHysteresisMv;
+    uint16_t    activityScalePercent;
+    uint32_t    activityDurationMs;
+
+    /**
+     * Number of thresholds the battery voltage is currently below.
+     */
+    uint8_t     batteryStep;
+
+    /**
+     * Whether an activity signal was ever received, and when the last one
+     * expires.
+     */
+    bool        activitySignalled;
+    uint32_t    activityEndTimeMs;
+};
+
+#endif  /* __ADVINTERVALPOLICY_H__ */
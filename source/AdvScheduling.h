@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) 2016, Google Inc, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __ADV_SCHEDULING_H__
+#define __ADV_SCHEDULING_H__
+
+#include <stdint.h>
+
+/**
+ * Helpers used by EddystoneService to spread slot frames in time: a phase
+ * offset for each slot when advertising starts, and a bounded random jitter
+ * added to every frame. Without them, slots with equal or harmonically
+ * related intervals become due in the same tick every cycle, and beacons
+ * that boot together stay phase-locked.
+ *
+ * They have no dependency on mbed so the host scheduler simulator
+ * (tools/AdvSchedulerSim) runs exactly the same code.
+ */
+
+/**
+ * Step a xorshift32 generator. The jitter does not need cryptographic
+ * randomness, so this is seeded once from the entropy source instead of
+ * paying for a DRBG call per frame.
+ *
+ * @param[in,out] state
+ *              The generator state, must not be 0.
+ *
+ * @return The next 32-bit pseudo random value.
+ */
+inline uint32_t eddystoneAdvRandNext(uint32_t &state)
+{
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+/**
+ * Draw a jitter to add to the next frame of a slot.
+ *
+ * @param[in,out] state
+ *              The generator state.
+ * @param[in] maxJitterMs
+ *              The jitter bound in milliseconds (0 disables jitter).
+ *
+ * @return A jitter in [0, maxJitterMs] milliseconds.
+ */
+inline uint16_t eddystoneAdvJitterMs(uint32_t &state, uint16_t maxJitterMs)
+{
+    if (maxJitterMs == 0) {
+        return 0;
+    }
+    return eddystoneAdvRandNext(state) % (maxJitterMs + 1u);
+}
+
+/**
+ * Phase offset of the first frame of a slot after advertising starts.
+ *
+ * @param[in,out] state
+ *              The generator state.
+ * @param[in] offsetMs
+ *              The configured offset for the slot.
+ * @param[in] intervalMs
+ *              The advertising interval of the slot.
+ * @param[in] randomized
+ *              If true, the offset is drawn uniformly in [0, intervalMs)
+ *              and @p offsetMs is ignored.
+ *
+ * @return The offset in milliseconds, always less than @p intervalMs.
+ */
+inline uint16_t eddystoneAdvSlotOffsetMs(uint32_t &state, uint16_t offsetMs, uint16_t intervalMs, bool randomized)
+{
+    if (intervalMs == 0) {
+        return 0;
+    }
+    if (randomized) {
+        return eddystoneAdvRandNext(state) % intervalMs;
+    }
+    return offsetMs % intervalMs;
+}
+
+/**
+ * Delay to post the next frame of a slot. The caller advances the slot
+ * schedule by one interval plus a fresh jitter per frame, like the advDelay
+ * of the BLE link layer: the jitter accumulates, so beacons that started in
+ * step drift apart, while time lost processing earlier frames does not.
+ *
+ * @param[in] nextDueMs
+ *              The time the next frame is due.
+ * @param[in] nowMs
+ *              The current time.
+ *
+ * @return The delay in milliseconds (0 for frames that are already late).
+ */
+inline uint32_t eddystoneAdvNextDelayMs(uint32_t nextDueMs, uint32_t nowMs)
+{
+    int32_t delay = (int32_t)(nextDueMs - nowMs);
+    return (delay > 0) ? (uint32_t)delay : 0;
+}
+
+#endif // __ADV_SCHEDULING_H__
@@ -0,0 +1,146 @@
+/*
+ * Copyright (c) 2016, Google Inc, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "AdvertisingSets.h"
+#include <string.h>
+
+#if !BLE_FEATURE_EXTENDED_ADVERTISING /* Extended advertising is implemented in mbedAdvertisingSets */
+
+#ifdef ADV_SETS_HOST_STUB
+    /**
+     * Host stub: pretend there is one set per slot and record what the
+     * service asks for so it can be checked without hardware.
+     */
+    static AdvSetStubState_t advSetStubStates[MAX_ADV_SLOTS];
+    static bool advSetStubFailStarts[MAX_ADV_SLOTS];
+
+    uint8_t eddystoneAdvSetsAvailable(BLE &ble)
+    {
+        (void) ble;
+        return MAX_ADV_SLOTS;
+    }
+
+    ble_error_t eddystoneAdvSetConfigure(BLE &ble, uint8_t set, uint16_t intervalMs, int8_t radioTxPower, bool connectable)
+    {
+        (void) ble;
+        if (set >= MAX_ADV_SLOTS) {
+            return BLE_ERROR_PARAM_OUT_OF_RANGE;
+        }
+        advSetStubStates[set].configured   = true;
+        advSetStubStates[set].connectable  = connectable;
+        advSetStubStates[set].intervalMs   = intervalMs;
+        advSetStubStates[set].radioTxPower = radioTxPower;
+        return BLE_ERROR_NONE;
+    }
+
+    ble_error_t eddystoneAdvSetPayload(BLE &ble, uint8_t set, const uint8_t *payload, uint8_t payloadLen)
+    {
+        (void) ble;
+        if ((set >= MAX_ADV_SLOTS) || (payloadLen > sizeof(advSetStubStates[set].payload))) {
+            return BLE_ERROR_PARAM_OUT_OF_RANGE;
+        }
+        memcpy(advSetStubStates[set].payload, payload, payloadLen);
+        advSetStubStates[set].payloadLen = payloadLen;
+        advSetStubStates[set].payloadUpdates++;
+        return BLE_ERROR_NONE;
+    }
+
+    ble_error_t eddystoneAdvSetStart(BLE &ble, uint8_t set)
+    {
+        (void) ble;
+        if ((set >= MAX_ADV_SLOTS) || !advSetStubStates[set].configured || advSetStubFailStarts[set]) {
+            return BLE_ERROR_INVALID_STATE;
+        }
+        advSetStubStates[set].advertising = true;
+        return BLE_ERROR_NONE;
+    }
+
+    ble_error_t eddystoneAdvSetStop(BLE &ble, uint8_t set)
+    {
+        (void) ble;
+        if (set >= MAX_ADV_SLOTS) {
+            return BLE_ERROR_PARAM_OUT_OF_RANGE;
+        }
+        advSetStubStates[set].advertising = false;
+        return BLE_ERROR_NONE;
+    }
+
+    const AdvSetStubState_t *eddystoneAdvSetStubState(uint8_t set)
+    {
+        return (set < MAX_ADV_SLOTS) ? &advSetStubStates[set] : NULL;
+    }
+
+    void eddystoneAdvSetStubReset(void)
+    {
+        memset(advSetStubStates, 0, sizeof(advSetStubStates));
+        memset(advSetStubFailStarts, 0, sizeof(advSetStubFailStarts));
+    }
+
+    void eddystoneAdvSetStubFailStart(uint8_t set, bool fail)
+    {
+        if (set < MAX_ADV_SLOTS) {
+            advSetStubFailStarts[set] = fail;
+        }
+    }
+
+#else
+    /**
+     * The BLE stack only supports legacy advertising: report no sets so
+     * EddystoneService keeps using the legacy frame swapper.
+     */
+    uint8_t eddystoneAdvSetsAvailable(BLE &ble)
+    {
+        (void) ble;
+        return 0;
+    }
+
+    ble_error_t eddystoneAdvSetConfigure(BLE &ble, uint8_t set, uint16_t intervalMs, int8_t radioTxPower, bool connectable)
+    {
+        /* Avoid compiler warnings */
+        (void) ble;
+        (void) set;
+        (void) intervalMs;
+        (void) radioTxPower;
+        (void) connectable;
+        return BLE_ERROR_NOT_IMPLEMENTED;
+    }
+
+    ble_error_t eddystoneAdvSetPayload(BLE &ble, uint8_t set, const uint8_t *payload, uint8_t payloadLen)
+    {
+        (void) ble;
+        (void) set;
+        (void) payload;
+        (void) payloadLen;
+        return BLE_ERROR_NOT_IMPLEMENTED;
+    }
+
+    ble_error_t eddystoneAdvSetStart(BLE &ble, uint8_t set)
+    {
+        (void) ble;
+        (void) set;
+        return BLE_ERROR_NOT_IMPLEMENTED;
+    }
+
+    ble_error_t eddystoneAdvSetStop(BLE &ble, uint8_t set)
+    {
+        (void) ble;
+        (void) set;
+        return BLE_ERROR_NOT_IMPLEMENTED;
+    }
+#endif /* #ifdef ADV_SETS_HOST_STUB */
+
+#endif /* #if !BLE_FEATURE_EXTENDED_ADVERTISING */
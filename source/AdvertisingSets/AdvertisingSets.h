@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) 2016, Google Inc, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __ADVERTISING_SETS_H__
+#define __ADVERTISING_SETS_H__
+
+#include "ble/BLE.h"
+#include "../EddystoneTypes.h"
+
+/**
+ * Generic API to run each Eddystone slot as its own BLE 5 advertising set.
+ * The controller then interleaves the slots natively, each with its own
+ * interval and TX power, instead of EddystoneService stopping, swapping and
+ * restarting a single legacy advertiser for every frame.
+ *
+ * Sets are numbered 0..eddystoneAdvSetsAvailable()-1; EddystoneService uses
+ * the slot number as the set number.
+ */
+
+/**
+ * Number of advertising sets that can run concurrently.
+ *
+ * @return 0 if the stack only supports legacy advertising, in which case
+ *         EddystoneService falls back to swapping frames in manageRadio().
+ */
+uint8_t eddystoneAdvSetsAvailable(BLE &ble);
+
+/**
+ * Configure (or reconfigure) an advertising set. Legacy PDUs are used so the
+ * frames remain visible to scanners that predate BLE 5.
+ *
+ * @param[in] set
+ *              The advertising set number.
+ * @param[in] intervalMs
+ *              The advertising interval in milliseconds.
+ * @param[in] radioTxPower
+ *              The radio TX power in dBm.
+ * @param[in] connectable
+ *              Whether the set uses connectable PDUs.
+ */
+ble_error_t eddystoneAdvSetConfigure(BLE &ble, uint8_t set, uint16_t intervalMs, int8_t radioTxPower, bool connectable);
+
+/**
+ * Replace the payload of an advertising set. This can be done while the set
+ * is advertising.
+ *
+ * @param[in] set
+ *              The advertising set number.
+ * @param[in] payload
+ *              The raw advertising data (AD structures).
+ * @param[in] payloadLen
+ *              The length in bytes of @p payload.
+ */
+ble_error_t eddystoneAdvSetPayload(BLE &ble, uint8_t set, const uint8_t *payload, uint8_t payloadLen);
+
+/**
+ * Start advertising an advertising set.
+ */
+ble_error_t eddystoneAdvSetStart(BLE &ble, uint8_t set);
+
+/**
+ * Stop advertising an advertising set.
+ */
+ble_error_t eddystoneAdvSetStop(BLE &ble, uint8_t set);
+
+#ifdef ADV_SETS_HOST_STUB
+/**
+ * State recorded for each set by the host stub, so the advertising-set
+ * backend can be exercised without a BLE 5 controller.
+ */
+typedef struct {
+    bool     configured;
+    bool     advertising;
+    bool     connectable;
+    uint16_t intervalMs;
+    int8_t   radioTxPower;
+    uint8_t  payload[31];
+    uint8_t  payloadLen;
+    uint32_t payloadUpdates;
+} AdvSetStubState_t;
+
+/**
+ * Get the state recorded by the host stub for an advertising set.
+ *
+ * @return NULL if @p set is out of range.
+ */
+const AdvSetStubState_t *eddystoneAdvSetStubState(uint8_t set);
+
+/**
+ * Clear the state recorded by the host stub for all sets.
+ */
+void eddystoneAdvSetStubReset(void);
+
+/**
+ * Make eddystoneAdvSetStart() fail for an advertising set, to exercise the
+ * fallback to legacy advertising.
+ */
+void eddystoneAdvSetStubFailStart(uint8_t set, bool fail);
+#endif
+
+#endif // __ADVERTISING_SETS_H__
@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) 2016, Google Inc, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../AdvertisingSets.h"
+
+#if BLE_FEATURE_EXTENDED_ADVERTISING /* BLE API with advertising sets (mbed OS 5.14+) */
+
+/*
+ * Set 0 reuses the legacy advertising set that always exists, the other sets
+ * are created the first time they are configured.
+ */
+static ble::advertising_handle_t advSetHandles[MAX_ADV_SLOTS];
+static bool                      advSetCreated[MAX_ADV_SLOTS];
+
+uint8_t eddystoneAdvSetsAvailable(BLE &ble)
+{
+    if (!ble.gap().isFeatureSupported(ble::controller_supported_features_t::LE_EXTENDED_ADVERTISING)) {
+        return 0;
+    }
+    uint8_t sets = ble.gap().getMaxAdvertisingSetNumber();
+    return (sets > MAX_ADV_SLOTS) ? MAX_ADV_SLOTS : sets;
+}
+
+ble_error_t eddystoneAdvSetConfigure(BLE &ble, uint8_t set, uint16_t intervalMs, int8_t radioTxPower, bool connectable)
+{
+    if (set >= MAX_ADV_SLOTS) {
+        return BLE_ERROR_PARAM_OUT_OF_RANGE;
+    }
+
+    ble::AdvertisingParameters params(
+        connectable ? ble::advertising_type_t::CONNECTABLE_UNDIRECTED : ble::advertising_type_t::NON_CONNECTABLE_UNDIRECTED,
+        ble::adv_interval_t(ble::millisecond_t(intervalMs)),
+        ble::adv_interval_t(ble::millisecond_t(intervalMs)),
+        true // Legacy PDUs, so pre BLE 5 scanners still see the frames
+    );
+    params.setTxPower(radioTxPower);
+
+    if (!advSetCreated[set]) {
+        ble_error_t error;
+        if (set == 0) {
+            advSetHandles[set] = ble::LEGACY_ADVERTISING_HANDLE;
+            error = ble.gap().setAdvertisingParameters(advSetHandles[set], params);
+        } else {
+            error = ble.gap().createAdvertisingSet(&advSetHandles[set], params);
+        }
+        advSetCreated[set] = (error == BLE_ERROR_NONE);
+        return error;
+    }
+    return ble.gap().setAdvertisingParameters(advSetHandles[set], params);
+}
+
+ble_error_t eddystoneAdvSetPayload(BLE &ble, uint8_t set, const uint8_t *payload, uint8_t payloadLen)
+{
+    if ((set >= MAX_ADV_SLOTS) || !advSetCreated[set]) {
+        return BLE_ERROR_INVALID_STATE;
+    }
+    return ble.gap().setAdvertisingPayload(advSetHandles[set], mbed::Span<const uint8_t>(payload, payloadLen));
+}
+
+ble_error_t eddystoneAdvSetStart(BLE &ble, uint8_t set)
+{
+    if ((set >= MAX_ADV_SLOTS) || !advSetCreated[set]) {
+        return BLE_ERROR_INVALID_STATE;
+    }
+    return ble.gap().startAdvertising(advSetHandles[set]);
+}
+
+ble_error_t eddystoneAdvSetStop(BLE &ble, uint8_t set)
+{
+    if ((set >= MAX_ADV_SLOTS) || !advSetCreated[set]) {
+        return BLE_ERROR_INVALID_STATE;
+    }
+    return ble.gap().stopAdvertising(advSetHandles[set]);
+}
+
+#endif /* #if BLE_FEATURE_EXTENDED_ADVERTISING */
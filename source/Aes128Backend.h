@@ -0,0 +1,223 @@
+/*
+ * Copyright (c) 2016, Google Inc, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __AES128BACKEND_H__
+#define __AES128BACKEND_H__
+
+#include <stdint.h>
+#include <string.h>
+#include "Eddystone_config.h"
+#include "mbedtls/aes.h"
+#include "aes128_ct.h"
+
+/**
+ * AES-128 block cipher backends.
+ *
+ * Every backend is a class of static inline functions with the same
+ * interface, and one of them is picked at compile time as Aes128Backend
+ * (see the AES OPTIONS in Eddystone_config.h), so the EID, ETLM and lock
+ * code calls the block cipher directly, without a function pointer or
+ * virtual call per block:
+ *
+ *   Context                    Expanded key, for one direction
+ *   init(ctx) / free(ctx)      Set up / wipe a context
+ *   setKeyEnc(ctx, key)        Expand a 16-byte key for encryption
+ *   setKeyDec(ctx, key)        Expand a 16-byte key for decryption
+ *   encrypt(ctx, in, out)      One block; in and out may be the same buffer
+ *   decrypt(ctx, in, out)      One block, with a decryption key
+ *   getName()                  Backend name, for the benchmarks
+ *
+ * The mode constants remain MBEDTLS_AES_ENCRYPT and MBEDTLS_AES_DECRYPT,
+ * and mbedtls AES stays linked whatever the backend, for the CTR_DRBG.
+ */
+
+/**
+ * The mbedtls implementation: the reference, with the ROM tables.
+ */
+class Aes128Mbedtls
+{
+public:
+    typedef mbedtls_aes_context Context;
+
+    static const char *getName(void) { return "mbedtls"; }
+
+    static void init(Context *ctx) { mbedtls_aes_init(ctx); }
+    static void free(Context *ctx) { mbedtls_aes_free(ctx); }
+    static void setKeyEnc(Context *ctx, const uint8_t key[16]) { mbedtls_aes_setkey_enc(ctx, key, 128); }
+    static void setKeyDec(Context *ctx, const uint8_t key[16]) { mbedtls_aes_setkey_dec(ctx, key, 128); }
+
+    static void encrypt(const Context *ctx, const uint8_t in[16], uint8_t out[16]) {
+        /* mbedtls does not modify the context, it just does not say so */
+        mbedtls_aes_crypt_ecb(const_cast<Context *>(ctx), MBEDTLS_AES_ENCRYPT, in, out);
+    }
+
+    static void decrypt(const Context *ctx, const uint8_t in[16], uint8_t out[16]) {
+        mbedtls_aes_crypt_ecb(const_cast<Context *>(ctx), MBEDTLS_AES_DECRYPT, in, out);
+    }
+};
+
+/**
+ * The table-free constant-time implementation (aes128_ct.h): no secret
+ * dependent loads, a smaller context, slower than the tables.
+ */
+class Aes128Ct
+{
+public:
+    typedef eddy_aes128_ct_context Context;
+
+    static const char *getName(void) { return "constant-time"; }
+
+    static void init(Context *ctx) { memset(ctx, 0, sizeof(*ctx)); }
+    static void free(Context *ctx) { eddy_aes128_ct_free(ctx); }
+    /* The same round keys serve both directions */
+    static void setKeyEnc(Context *ctx, const uint8_t key[16]) { eddy_aes128_ct_setkey(ctx, key); }
+    static void setKeyDec(Context *ctx, const uint8_t key[16]) { eddy_aes128_ct_setkey(ctx, key); }
+    static void encrypt(const Context *ctx, const uint8_t in[16], uint8_t out[16]) { eddy_aes128_ct_encrypt(ctx, in, out); }
+    static void decrypt(const Context *ctx, const uint8_t in[16], uint8_t out[16]) { eddy_aes128_ct_decrypt(ctx, in, out); }
+};
+
+#if defined(AES128_BACKEND_NRF_ECB)
+#include "nrf_soc.h"
+
+/**
+ * The nRF51/nRF52 ECB peripheral, through the SoftDevice. It only
+ * encrypts: decryption (the lock code's unlock key) uses Aes128Ct.
+ */
+class Aes128NrfEcb
+{
+public:
+    struct Context {
+        uint8_t             key[16];    /* The peripheral takes the raw key */
+        Aes128Ct::Context   dec;        /* Set by setKeyDec() only */
+    };
+
+    static const char *getName(void) { return "nRF ECB"; }
+
+    static void init(Context *ctx) { memset(ctx, 0, sizeof(*ctx)); }
+
+    static void free(Context *ctx) {
+        memset(ctx->key, 0, sizeof(ctx->key));
+        Aes128Ct::free(&ctx->dec);
+    }
+
+    static void setKeyEnc(Context *ctx, const uint8_t key[16]) { memcpy(ctx->key, key, sizeof(ctx->key)); }
+    static void setKeyDec(Context *ctx, const uint8_t key[16]) { Aes128Ct::setKeyDec(&ctx->dec, key); }
+
+    static void encrypt(const Context *ctx, const uint8_t in[16], uint8_t out[16]) {
+        nrf_ecb_hal_data_t ecb;
+        memcpy(ecb.key, ctx->key, sizeof(ecb.key));
+        memcpy(ecb.cleartext, in, sizeof(ecb.cleartext));
+        sd_ecb_block_encrypt(&ecb);
+        memcpy(out, ecb.ciphertext, sizeof(ecb.ciphertext));
+        memset(&ecb, 0, sizeof(ecb));
+    }
+
+    static void decrypt(const Context *ctx, const uint8_t in[16], uint8_t out[16]) { Aes128Ct::decrypt(&ctx->dec, in, out); }
+};
+#endif
+
+#if defined(AES128_BACKEND_AESNI)
+#if !defined(__AES__)
+#error "AES128_BACKEND_AESNI needs a host compiler with AES-NI enabled (-maes)"
+#endif
+#include <wmmintrin.h>
+
+/**
+ * AES-NI, for host builds of the firmware sources (tools/CryptoBench).
+ */
+class Aes128AesNi
+{
+public:
+    struct Context {
+        __m128i rk[11];
+    };
+
+    static const char *getName(void) { return "AES-NI"; }
+
+    static void init(Context *ctx) { memset(ctx, 0, sizeof(*ctx)); }
+    static void free(Context *ctx) { memset(ctx, 0, sizeof(*ctx)); }
+
+    static void setKeyEnc(Context *ctx, const uint8_t key[16]) {
+        __m128i k = _mm_loadu_si128((const __m128i *)key);
+        ctx->rk[0] = k;
+        k = expandRound(k, _mm_aeskeygenassist_si128(k, 0x01)); ctx->rk[1] = k;
+        k = expandRound(k, _mm_aeskeygenassist_si128(k, 0x02)); ctx->rk[2] = k;
+        k = expandRound(k, _mm_aeskeygenassist_si128(k, 0x04)); ctx->rk[3] = k;
+        k = expandRound(k, _mm_aeskeygenassist_si128(k, 0x08)); ctx->rk[4] = k;
+        k = expandRound(k, _mm_aeskeygenassist_si128(k, 0x10)); ctx->rk[5] = k;
+        k = expandRound(k, _mm_aeskeygenassist_si128(k, 0x20)); ctx->rk[6] = k;
+        k = expandRound(k, _mm_aeskeygenassist_si128(k, 0x40)); ctx->rk[7] = k;
+        k = expandRound(k, _mm_aeskeygenassist_si128(k, 0x80)); ctx->rk[8] = k;
+        k = expandRound(k, _mm_aeskeygenassist_si128(k, 0x1b)); ctx->rk[9] = k;
+        k = expandRound(k, _mm_aeskeygenassist_si128(k, 0x36)); ctx->rk[10] = k;
+    }
+
+    /* Equivalent inverse cipher: the round keys reversed, the middle ones through InvMixColumns */
+    static void setKeyDec(Context *ctx, const uint8_t key[16]) {
+        Context enc;
+        setKeyEnc(&enc, key);
+        ctx->rk[0] = enc.rk[10];
+        for (int i = 1; i < 10; i++) {
+            ctx->rk[i] = _mm_aesimc_si128(enc.rk[10 - i]);
+        }
+        ctx->rk[10] = enc.rk[0];
+        free(&enc);
+    }
+
+    static void encrypt(const Context *ctx, const uint8_t in[16], uint8_t out[16]) {
+        __m128i b = _mm_xor_si128(_mm_loadu_si128((const __m128i *)in), ctx->rk[0]);
+        for (int i = 1; i < 10; i++) {
+            b = _mm_aesenc_si128(b, ctx->rk[i]);
+        }
+        _mm_storeu_si128((__m128i *)out, _mm_aesenclast_si128(b, ctx->rk[10]));
+    }
+
+    static void decrypt(const Context *ctx, const uint8_t in[16], uint8_t out[16]) {
+        __m128i b = _mm_xor_si128(_mm_loadu_si128((const __m128i *)in), ctx->rk[0]);
+        for (int i = 1; i < 10; i++) {
+            b = _mm_aesdec_si128(b, ctx->rk[i]);
+        }
+        _mm_storeu_si128((__m128i *)out, _mm_aesdeclast_si128(b, ctx->rk[10]));
+    }
+
+private:
+    static __m128i expandRound(__m128i k, __m128i assist) {
+        assist = _mm_shuffle_epi32(assist, 0xff);
+        k = _mm_xor_si128(k, _mm_slli_si128(k, 4));
+        k = _mm_xor_si128(k, _mm_slli_si128(k, 4));
+        k = _mm_xor_si128(k, _mm_slli_si128(k, 4));
+        return _mm_xor_si128(k, assist);
+    }
+};
+#endif
+
+#if defined(AES128_BACKEND_NRF_ECB)
+typedef Aes128NrfEcb Aes128Backend;
+#elif defined(AES128_BACKEND_AESNI)
+typedef Aes128AesNi Aes128Backend;
+#elif defined(AES128_BACKEND_CT)
+typedef Aes128Ct Aes128Backend;
+#else
+typedef Aes128Mbedtls Aes128Backend;
+#endif
+
+/**
+ * Expanded AES-128 key of the selected backend.
+ */
+typedef Aes128Backend::Context Aes128Context;
+
+#endif  /* __AES128BACKEND_H__ */
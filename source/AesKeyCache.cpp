@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 2006-2016 Google Inc, All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+#include "AesKeyCache.h"
+
+AesKeyCache::AesKeyCache(void) :
+    keyExpansions(0)
+{
+    for (uint8_t i = 0; i < NUM_ENTRIES; i++) {
+        Aes128Backend::init(&entries[i].ctx);
+        memset(entries[i].sourceKey, 0, sizeof(entries[i].sourceKey));
+        entries[i].tag   = 0;
+        entries[i].mode  = MBEDTLS_AES_ENCRYPT;
+        entries[i].valid = false;
+    }
+}
+
+AesKeyCache::~AesKeyCache(void)
+{
+    invalidateAll();
+}
+
+Aes128Context *AesKeyCache::get(uint8_t entry, const uint8_t *key, int mode)
+{
+    Aes128Context *ctx = find(entry, key, 0, mode);
+    if (ctx == NULL) {
+        ctx = store(entry, key, 0, key, mode);
+    }
+    return ctx;
+}
+
+Aes128Context *AesKeyCache::find(uint8_t entry, const uint8_t *sourceKey, uint32_t tag, int mode)
+{
+    if (entry >= NUM_ENTRIES) {
+        return NULL;
+    }
+    Entry &e = entries[entry];
+    if (!e.valid || (e.tag != tag) || (e.mode != mode) || (memcmp(e.sourceKey, sourceKey, sizeof(e.sourceKey)) != 0)) {
+        return NULL;
+    }
+    return &e.ctx;
+}
+
+Aes128Context *AesKeyCache::store(uint8_t entry, const uint8_t *sourceKey, uint32_t tag, const uint8_t *key, int mode)
+{
+    if (entry >= NUM_ENTRIES) {
+        return NULL;
+    }
+    Entry &e = entries[entry];
+    Aes128Backend::free(&e.ctx);
+    Aes128Backend::init(&e.ctx);
+    if (mode == MBEDTLS_AES_DECRYPT) {
+        Aes128Backend::setKeyDec(&e.ctx, key);
+    } else {
+        Aes128Backend::setKeyEnc(&e.ctx, key);
+    }
+    memcpy(e.sourceKey, sourceKey, sizeof(e.sourceKey));
+    e.tag   = tag;
+    e.mode  = mode;
+    e.valid = true;
+    keyExpansions++;
+    return &e.ctx;
+}
+
+void AesKeyCache::invalidate(uint8_t entry)
+{
+    if (entry >= NUM_ENTRIES) {
+        return;
+    }
+    Entry &e = entries[entry];
+    /* Aes128Backend::free() zeroizes the round keys */
+    Aes128Backend::free(&e.ctx);
+    Aes128Backend::init(&e.ctx);
+    memset(e.sourceKey, 0, sizeof(e.sourceKey));
+    e.valid = false;
+}
+
+void AesKeyCache::invalidateAll(void)
+{
+    for (uint8_t i = 0; i < NUM_ENTRIES; i++) {
+        invalidate(i);
+    }
+}
+
+uint32_t AesKeyCache::getKeyExpansions(void) const
+{
+    return keyExpansions;
+}
@@ -0,0 +1,160 @@
+/*
+ * Copyright (c) 2006-2016 Google Inc, All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __AESKEYCACHE_H__
+#define __AESKEYCACHE_H__
+
+#include <stdint.h>
+#include "Aes128Backend.h"
+#include "EddystoneTypes.h"
+
+/**
+ * Class that keeps the expanded AES-128 key schedules of the beacon keys, so
+ * the EID, ETLM and lock computations do not run the key expansion for every
+ * block they encrypt.
+ *
+ * There is one entry per slot (the EID identity key of the slot, encrypt
+ * direction), two for the unlock key (encrypt and decrypt) and one per slot
+ * for the EID temporary key, which is derived from the identity key and
+ * only changes every 2^16 seconds. An entry is looked up by a 16-byte source
+ * key and a tag: the key itself and 0 for plain keys, the identity key and
+ * the epoch for derived ones. It is expanded again as soon as it is asked
+ * for a different source key or tag, so callers never see a stale schedule;
+ * the explicit invalidation is there to wipe key material that is no longer
+ * used.
+ *
+ * Each entry costs one Aes128Context: about 300 bytes with mbedtls, 176 with
+ * AES128_BACKEND_CT (see Aes128Backend.h).
+ */
+class AesKeyCache
+{
+public:
+    /**
+     * Entry of the unlock key, expanded for encryption.
+     */
+    static const uint8_t UNLOCK_ENCRYPT_ENTRY = MAX_ADV_SLOTS;
+
+    /**
+     * Entry of the unlock key, expanded for decryption.
+     */
+    static const uint8_t UNLOCK_DECRYPT_ENTRY = MAX_ADV_SLOTS + 1;
+
+    /**
+     * First entry of the EID temporary keys, TEMP_KEY_ENTRY + slot.
+     */
+    static const uint8_t TEMP_KEY_ENTRY = MAX_ADV_SLOTS + 2;
+
+    /**
+     * Total number of entries. Entries below MAX_ADV_SLOTS belong to the
+     * slot with the same number.
+     */
+    static const uint8_t NUM_ENTRIES = 2 * MAX_ADV_SLOTS + 2;
+
+    /**
+     * Construct a new instance of this class, with every entry invalid.
+     */
+    AesKeyCache(void);
+
+    /**
+     * Free the contexts and wipe the cached keys.
+     */
+    ~AesKeyCache(void);
+
+    /**
+     * Get the expanded key schedule of an entry, expanding it if the entry
+     * is invalid or holds a different key or direction.
+     *
+     * @param[in] entry
+     *              The entry: a slot number, UNLOCK_ENCRYPT_ENTRY or
+     *              UNLOCK_DECRYPT_ENTRY.
+     * @param[in] key
+     *              The 16-byte key.
+     * @param[in] mode
+     *              MBEDTLS_AES_ENCRYPT or MBEDTLS_AES_DECRYPT.
+     *
+     * @return The context to pass to Aes128Backend::encrypt() or decrypt(), or
+     *         NULL if @p entry is out of range. It remains valid until the
+     *         next call for the same entry.
+     */
+    Aes128Context *get(uint8_t entry, const uint8_t *key, int mode);
+
+    /**
+     * Look up the schedule of a derived key.
+     *
+     * @param[in] entry
+     *              The entry.
+     * @param[in] sourceKey
+     *              The 16-byte key the cached key was derived from.
+     * @param[in] tag
+     *              What else the derivation depends on (e.g. the EID epoch).
+     * @param[in] mode
+     *              MBEDTLS_AES_ENCRYPT or MBEDTLS_AES_DECRYPT.
+     *
+     * @return The context, or NULL if the entry holds anything else (the
+     *         caller then derives the key and calls store()).
+     */
+    Aes128Context *find(uint8_t entry, const uint8_t *sourceKey, uint32_t tag, int mode);
+
+    /**
+     * Expand a derived key into an entry.
+     *
+     * @param[in] entry
+     *              The entry.
+     * @param[in] sourceKey
+     *              The 16-byte key @p key was derived from.
+     * @param[in] tag
+     *              What else the derivation depends on.
+     * @param[in] key
+     *              The 16-byte derived key to expand.
+     * @param[in] mode
+     *              MBEDTLS_AES_ENCRYPT or MBEDTLS_AES_DECRYPT.
+     *
+     * @return The context, or NULL if @p entry is out of range.
+     */
+    Aes128Context *store(uint8_t entry, const uint8_t *sourceKey, uint32_t tag, const uint8_t *key, int mode);
+
+    /**
+     * Invalidate an entry and wipe its key material.
+     *
+     * @param[in] entry
+     *              The entry to invalidate.
+     */
+    void invalidate(uint8_t entry);
+
+    /**
+     * Invalidate every entry.
+     */
+    void invalidateAll(void);
+
+    /**
+     * Get the number of key expansions performed so far (cache misses).
+     */
+    uint32_t getKeyExpansions(void) const;
+
+private:
+    struct Entry {
+        Aes128Context       ctx;
+        uint8_t             sourceKey[sizeof(EidIdentityKey_t)];
+        uint32_t            tag;
+        int                 mode;
+        bool                valid;
+    };
+
+    Entry       entries[NUM_ENTRIES];
+    uint32_t    keyExpansions;
+};
+
+#endif  /* __AESKEYCACHE_H__ */
@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) 2006-2016 Google Inc, All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+#include "DrbgService.h"
+#include "EntropySource/EntropySource.h"
+
+/* Personalization string, so this DRBG instance never shares a state with another user of the entropy source */
+static const unsigned char drbgPersonalization[] = "EddystoneDrbg";
+
+DrbgService::DrbgService(void) :
+    sourceRegistered(false),
+    seeded(false),
+    poolLevel(0)
+{
+    mbedtls_entropy_init(&entropy);
+    mbedtls_ctr_drbg_init(&ctrDrbg);
+    memset(pool, 0, sizeof(pool));
+}
+
+DrbgService::~DrbgService(void)
+{
+    mbedtls_ctr_drbg_free(&ctrDrbg);
+    mbedtls_entropy_free(&entropy);
+    memset(pool, 0, sizeof(pool));
+}
+
+int DrbgService::ensureSeeded(void)
+{
+    if (seeded) {
+        return 0;
+    }
+    if (!sourceRegistered) {
+        /* Not in the constructor: a static instance is built before the SoftDevice is enabled */
+        int ret = eddystoneRegisterEntropySource(&entropy);
+        if (ret != 0) {
+            return ret;
+        }
+        sourceRegistered = true;
+    }
+    int ret = mbedtls_ctr_drbg_seed(&ctrDrbg, mbedtls_entropy_func, &entropy,
+                                    drbgPersonalization, sizeof(drbgPersonalization) - 1);
+    if (ret != 0) {
+        return ret;
+    }
+    mbedtls_ctr_drbg_set_reseed_interval(&ctrDrbg, EDDYSTONE_DRBG_RESEED_INTERVAL);
+    seeded = true;
+    return 0;
+}
+
+int DrbgService::random(uint8_t *output, size_t len)
+{
+    if (len <= poolLevel) {
+        /* Take the bytes from the end of the valid part and wipe them */
+        poolLevel -= len;
+        memcpy(output, pool + poolLevel, len);
+        memset(pool + poolLevel, 0, len);
+        return 0;
+    }
+    int ret = ensureSeeded();
+    if (ret != 0) {
+        return ret;
+    }
+    return mbedtls_ctr_drbg_random(&ctrDrbg, output, len);
+}
+
+int DrbgService::refill(void)
+{
+    if (poolLevel == sizeof(pool)) {
+        return 0;
+    }
+    int ret = ensureSeeded();
+    if (ret != 0) {
+        return ret;
+    }
+    ret = mbedtls_ctr_drbg_random(&ctrDrbg, pool + poolLevel, sizeof(pool) - poolLevel);
+    if (ret == 0) {
+        poolLevel = sizeof(pool);
+    }
+    return ret;
+}
+
+bool DrbgService::isPoolLow(void) const
+{
+    return poolLevel < sizeof(pool) / 2;
+}
+
+int DrbgService::reseed(void)
+{
+    memset(pool, 0, sizeof(pool));
+    poolLevel = 0;
+    if (!seeded) {
+        return ensureSeeded();
+    }
+    return mbedtls_ctr_drbg_reseed(&ctrDrbg, NULL, 0);
+}
+
+int DrbgService::mbedtlsRandom(void *drbg, unsigned char *output, size_t len)
+{
+    DrbgService *self = static_cast<DrbgService *>(drbg);
+    int ret = self->ensureSeeded();
+    if (ret != 0) {
+        return ret;
+    }
+    return mbedtls_ctr_drbg_random(&self->ctrDrbg, output, len);
+}
@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) 2006-2016 Google Inc, All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __DRBGSERVICE_H__
+#define __DRBGSERVICE_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include "mbedtls/entropy.h"
+#include "mbedtls/ctr_drbg.h"
+#include "Eddystone_config.h"
+
+/**
+ * Class that owns the beacon's CTR_DRBG. It is seeded from the hardware
+ * entropy source on first use and then reseeded every
+ * EDDYSTONE_DRBG_RESEED_INTERVAL requests, instead of setting up an
+ * entropy context and running a full seed for every random request.
+ *
+ * It also keeps a pool of EDDYSTONE_RANDOM_POOL_SIZE pre-generated bytes,
+ * so the small requests made while beaconing (MAC address, ETLM salt,
+ * unlock challenge) are served by a copy; refill() tops the pool up and is
+ * meant to be called when the beacon is otherwise idle.
+ */
+class DrbgService
+{
+public:
+    /**
+     * Construct a new instance of this class. Registering the entropy
+     * source and seeding are deferred to the first request, as the source
+     * may need the BLE stack to be initialised.
+     */
+    DrbgService(void);
+
+    /**
+     * Free the contexts and wipe the pool.
+     */
+    ~DrbgService(void);
+
+    /**
+     * Get random bytes, from the pool when it holds enough of them and
+     * from the DRBG otherwise.
+     *
+     * @param[out] output
+     *              Where to store the random bytes.
+     * @param[in] len
+     *              The number of bytes.
+     *
+     * @return 0 on success, an mbedtls error code otherwise.
+     */
+    int random(uint8_t *output, size_t len);
+
+    /**
+     * Top the pool up.
+     *
+     * @return 0 on success, an mbedtls error code otherwise.
+     */
+    int refill(void);
+
+    /**
+     * Test whether the pool is less than half full.
+     */
+    bool isPoolLow(void) const;
+
+    /**
+     * Force a reseed from the entropy source (e.g. before generating long
+     * term keys). Also drops the pool.
+     *
+     * @return 0 on success, an mbedtls error code otherwise.
+     */
+    int reseed(void);
+
+    /**
+     * Random callback with the mbedtls f_rng signature, to pass to mbedtls
+     * functions with a DrbgService instance as p_rng. Bypasses the pool.
+     */
+    static int mbedtlsRandom(void *drbg, unsigned char *output, size_t len);
+
+private:
+    /**
+     * Seed the DRBG if it was not seeded yet.
+     */
+    int ensureSeeded(void);
+
+    mbedtls_entropy_context     entropy;
+    mbedtls_ctr_drbg_context    ctrDrbg;
+    bool                        sourceRegistered;
+    bool                        seeded;
+
+    /**
+     * The pool holds poolLevel valid bytes at its start.
+     */
+    uint8_t                     pool[EDDYSTONE_RANDOM_POOL_SIZE];
+    size_t                      poolLevel;
+};
+
+#endif  /* __DRBGSERVICE_H__ */
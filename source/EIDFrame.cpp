@@ -17,15 +17,12 @@
 
 #include "EIDFrame.h"
 #include "EddystoneService.h"
-#include "EntropySource/EntropySource.h"
+#include "DrbgService.h"
+#include "x25519.h"
+#include "hkdf_sha256.h"
 
 EIDFrame::EIDFrame()
 {
-    mbedtls_entropy_init(&entropy);
-    // init entropy source
-    eddystoneRegisterEntropySource(&entropy);
-    // init Random
-    mbedtls_ctr_drbg_init(&ctr_drbg);
 }
 
 void EIDFrame::clearFrame(uint8_t* frame) {
@@ -82,19 +79,43 @@ void EIDFrame::setAdvTxPower(uint8_t* rawFrame, int8_t advTxPower)
 
 // Mote: This is only called after the rotation period is due, or on writing/creating a new eidIdentityKey
 void EIDFrame::update(uint8_t* rawFrame, uint8_t* eidIdentityKey, uint8_t rotationPeriodExp,  uint32_t timeSecs)
-{  
-    // Calculate the temporary key datastructure 1
-    uint8_t ts[4]; // big endian representation of time
+{
+    Aes128Context ctx;
+    Aes128Backend::init(&ctx);
+    Aes128Backend::setKeyEnc(&ctx, eidIdentityKey);
+    update(rawFrame, &ctx, rotationPeriodExp, timeSecs);
+    Aes128Backend::free(&ctx);
+}
+
+void EIDFrame::update(uint8_t* rawFrame, const Aes128Context* eidIdentityKeyCtx, uint8_t rotationPeriodExp,  uint32_t timeSecs)
+{
+    uint8_t tmpKey[16];
+    genTemporaryKey(eidIdentityKeyCtx, timeSecs, tmpKey);
+    Aes128Context tmpKeyCtx;
+    Aes128Backend::init(&tmpKeyCtx);
+    Aes128Backend::setKeyEnc(&tmpKeyCtx, tmpKey);
+    updateFromTemporaryKey(rawFrame, &tmpKeyCtx, rotationPeriodExp, timeSecs);
+    Aes128Backend::free(&tmpKeyCtx);
+    memset(tmpKey, 0, sizeof(tmpKey));
+}
+
+void EIDFrame::genTemporaryKey(const Aes128Context* eidIdentityKeyCtx, uint32_t timeSecs, uint8_t* tmpKey)
+{
+    // Calculate the temporary key datastructure 1: only the top 16 bits of the time are used
+    uint8_t ts[2];
     ts[0] = (timeSecs  >> 24) & 0xff;
     ts[1] = (timeSecs >> 16) & 0xff;
 
     uint8_t tmpEidDS1[16] = { 0,0,0,0,0,0,0,0,0,0,0, SALT, 0, 0, ts[0], ts[1] };
     
     // Perform the aes encryption to generate the final temporary key.
-    uint8_t tmpKey[16];
-    aes128Encrypt(eidIdentityKey, tmpEidDS1, tmpKey);
-    
+    Aes128Backend::encrypt(eidIdentityKeyCtx, tmpEidDS1, tmpKey);
+}
+
+void EIDFrame::updateFromTemporaryKey(uint8_t* rawFrame, const Aes128Context* tmpKeyCtx, uint8_t rotationPeriodExp,  uint32_t timeSecs)
+{
     // Compute the EID 
+    uint8_t ts[4]; // big endian representation of time
     uint8_t eid[16];
     uint32_t scaledTime = (timeSecs >> rotationPeriodExp) << rotationPeriodExp;
     ts[0] = (scaledTime  >> 24) & 0xff;
@@ -102,73 +123,53 @@ void EIDFrame::update(uint8_t* rawFrame, uint8_t* eidIdentityKey, uint8_t rotati
     ts[2] = (scaledTime >> 8) & 0xff;
     ts[3] = scaledTime & 0xff;
     uint8_t tmpEidDS2[16] = { 0,0,0,0,0,0,0,0,0,0,0, rotationPeriodExp, ts[0], ts[1], ts[2], ts[3] };
-    aes128Encrypt(tmpKey, tmpEidDS2, eid);
+    Aes128Backend::encrypt(tmpKeyCtx, tmpEidDS2, eid);
     
     // copy the leading 8 bytes of the eid result (full result length = 16) into the ADV frame
     memcpy(rawFrame + 5, eid, EID_LENGTH); 
     
 }
 
-/** AES128 encrypts a 16-byte input array with a key, resulting in a 16-byte output array */
-void EIDFrame::aes128Encrypt(uint8_t key[], uint8_t input[], uint8_t output[]) {
-    mbedtls_aes_context ctx;
-    mbedtls_aes_init(&ctx); 
-    mbedtls_aes_setkey_enc(&ctx, key, 8 * sizeof(Lock_t));
-    mbedtls_aes_crypt_ecb(&ctx, MBEDTLS_AES_ENCRYPT, input, output);
-    mbedtls_aes_free(&ctx);
-}
-
 int EIDFrame::genBeaconKeys(PrivateEcdhKey_t beaconPrivateEcdhKey, PublicEcdhKey_t beaconPublicEcdhKey) {
-    mbedtls_ecdh_init( &ecdh_ctx );
-    
-    int i = mbedtls_ctr_drbg_seed(&ctr_drbg, mbedtls_entropy_func, &entropy, NULL, 0);
+    // Fresh entropy for the long term beacon key
+    int i = EddystoneService::drbg.reseed();
     if (i != 0) {
         return i; // return EID_RND_FAIL;
     }
- 
-    if (mbedtls_ecp_group_load(&ecdh_ctx.grp, MBEDTLS_ECP_DP_CURVE25519) != 0) {
-        return EID_GRP_FAIL;
-    }
-    if (mbedtls_ecdh_gen_public(&ecdh_ctx.grp, &ecdh_ctx.d, &ecdh_ctx.Q, mbedtls_ctr_drbg_random, &ctr_drbg) != 0) {
-        return EID_GENKEY_FAIL;
+
+    uint8_t scalar[32];
+    uint8_t publicKey[32];
+    if (DrbgService::mbedtlsRandom(&EddystoneService::drbg, scalar, sizeof(scalar)) != 0) {
+        return EID_RND_FAIL;
     }
-    
-    mbedtls_mpi_write_binary(&ecdh_ctx.d, beaconPrivateEcdhKey, sizeof(PrivateEcdhKey_t));
-    mbedtls_mpi_write_binary(&ecdh_ctx.Q.X, beaconPublicEcdhKey, sizeof(PublicEcdhKey_t));
-    
-    mbedtls_ecdh_free( &ecdh_ctx );
+    // Clamp the scalar (RFC 7748), so the stored private key is the one actually used
+    scalar[0] &= 248;
+    scalar[31] &= 127;
+    scalar[31] |= 64;
+    eddy_x25519_base(publicKey, scalar);
+
+    // The keys are kept Big Endian, as they were with the mbedtls bignum implementation
+    EddystoneService::swapEndianArray(scalar, beaconPrivateEcdhKey, sizeof(PrivateEcdhKey_t));
+    EddystoneService::swapEndianArray(publicKey, beaconPublicEcdhKey, sizeof(PublicEcdhKey_t));
+    memset(scalar, 0, sizeof(scalar));
     return EID_SUCCESS;
 }
 
 int EIDFrame::genEcdhSharedKey(PrivateEcdhKey_t beaconPrivateEcdhKey, PublicEcdhKey_t beaconPublicEcdhKey, PublicEcdhKey_t serverPublicEcdhKey, EidIdentityKey_t eidIdentityKey) {
-  int16_t ret = 0;
+  int ret = 0;
   uint8_t tmp[32];
-  // initialize context
-  mbedtls_ecdh_init( &ecdh_ctx );
-  mbedtls_ecp_group_load( &ecdh_ctx.grp, MBEDTLS_ECP_DP_CURVE25519 );
-
-  // copy binary beacon private key (previously generated!) into context 
-  // Note: As the PrivateKey is generated locally, it is Big Endian
-  ret = mbedtls_mpi_read_binary( &ecdh_ctx.d, beaconPrivateEcdhKey, sizeof(PrivateEcdhKey_t) );
-  
-  // copy server-public-key (received through GATT characteristic 10) into context
-  ret = mbedtls_mpi_lset( &ecdh_ctx.Qp.Z, 1 );
-  EddystoneService::swapEndianArray(serverPublicEcdhKey, tmp, 32); // To make it Big Endian
-  ret = mbedtls_mpi_read_binary( &ecdh_ctx.Qp.X, tmp , sizeof(PublicEcdhKey_t) ); 
-
-  // ECDH point multiplication
-  size_t olen; // actual size of shared secret 
+
+  // Note: As the PrivateKey is generated locally, it is Big Endian; X25519 works Little Endian
+  uint8_t scalar[32];
+  EddystoneService::swapEndianArray(beaconPrivateEcdhKey, scalar, sizeof(PrivateEcdhKey_t));
+
+  // ECDH: the server-public-key (received through GATT characteristic 10) is already Little Endian
   uint8_t sharedSecret[32]; // shared ECDH secret
-  memset(sharedSecret, 0, 32);
-  ret = mbedtls_ecdh_calc_secret( &ecdh_ctx, &olen, sharedSecret, sizeof(sharedSecret), NULL, NULL );
-  LOG(("size of olen= %d  ret=%x\r\n", olen, ret));
-  EddystoneService::swapEndianArray(sharedSecret, tmp, 32);
-  memcpy(sharedSecret, tmp, 32);
+  ret = eddy_x25519(sharedSecret, scalar, serverPublicEcdhKey);
+  memset(scalar, 0, sizeof(scalar));
+  LOG(("X25519 ret=%x\r\n", ret));
   LOG(("Shared secret=")); EddystoneService::logPrintHex(sharedSecret, 32);
-  if (olen != sizeof(sharedSecret)) {
-      return EID_GENKEY_FAIL;
-  }
-  if (ret == MBEDTLS_ERR_ECP_BAD_INPUT_DATA) {
+  if (ret == EDDY_ERR_X25519_ZERO_SECRET) {
       return EID_RC_SS_IS_ZERO;
   }
 
@@ -183,24 +184,15 @@ int EIDFrame::genEcdhSharedKey(PrivateEcdhKey_t beaconPrivateEcdhKey, PublicEcdh
   memcpy( &k[32], tmp, sizeof(PublicEcdhKey_t) );
 
   // compute HKDF: see https://tools.ietf.org/html/rfc5869
-  // mbedtls_md_context_t md_ctx;
-  mbedtls_md_init( &md_ctx );
-  mbedtls_md_setup( &md_ctx, mbedtls_md_info_from_type( MBEDTLS_MD_SHA256 ), 1 );
-  mbedtls_md_hmac_starts( &md_ctx, k, sizeof( k ) );
-  mbedtls_md_hmac_update( &md_ctx, sharedSecret, sizeof(sharedSecret) );
-  unsigned char prk[ 32 ];
-  mbedtls_md_hmac_finish( &md_ctx, prk );
-  mbedtls_md_hmac_starts( &md_ctx, prk, sizeof( prk ) );
-  const unsigned char const1[] = { 0x01 };
-  mbedtls_md_hmac_update( &md_ctx, const1, sizeof( const1 ) );
+  // T(1) = HMAC(PRK, 0x01) is 32 bytes, the identity key is its first 16
   unsigned char t[ 32 ];
-  mbedtls_md_hmac_finish( &md_ctx, t );
+  eddy_hkdf_sha256( k, sizeof( k ), sharedSecret, sizeof( sharedSecret ), NULL, 0, t, sizeof( t ) );
+  memset( sharedSecret, 0, sizeof( sharedSecret ) );
 
   //Truncate the key material to 16 bytes (128 bits) to convert it to an AES-128 secret key.
   memcpy( eidIdentityKey, t, sizeof(EidIdentityKey_t) );
   LOG(("\r\nEIDIdentityKey=")); EddystoneService::logPrintHex(t, 32); LOG(("\r\n"));
+  memset( t, 0, sizeof( t ) );
 
-  mbedtls_md_free( &md_ctx );
-  mbedtls_ecdh_free( &ecdh_ctx );
   return EID_SUCCESS;
 }
@@ -20,11 +20,7 @@
 
 #include <string.h>
 #include "EddystoneTypes.h"
-#include "mbedtls/aes.h"
-#include "mbedtls/ecdh.h"
-#include "mbedtls/md.h"
-#include "mbedtls/entropy.h"
-#include "mbedtls/ctr_drbg.h"
+#include "Aes128Backend.h"
 #include "aes_eax.h"
 
 /**
@@ -165,6 +161,52 @@ public:
      *
      */
     void update(uint8_t* rawFrame, uint8_t* eidIdentityKey, uint8_t rotationPeriodExp,  uint32_t timeSecs);
+
+    /**
+     * Update the EID frame, with the identity key already expanded (see AesKeyCache).
+     * Saves the key expansion of the identity key on every rotation.
+     *
+     * @param[in] *rawFrame
+     *              Pointer to the location where the raw frame will be stored.
+     * @param[in] *eidIdentityKeyCtx
+     *              AES context with the Eid identity key set for encryption.
+     * @param[in] rotationPeriodExp
+     *              EID rotation time as an exponent k : 2^k seconds
+     * @param[in] timeSecs
+     *              time in seconds
+     *
+     */
+    void update(uint8_t* rawFrame, const Aes128Context* eidIdentityKeyCtx, uint8_t rotationPeriodExp,  uint32_t timeSecs);
+
+    /**
+     * Derive the EID temporary key. It only depends on the identity key and
+     * the top 16 bits of the time, so it can be kept for a whole 2^16 second
+     * epoch (see updateFromTemporaryKey()).
+     *
+     * @param[in] *eidIdentityKeyCtx
+     *              AES context with the Eid identity key set for encryption.
+     * @param[in] timeSecs
+     *              time in seconds
+     * @param[out] *tmpKey
+     *              The 16-byte temporary key.
+     */
+    void genTemporaryKey(const Aes128Context* eidIdentityKeyCtx, uint32_t timeSecs, uint8_t* tmpKey);
+
+    /**
+     * Update the EID frame from the expanded temporary key of the current
+     * epoch: a single AES block per rotation.
+     *
+     * @param[in] *rawFrame
+     *              Pointer to the location where the raw frame will be stored.
+     * @param[in] *tmpKeyCtx
+     *              AES context with the temporary key of the epoch of
+     *              @p timeSecs set for encryption (see genTemporaryKey()).
+     * @param[in] rotationPeriodExp
+     *              EID rotation time as an exponent k : 2^k seconds
+     * @param[in] timeSecs
+     *              time in seconds
+     */
+    void updateFromTemporaryKey(uint8_t* rawFrame, const Aes128Context* tmpKeyCtx, uint8_t rotationPeriodExp,  uint32_t timeSecs);
     
     /**
      * genEcdhSharedKey generates the eik value for inclusion in the EID ADV packet
@@ -186,12 +228,6 @@ public:
     static const uint8_t FRAME_TYPE_EID = 0x30;
 
 private:
-    
-    // Declare context for crypto functions
-    mbedtls_entropy_context entropy;
-    mbedtls_ctr_drbg_context ctr_drbg;
-    mbedtls_ecdh_context ecdh_ctx;
-    mbedtls_md_context_t md_ctx;
 
     /**
      * The size (in bytes) of an Eddystone-EID frame.
@@ -206,18 +242,6 @@ private:
     static const uint8_t EID_VALUE_OFFSET = 5;
     static const uint8_t EID_HEADER_LEN = 4;
     static const uint8_t EID_TXPOWER_OFFSET = 4;
-    
-    /**
-     * AES128 ECB Encrypts a 16-byte input array with a key, to an output array
-     *
-     * @param[in] *key
-     *              The encryption key
-     * @param[in] *input
-     *              The input array
-     * @param[in] *output
-     *              The output array (contains the encrypted data)
-     */
-    void aes128Encrypt(uint8_t *key, uint8_t *input, uint8_t *output);
  
 };
 
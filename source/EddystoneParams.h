@@ -0,0 +1,169 @@
+/*
+ * Copyright (c) 2016, Google Inc, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __EDDYSTONEPARAMS_H__
+#define __EDDYSTONEPARAMS_H__
+
+#include <stdint.h>
+#include "EddystoneTypes.h"
+
+/*
+ * The persistent configuration of EddystoneService. It only depends on
+ * EddystoneTypes.h, so that the host tools can build the same flash image
+ * (tools/FactoryImage).
+ */
+
+/**
+ * Scope of the frame types of the slots (slotFrameTypes), so that they are
+ * not in the global namespace. EddystoneService re-exports them.
+ */
+struct EddystoneFrameTypes {
+    /**
+     * Enumeration that defines the available frame types within Eddystone
+     * advertising packets.
+     */
+    enum FrameType {
+        /**
+         * The Eddystone-UID frame. Refer to
+         * https://github.com/google/eddystone/tree/master/eddystone-uid.
+         */
+        EDDYSTONE_FRAME_UID,
+        /**
+         * The Eddystone-URL frame. Refer to
+         * https://github.com/google/eddystone/tree/master/eddystone-url.
+         */
+        EDDYSTONE_FRAME_URL,
+        /**
+         * The Eddystone-TLM frame. Refer to
+         * https://github.com/google/eddystone/tree/master/eddystone-tlm.
+         */
+        EDDYSTONE_FRAME_TLM,
+        /**
+         * The Eddystone-EID frame. Refer to
+         * https://github.com/google/eddystone/tree/master/eddystone-eid.
+         */
+        EDDYSTONE_FRAME_EID,
+        /**
+         * The total number Eddystone frame types.
+         */
+        NUM_EDDYSTONE_FRAMES
+    };
+};
+
+/**
+ * Structure that encapsulates the Eddystone configuration parameters. This
+ * structure is particularly useful when storing the parameters to
+ * persistent storage.
+ */
+struct EddystoneParams_t {
+    /**
+     * 
+     */
+    TimeParams_t            timeParams;
+    /**
+     * A buffer describing the capabilities of the beacon
+     */
+    Capability_t            capabilities;
+
+     /**
+     * Defines the slot that advInterval, radioPower, advPower, advSlotData operate on
+     */
+    uint8_t                 activeSlot;
+
+    /**
+     * The Beacon interval for each beacon slot
+     *
+     * @note A value of zero disables Eddystone-URL frame trasmissions.
+     */
+    SlotAdvIntervals_t      slotAdvIntervals;
+
+     /**
+     * The Radio TX Powers supported by this beacon
+     */
+    PowerLevels_t           radioTxPowerLevels;
+
+     /**
+     * The Radio TX Power set for each slot
+     */
+    SlotTxPowerLevels_t     slotRadioTxPowerLevels;
+
+    /**
+     * The Calibrated Adv TX Powers supported by this beacon (one for each radio power)
+     */
+    PowerLevels_t           advTxPowerLevels;
+
+    /**
+     * The Adv TX Power set for each slot
+     */
+    SlotTxPowerLevels_t     slotAdvTxPowerLevels;
+
+    /**
+     * The value of the Eddystone-URL Configuration Service Lock State
+     * characteristic.
+     */
+    uint8_t                 lockState;
+
+    /**
+     * The value of the Eddystone-URL Configuration Service Unlock
+     * characteristic that can be used to unlock the beacon and clear the
+     * single-use lock-code.
+     */
+    Lock_t                  unlockToken;
+
+    /**
+     * An array holding the 128-bit unlockKey (big endian)
+     */
+    Lock_t                  unlockKey;
+
+    /**
+     * An array holding the 128-bit challenge (big endian) in the
+     * challenge/response unlock protocol
+     */
+    Lock_t                  challenge;
+
+    /**
+     * EID: An array holding the slot rotation period exponents
+     */
+    SlotEidRotationPeriodExps_t     slotEidRotationPeriodExps;
+
+    /**
+     * EID: An array holding the slot 128-bit EID Identity Key (big endian)
+     */
+    SlotEidIdentityKeys_t           slotEidIdentityKeys;
+
+    /**
+     * Specifies the type of each frame indexed by slot
+     */
+    SlotFrameTypes_t    slotFrameTypes;
+
+    /**
+     * A buffer that contains all slot frames, 32-bytes allocated to each frame
+     */
+    SlotStorage_t       slotStorage;
+
+     /**
+     * The state of the recently invoked Factory Reset characteristic
+     */
+    uint8_t          factoryReset;
+
+    /**
+     * The state of the recently invoked Remain Connectable characteristic
+     */
+    uint8_t          remainConnectable;
+};
+
+#endif  /* __EDDYSTONEPARAMS_H__ */
@@ -15,17 +15,45 @@
  */
 
 #include "EddystoneService.h"
+#include "x25519.h"
+#include "hkdf_sha256.h"
 #include "PersistentStorageHelper/ConfigParamsPersistence.h"
-#include "EntropySource/EntropySource.h"
+#include "AdvertisingSets/AdvertisingSets.h"
+#include "AdvScheduling.h"
+#include "EidRotation.h"
+#ifdef CRYPTO_BENCHMARK
+#include "crypto_selftest.h"
+#include "mbed_stats.h"
+#endif
 
 /* Use define zero for production, 1 for testing to allow connection at any time */
 #define DEFAULT_REMAIN_CONNECTABLE 0x01
 
+#ifdef EDDYSTONE_CONSTEXPR_URL
+/* The default slot URLs and the config URL, encoded at compile time */
+static constexpr const char *slotDefaultUrls[] = EDDYSTONE_DEFAULT_SLOT_URLS;
+static_assert(sizeof(slotDefaultUrls) / sizeof(slotDefaultUrls[0]) == MAX_ADV_SLOTS,
+              "EDDYSTONE_DEFAULT_SLOT_URLS needs one URL per slot");
+static_assert(eddystoneUrlsFit(slotDefaultUrls), "A default slot URL does not fit an Eddystone-URL frame");
+static constexpr EncodedUrls_t<MAX_ADV_SLOTS> slotDefaultEncodedUrls = eddystoneEncodeUrls(slotDefaultUrls);
+#ifdef INCLUDE_CONFIG_URL
+static_assert(eddystoneUrlFits(EDDYSTONE_CONFIG_URL), "EDDYSTONE_CONFIG_URL does not fit an Eddystone-URL frame");
+static constexpr EncodedUrl_t configEncodedUrl = eddystoneEncodeUrl(EDDYSTONE_CONFIG_URL);
+#endif
+#else
 const char * const EddystoneService::slotDefaultUrls[] = EDDYSTONE_DEFAULT_SLOT_URLS;
+#endif
+
+/* Battery steps of the advertising interval policy */
+static const uint16_t advIntervalBatteryLevelsMv[] = EDDYSTONE_ADV_INTERVAL_BATTERY_LEVELS_MV;
+static const uint16_t advIntervalBatteryScales[]   = EDDYSTONE_ADV_INTERVAL_BATTERY_SCALES;
 
 // Static timer used as time since boot
 Timer           EddystoneService::timeSinceBootTimer;
 
+// Static random generator
+DrbgService     EddystoneService::drbg;
+
 /*
  * CONSTRUCTOR #1 Used on 1st boot (after reflash)
  */
@@ -36,13 +64,27 @@ EddystoneService::EddystoneService(BLE                 &bleIn,
                                    uint32_t            advConfigIntervalIn) :
     ble(bleIn),
     operationMode(EDDYSTONE_MODE_NONE),
+    beaconKeysReady(false),
+    etlmEaxValid(false),
     uidFrame(),
     urlFrame(),
     tlmFrame(),
     eidFrame(),
     tlmBatteryVoltageCallback(NULL),
     tlmBeaconTemperatureCallback(NULL),
+    advIntervalPolicy(advIntervalBatteryLevelsMv, advIntervalBatteryScales,
+                      sizeof(advIntervalBatteryLevelsMv) / sizeof(advIntervalBatteryLevelsMv[0]),
+                      EDDYSTONE_ADV_INTERVAL_BATTERY_HYSTERESIS_MV,
+                      EDDYSTONE_ADV_INTERVAL_ACTIVITY_SCALE, EDDYSTONE_ADV_INTERVAL_ACTIVITY_MS),
+    batterySampleCallbackHandle(NULL),
+    advJitterState(0),
     radioManagerCallbackHandle(NULL),
+    randomPoolRefillHandle(NULL),
+    unlockChallengeHandle(NULL),
+    beaconKeyGenHandle(NULL),
+    advSetsActive(false),
+    advSetsStartTimeMs(0),
+    advSetsPduCount(0),
     deviceName(DEFAULT_DEVICE_NAME),
     eventQueue(evQ),
     nextEidSlot(0)
@@ -63,9 +105,15 @@ EddystoneService::EddystoneService(BLE                 &bleIn,
 
     // 1st Boot so reset everything to factory values
     LOG(("1st BOOT: "));
-    doFactoryReset();  // includes genBeaconKeys
-    
-    LOG(("After FactoryReset: 1st Boot Init: genBeaconKeyRC=%d\r\n", genBeaconKeyRC));
+    doFactoryReset();  // includes genBeaconKeys (posted)
+
+    resetSlotStats();
+    memset(&radioShadow, 0, sizeof(radioShadow));
+    memset(&eidRotationStats, 0, sizeof(eidRotationStats));
+
+#ifdef CRYPTO_BENCHMARK
+    eventQueue.post(&EddystoneService::runCryptoBenchmark, this);
+#endif
 
     /* Set the device name at startup */
     ble.gap().setDeviceName(reinterpret_cast<const uint8_t *>(deviceName));
@@ -81,13 +129,27 @@ EddystoneService::EddystoneService(BLE                 &bleIn,
                                    uint32_t            advConfigIntervalIn) :
     ble(bleIn),
     operationMode(EDDYSTONE_MODE_NONE),
+    beaconKeysReady(false),
+    etlmEaxValid(false),
     uidFrame(),
     urlFrame(),
     tlmFrame(),
     eidFrame(),
     tlmBatteryVoltageCallback(NULL),
     tlmBeaconTemperatureCallback(NULL),
+    advIntervalPolicy(advIntervalBatteryLevelsMv, advIntervalBatteryScales,
+                      sizeof(advIntervalBatteryLevelsMv) / sizeof(advIntervalBatteryLevelsMv[0]),
+                      EDDYSTONE_ADV_INTERVAL_BATTERY_HYSTERESIS_MV,
+                      EDDYSTONE_ADV_INTERVAL_ACTIVITY_SCALE, EDDYSTONE_ADV_INTERVAL_ACTIVITY_MS),
+    batterySampleCallbackHandle(NULL),
+    advJitterState(0),
     radioManagerCallbackHandle(NULL),
+    randomPoolRefillHandle(NULL),
+    unlockChallengeHandle(NULL),
+    beaconKeyGenHandle(NULL),
+    advSetsActive(false),
+    advSetsStartTimeMs(0),
+    advSetsPduCount(0),
     deviceName(DEFAULT_DEVICE_NAME),
     eventQueue(evQ),
     nextEidSlot(0)
@@ -115,6 +177,7 @@ EddystoneService::EddystoneService(BLE                 &bleIn,
     lockState           = paramsIn.lockState;
     memcpy(unlockKey,   paramsIn.unlockKey,   sizeof(Lock_t));
     memcpy(unlockToken, paramsIn.unlockToken, sizeof(Lock_t));
+    unlockTokenValid = true;
     memcpy(challenge, paramsIn.challenge, sizeof(Lock_t));
     memset(slotCallbackHandles, 0, sizeof(SlotCallbackHandles_t));
     memcpy(slotStorage, paramsIn.slotStorage, sizeof(SlotStorage_t));
@@ -123,6 +186,7 @@ EddystoneService::EddystoneService(BLE                 &bleIn,
     memcpy(slotEidIdentityKeys, paramsIn.slotEidIdentityKeys, sizeof(SlotEidIdentityKeys_t));
     // Zero next EID slot rotation times to enforce rotation of each slot on restart
     memset(slotEidNextRotationTimes, 0, sizeof(SlotEidNextRotationTimes_t)); 
+    slotEidPayloadsPending = 0;
     remainConnectable   = paramsIn.remainConnectable;
 
     if (advConfigIntervalIn != 0) {
@@ -135,7 +199,7 @@ EddystoneService::EddystoneService(BLE                 &bleIn,
         }
     }
     
-    // Generate fresh private and public ECDH keys for EID
+    // Generate fresh private and public ECDH keys for EID (posted)
     genEIDBeaconKeys();
 
     // Recompute EID Slot Data
@@ -145,11 +209,19 @@ EddystoneService::EddystoneService(BLE                 &bleIn,
             case EDDYSTONE_FRAME_EID:
                nextEidSlot = slot;
                eidFrame.setData(frame, slotAdvTxPowerLevels[slot], nullEid);
-               eidFrame.update(frame, slotEidIdentityKeys[slot], slotEidRotationPeriodExps[slot], getTimeSinceFirstBootSecs());
+               updateEidFrame(slot, frame, getTimeSinceFirstBootSecs());
                break;
         }
     }
     
+    resetSlotStats();
+    memset(&radioShadow, 0, sizeof(radioShadow));
+    memset(&eidRotationStats, 0, sizeof(eidRotationStats));
+
+#ifdef CRYPTO_BENCHMARK
+    eventQueue.post(&EddystoneService::runCryptoBenchmark, this);
+#endif
+
     /* Set the device name at startup */
     ble.gap().setDeviceName(reinterpret_cast<const uint8_t *>(deviceName));
 }
@@ -157,14 +229,41 @@ EddystoneService::EddystoneService(BLE                 &bleIn,
 // Regenerate the beacon keys
 void EddystoneService::genEIDBeaconKeys(void) {
     genBeaconKeyRC = -1;
+    beaconKeysReady = false;
+    memset(privateEcdhKey, 0, sizeof(PrivateEcdhKey_t));
+    memset(publicEcdhKey, 0, sizeof(PublicEcdhKey_t));
+    memset(publicEcdhKeyLE, 0, sizeof(PublicEcdhKey_t));
+    // The keys are only needed once a resolver registers the beacon, so the
+    // generation must not hold up the first advertisement
+    if (beaconKeyGenHandle == NULL) {
+        beaconKeyGenHandle = eventQueue.post(&EddystoneService::genEIDBeaconKeysTask, this);
+    }
+}
+
+void EddystoneService::genEIDBeaconKeysTask(void) {
+    beaconKeyGenHandle = NULL;
+    if (beaconKeysReady) {
+        return;
+    }
 #ifdef GEN_BEACON_KEYS_AT_INIT
-    memset(privateEcdhKey, 0, 32);
-    memset(publicEcdhKey, 0, 32);
+    uint32_t start = us_ticker_read();
     genBeaconKeyRC = eidFrame.genBeaconKeys(privateEcdhKey, publicEcdhKey);
-    swapEndianArray(publicEcdhKey, publicEcdhKeyLE, 32);
+    swapEndianArray(publicEcdhKey, publicEcdhKeyLE, sizeof(PublicEcdhKey_t));
+    beaconKeysReady = (genBeaconKeyRC == EIDFrame::EID_SUCCESS);
+    LOG(("genBeaconKeyRC=%d in %lu us\r\n", genBeaconKeyRC, (unsigned long)(us_ticker_read() - start)));
 #endif
 }
 
+bool EddystoneService::ensureEIDBeaconKeys(void) {
+    if (!beaconKeysReady) {
+        if (beaconKeyGenHandle != NULL) {
+            eventQueue.cancel(beaconKeyGenHandle);
+        }
+        genEIDBeaconKeysTask();
+    }
+    return beaconKeysReady;
+}
+
 /**
  * Factory reset all parmeters: used at initial boot, and activated from Char 11
  */
@@ -195,12 +294,18 @@ void EddystoneService::doFactoryReset(void)
       slotRadioTxPowerLevels[i] = buf2[i];
       slotAdvTxPowerLevels[i] = advTxPowerLevels[radioTxPowerToIndex(buf2[i])];
     }
+    // Drop the expanded keys of the previous configuration
+    aesKeyCache.invalidateAll();
+    etlmEaxValid = false;
+    memset(etlmEaxKey, 0, sizeof(EidIdentityKey_t));
     // Lock
     lockState      = UNLOCKED;
     uint8_t defKeyBuf[] = EDDYSTONE_DEFAULT_UNLOCK_KEY;
     memcpy(unlockKey,        defKeyBuf,     sizeof(Lock_t));
     memset(unlockToken,      0,     sizeof(Lock_t));
+    unlockTokenValid = true;
     memset(challenge,        0,     sizeof(Lock_t)); // NOTE: challenge is randomized on first unlockChar read;
+    unlockChallenge.invalidate();                    // The prepared token was for the previous key
 
     // Generate ECDH Beacon Key Pair (Private/Public)
     genEIDBeaconKeys();
@@ -209,6 +314,7 @@ void EddystoneService::doFactoryReset(void)
     uint8_t buf4[] = EDDYSTONE_DEFAULT_SLOT_EID_ROTATION_PERIOD_EXPS;
     memcpy(slotEidRotationPeriodExps, buf4, sizeof(SlotEidRotationPeriodExps_t));
     memset(slotEidNextRotationTimes, 0, sizeof(SlotEidNextRotationTimes_t));
+    slotEidPayloadsPending = 0;
     //  Slot Data Type Defaults
     uint8_t buf3[] = EDDYSTONE_DEFAULT_SLOT_TYPES;
     memcpy(slotFrameTypes, buf3, sizeof(SlotFrameTypes_t));
@@ -221,7 +327,12 @@ void EddystoneService::doFactoryReset(void)
                uidFrame.setData(frame, slotAdvTxPowerLevels[slot], reinterpret_cast<const uint8_t*>(slotDefaultUids[slot]));
                break;
             case EDDYSTONE_FRAME_URL:
+#ifdef EDDYSTONE_CONSTEXPR_URL
+               urlFrame.setData(frame, slotAdvTxPowerLevels[slot], slotDefaultEncodedUrls.url[slot].data,
+                                slotDefaultEncodedUrls.url[slot].length);
+#else
                urlFrame.setUnencodedUrlData(frame, slotAdvTxPowerLevels[slot], slotDefaultUrls[slot]);
+#endif
                break;
             case EDDYSTONE_FRAME_TLM:
                tlmFrame.setTLMData(TLMFrame::DEFAULT_TLM_VERSION);
@@ -229,13 +340,15 @@ void EddystoneService::doFactoryReset(void)
                eidSlot = getEidSlot();
                if (eidSlot != NO_EID_SLOT_SET) {
                    LOG(("EID slot Set in FactoryReset\r\n"));
-                   tlmFrame.encryptData(frame, slotEidIdentityKeys[eidSlot], slotEidRotationPeriodExps[eidSlot], getTimeSinceFirstBootSecs());
+                   if (tlmFrame.encryptData(frame, getSlotEaxContext(eidSlot), slotEidRotationPeriodExps[eidSlot], getTimeSinceFirstBootSecs()) != 0) {
+                       tlmFrame.clearFrame(frame); // No salt: leave the slot empty rather than send the TLM in the clear
+                   }
                }
                break;
             case EDDYSTONE_FRAME_EID:
                nextEidSlot = slot;
                eidFrame.setData(frame, slotAdvTxPowerLevels[slot], nullEid);
-               eidFrame.update(frame, slotEidIdentityKeys[slot], slotEidRotationPeriodExps[slot], getTimeSinceFirstBootSecs());
+               updateEidFrame(slot, frame, getTimeSinceFirstBootSecs());
                break;
         }
     }
@@ -281,8 +394,15 @@ EddystoneService::EddystoneError_t EddystoneService::startEddystoneBeaconAdverti
 
     operationMode = EDDYSTONE_MODE_BEACON;
 
+#ifdef USE_ADV_SETS
+    /* Let the controller interleave the slots if it can, otherwise fall back to swapping frames */
+    if (startAdvertisingSets()) {
+        return EDDYSTONE_ERROR_NONE;
+    }
+#endif
+
     /* Configure advertisements initially at power of active slot*/
-    ble.gap().setTxPower(slotRadioTxPowerLevels[activeSlot]);
+    setRadioTxPower(slotRadioTxPowerLevels[activeSlot]);
 
     if (remainConnectable) {
         ble.gap().setAdvertisingType(GapAdvertisingParams::ADV_CONNECTABLE_UNDIRECTED);
@@ -293,18 +413,46 @@ EddystoneService::EddystoneError_t EddystoneService::startEddystoneBeaconAdverti
 
     /* Make sure the queue is currently empty */
     advFrameQueue.reset();
+    /* Seed the jitter generator once, it only has to differ between beacons */
+    while (advJitterState == 0) {
+        if (generateRandom(reinterpret_cast<uint8_t *>(&advJitterState), sizeof(advJitterState)) != 0) {
+            advJitterState = getTimeSinceLastBootMs() | 1;
+        }
+    }
     /* Setup callbacks to periodically add frames to be advertised to the queue and
-     * add initial frame so that we have something to advertise on startup */
+     * add initial frame (of slots without phase offset) so that we have something
+     * to advertise on startup */
+    uint32_t nowMs = getTimeSinceLastBootMs();
     for (int slot = 0; slot < MAX_ADV_SLOTS; slot++) {
         uint8_t* frame = slotToFrame(slot);
         if (slotAdvIntervals[slot] && testValidFrame(frame)) {
-            advFrameQueue.push(slot);
-            slotCallbackHandles[slot] = eventQueue.post_every(
-                &EddystoneService::enqueueFrame, this, slot,
-                slotAdvIntervals[slot] /* ms */
-            );
+#ifdef RANDOM_ADV_OFFSETS
+            uint16_t offset = eddystoneAdvSlotOffsetMs(advJitterState, 0, slotAdvIntervals[slot], true);
+#else
+            uint16_t offset = eddystoneAdvSlotOffsetMs(advJitterState, slotDefaultAdvOffsets[slot], slotAdvIntervals[slot], false);
+#endif
+            slotNextAdvTimesMs[slot] = nowMs + offset;
+            if (offset == 0) {
+                slotFrameDueTimesMs[slot] = nowMs;
+                advFrameQueue.push(slot);
+                scheduleNextFrame(slot);
+            } else {
+                slotCallbackHandles[slot] = eventQueue.post_in(
+                    &EddystoneService::enqueueFrame, this, slot,
+                    offset /* ms */
+                );
+            }
         }
     }
+#ifdef ADAPTIVE_ADV_INTERVAL
+    /* Intervals follow the battery, the new ones are picked up as each slot reschedules */
+    sampleBatteryVoltage();
+    batterySampleCallbackHandle = eventQueue.post_every(
+        &EddystoneService::sampleBatteryVoltage, this,
+        EDDYSTONE_ADV_INTERVAL_BATTERY_SAMPLE_MS /* ms */
+    );
+#endif
+
     /* Start advertising */
     manageRadio();
 
@@ -364,40 +512,80 @@ void EddystoneService::getEddystoneParams(EddystoneParams_t &params)
 }
 
 void EddystoneService::swapAdvertisedFrame(int slot)
+{
+    size_t advFrameLength;
+    const uint8_t* advFrame = prepareAdvFrame(slot, advFrameLength);
+    /* Single slot configs and repeated UID/URL frames leave the payload unchanged */
+    if (radioShadow.payloadValid && (radioShadow.payloadLength == advFrameLength) &&
+        (memcmp(radioShadow.payload, advFrame, advFrameLength) == 0)) {
+        radioShadow.elidedPayloadUpdates++;
+    } else {
+        updateAdvertisementPacket(advFrame, advFrameLength);
+        radioShadow.payloadValid = (advFrameLength <= sizeof(radioShadow.payload));
+        if (radioShadow.payloadValid) {
+            radioShadow.payloadLength = advFrameLength;
+            memcpy(radioShadow.payload, advFrame, advFrameLength);
+        }
+    }
+    setRadioTxPower(slotRadioTxPowerLevels[slot]);
+}
+
+void EddystoneService::setRadioTxPower(int8_t radioTxPower)
+{
+    if (radioShadow.txPowerValid && (radioShadow.txPower == radioTxPower)) {
+        radioShadow.elidedTxPowerCalls++;
+        return;
+    }
+    ble.gap().setTxPower(radioTxPower);
+    radioShadow.txPower = radioTxPower;
+    radioShadow.txPowerValid = true;
+}
+
+void EddystoneService::invalidateRadioShadow(void)
+{
+    radioShadow.txPowerValid = false;
+    radioShadow.payloadValid = false;
+}
+
+uint32_t EddystoneService::getElidedRadioCallsPerHour(void)
+{
+    uint64_t elapsedMs = getTimeSinceLastBootMs() - radioShadow.countStartTimeMs;
+    if (elapsedMs == 0) {
+        return 0;
+    }
+    uint64_t elided = (uint64_t)radioShadow.elidedTxPowerCalls + radioShadow.elidedPayloadUpdates + radioShadow.elidedStopCalls;
+    return (uint32_t)(elided * 3600000 / elapsedMs);
+}
+
+const uint8_t* EddystoneService::prepareAdvFrame(int slot, size_t &advFrameLength)
 {
     uint8_t* frame = slotToFrame(slot);
     uint8_t frameType = slotFrameTypes[slot];
     uint32_t timeSecs = getTimeSinceFirstBootSecs();
     switch (frameType) {
         case EDDYSTONE_FRAME_UID:
-            updateAdvertisementPacket(uidFrame.getAdvFrame(frame), uidFrame.getAdvFrameLength(frame));
-            break;
+            advFrameLength = uidFrame.getAdvFrameLength(frame);
+            return uidFrame.getAdvFrame(frame);
         case EDDYSTONE_FRAME_URL:
-            updateAdvertisementPacket(urlFrame.getAdvFrame(frame), urlFrame.getAdvFrameLength(frame));
-            break;
+            advFrameLength = urlFrame.getAdvFrameLength(frame);
+            return urlFrame.getAdvFrame(frame);
         case EDDYSTONE_FRAME_TLM:
             updateRawTLMFrame(frame);
-            updateAdvertisementPacket(tlmFrame.getAdvFrame(frame), tlmFrame.getAdvFrameLength(frame));
-            break;
+            advFrameLength = tlmFrame.getAdvFrameLength(frame);
+            return tlmFrame.getAdvFrame(frame);
         case EDDYSTONE_FRAME_EID:
-            // only update the frame if the rotation period is due
+            // only update the frames if a rotation period is due
             if (timeSecs >= slotEidNextRotationTimes[slot]) {
-                eidFrame.update(frame, slotEidIdentityKeys[slot], slotEidRotationPeriodExps[slot], timeSecs);
-                slotEidNextRotationTimes[slot] = timeSecs + (1 << slotEidRotationPeriodExps[slot]);
-                // select a new random MAC address so the beacon is not trackable 
-                setRandomMacAddress(); 
-                // Store in NVM in case the beacon loses power
-                nvmSaveTimeParams(); 
-                LOG(("EID ROTATED: Time=%lu\r\n", timeSecs));
+                rotateEidSlots(timeSecs);
             }
-            updateAdvertisementPacket(eidFrame.getAdvFrame(frame), eidFrame.getAdvFrameLength(frame));
-            break;
+            advFrameLength = eidFrame.getAdvFrameLength(frame);
+            return eidFrame.getAdvFrame(frame);
         default:
             //Some error occurred
             error("Frame to swap in does not specify a valid type");
-            break;
+            advFrameLength = 0;
+            return frame;
     }
-    ble.gap().setTxPower(slotRadioTxPowerLevels[slot]);
 }
 
 
@@ -406,23 +594,33 @@ void EddystoneService::swapAdvertisedFrame(int slot)
  * done fairly often because the TLM frame TimeSinceBoot must have a 0.1 secs resolution according to the
  * Eddystone specification.
  */
-void EddystoneService::updateRawTLMFrame(uint8_t* frame)
+bool EddystoneService::updateRawTLMFrame(uint8_t* frame)
 {
     if (tlmBeaconTemperatureCallback != NULL) {
         tlmFrame.updateBeaconTemperature((*tlmBeaconTemperatureCallback)(tlmFrame.getBeaconTemperature()));
     }
     if (tlmBatteryVoltageCallback != NULL) {
         tlmFrame.updateBatteryVoltage((*tlmBatteryVoltageCallback)(tlmFrame.getBatteryVoltage()));
+        advIntervalPolicy.updateBatteryVoltage(tlmFrame.getBatteryVoltage());
     }
     tlmFrame.updateTimeSinceLastBoot(getTimeSinceLastBootMs());
-    tlmFrame.setData(frame);
     int slot = getEidSlot();
     LOG(("TLMHelper Method slot=%d\r\n", slot));
-    if (slot != NO_EID_SLOT_SET) {
-        LOG(("TLMHelper: Before Encrypting TLM\r\n"));
-        tlmFrame.encryptData(frame, slotEidIdentityKeys[slot], slotEidRotationPeriodExps[slot], getTimeSinceFirstBootSecs());
-        LOG(("TLMHelper: Before Encrypting TLM\r\n"));
+    if (slot == NO_EID_SLOT_SET) {
+        tlmFrame.setData(frame);
+        return true;
     }
+    LOG(("TLMHelper: Before Encrypting TLM\r\n"));
+    // Encrypt a copy: without a fresh salt the frame keeps its last ETLM, the TLM never goes out in the clear
+    uint8_t etlm[EDDYSTONE_UUID_SIZE + TLMFrame::FRAME_SIZE_ETLM + 1];
+    tlmFrame.setData(etlm);
+    if (tlmFrame.encryptData(etlm, getSlotEaxContext(slot), slotEidRotationPeriodExps[slot], getTimeSinceFirstBootSecs()) != 0) {
+        LOG(("TLMHelper: no ETLM salt, keeping the last frame\r\n"));
+        return false;
+    }
+    memcpy(frame, etlm, sizeof(etlm));
+    LOG(("TLMHelper: After Encrypting TLM\r\n"));
+    return true;
 }
 
 void EddystoneService::updateAdvertisementPacket(const uint8_t* rawFrame, size_t rawFrameLength)
@@ -433,13 +631,73 @@ void EddystoneService::updateAdvertisementPacket(const uint8_t* rawFrame, size_t
     ble.gap().accumulateAdvertisingPayload(GapAdvertisingData::SERVICE_DATA, rawFrame, rawFrameLength);
 }
 
+/* Builds the same AD structures as updateAdvertisementPacket() into a raw buffer,
+ * as needed by the advertising set API which takes the payload as a whole.
+ */
+uint8_t EddystoneService::buildAdvertisingPayload(const uint8_t* rawFrame, size_t rawFrameLength, uint8_t* payload)
+{
+    uint8_t index = 0;
+    if (rawFrameLength + 1 + 2 + 1 + sizeof(EDDYSTONE_UUID) + 1 + 2 > GapAdvertisingData::GAP_ADVERTISING_DATA_MAX_PAYLOAD) {
+        return 0;
+    }
+    payload[index++] = 2;
+    payload[index++] = GapAdvertisingData::FLAGS;
+    payload[index++] = GapAdvertisingData::BREDR_NOT_SUPPORTED | GapAdvertisingData::LE_GENERAL_DISCOVERABLE;
+    payload[index++] = sizeof(EDDYSTONE_UUID) + 1;
+    payload[index++] = GapAdvertisingData::COMPLETE_LIST_16BIT_SERVICE_IDS;
+    memcpy(payload + index, EDDYSTONE_UUID, sizeof(EDDYSTONE_UUID));
+    index += sizeof(EDDYSTONE_UUID);
+    payload[index++] = rawFrameLength + 1;
+    payload[index++] = GapAdvertisingData::SERVICE_DATA;
+    memcpy(payload + index, rawFrame, rawFrameLength);
+    index += rawFrameLength;
+    return index;
+}
+
 uint8_t* EddystoneService::slotToFrame(int slot)
 {
    return reinterpret_cast<uint8_t *>(&slotStorage[slot * sizeof(Slot_t)]);
 }
 
+uint16_t EddystoneService::getSlotAdvInterval(int slot)
+{
+#ifdef ADAPTIVE_ADV_INTERVAL
+    return correctAdvertisementPeriod(advIntervalPolicy.getIntervalMs(slotAdvIntervals[slot], getTimeSinceLastBootMs()));
+#else
+    return slotAdvIntervals[slot];
+#endif
+}
+
+void EddystoneService::sampleBatteryVoltage(void)
+{
+    if (tlmBatteryVoltageCallback != NULL) {
+        tlmFrame.updateBatteryVoltage((*tlmBatteryVoltageCallback)(tlmFrame.getBatteryVoltage()));
+    }
+    uint8_t batteryStep = advIntervalPolicy.getBatteryStep();
+    advIntervalPolicy.updateBatteryVoltage(tlmFrame.getBatteryVoltage());
+    if (batteryStep != advIntervalPolicy.getBatteryStep()) {
+        LOG(("Battery %umV: adv interval step %u\r\n", tlmFrame.getBatteryVoltage(), advIntervalPolicy.getBatteryStep()));
+    }
+}
+
+void EddystoneService::onActivity(void)
+{
+    advIntervalPolicy.signalActivity(getTimeSinceLastBootMs());
+}
+
+void EddystoneService::scheduleNextFrame(int slot)
+{
+    slotNextAdvTimesMs[slot] += getSlotAdvInterval(slot) + eddystoneAdvJitterMs(advJitterState, EDDYSTONE_ADV_JITTER_MS);
+    slotCallbackHandles[slot] = eventQueue.post_in(
+        &EddystoneService::enqueueFrame, this, slot,
+        eddystoneAdvNextDelayMs(slotNextAdvTimesMs[slot], getTimeSinceLastBootMs()) /* ms */
+    );
+}
+
 void EddystoneService::enqueueFrame(int slot)
 {
+    slotFrameDueTimesMs[slot] = slotNextAdvTimesMs[slot];
+    scheduleNextFrame(slot);
     advFrameQueue.push(slot);
     if (!radioManagerCallbackHandle) {
         /* Advertising stopped and there is not callback posted in the event queue. Just
@@ -458,6 +716,7 @@ void EddystoneService::manageRadio(void)
 
     if (advFrameQueue.pop(slot)) {
         /* We have something to advertise */
+        uint32_t swapStartUs = us_ticker_read();
         if (ble.gap().getState().advertising) {
             ble.gap().stopAdvertising();
         }
@@ -466,6 +725,8 @@ void EddystoneService::manageRadio(void)
 
         /* Increase the advertised packet count in TLM frame */
         tlmFrame.updatePduCount();
+        int32_t latencyMs = (int32_t)((uint32_t)startTimeManageRadio - slotFrameDueTimesMs[slot]);
+        updateSlotStats(slot, (latencyMs > 0) ? latencyMs : 0, us_ticker_read() - swapStartUs);
 
         /* Post a callback to itself to stop the advertisement or pop the next
          * frame from the queue. However, take into account the time taken to
@@ -478,6 +739,144 @@ void EddystoneService::manageRadio(void)
         /* Nothing else to advertise, stop advertising and do not schedule any callbacks */
         ble.gap().stopAdvertising();
     }
+
+    if (startTimeManageRadio >= radioShadow.nextReportTimeMs) {
+        LOG(("Radio calls elided: %lu/hour (txPower=%lu payload=%lu stop=%lu)\r\n",
+             (unsigned long)getElidedRadioCallsPerHour(), (unsigned long)radioShadow.elidedTxPowerCalls,
+             (unsigned long)radioShadow.elidedPayloadUpdates, (unsigned long)radioShadow.elidedStopCalls));
+        radioShadow.nextReportTimeMs = startTimeManageRadio + RADIO_SHADOW_REPORT_PERIOD_MS;
+    }
+
+    /* Top the random pool up for the next MAC rotation / ETLM salt while the radio is idle */
+    scheduleRandomPoolRefill();
+}
+
+/* Upper bounds (ms) of the latency histogram buckets, the last bucket takes the rest */
+static const uint16_t slotLatencyBucketLimitsMs[SLOT_LATENCY_BUCKETS - 1] = { 1, 2, 5, 10, 20, 50, 100 };
+
+void EddystoneService::updateSlotStats(int slot, uint32_t latencyMs, uint32_t swapTimeUs)
+{
+    SlotStats_t &stats = slotStats[slot];
+    uint8_t bucket = 0;
+    while ((bucket < SLOT_LATENCY_BUCKETS - 1) && (latencyMs >= slotLatencyBucketLimitsMs[bucket])) {
+        bucket++;
+    }
+    /* Saturate rather than wrap, so a long running beacon keeps a meaningful shape */
+    if (stats.latencyHistogram[bucket] != 0xFFFF) {
+        stats.latencyHistogram[bucket]++;
+    }
+    if (latencyMs > stats.maxLatencyMs) {
+        stats.maxLatencyMs = (latencyMs > 0xFFFF) ? 0xFFFF : latencyMs;
+    }
+    if (swapTimeUs > stats.maxSwapTimeUs) {
+        stats.maxSwapTimeUs = (swapTimeUs > 0xFFFF) ? 0xFFFF : swapTimeUs;
+    }
+    stats.totalSwapTimeUs += swapTimeUs;
+    stats.pduCount++;
+}
+
+void EddystoneService::getSlotStats(uint8_t slot, SlotStats_t &stats)
+{
+    if (slot < MAX_ADV_SLOTS) {
+        memcpy(&stats, &slotStats[slot], sizeof(SlotStats_t));
+    } else {
+        memset(&stats, 0, sizeof(SlotStats_t));
+    }
+}
+
+void EddystoneService::resetSlotStats(void)
+{
+    memset(slotStats, 0, sizeof(SlotStatsTable_t));
+}
+
+bool EddystoneService::startAdvertisingSets(void)
+{
+    uint8_t setsAvailable = eddystoneAdvSetsAvailable(ble);
+    for (int slot = 0; slot < MAX_ADV_SLOTS; slot++) {
+        if (slotAdvIntervals[slot] && testValidFrame(slotToFrame(slot)) && (slot >= setsAvailable)) {
+            /* Not enough sets to give each slot its own */
+            return false;
+        }
+    }
+
+    bool setsStarted = false;
+    for (int slot = 0; slot < MAX_ADV_SLOTS; slot++) {
+        if (!slotAdvIntervals[slot] || !testValidFrame(slotToFrame(slot))) {
+            continue;
+        }
+        /* Only one set needs to be connectable to reach the config service */
+        bool connectable = remainConnectable && !setsStarted;
+        if ((eddystoneAdvSetConfigure(ble, slot, correctAdvertisementPeriod(slotAdvIntervals[slot]),
+                                      slotRadioTxPowerLevels[slot], connectable) != BLE_ERROR_NONE) ||
+            !refreshAdvertisingSet(slot) ||
+            (eddystoneAdvSetStart(ble, slot) != BLE_ERROR_NONE)) {
+            LOG(("Advertising set %d failed, using legacy advertising\r\n", slot));
+            /* Undo only the sets created so far, the legacy swapper takes over from here */
+            for (int created = 0; created <= slot; created++) {
+                if (slotCallbackHandles[created]) {
+                    eventQueue.cancel(slotCallbackHandles[created]);
+                    slotCallbackHandles[created] = NULL;
+                }
+                if (slotAdvIntervals[created] && testValidFrame(slotToFrame(created))) {
+                    eddystoneAdvSetStop(ble, created);
+                }
+            }
+            advSetsActive = false;
+            return false;
+        }
+        setsStarted = true;
+
+        /* Only TLM and EID frames change once configured */
+        if (slotFrameTypes[slot] == EDDYSTONE_FRAME_TLM || slotFrameTypes[slot] == EDDYSTONE_FRAME_EID) {
+            slotCallbackHandles[slot] = eventQueue.post_every(
+                &EddystoneService::refreshAdvertisingSetCallback, this, slot,
+                slotAdvIntervals[slot] /* ms */
+            );
+        }
+    }
+    advSetsStartTimeMs = getTimeSinceLastBootMs();
+    advSetsPduCount = 0;
+    advSetsActive = setsStarted;
+    return advSetsActive;
+}
+
+void EddystoneService::refreshAdvertisingSetCallback(int slot)
+{
+    refreshAdvertisingSet(slot);
+}
+
+bool EddystoneService::refreshAdvertisingSet(int slot)
+{
+    uint8_t payload[GapAdvertisingData::GAP_ADVERTISING_DATA_MAX_PAYLOAD];
+    size_t advFrameLength;
+
+    if (slotFrameTypes[slot] == EDDYSTONE_FRAME_TLM && advSetsActive) {
+        /* The controller does not report the PDUs it sent, so estimate them from the set intervals */
+        uint64_t elapsedMs = getTimeSinceLastBootMs() - advSetsStartTimeMs;
+        uint32_t pduCount = 0;
+        for (int i = 0; i < MAX_ADV_SLOTS; i++) {
+            uint16_t interval = correctAdvertisementPeriod(slotAdvIntervals[i]);
+            if (interval && testValidFrame(slotToFrame(i))) {
+                pduCount += elapsedMs / interval;
+            }
+        }
+        tlmFrame.updatePduCount(pduCount - advSetsPduCount);
+        advSetsPduCount = pduCount;
+    }
+
+    /* EID sets only need a new payload when the EID rotates, which may have
+     * happened while preparing another EID slot sharing the boundary */
+    const uint8_t* advFrame = prepareAdvFrame(slot, advFrameLength);
+    if (slotFrameTypes[slot] == EDDYSTONE_FRAME_EID) {
+        bool pending = (slotEidPayloadsPending & (1u << slot)) != 0;
+        slotEidPayloadsPending &= ~(1u << slot);
+        if (advSetsActive && !pending) {
+            return true;
+        }
+    }
+
+    uint8_t payloadLength = buildAdvertisingPayload(advFrame, advFrameLength, payload);
+    return (payloadLength != 0) && (eddystoneAdvSetPayload(ble, slot, payload, payloadLength) == BLE_ERROR_NONE);
 }
 
 void EddystoneService::startEddystoneConfigService(void)
@@ -500,6 +899,9 @@ void EddystoneService::startEddystoneConfigService(void)
     advSlotDataChar       = new GattCharacteristic(UUID_ADV_SLOT_DATA_CHAR, slotData, 0, 34, GattCharacteristic::BLE_GATT_CHAR_PROPERTIES_READ | GattCharacteristic::BLE_GATT_CHAR_PROPERTIES_WRITE);
     factoryResetChar      = new WriteOnlyGattCharacteristic<uint8_t>(UUID_FACTORY_RESET_CHAR, &factoryReset);
     remainConnectableChar = new ReadWriteGattCharacteristic<uint8_t>(UUID_REMAIN_CONNECTABLE_CHAR, &remainConnectable);
+#ifdef INCLUDE_SLOT_DIAGNOSTICS
+    slotDiagnosticsChar   = new GattCharacteristic(UUID_SLOT_DIAGNOSTICS_CHAR, slotDiagnostics, sizeof(SlotDiagnostics_t), sizeof(SlotDiagnostics_t), GattCharacteristic::BLE_GATT_CHAR_PROPERTIES_READ);
+#endif
 
     // CHAR-1 capabilities (READ ONLY)
     capabilitiesChar->setReadAuthorizationCallback(this, &EddystoneService::readBasicTestLockAuthorizationCallback);
@@ -533,6 +935,10 @@ void EddystoneService::startEddystoneConfigService(void)
     // CHAR-12 Remain Connectable
     remainConnectableChar->setReadAuthorizationCallback(this, &EddystoneService::readBasicTestLockAuthorizationCallback);
     remainConnectableChar->setWriteAuthorizationCallback(this, &EddystoneService::writeBasicAuthorizationCallback<bool>);
+#ifdef INCLUDE_SLOT_DIAGNOSTICS
+    // CHAR-13 Slot Diagnostics (READ ONLY)
+    slotDiagnosticsChar->setReadAuthorizationCallback(this, &EddystoneService::readSlotDiagnosticsAuthorizationCallback);
+#endif
 
     // Create pointers to all characteristics in the GATT service
     charTable[0] = capabilitiesChar;
@@ -547,12 +953,17 @@ void EddystoneService::startEddystoneConfigService(void)
     charTable[9] = advSlotDataChar;
     charTable[10] = factoryResetChar;
     charTable[11] = remainConnectableChar;
+#ifdef INCLUDE_SLOT_DIAGNOSTICS
+    charTable[12] = slotDiagnosticsChar;
+#endif
 
     GattService configService(UUID_ES_BEACON_SERVICE, charTable, sizeof(charTable) / sizeof(GattCharacteristic *));
 
     ble.gattServer().addService(configService);
     ble.gattServer().onDataWritten(this, &EddystoneService::onDataWrittenCallback);
     updateCharacteristicValues();
+    // Have the first challenge ready before a client reads the unlock characteristic
+    scheduleUnlockChallenge();
 }
 
 
@@ -570,6 +981,9 @@ void EddystoneService::freeConfigCharacteristics(void)
     delete advSlotDataChar;
     delete factoryResetChar;
     delete remainConnectableChar;
+#ifdef INCLUDE_SLOT_DIAGNOSTICS
+    delete slotDiagnosticsChar;
+#endif
 }
 
 void EddystoneService::stopEddystoneBeaconAdvertisements(void)
@@ -588,8 +1002,26 @@ void EddystoneService::stopEddystoneBeaconAdvertisements(void)
         radioManagerCallbackHandle = NULL;
     }
 
+    if (batterySampleCallbackHandle) {
+        eventQueue.cancel(batterySampleCallbackHandle);
+        batterySampleCallbackHandle = NULL;
+    }
+
+    if (advSetsActive) {
+        for (int slot = 0; slot < MAX_ADV_SLOTS; slot++) {
+            eddystoneAdvSetStop(ble, slot);
+        }
+        advSetsActive = false;
+    }
+
     /* Stop any current Advs (ES Config or Beacon) */
-    BLE::Instance().gap().stopAdvertising();
+    if (ble.gap().getState().advertising) {
+        ble.gap().stopAdvertising();
+    } else {
+        radioShadow.elidedStopCalls++;
+    }
+    /* The next mode sets its own payload and power */
+    invalidateRadioShadow();
 }
 
 /*
@@ -686,6 +1118,13 @@ EddystoneService::EddystoneError_t EddystoneService::startEddystoneConfigAdverti
     ble.gap().setAdvertisingType(GapAdvertisingParams::ADV_CONNECTABLE_UNDIRECTED);
     ble.gap().setAdvertisingInterval(advConfigInterval);
     ble.gap().startAdvertising();
+#ifdef CRYPTO_BENCHMARK
+    static bool firstAdvertisement = true;
+    if (firstAdvertisement) {
+        firstAdvertisement = false;
+        printf("CRYPTO_BENCHMARK first advertisement %lu us after boot\r\n", (unsigned long)us_ticker_read());
+    }
+#endif
 
     return EDDYSTONE_ERROR_NONE;
 }
@@ -702,7 +1141,12 @@ void EddystoneService::setupEddystoneConfigScanResponse(void)
 #ifdef INCLUDE_CONFIG_URL 
     // Add SERVICE DATA for a PhyWeb Config URL
     uint8_t configFrame[URLFrame::ENCODED_BUF_SIZE];
+#ifdef EDDYSTONE_CONSTEXPR_URL
+    int encodedUrlLen = configEncodedUrl.length;
+    memcpy(configFrame + CONFIG_FRAME_HDR_LEN, configEncodedUrl.data, encodedUrlLen);
+#else
     int encodedUrlLen = URLFrame::encodeURL(configFrame + CONFIG_FRAME_HDR_LEN, EDDYSTONE_CONFIG_URL);
+#endif
     uint8_t advPower = advTxPowerLevels[sizeof(PowerLevels_t)-1] & 0xFF;
     uint8_t configFrameHdr[CONFIG_FRAME_HDR_LEN] = {0, 0, URLFrame::FRAME_TYPE_URL, advPower};
     // ++ Fill in the Eddystone Service UUID in the HDR
@@ -734,7 +1178,7 @@ void EddystoneService::writeUnlockAuthorizationCallback(GattWriteAuthCallbackPar
         authParams->authorizationReply = AUTH_CALLBACK_REPLY_ATTERR_INVALID_ATT_VAL_LENGTH;
     } else if (authParams->offset != 0) {
         authParams->authorizationReply = AUTH_CALLBACK_REPLY_ATTERR_INVALID_OFFSET;
-    } else if (memcmp(authParams->data, unlockToken, sizeof(Lock_t)) != 0) {
+    } else if (!unlockTokenValid || (memcmp(authParams->data, unlockToken, sizeof(Lock_t)) != 0)) {
         authParams->authorizationReply = AUTH_CALLBACK_REPLY_ATTERR_WRITE_NOT_PERMITTED;
     } else {
         authParams->authorizationReply = AUTH_CALLBACK_REPLY_SUCCESS;
@@ -831,11 +1275,15 @@ void EddystoneService::readPublicEcdhKeyAuthorizationCallback(GattReadAuthCallba
 {
     LOG(("\r\nDO READ BEACON PUBLIC ECDH KEY (LE) slot=%d\r\n", activeSlot));
 
+    // A connection can come before the posted key generation has run: generate the keys now
+    bool ready = (lockState != LOCKED) && ensureEIDBeaconKeys();
     ble.gattServer().write(publicEcdhKeyChar->getValueHandle(), publicEcdhKeyLE, sizeof(PublicEcdhKey_t));
     
     // When the array is all zeros, the key has not been set, so return fault
     if (lockState == LOCKED) { 
         authParams->authorizationReply = AUTH_CALLBACK_REPLY_ATTERR_READ_NOT_PERMITTED;
+    } else if (!ready) {
+        authParams->authorizationReply = AUTH_CALLBACK_REPLY_ATTERR_UNLIKELY_ERROR;
     } else {
         authParams->authorizationReply = AUTH_CALLBACK_REPLY_SUCCESS;
     }
@@ -907,9 +1355,12 @@ void EddystoneService::readUnlockAuthorizationCallback(GattReadAuthCallbackParam
         authParams->authorizationReply = AUTH_CALLBACK_REPLY_ATTERR_READ_NOT_PERMITTED;
         return;
     }
-    // Update the challenge ready for the characteristic read
-    generateRandom(challenge, sizeof(Lock_t));
-    aes128Encrypt(unlockKey, challenge, unlockToken);
+    // Update the challenge ready for the characteristic read: the pair was prepared in idle time
+    if (!nextUnlockChallenge()) {
+        // No random challenge: refuse rather than hand out a predictable one
+        authParams->authorizationReply = AUTH_CALLBACK_REPLY_ATTERR_READ_NOT_PERMITTED;
+        return;
+    }
     ble.gattServer().write(unlockChar->getValueHandle(), reinterpret_cast<uint8_t *>(challenge), sizeof(Lock_t));     
     authParams->authorizationReply = AUTH_CALLBACK_REPLY_SUCCESS;
 }
@@ -926,6 +1377,35 @@ void EddystoneService::readAdvIntervalAuthorizationCallback(GattReadAuthCallback
     authParams->authorizationReply = AUTH_CALLBACK_REPLY_SUCCESS;
 }
 
+void EddystoneService::readSlotDiagnosticsAuthorizationCallback(GattReadAuthCallbackParams *authParams)
+{
+    LOG(("\r\nDO READ SLOT DIAGNOSTICS slot=%d\r\n", activeSlot));
+    if (lockState == LOCKED) {
+        authParams->authorizationReply = AUTH_CALLBACK_REPLY_ATTERR_READ_NOT_PERMITTED;
+        return;
+    }
+    const SlotStats_t &stats = slotStats[activeSlot];
+    uint32_t meanSwapTimeUs = stats.pduCount ? (stats.totalSwapTimeUs / stats.pduCount) : 0;
+    uint8_t index = 0;
+    slotDiagnostics[index++] = activeSlot;
+    slotDiagnostics[index++] = (uint8_t)(stats.pduCount >> 24);
+    slotDiagnostics[index++] = (uint8_t)(stats.pduCount >> 16);
+    slotDiagnostics[index++] = (uint8_t)(stats.pduCount >> 8);
+    slotDiagnostics[index++] = (uint8_t)(stats.pduCount);
+    for (int i = 0; i < SLOT_LATENCY_BUCKETS; i++) {
+        slotDiagnostics[index++] = (uint8_t)(stats.latencyHistogram[i] >> 8);
+        slotDiagnostics[index++] = (uint8_t)(stats.latencyHistogram[i]);
+    }
+    slotDiagnostics[index++] = (uint8_t)(stats.maxLatencyMs >> 8);
+    slotDiagnostics[index++] = (uint8_t)(stats.maxLatencyMs);
+    slotDiagnostics[index++] = (uint8_t)(stats.maxSwapTimeUs >> 8);
+    slotDiagnostics[index++] = (uint8_t)(stats.maxSwapTimeUs);
+    slotDiagnostics[index++] = (uint8_t)(meanSwapTimeUs > 0xFFFF ? 0xFF : meanSwapTimeUs >> 8);
+    slotDiagnostics[index++] = (uint8_t)(meanSwapTimeUs > 0xFFFF ? 0xFF : meanSwapTimeUs);
+    ble.gattServer().write(slotDiagnosticsChar->getValueHandle(), slotDiagnostics, sizeof(SlotDiagnostics_t));
+    authParams->authorizationReply = AUTH_CALLBACK_REPLY_SUCCESS;
+}
+
 void EddystoneService::readRadioTxPowerAuthorizationCallback(GattReadAuthCallbackParams *authParams)
 {
     LOG(("\r\nDO READ RADIO TXPOWER slot=%d\r\n", activeSlot));
@@ -1013,6 +1493,10 @@ void EddystoneService::onDataWrittenCallback(const GattWriteCallbackParams *writ
             // Decrypt the new key
             aes128Decrypt(unlockKey, encryptedNewKey, newKey);
             memcpy(unlockKey, newKey, sizeof(Lock_t));
+            aesKeyCache.invalidate(AesKeyCache::UNLOCK_ENCRYPT_ENTRY);
+            aesKeyCache.invalidate(AesKeyCache::UNLOCK_DECRYPT_ENTRY);
+            unlockChallenge.invalidate();
+            scheduleUnlockChallenge();
         }
         ble.gattServer().write(lockStateChar->getValueHandle(), reinterpret_cast<uint8_t *>(&lockState), sizeof(uint8_t));
     // CHAR-7 UNLOCK
@@ -1022,8 +1506,7 @@ void EddystoneService::onDataWrittenCallback(const GattWriteCallbackParams *writ
        // writeUnlockAuthorizationCallback(...)  which is executed before this method call.
        lockState = UNLOCKED;
        // Regenerate challenge and expected unlockToken for Next unlock operation
-       generateRandom(challenge, sizeof(Lock_t));
-       aes128Encrypt(unlockKey, challenge, unlockToken);
+       nextUnlockChallenge();
        // Update Chars
        ble.gattServer().write(unlockChar->getValueHandle(), reinterpret_cast<uint8_t *>(challenge), sizeof(Lock_t));      // Update the challenge
        ble.gattServer().write(lockStateChar->getValueHandle(), reinterpret_cast<uint8_t *>(&lockState), sizeof(uint8_t)); // Update the lock
@@ -1068,15 +1551,13 @@ void EddystoneService::onDataWrittenCallback(const GattWriteCallbackParams *writ
                 break;
             case TLMFrame::FRAME_TYPE_TLM:
                 if (writeFrameLen == 0) {
-                    updateRawTLMFrame(frame);
-                    tlmFrame.setData(frame);
-                    int slot = getEidSlot();
-                    LOG(("WRITE: Testing if TLM or ETLM=%d\r\n", slot));
-                    if (slot != NO_EID_SLOT_SET) {
-                        LOG(("WRITE: Configuring ETLM Slot time(S)=%lu\r\n", getTimeSinceFirstBootSecs() ));
-                        tlmFrame.encryptData(frame, slotEidIdentityKeys[slot], slotEidRotationPeriodExps[slot], getTimeSinceFirstBootSecs() );
+                    LOG(("WRITE: Configuring TLM or ETLM time(S)=%lu\r\n", getTimeSinceFirstBootSecs() ));
+                    if (updateRawTLMFrame(frame)) {
+                        slotFrameTypes[activeSlot] = EDDYSTONE_FRAME_TLM;
+                    } else {
+                        // No ETLM salt: the slot is emptied, the TLM is not sent in the clear
+                        tlmFrame.clearFrame(frame);
                     }
-                    slotFrameTypes[activeSlot] = EDDYSTONE_FRAME_TLM;
                 }
                 break;
             case EIDFrame::FRAME_TYPE_EID:
@@ -1089,17 +1570,30 @@ void EddystoneService::onDataWrittenCallback(const GattWriteCallbackParams *writ
                     ble.gattServer().write(eidIdentityKeyChar->getValueHandle(), reinterpret_cast<uint8_t *>(&writeData), sizeof(EidIdentityKey_t));
                 } else if (writeFrameLen == 33 ) {  
                     // Most secure
-                    memcpy(serverPublicEcdhKey, writeData, 32);
-                    ble.gattServer().write(publicEcdhKeyChar->getValueHandle(), reinterpret_cast<uint8_t *>(&serverPublicEcdhKey), sizeof(PublicEcdhKey_t));
-                    LOG(("ServerPublicEcdhKey=")); logPrintHex(serverPublicEcdhKey, 32);
-                    slotEidRotationPeriodExps[activeSlot] = writeData[32]; // index 32 is the exponent
-                    LOG(("Exponent=%i\r\n", writeData[32]));
-                    LOG(("genBeaconKeyRC=%x\r\n", genBeaconKeyRC));
+                    // The slot is only changed once the registration succeeded
+                    if (!ensureEIDBeaconKeys()) {
+                        LOG(("genBeaconKeyRC=%x\r\n", genBeaconKeyRC));
+                        break; // No beacon key pair to register with
+                    }
                     LOG(("BeaconPrivateEcdhKey=")); logPrintHex(privateEcdhKey, 32);
                     LOG(("BeaconPublicEcdhKey=")); logPrintHex(publicEcdhKey, 32);
                     LOG(("genECDHShareKey\r\n"));
-                    int rc = eidFrame.genEcdhSharedKey(privateEcdhKey, publicEcdhKey, serverPublicEcdhKey, slotEidIdentityKeys[activeSlot]);
+                    PublicEcdhKey_t newServerKey;
+                    EidIdentityKey_t newIdentityKey;
+                    memcpy(newServerKey, writeData, sizeof(PublicEcdhKey_t));
+                    int rc = eidFrame.genEcdhSharedKey(privateEcdhKey, publicEcdhKey, newServerKey, newIdentityKey);
                     LOG(("Gen Keys RC = %x\r\n", rc));
+                    if (rc != EIDFrame::EID_SUCCESS) {
+                        memset(newIdentityKey, 0, sizeof(EidIdentityKey_t));
+                        break; // e.g. EID_RC_SS_IS_ZERO: a bad server key, the slot keeps its registration
+                    }
+                    memcpy(serverPublicEcdhKey, newServerKey, sizeof(PublicEcdhKey_t));
+                    ble.gattServer().write(publicEcdhKeyChar->getValueHandle(), reinterpret_cast<uint8_t *>(&serverPublicEcdhKey), sizeof(PublicEcdhKey_t));
+                    LOG(("ServerPublicEcdhKey=")); logPrintHex(serverPublicEcdhKey, 32);
+                    slotEidRotationPeriodExps[activeSlot] = writeData[32]; // index 32 is the exponent
+                    LOG(("Exponent=%i\r\n", writeData[32]));
+                    memcpy(slotEidIdentityKeys[activeSlot], newIdentityKey, sizeof(EidIdentityKey_t));
+                    memset(newIdentityKey, 0, sizeof(EidIdentityKey_t));
                     LOG(("Generated eidIdentityKey=")); logPrintHex(slotEidIdentityKeys[activeSlot], 16);
                     aes128Encrypt(unlockKey, slotEidIdentityKeys[activeSlot], encryptedEidIdentityKey);
                     LOG(("encryptedEidIdentityKey=")); logPrintHex(encryptedEidIdentityKey, 16);      
@@ -1107,6 +1601,7 @@ void EddystoneService::onDataWrittenCallback(const GattWriteCallbackParams *writ
                 } else if (writeFrameLen == 0) {
                     // Reset eidFrame
                     eidFrame.clearFrame(frame);
+                    aesKeyCache.invalidate(activeSlot);
                     break;
                 } else {
                     break; // Do nothing, this is not a recognized Frame length
@@ -1118,7 +1613,7 @@ void EddystoneService::onDataWrittenCallback(const GattWriteCallbackParams *writ
                 // Generate EID ADV frame packet 
                 eidFrame.setData(frame, advTxPower, nullEid);
                 // Fill in the correct EID Value from the Identity Key/exp/clock
-                eidFrame.update(frame, slotEidIdentityKeys[activeSlot], slotEidRotationPeriodExps[activeSlot], getTimeSinceFirstBootSecs() );
+                updateEidFrame(activeSlot, frame, getTimeSinceFirstBootSecs());
                 LOG(("END update Eid Frame\r\n"));
                 break;
             default:
@@ -1172,49 +1667,381 @@ uint8_t EddystoneService::radioTxPowerToIndex(int8_t txPower) {
 
 /** AES128 encrypts a 16-byte input array with a key, resulting in a 16-byte output array */
 void EddystoneService::aes128Encrypt(uint8_t key[], uint8_t input[], uint8_t output[]) {
-    mbedtls_aes_context ctx;
-    mbedtls_aes_init(&ctx);
-    mbedtls_aes_setkey_enc(&ctx, key, 8 * sizeof(Lock_t));
-    mbedtls_aes_crypt_ecb(&ctx, MBEDTLS_AES_ENCRYPT, input, output);
-    mbedtls_aes_free(&ctx);
+    // Only ever used with the unlock key; the cache re-expands if it is given another key
+    Aes128Backend::encrypt(aesKeyCache.get(AesKeyCache::UNLOCK_ENCRYPT_ENTRY, key, MBEDTLS_AES_ENCRYPT), input, output);
 }
 
 /** AES128 decrypts a 16-byte input array with a key, resulting in a 16-byte output array */
 void EddystoneService::aes128Decrypt(uint8_t key[], uint8_t input[], uint8_t output[]) {
-    mbedtls_aes_context ctx;
-    mbedtls_aes_init(&ctx);
-    mbedtls_aes_setkey_dec(&ctx, key, 8 * sizeof(Lock_t));
-    mbedtls_aes_crypt_ecb(&ctx, MBEDTLS_AES_DECRYPT, input, output);
-    mbedtls_aes_free(&ctx);
+    Aes128Backend::decrypt(aesKeyCache.get(AesKeyCache::UNLOCK_DECRYPT_ENTRY, key, MBEDTLS_AES_DECRYPT), input, output);
 }
 
+/** Returns the EID identity key of a slot, expanded for encryption */
+const Aes128Context* EddystoneService::getSlotKeyContext(int slot) {
+    return aesKeyCache.get(slot, slotEidIdentityKeys[slot], MBEDTLS_AES_ENCRYPT);
+}
+
+/** Returns the EAX state of the EID identity key of a slot, recomputed when the key changes */
+const eddy_eax_context* EddystoneService::getSlotEaxContext(int slot) {
+    const Aes128Context* aes = getSlotKeyContext(slot);
+    if (!etlmEaxValid || (etlmEaxContext.aes != aes) ||
+        (memcmp(etlmEaxKey, slotEidIdentityKeys[slot], sizeof(EidIdentityKey_t)) != 0)) {
+        eddy_eax_setup(&etlmEaxContext, aes);
+        memcpy(etlmEaxKey, slotEidIdentityKeys[slot], sizeof(EidIdentityKey_t));
+        etlmEaxValid = true;
+    }
+    return &etlmEaxContext;
+}
+
+void EddystoneService::scheduleRandomPoolRefill(void)
+{
+#ifdef HARDWARE_RANDOM_NUM_GENERATOR
+    if ((randomPoolRefillHandle == NULL) && drbg.isPoolLow()) {
+        randomPoolRefillHandle = eventQueue.post(&EddystoneService::refillRandomPool, this);
+    }
+#endif
+}
+
+void EddystoneService::refillRandomPool(void)
+{
+    randomPoolRefillHandle = NULL;
+    drbg.refill();
+}
+
+void EddystoneService::scheduleUnlockChallenge(void)
+{
+    if ((unlockChallengeHandle == NULL) && !unlockChallenge.isReady()) {
+        unlockChallengeHandle = eventQueue.post(&EddystoneService::prepareUnlockChallengeTask, this);
+    }
+}
+
+bool EddystoneService::prepareUnlockChallenge(void)
+{
+    if (unlockChallenge.isReady()) {
+        return true;
+    }
+    uint8_t random[sizeof(Lock_t)];
+    int ret = generateRandom(random, sizeof(random));
+    scheduleRandomPoolRefill();
+    if (ret != 0) {
+        return false;
+    }
+    unlockChallenge.prepare(random, aesKeyCache.get(AesKeyCache::UNLOCK_ENCRYPT_ENTRY, unlockKey, MBEDTLS_AES_ENCRYPT));
+    memset(random, 0, sizeof(random));
+    return true;
+}
+
+void EddystoneService::prepareUnlockChallengeTask(void)
+{
+    unlockChallengeHandle = NULL;
+    prepareUnlockChallenge();
+}
+
+bool EddystoneService::nextUnlockChallenge(void)
+{
+    if (!unlockChallenge.isReady()) {
+        // A read came before the idle task ran (or right after a key change)
+        prepareUnlockChallenge();
+    }
+    unlockTokenValid = unlockChallenge.take(challenge, unlockToken);
+    scheduleUnlockChallenge();
+    return unlockTokenValid;
+}
+
+/** Returns the EID temporary key of a slot for the epoch of timeSecs, deriving it once per epoch */
+const Aes128Context* EddystoneService::getSlotTempKeyContext(int slot, uint32_t timeSecs) {
+    uint8_t entry = AesKeyCache::TEMP_KEY_ENTRY + slot;
+    uint32_t epoch = timeSecs >> 16;
+    Aes128Context* ctx = aesKeyCache.find(entry, slotEidIdentityKeys[slot], epoch, MBEDTLS_AES_ENCRYPT);
+    if (ctx == NULL) {
+        uint8_t tmpKey[16];
+        eidFrame.genTemporaryKey(getSlotKeyContext(slot), timeSecs, tmpKey);
+        ctx = aesKeyCache.store(entry, slotEidIdentityKeys[slot], epoch, tmpKey, MBEDTLS_AES_ENCRYPT);
+        memset(tmpKey, 0, sizeof(tmpKey));
+    }
+    return ctx;
+}
+
+/** Recomputes the EID value of a slot frame */
+void EddystoneService::updateEidFrame(int slot, uint8_t* frame, uint32_t timeSecs) {
+    eidFrame.updateFromTemporaryKey(frame, getSlotTempKeyContext(slot, timeSecs), slotEidRotationPeriodExps[slot], timeSecs);
+}
+
+void EddystoneService::rotateEidSlots(uint32_t timeSecs) {
+    uint32_t eidSlots = 0;
+    for (int slot = 0; slot < MAX_ADV_SLOTS; slot++) {
+        if (slotFrameTypes[slot] == EDDYSTONE_FRAME_EID) {
+            eidSlots |= 1u << slot;
+        }
+    }
+    uint32_t dueSlots = eddystoneEidDueSlots(eidSlots, slotEidNextRotationTimes, MAX_ADV_SLOTS, timeSecs);
+    if (dueSlots == 0) {
+        return;
+    }
+    for (int slot = 0; slot < MAX_ADV_SLOTS; slot++) {
+        if (dueSlots & (1u << slot)) {
+            updateEidFrame(slot, slotToFrame(slot), timeSecs);
+            slotEidNextRotationTimes[slot] = eddystoneEidNextRotationTime(timeSecs, slotEidRotationPeriodExps[slot]);
+            eidRotationStats.eidUpdates++;
+        }
+    }
+    slotEidPayloadsPending |= dueSlots;
+    // select a new random MAC address so the beacon is not trackable 
+    if (setRandomMacAddress()) {
+        eidRotationStats.macChanges++;
+    }
+    // Store in NVM in case the beacon loses power
+    nvmSaveTimeParams();
+    eidRotationStats.timeCheckpoints++;
+    LOG(("EID ROTATED: Time=%lu Slots=0x%lx (since boot: eids=%lu mac=%lu nvm=%lu)\r\n", timeSecs, (unsigned long)dueSlots,
+         (unsigned long)eidRotationStats.eidUpdates, (unsigned long)eidRotationStats.macChanges,
+         (unsigned long)eidRotationStats.timeCheckpoints));
+}
+
+#ifdef CRYPTO_BENCHMARK
+/* Cost of one primitive: cycles per call and heap held after. The stack is measured by the
+ * host CryptoBench: the event queue runs on an RTOS thread stack, which the linker's stack
+ * symbols do not describe. */
+struct CryptoBenchSample {
+    uint32_t cycles;
+    int32_t  heapBytes;
+};
+
+static uint32_t benchCycleStart;
+static int32_t benchHeapStart;
+
+/* DWT cycle counter on Cortex-M3/M4 (nRF52); the microsecond ticker scaled to the core clock on Cortex-M0 (nRF51) */
+static uint32_t benchCycleCount(void)
+{
+#if defined(DWT_CTRL_CYCCNTENA_Msk)
+    return DWT->CYCCNT;
+#else
+    return us_ticker_read() * (SystemCoreClock / 1000000);
+#endif
+}
+
+static int32_t benchHeapInUse(void)
+{
+#ifdef MBED_HEAP_STATS_ENABLED
+    mbed_stats_heap_t stats;
+    mbed_stats_heap_get(&stats);
+    return (int32_t)stats.current_size;
+#else
+    return 0;
+#endif
+}
+
+static void benchBegin(void)
+{
+    benchHeapStart = benchHeapInUse();
+    benchCycleStart = benchCycleCount();
+}
+
+static void benchEnd(CryptoBenchSample& sample, int iterations)
+{
+    sample.cycles = (benchCycleCount() - benchCycleStart) / iterations;
+    sample.heapBytes = benchHeapInUse() - benchHeapStart;
+}
+
+static void benchPrint(const char* name, const CryptoBenchSample& sample)
+{
+    printf("CRYPTO_BENCHMARK %-24s %8lu cycles %5lu us %5ld B heap\r\n", name,
+           (unsigned long)sample.cycles, (unsigned long)(sample.cycles / (SystemCoreClock / 1000000)),
+           (long)sample.heapBytes);
+}
+
+/* Runs the crypto known answer tests (crypto_selftest.h), checks EIDFrame and TLMFrame against
+ * the Eddystone vector, then reports cycles and heap of each primitive: EID and ETLM with
+ * a fresh key expansion per frame (as before the key schedule cache), with the cached identity
+ * key schedule and with the cached temporary key (EID) or EAX state (ETLM), and the key exchange.
+ * Uses printf so the results show with NO_LOGGING, which (with NO_EAX_TEST) should be set to keep
+ * the frame logs out of the timings.
+ */
+void EddystoneService::runCryptoBenchmark(void)
+{
+    static const int ITERATIONS = 100;
+#if defined(DWT_CTRL_CYCCNTENA_Msk)
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+    printf("CRYPTO_BENCHMARK AES-128 backend: %s\r\n", Aes128Backend::getName());
+    int failed = eddy_crypto_self_test(1);
+
+    /* The firmware code paths against the same vector */
+    const eddy_eid_test_vector* v = &eddy_eid_test_vector_1;
+    PrivateEcdhKey_t beaconPrivateKey;
+    PublicEcdhKey_t beaconPublicKey;
+    PublicEcdhKey_t serverPublicKey;
+    EidIdentityKey_t key;
+    swapEndianArray(const_cast<uint8_t*>(v->beacon_private_key), beaconPrivateKey, sizeof(PrivateEcdhKey_t));
+    swapEndianArray(const_cast<uint8_t*>(v->beacon_public_key), beaconPublicKey, sizeof(PublicEcdhKey_t));
+    memcpy(serverPublicKey, v->server_public_key, sizeof(PublicEcdhKey_t));
+    bool ok = eidFrame.genEcdhSharedKey(beaconPrivateKey, beaconPublicKey, serverPublicKey, key) == EIDFrame::EID_SUCCESS &&
+              memcmp(key, v->identity_key, sizeof(key)) == 0;
+    failed += ok ? 0 : 1;
+    printf("  EIDFrame::genEcdhSharedKey: %s\r\n", ok ? "passed" : "failed");
+
+    Slot_t frame;
+    eidFrame.setData(frame, 0, nullEid);
+    eidFrame.update(frame, key, v->rotation_period_exp, v->beacon_time_secs);
+    ok = memcmp(eidFrame.getEid(frame), v->eid, sizeof(v->eid)) == 0;
+    failed += ok ? 0 : 1;
+    printf("  EIDFrame::update: %s\r\n", ok ? "passed" : "failed");
+
+    /* The salt is random: decrypt with the nonce rebuilt from the frame */
+    tlmFrame.setData(frame);
+    uint8_t tlmData[12];
+    uint8_t etlmData[16];
+    memcpy(tlmData, frame + 5, sizeof(tlmData));
+    tlmFrame.encryptData(frame, key, v->rotation_period_exp, v->beacon_time_secs);
+    memcpy(etlmData, frame + 5, sizeof(etlmData));
+    uint32_t scaledTime = (v->beacon_time_secs >> v->rotation_period_exp) << v->rotation_period_exp;
+    uint8_t nonce[6] = { (uint8_t)(scaledTime >> 24), (uint8_t)(scaledTime >> 16), (uint8_t)(scaledTime >> 8),
+                         (uint8_t)scaledTime, etlmData[12], etlmData[13] };
+    uint8_t plain[12];
+    Aes128Context ctx;
+    Aes128Backend::init(&ctx);
+    Aes128Backend::setKeyEnc(&ctx, key);
+    ok = eddy_aes_authcrypt_eax(&ctx, MBEDTLS_AES_DECRYPT, nonce, sizeof(nonce), NULL, 0, sizeof(plain),
+                                etlmData, plain, etlmData + 14, 2) == 0 && memcmp(plain, tlmData, sizeof(plain)) == 0;
+    failed += ok ? 0 : 1;
+    printf("  TLMFrame::encryptData: %s\r\n", ok ? "passed" : "failed");
+    printf("CRYPTO_BENCHMARK self test: %d failed\r\n", failed);
+
+    uint32_t timeSecs = getTimeSinceFirstBootSecs();
+    static AesKeyCache cache;   /* Over 2 KB of key schedules: not on the event thread's stack */
+    CryptoBenchSample sample;
+
+    eidFrame.setData(frame, 0, nullEid);
+    benchBegin();
+    for (int i = 0; i < ITERATIONS; i++) {
+        eidFrame.update(frame, key, 10, timeSecs);
+    }
+    benchEnd(sample, ITERATIONS);
+    benchPrint("EID", sample);
+    benchBegin();
+    for (int i = 0; i < ITERATIONS; i++) {
+        eidFrame.update(frame, cache.get(0, key, MBEDTLS_AES_ENCRYPT), 10, timeSecs);
+    }
+    benchEnd(sample, ITERATIONS);
+    benchPrint("EID (cached key)", sample);
+    benchBegin();
+    for (int i = 0; i < ITERATIONS; i++) {
+        uint32_t epoch = timeSecs >> 16;
+        Aes128Context* tmpKeyCtx = cache.find(AesKeyCache::TEMP_KEY_ENTRY, key, epoch, MBEDTLS_AES_ENCRYPT);
+        if (tmpKeyCtx == NULL) {
+            uint8_t tmpKey[16];
+            eidFrame.genTemporaryKey(cache.get(0, key, MBEDTLS_AES_ENCRYPT), timeSecs, tmpKey);
+            tmpKeyCtx = cache.store(AesKeyCache::TEMP_KEY_ENTRY, key, epoch, tmpKey, MBEDTLS_AES_ENCRYPT);
+        }
+        eidFrame.updateFromTemporaryKey(frame, tmpKeyCtx, 10, timeSecs);
+    }
+    benchEnd(sample, ITERATIONS);
+    benchPrint("EID (temporary key)", sample);
+
+    tlmFrame.setData(frame);
+    eddy_eax_context eax;
+    eddy_eax_setup(&eax, cache.get(0, key, MBEDTLS_AES_ENCRYPT));
+    benchBegin();
+    for (int i = 0; i < ITERATIONS; i++) {
+        tlmFrame.encryptData(frame, key, 10, timeSecs);
+    }
+    benchEnd(sample, ITERATIONS);
+    benchPrint("ETLM", sample);
+    benchBegin();
+    for (int i = 0; i < ITERATIONS; i++) {
+        tlmFrame.encryptData(frame, &eax, 10, timeSecs);
+    }
+    benchEnd(sample, ITERATIONS);
+    benchPrint("ETLM (cached EAX)", sample);
+    benchBegin();
+    for (int i = 0; i < ITERATIONS; i++) {
+        eddy_aes_authcrypt_eax(&ctx, MBEDTLS_AES_ENCRYPT, nonce, sizeof(nonce), NULL, 0, sizeof(tlmData),
+                               tlmData, etlmData, etlmData + 14, 2);
+    }
+    benchEnd(sample, ITERATIONS);
+    benchPrint("eddy_aes_authcrypt_eax", sample);
+    Aes128Backend::free(&ctx);
+    printf("CRYPTO_BENCHMARK key expansions %lu\r\n", (unsigned long)cache.getKeyExpansions());
+
+    uint8_t random[16];
+    benchBegin();
+    for (int i = 0; i < ITERATIONS; i++) {
+        generateRandom(random, sizeof(random));
+    }
+    benchEnd(sample, ITERATIONS);
+    benchPrint("generateRandom (16 B)", sample);
+
+    /* Key exchange: one key pair and one shared key, as for an EID registration */
+    static const int ECDH_ITERATIONS = 4;
+    PrivateEcdhKey_t privateKey;
+    PublicEcdhKey_t publicKey;
+    benchBegin();
+    for (int i = 0; i < ECDH_ITERATIONS; i++) {
+        eddy_x25519_base(publicKey, v->beacon_private_key);
+    }
+    benchEnd(sample, ECDH_ITERATIONS);
+    benchPrint("X25519 public key", sample);
+    benchBegin();
+    for (int i = 0; i < ECDH_ITERATIONS; i++) {
+        eddy_x25519(publicKey, v->beacon_private_key, v->server_public_key);
+    }
+    benchEnd(sample, ECDH_ITERATIONS);
+    benchPrint("X25519 shared secret", sample);
+    benchBegin();
+    for (int i = 0; i < ECDH_ITERATIONS; i++) {
+        eidFrame.genBeaconKeys(privateKey, publicKey);
+    }
+    benchEnd(sample, ECDH_ITERATIONS);
+    benchPrint("genBeaconKeys", sample);
+    benchBegin();
+    for (int i = 0; i < ECDH_ITERATIONS; i++) {
+        eidFrame.genEcdhSharedKey(beaconPrivateKey, beaconPublicKey, serverPublicKey, key);
+    }
+    benchEnd(sample, ECDH_ITERATIONS);
+    benchPrint("genEcdhSharedKey", sample);
+    memset(privateKey, 0, sizeof(privateKey));
+    memset(key, 0, sizeof(key));
+
+    /* HKDF-SHA256 as done by genEcdhSharedKey(): 64-byte salt, 32-byte secret, 32 bytes out */
+    uint8_t salt[64];
+    uint8_t secret[32];
+    memcpy(salt, serverPublicKey, sizeof(PublicEcdhKey_t));
+    memcpy(salt + sizeof(PublicEcdhKey_t), v->beacon_public_key, sizeof(PublicEcdhKey_t));
+    memcpy(secret, v->beacon_private_key, sizeof(secret));
+    benchBegin();
+    for (int i = 0; i < ITERATIONS; i++) {
+        eddy_hkdf_sha256(salt, sizeof(salt), secret, sizeof(secret), NULL, 0, secret, sizeof(secret));
+    }
+    benchEnd(sample, ITERATIONS);
+    benchPrint("HKDF-SHA256", sample);
+}
+#endif
+
 
 
 #ifdef HARDWARE_RANDOM_NUM_GENERATOR
 // Generates a set of random values in byte array[size] based on hardware source
-void EddystoneService::generateRandom(uint8_t ain[], int size) {
-    mbedtls_entropy_context entropy;
-    mbedtls_entropy_init(&entropy);
-    // init entropy source
-    eddystoneRegisterEntropySource(&entropy);
-    mbedtls_ctr_drbg_context ctr_drbg;
-    mbedtls_ctr_drbg_init(&ctr_drbg);
-    mbedtls_ctr_drbg_seed(&ctr_drbg, mbedtls_entropy_func, &entropy, NULL, 0);
-    mbedtls_ctr_drbg_random(&ctr_drbg, ain, size);
-    mbedtls_ctr_drbg_free(&ctr_drbg);
-    mbedtls_entropy_free(&entropy);
-    return;
+int EddystoneService::generateRandom(uint8_t ain[], int size) {
+    // Served from the random pool when it holds enough bytes, from the long-lived DRBG otherwise
+    int ret = drbg.random(ain, size);
+    if (ret != 0) {
+        LOG(("generateRandom failed: %d\r\n", ret));
+        memset(ain, 0, size);
+    }
+    return ret;
 }
 #else
 // Generates a set of random values in byte array[size] seeded by the clock(ms)
-void EddystoneService::generateRandom(uint8_t ain[], int size) {
+int EddystoneService::generateRandom(uint8_t ain[], int size) {
     int i;
     // Random seed based on boot time in milliseconds
     srand(getTimeSinceLastBootMs());
     for (i = 0; i < size; i++) {
         ain[i] = rand() % 256;
     }
-    return;
+    return 0;
 }
 #endif
 
@@ -1252,13 +2079,16 @@ void EddystoneService::logPrintHex(uint8_t* a, int len) {
     LOG(("\r\n"));
 }
 
-void EddystoneService::setRandomMacAddress(void) {
+bool EddystoneService::setRandomMacAddress(void) {
 #ifdef EID_RANDOM_MAC
     uint8_t macAddress[6]; // 48 bit Mac Address
-    generateRandom(macAddress, 6);
+    if (generateRandom(macAddress, 6) != 0) {
+        return false; // Keep the current address rather than set a predictable one
+    }
     macAddress[5] |= 0xc0; // Ensure upper two bits are 11's for Random Add
     ble.setAddress(BLEProtocol::AddressType::RANDOM_STATIC, macAddress);
 #endif
+    return true;
 }
 
 int EddystoneService::getEidSlot(void) {
@@ -1327,5 +2157,7 @@ const uint8_t EddystoneService::slotDefaultEidIdentityKeys[MAX_ADV_SLOTS][16] =
 
 const uint8_t EddystoneService::nullEid[8] = {0,0,0,0,0,0,0,0};
 
+const uint16_t EddystoneService::slotDefaultAdvOffsets[MAX_ADV_SLOTS] = EDDYSTONE_DEFAULT_SLOT_ADV_OFFSETS;
+
 
 
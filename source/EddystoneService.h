@@ -22,10 +22,16 @@
 #include "EventQueue/EventQueue.h"
 #include "ble/BLE.h"
 #include "EddystoneTypes.h"
+#include "EddystoneParams.h"
 #include "UIDFrame.h"
 #include "URLFrame.h"
+#include "UrlEncoding.h"
 #include "TLMFrame.h"
 #include "EIDFrame.h"
+#include "AdvIntervalPolicy.h"
+#include "AesKeyCache.h"
+#include "DrbgService.h"
+#include "UnlockChallenge.h"
 #include <string.h>
 #include "mbedtls/aes.h"
 #include "mbedtls/entropy.h"
@@ -56,7 +62,11 @@ public:
      * Total number of GATT Characteristics in the Eddystonei-URL Configuration
      * Service.
      */
+#ifdef INCLUDE_SLOT_DIAGNOSTICS
+    static const uint16_t TOTAL_CHARACTERISTICS = 13;
+#else
     static const uint16_t TOTAL_CHARACTERISTICS = 12;
+#endif
     
     /**
      * Max data that can be written to the data characteristic
@@ -102,106 +112,21 @@ public:
     };
 
     /**
-     * Structure that encapsulates the Eddystone configuration parameters. This
-     * structure is particularly useful when storing the parameters to
-     * persistent storage.
+     * Structure that encapsulates the Eddystone configuration parameters
+     * (see EddystoneParams.h).
      */
-    struct EddystoneParams_t {
-        /**
-         * 
-         */
-        TimeParams_t            timeParams;
-        /**
-         * A buffer describing the capabilities of the beacon
-         */
-        Capability_t            capabilities;
+    typedef ::EddystoneParams_t EddystoneParams_t;
 
-         /**
-         * Defines the slot that advInterval, radioPower, advPower, advSlotData operate on
-         */
-        uint8_t                 activeSlot;
-
-        /**
-         * The Beacon interval for each beacon slot
-         *
-         * @note A value of zero disables Eddystone-URL frame trasmissions.
-         */
-        SlotAdvIntervals_t      slotAdvIntervals;
-
-         /**
-         * The Radio TX Powers supported by this beacon
-         */
-        PowerLevels_t           radioTxPowerLevels;
-
-         /**
-         * The Radio TX Power set for each slot
-         */
-        SlotTxPowerLevels_t     slotRadioTxPowerLevels;
-
-        /**
-         * The Calibrated Adv TX Powers supported by this beacon (one for each radio power)
-         */
-        PowerLevels_t           advTxPowerLevels;
-
-        /**
-         * The Adv TX Power set for each slot
-         */
-        SlotTxPowerLevels_t     slotAdvTxPowerLevels;
-
-        /**
-         * The value of the Eddystone-URL Configuration Service Lock State
-         * characteristic.
-         */
-        uint8_t                 lockState;
-
-        /**
-         * The value of the Eddystone-URL Configuration Service Unlock
-         * characteristic that can be used to unlock the beacon and clear the
-         * single-use lock-code.
-         */
-        Lock_t                  unlockToken;
-
-        /**
-         * An array holding the 128-bit unlockKey (big endian)
-         */
-        Lock_t                  unlockKey;
-
-        /**
-         * An array holding the 128-bit challenge (big endian) in the
-         * challenge/response unlock protocol
-         */
-        Lock_t                  challenge;
-
-        /**
-         * EID: An array holding the slot rotation period exponents
-         */
-        SlotEidRotationPeriodExps_t     slotEidRotationPeriodExps;
-
-        /**
-         * EID: An array holding the slot 128-bit EID Identity Key (big endian)
-         */
-        SlotEidIdentityKeys_t           slotEidIdentityKeys;
-
-        /**
-         * Specifies the type of each frame indexed by slot
-         */
-        SlotFrameTypes_t    slotFrameTypes;
-
-        /**
-         * A buffer that contains all slot frames, 32-bytes allocated to each frame
-         */
-        SlotStorage_t       slotStorage;
-
-         /**
-         * The state of the recently invoked Factory Reset characteristic
-         */
-        uint8_t          factoryReset;
-
-        /**
-         * The state of the recently invoked Remain Connectable characteristic
-         */
-        uint8_t          remainConnectable;
-    };
+    /**
+     * The available frame types within Eddystone advertising packets (see
+     * EddystoneParams.h).
+     */
+    typedef EddystoneFrameTypes::FrameType FrameType;
+    static const FrameType EDDYSTONE_FRAME_UID  = EddystoneFrameTypes::EDDYSTONE_FRAME_UID;
+    static const FrameType EDDYSTONE_FRAME_URL  = EddystoneFrameTypes::EDDYSTONE_FRAME_URL;
+    static const FrameType EDDYSTONE_FRAME_TLM  = EddystoneFrameTypes::EDDYSTONE_FRAME_TLM;
+    static const FrameType EDDYSTONE_FRAME_EID  = EddystoneFrameTypes::EDDYSTONE_FRAME_EID;
+    static const FrameType NUM_EDDYSTONE_FRAMES = EddystoneFrameTypes::NUM_EDDYSTONE_FRAMES;
 
     /**
      * Enumeration that defines the various error codes for EddystoneService.
@@ -229,37 +154,6 @@ public:
         EDDYSTONE_ERROR_INVALID_STATE
     };
 
-    /**
-     * Enumeration that defines the available frame types within Eddystone
-     * advertising packets.
-     */
-    enum FrameType {
-        /**
-         * The Eddystone-UID frame. Refer to
-         * https://github.com/google/eddystone/tree/master/eddystone-uid.
-         */
-        EDDYSTONE_FRAME_UID,
-        /**
-         * The Eddystone-URL frame. Refer to
-         * https://github.com/google/eddystone/tree/master/eddystone-url.
-         */
-        EDDYSTONE_FRAME_URL,
-        /**
-         * The Eddystone-TLM frame. Refer to
-         * https://github.com/google/eddystone/tree/master/eddystone-tlm.
-         */
-        EDDYSTONE_FRAME_TLM,
-        /**
-         * The Eddystone-EID frame. Refer to
-         * https://github.com/google/eddystone/tree/master/eddystone-eid.
-         */
-        EDDYSTONE_FRAME_EID,
-        /**
-         * The total number Eddystone frame types.
-         */
-        NUM_EDDYSTONE_FRAMES
-    };
-
     typedef eq::EventQueue event_queue_t;
 
     /**
@@ -314,7 +208,9 @@ public:
                      
           
     /**
-     * Generate the EID Beacon Random ECHD Keys (private and Public)
+     * Discard the EID Beacon ECDH Keys (private and Public) and post the
+     * generation of a fresh pair, so it runs after the advertisements have
+     * started instead of delaying them.
      */                  
     void genEIDBeaconKeys(void);                
 
@@ -439,6 +335,46 @@ public:
      */
     void stopEddystoneConfigService();
 
+    /**
+     * Get the advertising statistics of a slot: the number of frames put on
+     * air, a histogram of how late they went out relative to their scheduled
+     * time (buckets: <1, <2, <5, <10, <20, <50, <100 and >=100 ms) and the time
+     * spent swapping the frame in.
+     *
+     * @param[in] slot
+     *              The slot number.
+     * @param[out] stats
+     *              The statistics of the slot since boot or the last
+     *              resetSlotStats().
+     *
+     * @note Frames of slots running as advertising sets (USE_ADV_SETS) are
+     *       scheduled by the controller and are not accounted for.
+     */
+    void getSlotStats(uint8_t slot, SlotStats_t &stats);
+
+    /**
+     * Clear the advertising statistics of all slots.
+     */
+    void resetSlotStats(void);
+
+    /**
+     * Signal external activity (e.g. from an accelerometer interrupt, via the
+     * event queue). With ADAPTIVE_ADV_INTERVAL the slot intervals are
+     * shortened by EDDYSTONE_ADV_INTERVAL_ACTIVITY_SCALE for
+     * EDDYSTONE_ADV_INTERVAL_ACTIVITY_MS, starting with the next frame of
+     * each slot.
+     */
+    void onActivity(void);
+
+    /**
+     * Get the rate at which SoftDevice calls were skipped because they would
+     * not have changed the radio state (same TX power, same payload, or
+     * advertising already stopped), averaged since boot.
+     *
+     * @return The number of elided calls per hour.
+     */
+    uint32_t getElidedRadioCallsPerHour(void);
+
     /**
      * Tests if the beacon is locked or not
      *
@@ -479,13 +415,22 @@ public:
      *              The input/output array
      * @param[in] size
      *              The size of the array in bytes
+     *
+     * @return 0 on success, or the random generator error, in which case
+     *         the contents of @p ain must not be used.
      */
-    static void generateRandom(uint8_t *ain, int size);
+    static int generateRandom(uint8_t *ain, int size);
     
     /**
      * Timer that keeps track of the time since boot.
      */
     static Timer        timeSinceBootTimer;
+
+    /**
+     * The beacon's random generator, shared by generateRandom() and the EID
+     * key generation.
+     */
+    static DrbgService  drbg;
     
 private:
 
@@ -498,6 +443,38 @@ private:
     static const uint8_t REMAIN_CONNECTABLE_UNSET = 0x00;
     
     static const uint8_t CONFIG_FRAME_HDR_LEN = 4;
+
+    static const uint32_t RADIO_SHADOW_REPORT_PERIOD_MS = 3600000;
+
+    /* Largest frame of prepareAdvFrame(): an advertising payload is 31 bytes at most */
+    static const uint8_t ADV_FRAME_MAX_LEN = 31;
+
+    /**
+     * Shadow of the radio state last set through the BLE API, used to skip
+     * calls that would not change anything, and the number of calls skipped.
+     */
+    struct RadioShadow_t {
+        int8_t      txPower;
+        bool        txPowerValid;
+        bool        payloadValid;
+        uint8_t     payloadLength;
+        uint8_t     payload[ADV_FRAME_MAX_LEN];
+        uint32_t    elidedTxPowerCalls;
+        uint32_t    elidedPayloadUpdates;
+        uint32_t    elidedStopCalls;
+        uint64_t    countStartTimeMs;
+        uint64_t    nextReportTimeMs;
+    };
+
+    /**
+     * Work done by the EID rotations since boot: EID values recomputed, MAC
+     * address changes and time checkpoints written to flash.
+     */
+    struct EidRotationStats_t {
+        uint32_t    eidUpdates;
+        uint32_t    macChanges;
+        uint32_t    timeCheckpoints;
+    };
      
     /**
      * Helper funtion that will be registered as an initialization complete
@@ -522,6 +499,60 @@ private:
      */
     void swapAdvertisedFrame(int slot);
 
+    /**
+     * Set the radio TX power, unless the radio already uses it.
+     *
+     * @param[in] radioTxPower
+     *              The radio TX power in dBm.
+     */
+    void setRadioTxPower(int8_t radioTxPower);
+
+    /**
+     * Forget the shadowed TX power and payload, so the next frame sets both.
+     * Needed whenever the payload or power is changed outside of
+     * swapAdvertisedFrame().
+     */
+    void invalidateRadioShadow(void);
+
+    /**
+     * Helper function that brings the frame in a slot up to date (TLM data,
+     * EID rotation) and returns the service data to advertise for it.
+     *
+     * @param[in] slot
+     *              The slot whose frame is prepared.
+     * @param[out] advFrameLength
+     *              The length in bytes of the returned frame.
+     *
+     * @return A pointer to the service data of the frame.
+     */
+    const uint8_t* prepareAdvFrame(int slot, size_t &advFrameLength);
+
+    /**
+     * When the BLE stack supports advertising sets, give each slot its own
+     * set with the slot's interval and radio TX power, so the controller
+     * interleaves the frames itself and manageRadio() is not used.
+     *
+     * @return true if every slot got an advertising set, false if the
+     *         legacy frame swapper has to be used instead.
+     */
+    bool startAdvertisingSets(void);
+
+    /**
+     * Update the payload of the advertising set of a slot. Called
+     * periodically for TLM and EID slots, whose frames change over time.
+     *
+     * @param[in] slot
+     *              The slot whose advertising set is refreshed.
+     *
+     * @return true if the payload was accepted by the BLE stack.
+     */
+    bool refreshAdvertisingSet(int slot);
+
+    /**
+     * Event queue callback wrapper for refreshAdvertisingSet().
+     */
+    void refreshAdvertisingSetCallback(int slot);
+
     /**
      * Helper function that manages the BLE radio that is used to broadcast
      * advertising packets. To advertise frames at the configured intervals
@@ -538,9 +569,19 @@ private:
      */
     void manageRadio(void);
 
+    /**
+     * Post the enqueueFrame() callback for the next frame of a slot: one
+     * slotAdvIntervals[slot] plus a random jitter of up to
+     * EDDYSTONE_ADV_JITTER_MS after the time the current frame was due.
+     *
+     * @param[in] slot
+     *              The slot to schedule.
+     */
+    void scheduleNextFrame(int slot);
+
     /**
      * Regular callbacks posted at the rate of slotAdvPeriod[slot] milliseconds
-     * enqueue frames to be advertised. If the
+     * (see scheduleNextFrame()) enqueue frames to be advertised. If the
      * frame queue is currently empty, then this function directly calls
      * manageRadio() to broadcast the required FrameType.
      *
@@ -549,6 +590,35 @@ private:
      */
     void enqueueFrame(int slot);
 
+    /**
+     * Periodic callback that feeds the battery voltage from the registered
+     * TLM callback to the advertising interval policy.
+     */
+    void sampleBatteryVoltage(void);
+
+    /**
+     * The interval to use for the next frame of a slot.
+     *
+     * @param[in] slot
+     *              The slot number.
+     *
+     * @return slotAdvIntervals[slot], adapted by the advertising interval
+     *         policy if ADAPTIVE_ADV_INTERVAL is defined.
+     */
+    uint16_t getSlotAdvInterval(int slot);
+
+    /**
+     * Account for a frame of a slot put on air by manageRadio().
+     *
+     * @param[in] slot
+     *              The slot of the frame.
+     * @param[in] latencyMs
+     *              How late the frame went out relative to its scheduled time.
+     * @param[in] swapTimeUs
+     *              The time taken to swap the frame in.
+     */
+    void updateSlotStats(int slot, uint32_t latencyMs, uint32_t swapTimeUs);
+
     /**
      * Helper function that updates the advertising payload when in
      * EDDYSTONE_MODE_BEACON to contain a new frame.
@@ -560,6 +630,21 @@ private:
      */
     void updateAdvertisementPacket(const uint8_t* rawFrame, size_t rawFrameLength);
 
+    /**
+     * Helper function that builds the raw advertising payload (flags,
+     * Eddystone service UUID and service data) for a frame.
+     *
+     * @param[in] rawFrame
+     *              The raw bytes of the frame to advertise.
+     * @param[in] rawFrameLength
+     *              The length in bytes of the array pointed to by @p rawFrame.
+     * @param[out] payload
+     *              Buffer of GAP_ADVERTISING_DATA_MAX_PAYLOAD bytes.
+     *
+     * @return The length of the payload, or 0 if the frame does not fit.
+     */
+    uint8_t buildAdvertisingPayload(const uint8_t* rawFrame, size_t rawFrameLength, uint8_t* payload);
+
     /**
      * Helper function that updates the information in the Eddystone-TLM frames
      * Internally, this function executes the registered callbacks to update
@@ -567,8 +652,11 @@ private:
      * function updates the raw frame data. This operation must be done fairly
      * often because the Eddystone-TLM frame Time Since Boot must have a 0.1
      * seconds resolution according to the Eddystone specification.
+     *
+     * @return false if the frame is an ETLM and no salt could be drawn, in
+     *         which case the frame is left unchanged.
      */
-    void updateRawTLMFrame(uint8_t* frame);
+    bool updateRawTLMFrame(uint8_t* frame);
 
     /**
      * Calculate the Frame pointer from the slot number
@@ -745,6 +833,16 @@ private:
      */
     void readAdvIntervalAuthorizationCallback(GattReadAuthCallbackParams *authParams);
 
+    /**
+     * This callback is invoked when a GATT client attempts to read from the
+     * Slot Diagnostics characteristic, which is blocked if the beacon lock is
+     * set to LOCKED. The value is refreshed with the stats of the active slot.
+     *
+     * @param[in] authParams
+     *              Information about the values that are being read.
+     */
+    void readSlotDiagnosticsAuthorizationCallback(GattReadAuthCallbackParams *authParams);
+
     /**
      * Calculates the index in the radio power levels array which can be used
      * to index into the adv power levels array to find the calibrated adv power
@@ -797,6 +895,126 @@ private:
      */
     void aes128Decrypt(uint8_t *key, uint8_t *input, uint8_t *output);
 
+    /**
+     * Get the Eid Identity Key of a slot expanded for encryption, from the
+     * key schedule cache.
+     *
+     * @param[in] slot
+     *              The slot number
+     *
+     * @return The AES context to pass to EIDFrame::update() and
+     *         TLMFrame::encryptData()
+     */
+    const Aes128Context* getSlotKeyContext(int slot);
+
+    /**
+     * Get the EAX state of the Eid Identity Key of a slot, used to encrypt
+     * the TLM frame. It is computed once per key.
+     *
+     * @param[in] slot
+     *              The slot number
+     *
+     * @return The EAX context to pass to TLMFrame::encryptData()
+     */
+    const eddy_eax_context* getSlotEaxContext(int slot);
+
+    /**
+     * Post a refill of the random pool if it runs low. The refill runs
+     * after the events already queued, i.e. when the beacon is idle.
+     */
+    void scheduleRandomPoolRefill(void);
+
+    /**
+     * Refill the random pool (event queue callback).
+     */
+    void refillRandomPool(void);
+
+    /**
+     * Post the preparation of the next unlock challenge and token if none
+     * is ready or posted, so it runs when the beacon is idle.
+     */
+    void scheduleUnlockChallenge(void);
+
+    /**
+     * Prepare the next unlock challenge and token now, if none is ready.
+     *
+     * @return false if no random challenge could be drawn.
+     */
+    bool prepareUnlockChallenge(void);
+
+    /**
+     * Prepare the next unlock challenge and token (event queue callback).
+     */
+    void prepareUnlockChallengeTask(void);
+
+    /**
+     * Move the prepared unlock challenge and token into challenge and
+     * unlockToken, preparing them now if the idle task has not run yet,
+     * and post the preparation of the following pair.
+     *
+     * @return false if no challenge could be prepared. The previous token is
+     *         then refused until a new challenge is issued.
+     */
+    bool nextUnlockChallenge(void);
+
+    /**
+     * Generate the EID Beacon ECDH Keys (event queue callback).
+     */
+    void genEIDBeaconKeysTask(void);
+
+    /**
+     * Make sure the EID Beacon ECDH Keys are available, generating them now
+     * if the posted generation has not run yet.
+     *
+     * @return true if the keys are ready, false if the generation failed.
+     */
+    bool ensureEIDBeaconKeys(void);
+
+    /**
+     * Get the EID temporary key of a slot expanded for encryption. It is
+     * derived from the Eid Identity Key once per 2^16 second epoch and kept
+     * in the key schedule cache.
+     *
+     * @param[in] slot
+     *              The slot number
+     * @param[in] timeSecs
+     *              The time in seconds
+     *
+     * @return The AES context to pass to EIDFrame::updateFromTemporaryKey()
+     */
+    const Aes128Context* getSlotTempKeyContext(int slot, uint32_t timeSecs);
+
+    /**
+     * Recompute the EID value in the frame of an EID slot.
+     *
+     * @param[in] slot
+     *              The slot number
+     * @param[in] frame
+     *              The raw frame of the slot
+     * @param[in] timeSecs
+     *              The time in seconds
+     */
+    void updateEidFrame(int slot, uint8_t* frame, uint32_t timeSecs);
+
+    /**
+     * Rotate every EID slot whose rotation boundary has passed, with one MAC
+     * address change and one time checkpoint for all of them, and schedule
+     * their next rotation on the following boundary.
+     *
+     * @param[in] timeSecs
+     *              The time since first boot in seconds
+     */
+    void rotateEidSlots(uint32_t timeSecs);
+
+#ifdef CRYPTO_BENCHMARK
+    /**
+     * Run the crypto known answer tests, then log the cycles, stack and heap
+     * taken by the EID and ETLM computations, with and without the key
+     * schedule cache, and by the key exchange.
+     */
+    void runCryptoBenchmark(void);
+#endif
+
 
 
     /**
@@ -825,14 +1043,12 @@ private:
     uint16_t correctAdvertisementPeriod(uint16_t beaconPeriodIn) const;
     
     /**
-     * Swaps the endianess of a 16-bit unsigned int
-     *
-     * @param[in] arg
-     *              The value with the byte order to be reversed
+     * Select a new random static MAC address (if EID_RANDOM_MAC is defined).
      *
-     * @return The resulting 16-bit value with byte order reversed
+     * @return false if no random bytes were available and the current address
+     *         was kept.
      */
-    void setRandomMacAddress(void);     
+    bool setRandomMacAddress(void);     
     
     /**
      * Finds the first EID slot set
@@ -881,6 +1097,11 @@ private:
      * Parameter to consistently record the return code when generating Beacon Keys
      */
     int                                                             genBeaconKeyRC;
+
+    /**
+     * Whether privateEcdhKey/publicEcdhKey hold a generated key pair.
+     */
+    bool                                                            beaconKeysReady;
     
     /**
      * Keeps track of time in prior boots and current/last boot
@@ -957,6 +1178,12 @@ private:
      */
     Lock_t                                                          unlockToken;
 
+    /**
+     * Whether unlockToken may unlock the beacon. Cleared when a fresh
+     * challenge was needed but none could be drawn, so an old token cannot
+     * be replayed.
+     */
+    bool                                                            unlockTokenValid;
 
     /**
      * EID: An array holding the 256-bit private Ecdh Key (big endian)
@@ -983,6 +1210,25 @@ private:
      */
     SlotEidIdentityKeys_t                                           slotEidIdentityKeys;
 
+    /**
+     * Expanded AES key schedules of the slot Eid Identity Keys and of the
+     * unlock key.
+     */
+    AesKeyCache                                                     aesKeyCache;
+
+    /**
+     * The next unlock challenge and token, prepared in idle time.
+     */
+    UnlockChallenge                                                 unlockChallenge;
+
+    /**
+     * EAX state of the Eid Identity Key used for the ETLM frame, and the key
+     * it was computed for.
+     */
+    eddy_eax_context                                                etlmEaxContext;
+    EidIdentityKey_t                                                etlmEaxKey;
+    bool                                                            etlmEaxValid;
+
     /**
      * EID: An array holding the slot Eid Public Ecdh Keys
      */
@@ -1096,6 +1342,12 @@ private:
      */
     ReadWriteGattCharacteristic<uint8_t>                            *remainConnectableChar;
 
+    /**
+     * Pointer to the BLE API characteristic encapsulation for the Slot
+     * Diagnostics characteristic.
+     */
+    GattCharacteristic                                              *slotDiagnosticsChar;
+
     /**
      * END OF GATT CHARACTERISTICS
      */
@@ -1105,6 +1357,17 @@ private:
      */
     SlotEidNextRotationTimes_t                                      slotEidNextRotationTimes;
 
+    /**
+     * EID: Bit mask of the slots rotated since their advertising set payload
+     * was last pushed (bit n = slot n)
+     */
+    uint32_t                                                        slotEidPayloadsPending;
+
+    /**
+     * EID: Rotation statistics, see EidRotationStats_t
+     */
+    EidRotationStats_t                                              eidRotationStats;
+
     /**
      * EID: Storage for the current slot encrypted EID Identity Key
      */
@@ -1148,11 +1411,80 @@ private:
      */
     SlotCallbackHandles_t                                           slotCallbackHandles;
 
+    /**
+     * Time since boot (ms) at which the next frame of each slot is due.
+     */
+    uint32_t                                                        slotNextAdvTimesMs[MAX_ADV_SLOTS];
+
+    /**
+     * Time since boot (ms) at which the frame of each slot waiting in the
+     * advFrameQueue was due, used to measure its lateness.
+     */
+    uint32_t                                                        slotFrameDueTimesMs[MAX_ADV_SLOTS];
+
+    /**
+     * Shadow of the radio state, see RadioShadow_t
+     */
+    RadioShadow_t                                                   radioShadow;
+
+    /**
+     * Advertising statistics of each slot
+     */
+    SlotStatsTable_t                                                slotStats;
+
+    /**
+     * Value of the Slot Diagnostics characteristic
+     */
+    SlotDiagnostics_t                                               slotDiagnostics;
+
+    /**
+     * Policy adapting the slot intervals to the battery voltage and activity
+     */
+    AdvIntervalPolicy                                               advIntervalPolicy;
+
+    /**
+     * Callback handle of the periodic sampleBatteryVoltage() callback
+     */
+    event_queue_t::event_handle_t                                   batterySampleCallbackHandle;
+
+    /**
+     * State of the generator used for the slot phase offsets and jitter.
+     */
+    uint32_t                                                        advJitterState;
+
     /**
      * Callback handle to keep track of manageRadio() callbacks.
      */
     event_queue_t::event_handle_t                                   radioManagerCallbackHandle;
 
+    /**
+     * Handle of the pending random pool refill, NULL if none is posted.
+     */
+    event_queue_t::event_handle_t                                   randomPoolRefillHandle;
+
+    /**
+     * Handle of the pending unlock challenge preparation, NULL if none is posted.
+     */
+    event_queue_t::event_handle_t                                   unlockChallengeHandle;
+
+    /**
+     * Handle of the pending beacon key generation, NULL if none is posted.
+     */
+    event_queue_t::event_handle_t                                   beaconKeyGenHandle;
+
+    /**
+     * Whether the slots are advertised through advertising sets rather than
+     * by manageRadio().
+     */
+    bool                                                            advSetsActive;
+
+    /**
+     * Time since boot (ms) at which the advertising sets were started, and
+     * the PDU count estimated since then, used to keep the TLM ADV_CNT going.
+     */
+    uint64_t                                                        advSetsStartTimeMs;
+    uint32_t                                                        advSetsPduCount;
+
     /**
      * GattCharacteristic table used to populate the BLE ATT table in the
      * GATT Server.
@@ -1164,10 +1496,13 @@ private:
      */
     const char                                                      *deviceName;
 
+#ifndef EDDYSTONE_CONSTEXPR_URL
     /**
      * Defines an array of string constants (a container) used to initialise any URL slots
+     * (encoded at compile time with EDDYSTONE_CONSTEXPR_URL)
      */
     static const char* const slotDefaultUrls[];
+#endif
 
     /**
      * Defines an array of UIDs to initialize UID slots
@@ -1179,6 +1514,11 @@ private:
      */
     static const uint8_t slotDefaultEidIdentityKeys[MAX_ADV_SLOTS][16];
 
+    /**
+     * Defines the phase offset (ms) of the first frame of each slot
+     */
+    static const uint16_t slotDefaultAdvOffsets[MAX_ADV_SLOTS];
+
     /**
      * Defines default EID payload before being updated with the first EID rotation value
      */
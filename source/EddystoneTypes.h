@@ -118,6 +118,12 @@ const uint8_t UUID_FACTORY_RESET_CHAR[]         = UUID_ES_BEACON(0x75, 0x0b);
  */
 const uint8_t UUID_REMAIN_CONNECTABLE_CHAR[]    = UUID_ES_BEACON(0x75, 0x0c);
 
+/**
+ * 128-bit UUID for the Slot Diagnostics characteristic (not part of the
+ * Eddystone GATT specification).
+ */
+const uint8_t UUID_SLOT_DIAGNOSTICS_CHAR[]      = UUID_ES_BEACON(0x75, 0x0d);
+
 /** END OF CHARACTERISTICS  */
 
 /**
@@ -203,6 +209,38 @@ typedef uint32_t SlotEidNextRotationTimes_t[MAX_ADV_SLOTS];
  */
 typedef EidIdentityKey_t SlotEidIdentityKeys_t[MAX_ADV_SLOTS];
 
+/**
+ * Number of buckets in the per slot frame latency histogram
+ */
+const uint8_t SLOT_LATENCY_BUCKETS = 8;
+
+/**
+ * Per slot advertising statistics, maintained by enqueueFrame() and manageRadio()
+ */
+typedef struct {
+    /* Frames put on air */
+    uint32_t pduCount;
+    /* Frames by lateness relative to their scheduled time, see EddystoneService::getSlotStats() */
+    uint16_t latencyHistogram[SLOT_LATENCY_BUCKETS];
+    /* Worst lateness in ms */
+    uint16_t maxLatencyMs;
+    /* Worst and accumulated time spent in swapAdvertisedFrame() in us */
+    uint16_t maxSwapTimeUs;
+    uint32_t totalSwapTimeUs;
+} SlotStats_t;
+
+/**
+ * Type representing the per slot statistics of all slots
+ */
+typedef SlotStats_t SlotStatsTable_t[MAX_ADV_SLOTS];
+
+/**
+ * Type representing the Slot Diagnostics characteristic value (big endian):
+ * slot, pduCount(4), latencyHistogram(2 each), maxLatencyMs(2),
+ * maxSwapTimeUs(2), meanSwapTimeUs(2)
+ */
+typedef uint8_t SlotDiagnostics_t[1 + 4 + 2 * SLOT_LATENCY_BUCKETS + 2 + 2 + 2];
+
 /**
  * Size in bytes of UID namespace ID.
  */
@@ -85,6 +85,10 @@
  *   NO_4SEC_START_DELAY: Debugging flag to pause 4s before starting; allow time to connect virtual terminal
  *   NO_EAX_TEST: Debugging flag: when not define, test will check x = EAX_DECRYPT(EAX_ENCRYPT(x)), output in LOG
  *   NO_LOGGING: Debugging flag; controls logging to virtual terminal
+ *   CRYPTO_BENCHMARK: Debugging flag; runs the crypto known answer tests (crypto_selftest.h) at boot,
+ *                     then prints the cycles, stack and heap used by the EID/ETLM computations
+ *                     (with and without the key schedule cache) and the key exchange (leave
+ *                     commented out for production; set MBED_HEAP_STATS_ENABLED for heap figures)
  */ 
 #define GEN_BEACON_KEYS_AT_INIT
 #define HARDWARE_RANDOM_NUM_GENERATOR
@@ -94,6 +98,40 @@
 #define NO_4SEC_START_DELAY
 #define NO_EAX_TEST
 #define NO_LOGGING
+// #define CRYPTO_BENCHMARK
+
+/**
+ * ADVERTISING OPTIONS
+ * Key
+ *   USE_ADV_SETS: advertise each slot in its own BLE 5 advertising set when the BLE stack
+ *                 supports it, otherwise slots are swapped in and out of the legacy advertiser
+ *   ADV_SETS_HOST_STUB: testing flag; emulates advertising sets in software (no BLE 5 controller needed)
+ *   RANDOM_ADV_OFFSETS: start each slot at a random phase within its interval, so co-located beacons
+ *                       that boot together do not stay in step (overrides EDDYSTONE_DEFAULT_SLOT_ADV_OFFSETS)
+ *   INCLUDE_SLOT_DIAGNOSTICS: adds a read only characteristic to the configuration service reporting
+ *                             the frame count, latency histogram and swap times of the active slot
+ *   ADAPTIVE_ADV_INTERVAL: stretch the slot intervals as the battery voltage (TLM battery callback) drops,
+ *                          and shorten them for a while after EddystoneService::onActivity()
+ */
+// #define USE_ADV_SETS
+// #define ADV_SETS_HOST_STUB
+// #define RANDOM_ADV_OFFSETS
+// #define INCLUDE_SLOT_DIAGNOSTICS
+// #define ADAPTIVE_ADV_INTERVAL
+
+/**
+ * AES OPTIONS
+ * The AES-128 block cipher used for EID, ETLM and the lock (see Aes128Backend.h); define at most one,
+ * with none the mbedtls implementation is used
+ * Key
+ *   AES128_BACKEND_CT: table-free constant-time software AES (aes128_ct.h), slower but with no
+ *                      secret dependent memory accesses and smaller cached key schedules
+ *   AES128_BACKEND_NRF_ECB: the nRF ECB peripheral through the SoftDevice for encryption (EID, ETLM,
+ *                           unlock challenges), AES128_BACKEND_CT for decryption of the new lock keys
+ *   AES128_BACKEND_AESNI: host builds of the firmware sources only (tools/CryptoBench, with -maes)
+ */
+// #define AES128_BACKEND_CT
+// #define AES128_BACKEND_NRF_ECB
 
 /* Default enable printf logging, unless explicitly NO_LOGGING */
 #ifdef NO_LOGGING
@@ -151,6 +189,26 @@
 
 #define EDDYSTONE_DEFAULT_SLOT_TX_POWERS { -8, -8, -8 }
 
+/* Phase offset (ms) of the first frame of each slot, used unless RANDOM_ADV_OFFSETS */
+#define EDDYSTONE_DEFAULT_SLOT_ADV_OFFSETS { 0, 0, 0 }
+
+/* Upper bound (ms) of the random delay added to each slot frame, 0 disables the jitter */
+#define EDDYSTONE_ADV_JITTER_MS 10
+
+/* ADAPTIVE_ADV_INTERVAL: below each battery level (mV, decreasing) the slot intervals are scaled (percent) */
+#define EDDYSTONE_ADV_INTERVAL_BATTERY_LEVELS_MV { 2700, 2500, 2300 }
+#define EDDYSTONE_ADV_INTERVAL_BATTERY_SCALES { 150, 200, 400 }
+#define EDDYSTONE_ADV_INTERVAL_BATTERY_HYSTERESIS_MV 50
+#define EDDYSTONE_ADV_INTERVAL_BATTERY_SAMPLE_MS 60000
+/* ADAPTIVE_ADV_INTERVAL: slot intervals are scaled (percent) for a while (ms) after an activity signal */
+#define EDDYSTONE_ADV_INTERVAL_ACTIVITY_SCALE 25
+#define EDDYSTONE_ADV_INTERVAL_ACTIVITY_MS 30000
+
+/* Random bytes kept ready for generateRandom(), topped up from the DRBG in idle time */
+#define EDDYSTONE_RANDOM_POOL_SIZE 32
+/* Number of DRBG requests between reseeds from the hardware entropy source */
+#define EDDYSTONE_DRBG_RESEED_INTERVAL 64
+
 /**
  * Lock constants
  */
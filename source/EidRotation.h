@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2016, Google Inc, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __EID_ROTATION_H__
+#define __EID_ROTATION_H__
+
+#include <stdint.h>
+
+/**
+ * Helpers used by EddystoneService to rotate all the EID slots that share
+ * a rotation boundary together.
+ *
+ * An EID only changes when the scaled time (t >> k) << k changes, i.e. on
+ * multiples of 2^k seconds. Scheduling every slot's next rotation on that
+ * boundary, rather than one period after the frame that happened to update
+ * it, means slots with the same exponent rotate in the same second, and a
+ * slot with a larger exponent only ever rotates on a boundary of the smaller
+ * ones. The beacon then recomputes all of them in one pass, with a single
+ * MAC address change and a single time checkpoint to flash, and the ETLM
+ * nonce (the same scaled time) moves to the new window with them.
+ *
+ * They have no dependency on mbed so the host rotation simulator
+ * (tools/EidRotationSim) runs exactly the same code.
+ */
+
+/**
+ * Start of the rotation window following the one that holds a time.
+ *
+ * @param[in] timeSecs
+ *              The time since first boot, in seconds.
+ * @param[in] rotationPeriodExp
+ *              The rotation period exponent k of the slot (period 2^k s).
+ *
+ * @return The next multiple of 2^k seconds after @p timeSecs.
+ */
+inline uint32_t eddystoneEidNextRotationTime(uint32_t timeSecs, uint8_t rotationPeriodExp)
+{
+    return ((timeSecs >> rotationPeriodExp) + 1) << rotationPeriodExp;
+}
+
+/**
+ * Find the EID slots whose rotation is due.
+ *
+ * @param[in] eidSlots
+ *              Bit mask of the slots holding an EID frame (bit n = slot n).
+ * @param[in] nextRotationTimes
+ *              The time each slot is next due for rotation.
+ * @param[in] numSlots
+ *              The number of slots, at most 32.
+ * @param[in] timeSecs
+ *              The current time since first boot, in seconds.
+ *
+ * @return Bit mask of the EID slots due, to be rotated together.
+ */
+inline uint32_t eddystoneEidDueSlots(uint32_t eidSlots, const uint32_t *nextRotationTimes, int numSlots, uint32_t timeSecs)
+{
+    uint32_t due = 0;
+    for (int slot = 0; slot < numSlots; slot++) {
+        if ((eidSlots & (1u << slot)) && (timeSecs >= nextRotationTimes[slot])) {
+            due |= 1u << slot;
+        }
+    }
+    return due;
+}
+
+#endif // __EID_ROTATION_H__
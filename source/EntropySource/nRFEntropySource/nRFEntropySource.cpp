@@ -53,7 +53,10 @@ int eddystoneEntropyPoll(void *data, unsigned char *output, size_t len, size_t *
 
 int eddystoneRegisterEntropySource(	mbedtls_entropy_context* ctx) {
     uint8_t pool_capacity;
-    sd_rand_application_pool_capacity_get(&pool_capacity);
+    // fails if the SoftDevice is not enabled yet
+    if (sd_rand_application_pool_capacity_get(&pool_capacity) != NRF_SUCCESS) {
+        return MBEDTLS_ERR_ENTROPY_SOURCE_FAILED;
+    }
 
     return mbedtls_entropy_add_source(
         ctx,
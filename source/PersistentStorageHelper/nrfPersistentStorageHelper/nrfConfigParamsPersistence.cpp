@@ -22,20 +22,9 @@ extern "C" {
 
 #include "nrf_error.h"
 #include "../../EddystoneService.h"
+#include "nrfPersistentParams.h"
 #include <cstddef>
 
-/**
- * Nordic specific structure used to store params persistently.
- * It extends EddystoneService::EddystoneParams_t with a persistence signature.
- */
-struct PersistentParams_t {
-    EddystoneService::EddystoneParams_t params;
-    uint32_t                         persistenceSignature; /* This isn't really a parameter, but having the expected
-                                                            * magic value in this field indicates persistence. */
-
-    static const uint32_t MAGIC = 0x1BEAC000;              /* Magic that identifies persistence */
-};
-
 /**
  * The following is a module-local variable to hold configuration parameters for
  * short periods during flash access. This is necessary because the fstorage
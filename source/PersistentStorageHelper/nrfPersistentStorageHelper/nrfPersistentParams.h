@@ -0,0 +1,36 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2015 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __NRF_PERSISTENT_PARAMS_H__
+#define __NRF_PERSISTENT_PARAMS_H__
+
+#include <stdint.h>
+#include "../../EddystoneParams.h"
+
+/**
+ * Nordic specific structure used to store params persistently.
+ * It extends EddystoneParams_t with a persistence signature. This is the
+ * layout of the flash page, which tools/FactoryImage also writes.
+ */
+struct PersistentParams_t {
+    EddystoneParams_t       params;
+    uint32_t                persistenceSignature;  /* This isn't really a parameter, but having the expected
+                                                    * magic value in this field indicates persistence. */
+
+    static const uint32_t MAGIC = 0x1BEAC000;      /* Magic that identifies persistence */
+};
+
+#endif /* #ifndef __NRF_PERSISTENT_PARAMS_H__ */
@@ -31,6 +31,10 @@ TLMFrame::TLMFrame(uint8_t  tlmVersionIn,
 {
 }
 
+void TLMFrame::clearFrame(uint8_t* frame) {
+    frame[FRAME_LEN_OFFSET] = 0; // Set frame length to zero to clear it
+}
+
 void TLMFrame::setTLMData(uint8_t tlmVersionIn)
 {
     /* According to the Eddystone spec BatteryVoltage is 0 and
@@ -65,28 +69,39 @@ void TLMFrame::setData(uint8_t *rawFrame)  // add eidTime - a 4 byte quantity
     rawFrame[index++] = (uint8_t)(tlmTimeSinceBoot >> 0);     // Time Since Boot [3]
 }
 
-void TLMFrame::encryptData(uint8_t* rawFrame, uint8_t* eidIdentityKey, uint8_t rotationPeriodExp, uint32_t beaconTimeSecs) {
+int TLMFrame::encryptData(uint8_t* rawFrame, uint8_t* eidIdentityKey, uint8_t rotationPeriodExp, uint32_t beaconTimeSecs) {
     // Initialize AES data
-    mbedtls_aes_context ctx;
-    mbedtls_aes_init(&ctx); 
-    mbedtls_aes_setkey_enc(&ctx, eidIdentityKey, sizeof(EidIdentityKey_t) *8 );
-    // Change the TLM version number to the encrypted version
-    rawFrame[VERSION_OFFSET] = ETLM_VERSION; // Encrypted TLM Version number
+    Aes128Context ctx;
+    Aes128Backend::init(&ctx);
+    Aes128Backend::setKeyEnc(&ctx, eidIdentityKey);
+    LOG(("EIDIdentityKey=\r\n")); EddystoneService::logPrintHex(eidIdentityKey, 16);
+    eddy_eax_context eax;
+    eddy_eax_setup(&eax, &ctx);
+    int rc = encryptData(rawFrame, &eax, rotationPeriodExp, beaconTimeSecs);
+    Aes128Backend::free(&ctx);
+    return rc;
+}
+
+int TLMFrame::encryptData(uint8_t* rawFrame, const eddy_eax_context* eidIdentityKeyEax, uint8_t rotationPeriodExp, uint32_t beaconTimeSecs) {
     // Create EAX Params
     uint8_t nonce[ETLM_NONCE_LEN];
-    // Calculate the 48-bit nonce
-    generateEtlmNonce(nonce, rotationPeriodExp, beaconTimeSecs);
+    // Calculate the 48-bit nonce, a reused salt would repeat the EAX keystream
+    int rc = generateEtlmNonce(nonce, rotationPeriodExp, beaconTimeSecs);
+    if (rc != 0) {
+        return rc;
+    }
+    // Change the TLM version number to the encrypted version
+    rawFrame[VERSION_OFFSET] = ETLM_VERSION; // Encrypted TLM Version number
  
     uint8_t* input = rawFrame + DATA_OFFSET;  // array size 12
     uint8_t output[ETLM_DATA_LEN]; // array size 16 (4 bytes are added: SALT[2], MIC[2])
     memset(output, 0, ETLM_DATA_LEN);
     uint8_t emptyHeader[1]; // Empty header
-    LOG(("EIDIdentityKey=\r\n")); EddystoneService::logPrintHex(eidIdentityKey, 16);
     LOG(("ETLM Encoder INPUT=\r\n")); EddystoneService::logPrintHex(input, 12);
     LOG(("ETLM SALT=\r\n")); EddystoneService::logPrintHex(nonce+4, 2);
     LOG(("ETLM Nonce=\r\n")); EddystoneService::logPrintHex(nonce, 6);
     // Encrypt the TLM to ETLM
-    eddy_aes_authcrypt_eax(&ctx, MBEDTLS_AES_ENCRYPT, nonce, sizeof(nonce), emptyHeader, 0, TLM_DATA_LEN, input, output, output + MIC_OFFSET, MIC_LEN);
+    eddy_eax_authcrypt(eidIdentityKeyEax, MBEDTLS_AES_ENCRYPT, nonce, sizeof(nonce), emptyHeader, 0, TLM_DATA_LEN, input, output, output + MIC_OFFSET, MIC_LEN);
 
 #ifndef NO_EAX_TEST
     // Part of test code to confirm x == EAX_DECRYPT( EAX_ENCRYPT(x) )
@@ -105,14 +120,13 @@ void TLMFrame::encryptData(uint8_t* rawFrame, uint8_t* eidIdentityKey, uint8_t r
     // Perform test to confirm x == EAX_DECRYPT( EAX_ENCRYPT(x) )
     uint8_t buf[ETLM_DATA_LEN];
     memset(buf, 0, ETLM_DATA_LEN);
-    int ret = eddy_aes_authcrypt_eax(&ctx, MBEDTLS_AES_DECRYPT, nonce, sizeof(nonce), emptyHeader, 0, TLM_DATA_LEN, newinput, buf, newinput + MIC_OFFSET, MIC_LEN);
+    int ret = eddy_eax_authcrypt(eidIdentityKeyEax, MBEDTLS_AES_DECRYPT, nonce, sizeof(nonce), emptyHeader, 0, TLM_DATA_LEN, newinput, buf, newinput + MIC_OFFSET, MIC_LEN);
     LOG(("ETLM Decoder OUTPUT ret=%d buf=\r\n", ret)); EddystoneService::logPrintHex(buf, 12);
 #endif
         
     // fix the frame length to the encrypted length
     rawFrame[FRAME_LEN_OFFSET] = FRAME_SIZE_ETLM + EDDYSTONE_UUID_SIZE; 
-    // Free the AES data struture
-    mbedtls_aes_free(&ctx);
+    return 0;
 }
     
 
@@ -159,9 +173,9 @@ void TLMFrame::updateBeaconTemperature(uint16_t tlmBeaconTemperatureIn)
     tlmBeaconTemperature = tlmBeaconTemperatureIn;
 }
 
-void TLMFrame::updatePduCount(void)
+void TLMFrame::updatePduCount(uint32_t pduCount)
 {
-    tlmPduCount++;
+    tlmPduCount += pduCount;
 }
 
 uint16_t TLMFrame::getBatteryVoltage(void) const
@@ -180,17 +194,17 @@ uint8_t TLMFrame::getTLMVersion(void) const
 }
 
 int TLMFrame::generateEtlmNonce(uint8_t* nonce, uint8_t rotationPeriodExp, uint32_t beaconTimeSecs) {
+    // nonce is a pointer here, callers pass an array of ETLM_NONCE_LEN bytes
     int rc = 0;
-    if (sizeof(nonce) != ETLM_NONCE_LEN) {
-      rc = ETLM_NONCE_INVALID_LEN; 
-    }
     uint32_t scaledTime = (beaconTimeSecs >> rotationPeriodExp) << rotationPeriodExp;
     int index = 0;
     nonce[index++] = (scaledTime  >> 24) & 0xff;
     nonce[index++] = (scaledTime >> 16) & 0xff;
     nonce[index++] = (scaledTime >> 8) & 0xff;
     nonce[index++] = scaledTime & 0xff;
-    EddystoneService::generateRandom(nonce + index, SALT_LEN);
+    if (EddystoneService::generateRandom(nonce + index, SALT_LEN) != 0) {
+        rc = ETLM_NONCE_NO_SALT;
+    }
     return rc;
 }
 
@@ -48,6 +48,11 @@ public:
              uint32_t tlmPduCountIn          = 0,
              uint32_t tlmTimeSinceBootIn     = 0);
 
+    /**
+     * Clear frame (intervally indicated by length = 0 )
+     */
+    void clearFrame(uint8_t* frame);
+
     /**
      * Set the Eddystone-TLM version number.
      */
@@ -74,8 +79,27 @@ public:
      *              Rotation exponent for EID
      * @param[in] beaconTimeSecs
      *              Time in seconds since beacon boot.
+     * @return 0 on success, or the random generator error if no salt could
+     *         be drawn, in which case the frame is left unchanged.
+     */
+    int encryptData(uint8_t* rawFrame, uint8_t* eidIdentityKey, uint8_t rotationPeriodExp, uint32_t beaconTimeSecs);
+
+    /**
+     * Construct the encrypted bytes of the Eddystone-ETLM frame, with the
+     * EAX state of the eidIdentityKey already computed (see eddy_eax_setup()).
+     *
+     * @param[in] rawFrame
+     *              Pointer to the location where the raw frame will be stored.
+     * @param[in] eidIdentityKeyEax
+     *              EAX context of the eidIdentityKey in use
+     * @param[in] rotationPeriodExp
+     *              Rotation exponent for EID
+     * @param[in] beaconTimeSecs
+     *              Time in seconds since beacon boot.
+     * @return 0 on success, or the random generator error if no salt could
+     *         be drawn, in which case the frame is left unchanged.
      */
-    void encryptData(uint8_t* rawFrame, uint8_t* eidIdentityKey, uint8_t rotationPeriodExp, uint32_t beaconTimeSecs);
+    int encryptData(uint8_t* rawFrame, const eddy_eax_context* eidIdentityKeyEax, uint8_t rotationPeriodExp, uint32_t beaconTimeSecs);
 
     /**
      * Get the size of the Eddystone-TLM frame constructed with the
@@ -155,9 +179,12 @@ public:
     void updateBeaconTemperature(uint16_t tlmBeaconTemperatureIn);
 
     /**
-     * Increment the current PDU counter by 1.
+     * Increment the current PDU counter.
+     *
+     * @param[in] pduCount
+     *              The number of PDUs sent since the last update.
      */
-    void updatePduCount(void);
+    void updatePduCount(uint32_t pduCount = 1);
 
     /**
      * Get the current Battery Voltage.
@@ -217,6 +244,7 @@ public:
     static const uint8_t MIC_LEN = 2;
     // Return codes
     static const int ETLM_NONCE_INVALID_LEN = -1;
+    static const int ETLM_NONCE_NO_SALT = -2;
 
     /**
      * Constructs 6 byte (48-bit) Nonce from an empty array, rotationExp and beacon time (secs) 
@@ -227,7 +255,7 @@ public:
      *              Rotation exponent for EID
      * @param[in] beaconTimeSecs
      *              Time in seconds since beacon boot.
-     * @return[out] return code (success = 0)
+     * @return[out] return code (success = 0, or the random generator error)
      */
     int generateEtlmNonce(uint8_t* nonce, uint8_t rotatePeriodExp, uint32_t beaconTimeSecs);
 
@@ -79,31 +79,6 @@ uint8_t URLFrame::encodeURL(uint8_t* encodedUrl, const char *rawUrl)
 {
     uint8_t urlDataLength = 0;
     
-    const char  *prefixes[] = {
-        "http://www.",
-        "https://www.",
-        "http://",
-        "https://",
-    };
-    const size_t NUM_PREFIXES = sizeof(prefixes) / sizeof(char *);
-    const char  *suffixes[]   = {
-        ".com/",
-        ".org/",
-        ".edu/",
-        ".net/",
-        ".info/",
-        ".biz/",
-        ".gov/",
-        ".com",
-        ".org",
-        ".edu",
-        ".net",
-        ".info",
-        ".biz",
-        ".gov"
-    };
-    const size_t NUM_SUFFIXES = sizeof(suffixes) / sizeof(char *);
-
     /*
      * Fill with one more 0 than max url data size to ensure its null terminated
      * And can be printed out for debug purposes
@@ -117,9 +92,9 @@ uint8_t URLFrame::encodeURL(uint8_t* encodedUrl, const char *rawUrl)
     /*
      * handle prefix
      */
-    for (size_t i = 0; i < NUM_PREFIXES; i++) {
-        size_t prefixLen = strlen(prefixes[i]);
-        if (strncmp(rawUrl, prefixes[i], prefixLen) == 0) {
+    for (uint8_t i = 0; i < NUM_URL_PREFIXES; i++) {
+        size_t prefixLen = strlen(getUrlPrefix(i));
+        if (strncmp(rawUrl, getUrlPrefix(i), prefixLen) == 0) {
             encodedUrl[urlDataLength++]  = i;
             rawUrl                      += prefixLen;
             break;
@@ -131,17 +106,17 @@ uint8_t URLFrame::encodeURL(uint8_t* encodedUrl, const char *rawUrl)
      */
     while (*rawUrl && (urlDataLength <= MAX_URL_DATA)) {
         /* check for suffix match */
-        size_t i;
-        for (i = 0; i < NUM_SUFFIXES; i++) {
-            size_t suffixLen = strlen(suffixes[i]);
-            if (strncmp(rawUrl, suffixes[i], suffixLen) == 0) {
+        uint8_t i;
+        for (i = 0; i < NUM_URL_SUFFIXES; i++) {
+            size_t suffixLen = strlen(getUrlSuffix(i));
+            if (strncmp(rawUrl, getUrlSuffix(i), suffixLen) == 0) {
                 encodedUrl[urlDataLength++]  = i;
                 rawUrl                      += suffixLen;
                 break; /* from the for loop for checking against suffixes */
             }
         }
         /* This is the default case where we've got an ordinary character which doesn't match a suffix. */
-        if (i == NUM_SUFFIXES) {
+        if (i == NUM_URL_SUFFIXES) {
             encodedUrl[urlDataLength++] = *rawUrl;
             ++rawUrl;
         }
@@ -20,6 +20,19 @@
 #include "EddystoneTypes.h"
 #include <string.h>
 
+/*
+ * With C++11 the URL encoding tables below are constexpr, and UrlEncoding.h
+ * encodes the compile-time URLs (the default slot URLs, the config URL)
+ * when the firmware is built. Otherwise URLFrame::encodeURL() encodes them
+ * at run time.
+ */
+#if __cplusplus >= 201103L
+#define EDDYSTONE_CONSTEXPR_URL
+#define URL_CONSTEXPR constexpr
+#else
+#define URL_CONSTEXPR
+#endif
+
 /**
  * Class that encapsulates data that belongs to the Eddystone-URL frame. For
  * more information refer to https://github.com/google/eddystone/tree/master/eddystone-url.
@@ -153,6 +166,44 @@ public:
      */
     static uint8_t encodeURL(uint8_t* encodedUrlData, const char* rawUrl);
 
+    /**
+     * The URL scheme prefix encoded as code, for code < NUM_URL_PREFIXES.
+     */
+    static URL_CONSTEXPR const char *getUrlPrefix(uint8_t code) {
+        return (code == 0) ? "http://www." :
+               (code == 1) ? "https://www." :
+               (code == 2) ? "http://" :
+                             "https://";
+    }
+
+    /**
+     * The expansion encoded as code, for code < NUM_URL_SUFFIXES.
+     */
+    static URL_CONSTEXPR const char *getUrlSuffix(uint8_t code) {
+        return (code == 0)  ? ".com/" :
+               (code == 1)  ? ".org/" :
+               (code == 2)  ? ".edu/" :
+               (code == 3)  ? ".net/" :
+               (code == 4)  ? ".info/" :
+               (code == 5)  ? ".biz/" :
+               (code == 6)  ? ".gov/" :
+               (code == 7)  ? ".com" :
+               (code == 8)  ? ".org" :
+               (code == 9)  ? ".edu" :
+               (code == 10) ? ".net" :
+               (code == 11) ? ".info" :
+               (code == 12) ? ".biz" :
+                              ".gov";
+    }
+
+    static const uint8_t NUM_URL_PREFIXES = 4;
+    static const uint8_t NUM_URL_SUFFIXES = 14;
+
+    /**
+     * The max size (in bytes) of the encoded URL in an Eddystone-URL frame.
+     */
+    static const uint8_t MAX_URL_DATA = 18;
+
     /**
      * The max size (in bytes) of an Eddystone-URL frame.
      */
@@ -175,11 +226,6 @@ private:
      * The minimum size (in bytes) of an Eddystone-URL frame.
      */
     static const uint8_t FRAME_MIN_SIZE_URL = 2;
-    
-    /**
-    * Offset for playload in a rawFrame UID
-    */
-    static const uint8_t MAX_URL_DATA = 18;
 };
 
 #endif /* __URLFRAME_H__ */
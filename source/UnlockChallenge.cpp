@@ -0,0 +1,61 @@
+/*
+ * Copyright (c) 2016, Google Inc, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+#include "UnlockChallenge.h"
+
+UnlockChallenge::UnlockChallenge(void) :
+    ready(false)
+{
+    memset(nextChallenge, 0, sizeof(Lock_t));
+    memset(nextUnlockToken, 0, sizeof(Lock_t));
+}
+
+UnlockChallenge::~UnlockChallenge(void)
+{
+    invalidate();
+}
+
+void UnlockChallenge::prepare(const uint8_t *random, const Aes128Context *unlockKeyCtx)
+{
+    memcpy(nextChallenge, random, sizeof(Lock_t));
+    Aes128Backend::encrypt(unlockKeyCtx, nextChallenge, nextUnlockToken);
+    ready = true;
+}
+
+bool UnlockChallenge::isReady(void) const
+{
+    return ready;
+}
+
+bool UnlockChallenge::take(uint8_t *challenge, uint8_t *unlockToken)
+{
+    if (!ready) {
+        return false;
+    }
+    memcpy(challenge, nextChallenge, sizeof(Lock_t));
+    memcpy(unlockToken, nextUnlockToken, sizeof(Lock_t));
+    invalidate();
+    return true;
+}
+
+void UnlockChallenge::invalidate(void)
+{
+    memset(nextChallenge, 0, sizeof(Lock_t));
+    memset(nextUnlockToken, 0, sizeof(Lock_t));
+    ready = false;
+}
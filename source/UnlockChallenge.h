@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2016, Google Inc, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __UNLOCKCHALLENGE_H__
+#define __UNLOCKCHALLENGE_H__
+
+#include <stdint.h>
+#include "Aes128Backend.h"
+#include "EddystoneTypes.h"
+
+/**
+ * Class that keeps the next unlock challenge and its expected token ready.
+ *
+ * Every read of the unlock characteristic, and every successful unlock,
+ * hands out a fresh challenge and must know the token (the challenge
+ * encrypted with the unlock key) the client will write back. Producing
+ * the pair takes random bytes and an AES block, which EddystoneService
+ * does in idle time through prepare(). The GATT callbacks then only copy
+ * the pair out with take(), and post the preparation of the next one.
+ *
+ * The prepared pair depends on the unlock key: invalidate() it when the
+ * key changes.
+ */
+class UnlockChallenge
+{
+public:
+    /**
+     * Construct a new instance of this class, with no pair ready.
+     */
+    UnlockChallenge(void);
+
+    /**
+     * Wipe the prepared pair.
+     */
+    ~UnlockChallenge(void);
+
+    /**
+     * Prepare the next pair.
+     *
+     * @param[in] random
+     *              16 fresh random bytes, the challenge.
+     * @param[in] unlockKeyCtx
+     *              The unlock key, expanded for encryption.
+     */
+    void prepare(const uint8_t *random, const Aes128Context *unlockKeyCtx);
+
+    /**
+     * Test whether a pair is ready.
+     */
+    bool isReady(void) const;
+
+    /**
+     * Move the prepared pair out. No pair is ready afterwards.
+     *
+     * @param[out] challenge
+     *              The challenge to expose on the unlock characteristic.
+     * @param[out] unlockToken
+     *              The token the client must write back.
+     *
+     * @return true if a pair was ready, false (and nothing written) otherwise.
+     */
+    bool take(uint8_t *challenge, uint8_t *unlockToken);
+
+    /**
+     * Drop the prepared pair, e.g. because the unlock key changed.
+     */
+    void invalidate(void);
+
+private:
+    Lock_t      nextChallenge;
+    Lock_t      nextUnlockToken;
+    bool        ready;
+};
+
+#endif  /* __UNLOCKCHALLENGE_H__ */
@@ -0,0 +1,184 @@
+/*
+ * Copyright (c) 2016, Google Inc, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __URL_ENCODING_H__
+#define __URL_ENCODING_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include "URLFrame.h"
+
+/**
+ * An Eddystone-URL encoded URL, as URLFrame::encodeURL() produces it.
+ */
+struct EncodedUrl_t {
+    uint8_t length;
+    uint8_t data[URLFrame::MAX_URL_DATA];
+};
+
+#ifdef EDDYSTONE_CONSTEXPR_URL
+/*
+ * Compile-time Eddystone-URL encoding of string literals, for the URLs
+ * fixed in Eddystone_config.h: the beacon then neither scans them at boot
+ * nor carries the prefix and suffix strings. C++11 constexpr functions
+ * are a single return, hence the recursion. The encoding is the one of
+ * URLFrame::encodeURL(), with the same tables: the first matching scheme
+ * prefix, then at each character the first matching expansion or the
+ * character itself.
+ */
+
+constexpr bool eddystoneUrlStartsWith(const char *s, const char *prefix)
+{
+    return (*prefix == '\0') || ((*s == *prefix) && eddystoneUrlStartsWith(s + 1, prefix + 1));
+}
+
+constexpr size_t eddystoneUrlStrlen(const char *s)
+{
+    return (*s == '\0') ? 0 : 1 + eddystoneUrlStrlen(s + 1);
+}
+
+/* The code of the scheme prefix of url, NUM_URL_PREFIXES if none */
+constexpr uint8_t eddystoneUrlPrefixCode(const char *url, uint8_t code = 0)
+{
+    return (code == URLFrame::NUM_URL_PREFIXES) ? code :
+           eddystoneUrlStartsWith(url, URLFrame::getUrlPrefix(code)) ? code :
+           eddystoneUrlPrefixCode(url, code + 1);
+}
+
+/* The code of the expansion at s, NUM_URL_SUFFIXES if none */
+constexpr uint8_t eddystoneUrlSuffixCode(const char *s, uint8_t code = 0)
+{
+    return (code == URLFrame::NUM_URL_SUFFIXES) ? code :
+           eddystoneUrlStartsWith(s, URLFrame::getUrlSuffix(code)) ? code :
+           eddystoneUrlSuffixCode(s, code + 1);
+}
+
+constexpr bool eddystoneUrlHasPrefix(const char *url)
+{
+    return eddystoneUrlPrefixCode(url) != URLFrame::NUM_URL_PREFIXES;
+}
+
+/* url past its scheme prefix */
+constexpr const char *eddystoneUrlBody(const char *url)
+{
+    return eddystoneUrlHasPrefix(url) ? url + eddystoneUrlStrlen(URLFrame::getUrlPrefix(eddystoneUrlPrefixCode(url))) : url;
+}
+
+/* The encoded byte of the body at s, and what follows it */
+constexpr uint8_t eddystoneUrlBodyToken(const char *s)
+{
+    return (eddystoneUrlSuffixCode(s) != URLFrame::NUM_URL_SUFFIXES) ? eddystoneUrlSuffixCode(s) : (uint8_t)*s;
+}
+
+constexpr const char *eddystoneUrlBodyNext(const char *s)
+{
+    return (eddystoneUrlSuffixCode(s) != URLFrame::NUM_URL_SUFFIXES) ?
+           s + eddystoneUrlStrlen(URLFrame::getUrlSuffix(eddystoneUrlSuffixCode(s))) : s + 1;
+}
+
+constexpr size_t eddystoneUrlBodyLength(const char *s)
+{
+    return (*s == '\0') ? 0 : 1 + eddystoneUrlBodyLength(eddystoneUrlBodyNext(s));
+}
+
+constexpr uint8_t eddystoneUrlBodyByte(const char *s, size_t index)
+{
+    return (*s == '\0') ? 0 :
+           (index == 0) ? eddystoneUrlBodyToken(s) :
+           eddystoneUrlBodyByte(eddystoneUrlBodyNext(s), index - 1);
+}
+
+/**
+ * The length of the encoding of url, whether or not it fits a frame.
+ */
+constexpr size_t eddystoneEncodedUrlLength(const char *url)
+{
+    return (url == NULL || *url == '\0') ? 0 :
+           (eddystoneUrlHasPrefix(url) ? 1 : 0) + eddystoneUrlBodyLength(eddystoneUrlBody(url));
+}
+
+/**
+ * Byte index of the encoding of url, 0 past its end.
+ */
+constexpr uint8_t eddystoneEncodedUrlByte(const char *url, size_t index)
+{
+    return (index >= eddystoneEncodedUrlLength(url)) ? 0 :
+           !eddystoneUrlHasPrefix(url) ? eddystoneUrlBodyByte(url, index) :
+           (index == 0) ? eddystoneUrlPrefixCode(url) :
+           eddystoneUrlBodyByte(eddystoneUrlBody(url), index - 1);
+}
+
+/**
+ * Test whether the encoding of url fits an Eddystone-URL frame, for a
+ * static_assert next to eddystoneEncodeUrl().
+ */
+constexpr bool eddystoneUrlFits(const char *url)
+{
+    return eddystoneEncodedUrlLength(url) <= URLFrame::MAX_URL_DATA;
+}
+
+/* 0, 1, ..., N - 1 as a parameter pack (std::index_sequence is C++14) */
+template <size_t... I> struct EddystoneUrlIndices {};
+template <size_t N, size_t... I> struct EddystoneUrlMakeIndices : EddystoneUrlMakeIndices<N - 1, N - 1, I...> {};
+template <size_t... I> struct EddystoneUrlMakeIndices<0, I...> { typedef EddystoneUrlIndices<I...> Type; };
+
+template <size_t... I>
+constexpr EncodedUrl_t eddystoneEncodeUrl(const char *url, EddystoneUrlIndices<I...>)
+{
+    return EncodedUrl_t{ (uint8_t)eddystoneEncodedUrlLength(url), { eddystoneEncodedUrlByte(url, I)... } };
+}
+
+/**
+ * Encode url at compile time. Check eddystoneUrlFits(url) first: the
+ * encoding is truncated to MAX_URL_DATA bytes, but not its length.
+ */
+constexpr EncodedUrl_t eddystoneEncodeUrl(const char *url)
+{
+    return eddystoneEncodeUrl(url, EddystoneUrlMakeIndices<URLFrame::MAX_URL_DATA>::Type());
+}
+
+/**
+ * An array of encoded URLs (a constexpr function cannot return an array).
+ */
+template <size_t N>
+struct EncodedUrls_t {
+    EncodedUrl_t url[N];
+};
+
+template <size_t N, size_t... I>
+constexpr EncodedUrls_t<N> eddystoneEncodeUrls(const char *const (&urls)[N], EddystoneUrlIndices<I...>)
+{
+    return EncodedUrls_t<N>{ { eddystoneEncodeUrl(urls[I])... } };
+}
+
+/**
+ * Encode an array of URLs at compile time, after eddystoneUrlsFit(urls).
+ */
+template <size_t N>
+constexpr EncodedUrls_t<N> eddystoneEncodeUrls(const char *const (&urls)[N])
+{
+    return eddystoneEncodeUrls(urls, typename EddystoneUrlMakeIndices<N>::Type());
+}
+
+template <size_t N>
+constexpr bool eddystoneUrlsFit(const char *const (&urls)[N], size_t index = 0)
+{
+    return (index == N) || (eddystoneUrlFits(urls[index]) && eddystoneUrlsFit(urls, index + 1));
+}
+#endif /* EDDYSTONE_CONSTEXPR_URL */
+
+#endif /* __URL_ENCODING_H__ */
@@ -0,0 +1,373 @@
+/*
+ * Copyright (c) 2016, Google Inc, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+
+#include "aes128_ct.h"
+
+/*
+ * State byte i (FIPS-197 order: row i % 4, column i / 4) is bit i of each
+ * plane, so ShiftRows rotates the bits of a row by 4 per column and
+ * MixColumns rotates within the nibble of a column.
+ */
+#define ROW_ROT_(x, m, k)   ((((x) & (m)) >> (k)) | (((x) & (m)) << (16 - (k))))
+#define COL_ROT1_(x)        ((((x) >> 1) & 0x7777) | (((x) << 3) & 0x8888))
+#define COL_ROT2_(x)        ((((x) >> 2) & 0x3333) | (((x) << 2) & 0xcccc))
+#define COL_ROT3_(x)        ((((x) >> 3) & 0x1111) | (((x) << 1) & 0xeeee))
+
+static void to_planes_( uint32_t q[8], const unsigned char in[16] )
+{
+	int b, j;
+	for (b = 0; b < 8; b++)
+		q[b] = 0;
+	for (j = 0; j < 4; j++) {
+		uint32_t w = (uint32_t)in[4 * j] | ((uint32_t)in[4 * j + 1] << 8) |
+		             ((uint32_t)in[4 * j + 2] << 16) | ((uint32_t)in[4 * j + 3] << 24);
+		for (b = 0; b < 8; b++) {
+			uint32_t x = (w >> b) & 0x01010101;
+			x = (x | (x >> 7) | (x >> 14) | (x >> 21)) & 0xf;
+			q[b] |= x << (4 * j);
+		}
+	}
+}
+
+static void from_planes_( const uint32_t q[8], unsigned char out[16] )
+{
+	int b, j;
+	for (j = 0; j < 4; j++) {
+		uint32_t w = 0;
+		for (b = 0; b < 8; b++) {
+			uint32_t x = (q[b] >> (4 * j)) & 0xf;
+			x = (x & 1) | ((x & 2) << 7) | ((x & 4) << 14) | ((x & 8) << 21);
+			w |= x << b;
+		}
+		out[4 * j] = (unsigned char)w;
+		out[4 * j + 1] = (unsigned char)(w >> 8);
+		out[4 * j + 2] = (unsigned char)(w >> 16);
+		out[4 * j + 3] = (unsigned char)(w >> 24);
+	}
+}
+
+/* The AES S-box as a circuit (Boyar and Peralta); q[b] is bit b of the byte */
+static void sub_bytes_( uint32_t q[8] )
+{
+	uint32_t x0 = q[7], x1 = q[6], x2 = q[5], x3 = q[4], x4 = q[3], x5 = q[2], x6 = q[1], x7 = q[0];
+
+	/* Top linear transformation */
+	uint32_t y14 = x3 ^ x5;
+	uint32_t y13 = x0 ^ x6;
+	uint32_t y9 = x0 ^ x3;
+	uint32_t y8 = x0 ^ x5;
+	uint32_t t0 = x1 ^ x2;
+	uint32_t y1 = t0 ^ x7;
+	uint32_t y4 = y1 ^ x3;
+	uint32_t y12 = y13 ^ y14;
+	uint32_t y2 = y1 ^ x0;
+	uint32_t y5 = y1 ^ x6;
+	uint32_t y3 = y5 ^ y8;
+	uint32_t t1 = x4 ^ y12;
+	uint32_t y15 = t1 ^ x5;
+	uint32_t y20 = t1 ^ x1;
+	uint32_t y6 = y15 ^ x7;
+	uint32_t y10 = y15 ^ t0;
+	uint32_t y11 = y20 ^ y9;
+	uint32_t y7 = x7 ^ y11;
+	uint32_t y17 = y10 ^ y11;
+	uint32_t y19 = y10 ^ y8;
+	uint32_t y16 = t0 ^ y11;
+	uint32_t y21 = y13 ^ y16;
+	uint32_t y18 = x0 ^ y16;
+
+	/* Non-linear section */
+	uint32_t t2 = y12 & y15;
+	uint32_t t3 = y3 & y6;
+	uint32_t t4 = t3 ^ t2;
+	uint32_t t5 = y4 & x7;
+	uint32_t t6 = t5 ^ t2;
+	uint32_t t7 = y13 & y16;
+	uint32_t t8 = y5 & y1;
+	uint32_t t9 = t8 ^ t7;
+	uint32_t t10 = y2 & y7;
+	uint32_t t11 = t10 ^ t7;
+	uint32_t t12 = y9 & y11;
+	uint32_t t13 = y14 & y17;
+	uint32_t t14 = t13 ^ t12;
+	uint32_t t15 = y8 & y10;
+	uint32_t t16 = t15 ^ t12;
+	uint32_t t17 = t4 ^ t14;
+	uint32_t t18 = t6 ^ t16;
+	uint32_t t19 = t9 ^ t14;
+	uint32_t t20 = t11 ^ t16;
+	uint32_t t21 = t17 ^ y20;
+	uint32_t t22 = t18 ^ y19;
+	uint32_t t23 = t19 ^ y21;
+	uint32_t t24 = t20 ^ y18;
+	uint32_t t25 = t21 ^ t22;
+	uint32_t t26 = t21 & t23;
+	uint32_t t27 = t24 ^ t26;
+	uint32_t t28 = t25 & t27;
+	uint32_t t29 = t28 ^ t22;
+	uint32_t t30 = t23 ^ t24;
+	uint32_t t31 = t22 ^ t26;
+	uint32_t t32 = t31 & t30;
+	uint32_t t33 = t32 ^ t24;
+	uint32_t t34 = t23 ^ t33;
+	uint32_t t35 = t27 ^ t33;
+	uint32_t t36 = t24 & t35;
+	uint32_t t37 = t36 ^ t34;
+	uint32_t t38 = t27 ^ t36;
+	uint32_t t39 = t29 & t38;
+	uint32_t t40 = t25 ^ t39;
+	uint32_t t41 = t40 ^ t37;
+	uint32_t t42 = t29 ^ t33;
+	uint32_t t43 = t29 ^ t40;
+	uint32_t t44 = t33 ^ t37;
+	uint32_t t45 = t42 ^ t41;
+	uint32_t z0 = t44 & y15;
+	uint32_t z1 = t37 & y6;
+	uint32_t z2 = t33 & x7;
+	uint32_t z3 = t43 & y16;
+	uint32_t z4 = t40 & y1;
+	uint32_t z5 = t29 & y7;
+	uint32_t z6 = t42 & y11;
+	uint32_t z7 = t45 & y17;
+	uint32_t z8 = t41 & y10;
+	uint32_t z9 = t44 & y12;
+	uint32_t z10 = t37 & y3;
+	uint32_t z11 = t33 & y4;
+	uint32_t z12 = t43 & y13;
+	uint32_t z13 = t40 & y5;
+	uint32_t z14 = t29 & y2;
+	uint32_t z15 = t42 & y9;
+	uint32_t z16 = t45 & y14;
+	uint32_t z17 = t41 & y8;
+
+	/* Bottom linear transformation */
+	uint32_t t46 = z15 ^ z16;
+	uint32_t t47 = z10 ^ z11;
+	uint32_t t48 = z5 ^ z13;
+	uint32_t t49 = z9 ^ z10;
+	uint32_t t50 = z2 ^ z12;
+	uint32_t t51 = z2 ^ z5;
+	uint32_t t52 = z7 ^ z8;
+	uint32_t t53 = z0 ^ z3;
+	uint32_t t54 = z6 ^ z7;
+	uint32_t t55 = z16 ^ z17;
+	uint32_t t56 = z12 ^ t48;
+	uint32_t t57 = t50 ^ t53;
+	uint32_t t58 = z4 ^ t46;
+	uint32_t t59 = z3 ^ t54;
+	uint32_t t60 = t46 ^ t57;
+	uint32_t t61 = z14 ^ t57;
+	uint32_t t62 = t52 ^ t58;
+	uint32_t t63 = t49 ^ t58;
+	uint32_t t64 = z4 ^ t59;
+	uint32_t t65 = t61 ^ t62;
+	uint32_t t66 = z1 ^ t63;
+	uint32_t s0 = t59 ^ t63;
+	uint32_t s6 = t56 ^ ~t62;
+	uint32_t s7 = t48 ^ ~t60;
+	uint32_t t67 = t64 ^ t65;
+	uint32_t s3 = t53 ^ t66;
+	uint32_t s4 = t51 ^ t66;
+	uint32_t s5 = t47 ^ t65;
+	uint32_t s1 = t64 ^ ~s3;
+	uint32_t s2 = t55 ^ ~t67;
+
+	q[7] = s0 & 0xffff;
+	q[6] = s1 & 0xffff;
+	q[5] = s2 & 0xffff;
+	q[4] = s3 & 0xffff;
+	q[3] = s4 & 0xffff;
+	q[2] = s5 & 0xffff;
+	q[1] = s6 & 0xffff;
+	q[0] = s7 & 0xffff;
+}
+
+/* B(), the inverse of the S-box affine map A(): bit i = x(i+2) ^ x(i+5) ^ x(i+7) */
+static void inv_affine_( uint32_t q[8] )
+{
+	uint32_t x[8];
+	int i;
+	for (i = 0; i < 8; i++)
+		x[i] = q[i];
+	for (i = 0; i < 8; i++)
+		q[i] = x[(i + 2) & 7] ^ x[(i + 5) & 7] ^ x[(i + 7) & 7];
+}
+
+/* S(x) = A(I(x)) ^ 0x63, so InvS(y) = B(S(B(y ^ 0x63)) ^ 0x63) */
+static void inv_sub_bytes_( uint32_t q[8] )
+{
+	int i;
+	for (i = 0; i < 2; i++) {
+		q[0] ^= 0xffff;
+		q[1] ^= 0xffff;
+		q[5] ^= 0xffff;
+		q[6] ^= 0xffff;
+		inv_affine_(q);
+		if (i == 0)
+			sub_bytes_(q);
+	}
+}
+
+static void shift_rows_( uint32_t q[8] )
+{
+	int b;
+	for (b = 0; b < 8; b++) {
+		uint32_t x = q[b];
+		q[b] = ((x & 0x1111) | ROW_ROT_(x, 0x2222, 4) | ROW_ROT_(x, 0x4444, 8) | ROW_ROT_(x, 0x8888, 12)) & 0xffff;
+	}
+}
+
+static void inv_shift_rows_( uint32_t q[8] )
+{
+	int b;
+	for (b = 0; b < 8; b++) {
+		uint32_t x = q[b];
+		q[b] = ((x & 0x1111) | ROW_ROT_(x, 0x2222, 12) | ROW_ROT_(x, 0x4444, 8) | ROW_ROT_(x, 0x8888, 4)) & 0xffff;
+	}
+}
+
+/* Multiplication by x in GF(2^8) of every byte: 0x1b is bits 0, 1, 3 and 4 */
+static void xtime_( uint32_t q[8] )
+{
+	uint32_t hi = q[7];
+	q[7] = q[6];
+	q[6] = q[5];
+	q[5] = q[4];
+	q[4] = q[3] ^ hi;
+	q[3] = q[2] ^ hi;
+	q[2] = q[1];
+	q[1] = q[0] ^ hi;
+	q[0] = hi;
+}
+
+/* b(r) = 2 (a(r) ^ a(r+1)) ^ a(r+1) ^ a(r+2) ^ a(r+3) */
+static void mix_columns_( uint32_t q[8] )
+{
+	uint32_t d[8];
+	int b;
+	for (b = 0; b < 8; b++)
+		d[b] = q[b] ^ COL_ROT1_(q[b]);
+	xtime_(d);
+	for (b = 0; b < 8; b++)
+		q[b] = d[b] ^ COL_ROT1_(q[b]) ^ COL_ROT2_(q[b]) ^ COL_ROT3_(q[b]);
+}
+
+/* InvMixColumns = MixColumns after a(r) ^= 4 (a(r) ^ a(r+2)) */
+static void inv_mix_columns_( uint32_t q[8] )
+{
+	uint32_t d[8];
+	int b;
+	for (b = 0; b < 8; b++)
+		d[b] = q[b] ^ COL_ROT2_(q[b]);
+	xtime_(d);
+	xtime_(d);
+	for (b = 0; b < 8; b++)
+		q[b] ^= d[b];
+	mix_columns_(q);
+}
+
+static void add_round_key_( uint32_t q[8], const uint16_t rk[8] )
+{
+	int b;
+	for (b = 0; b < 8; b++)
+		q[b] ^= rk[b];
+}
+
+void eddy_aes128_ct_setkey( eddy_aes128_ct_context *ctx,
+                            const unsigned char key[16] )
+{
+	unsigned char w[16];
+	unsigned char t[16];
+	uint32_t q[8];
+	unsigned char rcon = 1;
+	int r, i, b;
+
+	memcpy(w, key, sizeof(w));
+	for (r = 0; r <= 10; r++) {
+		if (r > 0) {
+			/* SubWord(RotWord(w3)) through the bitsliced S-box */
+			memset(t, 0, sizeof(t));
+			t[0] = w[13];
+			t[1] = w[14];
+			t[2] = w[15];
+			t[3] = w[12];
+			to_planes_(q, t);
+			sub_bytes_(q);
+			from_planes_(q, t);
+			t[0] ^= rcon;
+			rcon = (unsigned char)((rcon << 1) ^ ((rcon >> 7) * 0x1b));
+			for (i = 0; i < 16; i++) {
+				w[i] ^= (i < 4) ? t[i] : w[i - 4];
+			}
+		}
+		to_planes_(q, w);
+		for (b = 0; b < 8; b++)
+			ctx->rk[r][b] = (uint16_t)q[b];
+	}
+	memset(w, 0, sizeof(w));
+	memset(t, 0, sizeof(t));
+	memset(q, 0, sizeof(q));
+}
+
+void eddy_aes128_ct_encrypt( const eddy_aes128_ct_context *ctx,
+                             const unsigned char input[16],
+                             unsigned char output[16] )
+{
+	uint32_t q[8];
+	int r;
+
+	to_planes_(q, input);
+	add_round_key_(q, ctx->rk[0]);
+	for (r = 1; r < 10; r++) {
+		sub_bytes_(q);
+		shift_rows_(q);
+		mix_columns_(q);
+		add_round_key_(q, ctx->rk[r]);
+	}
+	sub_bytes_(q);
+	shift_rows_(q);
+	add_round_key_(q, ctx->rk[10]);
+	from_planes_(q, output);
+}
+
+void eddy_aes128_ct_decrypt( const eddy_aes128_ct_context *ctx,
+                             const unsigned char input[16],
+                             unsigned char output[16] )
+{
+	uint32_t q[8];
+	int r;
+
+	to_planes_(q, input);
+	add_round_key_(q, ctx->rk[10]);
+	for (r = 9; r > 0; r--) {
+		inv_shift_rows_(q);
+		inv_sub_bytes_(q);
+		add_round_key_(q, ctx->rk[r]);
+		inv_mix_columns_(q);
+	}
+	inv_shift_rows_(q);
+	inv_sub_bytes_(q);
+	add_round_key_(q, ctx->rk[0]);
+	from_planes_(q, output);
+}
+
+void eddy_aes128_ct_free( eddy_aes128_ct_context *ctx )
+{
+	memset(ctx->rk, 0, sizeof(ctx->rk));
+}
@@ -0,0 +1,49 @@
+#if !defined(AES128_CT_H__INCLUDED__)
+#define AES128_CT_H__INCLUDED__
+/*
+ * Copyright (c) 2016, Google Inc, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Table-free, constant time AES-128 (one of the Aes128Backend policies, see
+ * Aes128Backend.h). The state is held as 8 bit planes, plane b holding bit
+ * b of the 16 state bytes, and every step is boolean logic on those planes:
+ * the S-box is the Boyar-Peralta circuit, so no memory access or branch
+ * depends on the key or the data. The same schedule serves encryption and
+ * decryption. No heap, a few hundred bytes of stack.
+ */
+
+#include <stdint.h>
+
+typedef struct {
+    uint16_t rk[11][8];                 /* Round keys, as bit planes */
+} eddy_aes128_ct_context;
+
+void eddy_aes128_ct_setkey( eddy_aes128_ct_context *ctx,
+                            const unsigned char key[16] );
+
+void eddy_aes128_ct_encrypt( const eddy_aes128_ct_context *ctx,
+                             const unsigned char input[16],
+                             unsigned char output[16] );
+
+void eddy_aes128_ct_decrypt( const eddy_aes128_ct_context *ctx,
+                             const unsigned char input[16],
+                             unsigned char output[16] );
+
+/* Wipes the round keys */
+void eddy_aes128_ct_free( eddy_aes128_ct_context *ctx );
+
+#endif /* defined(AES128_CT_H__INCLUDED__) */
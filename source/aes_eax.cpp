@@ -17,11 +17,7 @@
  
 #include <string.h>
 
-// #include "aes_eax.h"
-// set defines before loading aes.h
-#define MBEDTLS_CIPHER_MODE_CBC
-#define MBEDTLS_CIPHER_MODE_CTR
-#include "mbedtls/aes.h"
+#include "aes_eax.h"
 
 #define EDDY_ERR_EAX_AUTH_FAILED    -0x000F /**< Authenticated decryption failed. */
 
@@ -37,13 +33,14 @@ void gf128_double_( unsigned char val[16] )
 	}
 }
 
-int compute_cmac_( mbedtls_aes_context *ctx,
+int compute_cmac_( const Aes128Context *ctx,
 		          const unsigned char *input,
 		          size_t length,
 		          unsigned char param,
 		          unsigned char mac[16] )
 {
 	unsigned char buf[16], iv[16];
+	size_t i;
 	memset(buf, 0, sizeof(buf));
 	buf[15] = param;
 	memset(iv, 0, sizeof(iv));
@@ -51,16 +48,19 @@ int compute_cmac_( mbedtls_aes_context *ctx,
 
 	unsigned char pad[16];
 	memset(pad, 0, sizeof(pad));
-	mbedtls_aes_crypt_ecb(ctx, MBEDTLS_AES_ENCRYPT, pad, pad);
+	Aes128Backend::encrypt(ctx, pad, pad);
 	gf128_double_(pad);
 	if (length & 15) {
 		gf128_double_(pad);
 		pad[length & 15] ^= 0x80;
 	}
 
+	/* CBC-MAC of the tweak block and the input, but for the last block */
 	const unsigned char *tmp_input = buf;
 	while (length > 16) {
-		mbedtls_aes_crypt_cbc(ctx, MBEDTLS_AES_ENCRYPT, 16, iv, tmp_input, buf);
+		for (i = 0; i < 16; i++)
+			iv[i] ^= tmp_input[i];
+		Aes128Backend::encrypt(ctx, iv, iv);
 		if (tmp_input == buf) {
 			tmp_input = input;
 		} else {
@@ -69,34 +69,96 @@ int compute_cmac_( mbedtls_aes_context *ctx,
 		length -= 16;
 	}
 
-	size_t i;
 	for (i = 0; i < length; i++)
 		pad[i] ^= tmp_input[i];
+	for (i = 0; i < 16; i++)
+		pad[i] ^= iv[i];
 
-	mbedtls_aes_crypt_cbc(ctx, MBEDTLS_AES_ENCRYPT, 16, iv, pad, mac);
+	Aes128Backend::encrypt(ctx, pad, mac);
 	return 0;
 }
 
-int eddy_aes_authcrypt_eax( mbedtls_aes_context *ctx,
-                            int mode,                   
-                            const unsigned char *nonce, 
-                            size_t nonce_length,        
-                            const unsigned char *header,
-                            size_t header_length, 
-                            size_t message_length,
-                            const unsigned char *input,
-                            unsigned char *output,
-                            unsigned char *tag,
-                            size_t tag_length )
+static void eax_omac_( const eddy_eax_context *eax,
+                       unsigned char t,
+                       const unsigned char *input,
+                       size_t length,
+                       unsigned char mac[16] )
+{
+	unsigned char x[16];
+	size_t i;
+	if (length == 0) {
+		/* The tweak block is the last block: E((0^15 || t) ^ 2L) */
+		memset(x, 0, sizeof(x));
+		x[15] = t;
+		for (i = 0; i < 16; i++)
+			x[i] ^= eax->l2[i];
+		Aes128Backend::encrypt(eax->aes, x, mac);
+		return;
+	}
+	memcpy(x, eax->tweak_mac[t], sizeof(x));
+	while (length > 16) {
+		for (i = 0; i < 16; i++)
+			x[i] ^= input[i];
+		Aes128Backend::encrypt(eax->aes, x, x);
+		input += 16;
+		length -= 16;
+	}
+	for (i = 0; i < length; i++)
+		x[i] ^= input[i];
+	if (length == 16) {
+		for (i = 0; i < 16; i++)
+			x[i] ^= eax->l2[i];
+	} else {
+		x[length] ^= 0x80;
+		for (i = 0; i < 16; i++)
+			x[i] ^= eax->l4[i];
+	}
+	Aes128Backend::encrypt(eax->aes, x, mac);
+}
+
+int eddy_eax_setup( eddy_eax_context *eax,
+                    const Aes128Context *ctx )
+{
+	unsigned char t;
+	eax->aes = ctx;
+	memset(eax->l2, 0, sizeof(eax->l2));
+	Aes128Backend::encrypt(ctx, eax->l2, eax->l2);
+	gf128_double_(eax->l2);
+	memcpy(eax->l4, eax->l2, sizeof(eax->l4));
+	gf128_double_(eax->l4);
+	for (t = 0; t < 3; t++) {
+		memset(eax->tweak_mac[t], 0, sizeof(eax->tweak_mac[t]));
+		eax->tweak_mac[t][15] = t;
+		Aes128Backend::encrypt(ctx, eax->tweak_mac[t], eax->tweak_mac[t]);
+	}
+	eax_omac_(eax, 1, NULL, 0, eax->empty_header_mac);
+	return 0;
+}
+
+int eddy_eax_authcrypt( const eddy_eax_context *eax,
+                        int mode,
+                        const unsigned char *nonce,
+                        size_t nonce_length,
+                        const unsigned char *header,
+                        size_t header_length,
+                        size_t message_length,
+                        const unsigned char *input,
+                        unsigned char *output,
+                        unsigned char *tag,
+                        size_t tag_length )
 {
 	unsigned char header_mac[16];
 	unsigned char nonce_mac[16];
 	unsigned char ciphertext_mac[16];
 	uint8_t i;
-	compute_cmac_(ctx, header, header_length, 1, header_mac);
-	compute_cmac_(ctx, nonce, nonce_length, 0, nonce_mac);
+	if (header_length == 0) {
+		memcpy(header_mac, eax->empty_header_mac, sizeof(header_mac));
+	} else {
+		eax_omac_(eax, 1, header, header_length, header_mac);
+	}
+	eax_omac_(eax, 0, nonce, nonce_length, nonce_mac);
 	if (mode == MBEDTLS_AES_DECRYPT) {
-		compute_cmac_(ctx, input, message_length, 2, ciphertext_mac);
+		eax_omac_(eax, 2, input, message_length, ciphertext_mac);
 		unsigned char n_ok = 0;
 		for (i = 0; i < tag_length; i++) {
 			ciphertext_mac[i] ^= header_mac[i];
@@ -107,15 +169,43 @@ int eddy_aes_authcrypt_eax( mbedtls_aes_context *ctx,
 		if (n_ok)
 			return EDDY_ERR_EAX_AUTH_FAILED;
 	}
-	size_t nc_off = 0;
-	unsigned char nonce_copy[16];
-	memcpy(nonce_copy, nonce_mac, sizeof(nonce_mac));
-	unsigned char sb[16];
-	mbedtls_aes_crypt_ctr(ctx, message_length, &nc_off, nonce_copy, sb, input, output);
+	/* CTR, from the nonce OMAC, with a big endian 128-bit counter */
+	unsigned char counter[16];
+	unsigned char stream[16];
+	size_t offset;
+	memcpy(counter, nonce_mac, sizeof(nonce_mac));
+	for (offset = 0; offset < message_length; offset += 16) {
+		Aes128Backend::encrypt(eax->aes, counter, stream);
+		for (i = 0; (i < 16) && (offset + i < message_length); i++)
+			output[offset + i] = input[offset + i] ^ stream[i];
+		for (i = 16; i > 0; i--) {
+			if (++counter[i - 1] != 0)
+				break;
+		}
+	}
+	memset(stream, 0, sizeof(stream));
 	if (mode == MBEDTLS_AES_ENCRYPT) {
-		compute_cmac_(ctx, output, message_length, 2, ciphertext_mac); 
+		eax_omac_(eax, 2, output, message_length, ciphertext_mac);
 		for (i = 0; i < tag_length; i++)
 			tag[i] = header_mac[i] ^ nonce_mac[i] ^ ciphertext_mac[i];
 	}
 	return 0;
 }
+
+int eddy_aes_authcrypt_eax( const Aes128Context *ctx,
+                            int mode,                   
+                            const unsigned char *nonce, 
+                            size_t nonce_length,        
+                            const unsigned char *header,
+                            size_t header_length, 
+                            size_t message_length,
+                            const unsigned char *input,
+                            unsigned char *output,
+                            unsigned char *tag,
+                            size_t tag_length )
+{
+	eddy_eax_context eax;
+	eddy_eax_setup(&eax, ctx);
+	return eddy_eax_authcrypt(&eax, mode, nonce, nonce_length, header, header_length,
+	                          message_length, input, output, tag, tag_length);
+}
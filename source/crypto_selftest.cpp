@@ -0,0 +1,282 @@
+/*
+ * Copyright (c) 2016, Google Inc, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "crypto_selftest.h"
+#include "aes_eax.h"
+#include "x25519.h"
+#include "hkdf_sha256.h"
+
+const eddy_eid_test_vector eddy_eid_test_vector_1 = {
+	{ 0x77, 0x07, 0x6d, 0x0a, 0x73, 0x18, 0xa5, 0x7d, 0x3c, 0x16, 0xc1, 0x72, 0x51, 0xb2, 0x66, 0x45,
+	  0xdf, 0x4c, 0x2f, 0x87, 0xeb, 0xc0, 0x99, 0x2a, 0xb1, 0x77, 0xfb, 0xa5, 0x1d, 0xb9, 0x2c, 0x2a },
+	{ 0x85, 0x20, 0xf0, 0x09, 0x89, 0x30, 0xa7, 0x54, 0x74, 0x8b, 0x7d, 0xdc, 0xb4, 0x3e, 0xf7, 0x5a,
+	  0x0d, 0xbf, 0x3a, 0x0d, 0x26, 0x38, 0x1a, 0xf4, 0xeb, 0xa4, 0xa9, 0x8e, 0xaa, 0x9b, 0x4e, 0x6a },
+	{ 0xde, 0x9e, 0xdb, 0x7d, 0x7b, 0x7d, 0xc1, 0xb4, 0xd3, 0x5b, 0x61, 0xc2, 0xec, 0xe4, 0x35, 0x37,
+	  0x3f, 0x83, 0x43, 0xc8, 0x5b, 0x78, 0x67, 0x4d, 0xad, 0xfc, 0x7e, 0x14, 0x6f, 0x88, 0x2b, 0x4f },
+	{ 0x93, 0xf4, 0xd2, 0xce, 0xb4, 0x7a, 0x10, 0xa8, 0x2d, 0x72, 0xaf, 0x75, 0x1e, 0xf2, 0x67, 0x3a },
+	10,
+	0x00012345,
+	{ 0x69, 0xe1, 0xa5, 0x56, 0x25, 0x96, 0xb4, 0x15, 0x0e, 0xb8, 0x0d, 0x62, 0x6d, 0x7b, 0x06, 0xe1 },
+	{ 0xa6, 0x9f, 0x21, 0x57, 0x12, 0x69, 0x39, 0x82 },
+	{ 0x0b, 0xb8, 0x18, 0x80, 0x00, 0x00, 0x12, 0x34, 0x00, 0x00, 0x56, 0x78 },
+	{ 0xfa, 0xb8, 0x87, 0xc3, 0x5b, 0x26, 0x68, 0x59, 0x2a, 0x4b, 0x02, 0xac, 0xbe, 0xef, 0x73, 0x8b }
+};
+
+static int check_( int verbose, const char *name, int ok )
+{
+	if (verbose != 0)
+		printf("  %s: %s\r\n", name, ok ? "passed" : "failed");
+	return ok ? 0 : 1;
+}
+
+/* FIPS-197 appendix C.1 */
+int eddy_aes_self_test( int verbose )
+{
+	static const unsigned char key[16] = {
+		0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f };
+	static const unsigned char plain[16] = {
+		0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff };
+	static const unsigned char cipher[16] = {
+		0x69, 0xc4, 0xe0, 0xd8, 0x6a, 0x7b, 0x04, 0x30, 0xd8, 0xcd, 0xb7, 0x80, 0x70, 0xb4, 0xc5, 0x5a };
+	unsigned char out[16];
+	Aes128Context ctx;
+	int failed = 0;
+
+	Aes128Backend::init(&ctx);
+	Aes128Backend::setKeyEnc(&ctx, key);
+	Aes128Backend::encrypt(&ctx, plain, out);
+	failed += check_(verbose, "AES-128 FIPS-197 C.1 encryption", memcmp(out, cipher, sizeof(cipher)) == 0);
+
+	Aes128Backend::setKeyDec(&ctx, key);
+	Aes128Backend::decrypt(&ctx, cipher, out);
+	failed += check_(verbose, "AES-128 FIPS-197 C.1 decryption", memcmp(out, plain, sizeof(plain)) == 0);
+	Aes128Backend::free(&ctx);
+	return failed;
+}
+
+/* Vectors of "The EAX Mode of Operation" (Bellare, Rogaway, Wagner), appendix */
+typedef struct {
+	unsigned char msg_length;
+	unsigned char msg[6];
+	unsigned char key[16];
+	unsigned char nonce[16];
+	unsigned char header[8];
+	unsigned char cipher[6];
+	unsigned char tag[16];
+} eax_test_vector_;
+
+static const eax_test_vector_ eax_test_vectors_[] = {
+	{ 0, { 0 },
+	  { 0x23, 0x39, 0x52, 0xde, 0xe4, 0xd5, 0xed, 0x5f, 0x9b, 0x9c, 0x6d, 0x6f, 0xf8, 0x0f, 0xf4, 0x78 },
+	  { 0x62, 0xec, 0x67, 0xf9, 0xc3, 0xa4, 0xa4, 0x07, 0xfc, 0xb2, 0xa8, 0xc4, 0x90, 0x31, 0xa8, 0xb3 },
+	  { 0x6b, 0xfb, 0x91, 0x4f, 0xd0, 0x7e, 0xae, 0x6b },
+	  { 0 },
+	  { 0xe0, 0x37, 0x83, 0x0e, 0x83, 0x89, 0xf2, 0x7b, 0x02, 0x5a, 0x2d, 0x65, 0x27, 0xe7, 0x9d, 0x01 } },
+	{ 2, { 0xf7, 0xfb },
+	  { 0x91, 0x94, 0x5d, 0x3f, 0x4d, 0xcb, 0xee, 0x0b, 0xf4, 0x5e, 0xf5, 0x22, 0x55, 0xf0, 0x95, 0xa4 },
+	  { 0xbe, 0xca, 0xf0, 0x43, 0xb0, 0xa2, 0x3d, 0x84, 0x31, 0x94, 0xba, 0x97, 0x2c, 0x66, 0xde, 0xbd },
+	  { 0xfa, 0x3b, 0xfd, 0x48, 0x06, 0xeb, 0x53, 0xfa },
+	  { 0x19, 0xdd },
+	  { 0x5c, 0x4c, 0x93, 0x31, 0x04, 0x9d, 0x0b, 0xda, 0xb0, 0x27, 0x74, 0x08, 0xf6, 0x79, 0x67, 0xe5 } },
+	{ 5, { 0x1a, 0x47, 0xcb, 0x49, 0x33 },
+	  { 0x01, 0xf7, 0x4a, 0xd6, 0x40, 0x77, 0xf2, 0xe7, 0x04, 0xc0, 0xf6, 0x0a, 0xda, 0x3d, 0xd5, 0x23 },
+	  { 0x70, 0xc3, 0xdb, 0x4f, 0x0d, 0x26, 0x36, 0x84, 0x00, 0xa1, 0x0e, 0xd0, 0x5d, 0x2b, 0xff, 0x5e },
+	  { 0x23, 0x4a, 0x34, 0x63, 0xc1, 0x26, 0x4a, 0xc6 },
+	  { 0xd8, 0x51, 0xd5, 0xba, 0xe0 },
+	  { 0x3a, 0x59, 0xf2, 0x38, 0xa2, 0x3e, 0x39, 0x19, 0x9d, 0xc9, 0x26, 0x66, 0x26, 0xc4, 0x0f, 0x80 } },
+	{ 6, { 0x40, 0xd0, 0xc0, 0x7d, 0xa5, 0xe4 },
+	  { 0x35, 0xb6, 0xd0, 0x58, 0x00, 0x05, 0xbb, 0xc1, 0x2b, 0x05, 0x87, 0x12, 0x45, 0x57, 0xd2, 0xc2 },
+	  { 0xfd, 0xb6, 0xb0, 0x66, 0x76, 0xee, 0xdc, 0x5c, 0x61, 0xd7, 0x42, 0x76, 0xe1, 0xf8, 0xe8, 0x16 },
+	  { 0xae, 0xb9, 0x6e, 0xae, 0xbe, 0x29, 0x70, 0xe9 },
+	  { 0x07, 0x1d, 0xfe, 0x16, 0xc6, 0x75 },
+	  { 0xcb, 0x06, 0x77, 0xe5, 0x36, 0xf7, 0x3a, 0xfe, 0x6a, 0x14, 0xb7, 0x4e, 0xe4, 0x98, 0x44, 0xdd } }
+};
+
+int eddy_eax_self_test( int verbose )
+{
+	int failed = 0;
+	size_t i;
+
+	for (i = 0; i < sizeof(eax_test_vectors_) / sizeof(eax_test_vectors_[0]); i++) {
+		const eax_test_vector_ *v = &eax_test_vectors_[i];
+		unsigned char out[6];
+		unsigned char tag[16];
+		Aes128Context ctx;
+		int ok;
+
+		Aes128Backend::init(&ctx);
+		Aes128Backend::setKeyEnc(&ctx, v->key);
+		eddy_aes_authcrypt_eax(&ctx, MBEDTLS_AES_ENCRYPT, v->nonce, sizeof(v->nonce), v->header, sizeof(v->header),
+		                       v->msg_length, v->msg, out, tag, sizeof(tag));
+		ok = memcmp(out, v->cipher, v->msg_length) == 0 && memcmp(tag, v->tag, sizeof(tag)) == 0;
+
+		memcpy(tag, v->tag, sizeof(tag));
+		ok = ok && eddy_aes_authcrypt_eax(&ctx, MBEDTLS_AES_DECRYPT, v->nonce, sizeof(v->nonce), v->header,
+		                                  sizeof(v->header), v->msg_length, v->cipher, out, tag, sizeof(tag)) == 0;
+		ok = ok && memcmp(out, v->msg, v->msg_length) == 0;
+
+		/* A flipped tag bit must be rejected */
+		tag[15] ^= 0x01;
+		ok = ok && eddy_aes_authcrypt_eax(&ctx, MBEDTLS_AES_DECRYPT, v->nonce, sizeof(v->nonce), v->header,
+		                                  sizeof(v->header), v->msg_length, v->cipher, out, tag, sizeof(tag)) != 0;
+		Aes128Backend::free(&ctx);
+
+		if (verbose != 0)
+			printf("  EAX test #%d: %s\r\n", (int)i + 1, ok ? "passed" : "failed");
+		failed += ok ? 0 : 1;
+	}
+	return failed;
+}
+
+/* RFC 7748 section 5.2, first vector, and section 6.1 */
+int eddy_x25519_self_test( int verbose )
+{
+	static const unsigned char scalar[32] = {
+		0xa5, 0x46, 0xe3, 0x6b, 0xf0, 0x52, 0x7c, 0x9d, 0x3b, 0x16, 0x15, 0x4b, 0x82, 0x46, 0x5e, 0xdd,
+		0x62, 0x14, 0x4c, 0x0a, 0xc1, 0xfc, 0x5a, 0x18, 0x50, 0x6a, 0x22, 0x44, 0xba, 0x44, 0x9a, 0xc4 };
+	static const unsigned char u[32] = {
+		0xe6, 0xdb, 0x68, 0x67, 0x58, 0x30, 0x30, 0xdb, 0x35, 0x94, 0xc1, 0xa4, 0x24, 0xb1, 0x5f, 0x7c,
+		0x72, 0x66, 0x24, 0xec, 0x26, 0xb3, 0x35, 0x3b, 0x10, 0xa9, 0x03, 0xa6, 0xd0, 0xab, 0x1c, 0x4c };
+	static const unsigned char expected[32] = {
+		0xc3, 0xda, 0x55, 0x37, 0x9d, 0xe9, 0xc6, 0x90, 0x8e, 0x94, 0xea, 0x4d, 0xf2, 0x8d, 0x08, 0x4f,
+		0x32, 0xec, 0xcf, 0x03, 0x49, 0x1c, 0x71, 0xf7, 0x54, 0xb4, 0x07, 0x55, 0x77, 0xa2, 0x85, 0x52 };
+	static const unsigned char zero[32] = { 0 };
+	const eddy_eid_test_vector *v = &eddy_eid_test_vector_1;
+	unsigned char out[32];
+	int failed = 0;
+
+	eddy_x25519(out, scalar, u);
+	failed += check_(verbose, "X25519 RFC 7748 5.2", memcmp(out, expected, sizeof(expected)) == 0);
+
+	eddy_x25519_base(out, v->beacon_private_key);
+	failed += check_(verbose, "X25519 RFC 7748 6.1 public key", memcmp(out, v->beacon_public_key, sizeof(out)) == 0);
+
+	/* The point 0 has small order: the shared secret must be refused */
+	failed += check_(verbose, "X25519 low order point",
+	                 eddy_x25519(out, v->beacon_private_key, zero) == EDDY_ERR_X25519_ZERO_SECRET);
+	return failed;
+}
+
+/* RFC 5869 test cases 1 and 3 */
+int eddy_hkdf_sha256_self_test( int verbose )
+{
+	static const unsigned char salt[13] = {
+		0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c };
+	static const unsigned char info[10] = {
+		0xf0, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8, 0xf9 };
+	static const unsigned char okm1[42] = {
+		0x3c, 0xb2, 0x5f, 0x25, 0xfa, 0xac, 0xd5, 0x7a, 0x90, 0x43, 0x4f, 0x64, 0xd0, 0x36, 0x2f, 0x2a,
+		0x2d, 0x2d, 0x0a, 0x90, 0xcf, 0x1a, 0x5a, 0x4c, 0x5d, 0xb0, 0x2d, 0x56, 0xec, 0xc4, 0xc5, 0xbf,
+		0x34, 0x00, 0x72, 0x08, 0xd5, 0xb8, 0x87, 0x18, 0x58, 0x65 };
+	static const unsigned char okm3[42] = {
+		0x8d, 0xa4, 0xe7, 0x75, 0xa5, 0x63, 0xc1, 0x8f, 0x71, 0x5f, 0x80, 0x2a, 0x06, 0x3c, 0x5a, 0x31,
+		0xb8, 0xa1, 0x1f, 0x5c, 0x5e, 0xe1, 0x87, 0x9e, 0xc3, 0x45, 0x4e, 0x5f, 0x3c, 0x73, 0x8d, 0x2d,
+		0x9d, 0x20, 0x13, 0x95, 0xfa, 0xa4, 0xb6, 0x1a, 0x96, 0xc8 };
+	unsigned char ikm[22];
+	unsigned char okm[42];
+	int failed = 0;
+
+	memset(ikm, 0x0b, sizeof(ikm));
+	eddy_hkdf_sha256(salt, sizeof(salt), ikm, sizeof(ikm), info, sizeof(info), okm, sizeof(okm));
+	failed += check_(verbose, "HKDF-SHA256 RFC 5869 case 1", memcmp(okm, okm1, sizeof(okm)) == 0);
+
+	eddy_hkdf_sha256(NULL, 0, ikm, sizeof(ikm), NULL, 0, okm, sizeof(okm));
+	failed += check_(verbose, "HKDF-SHA256 RFC 5869 case 3", memcmp(okm, okm3, sizeof(okm)) == 0);
+	return failed;
+}
+
+int eddy_eid_self_test( int verbose )
+{
+	const eddy_eid_test_vector *v = &eddy_eid_test_vector_1;
+	unsigned char secret[32];
+	unsigned char salt[64];
+	unsigned char okm[32];
+	unsigned char block[16];
+	unsigned char nonce[6];
+	unsigned char out[16];
+	unsigned long scaled_time;
+	Aes128Context ctx;
+	int failed = 0;
+
+	/* EIDFrame::genEcdhSharedKey(): the salt is the server then the beacon public key */
+	eddy_x25519(secret, v->beacon_private_key, v->server_public_key);
+	memcpy(salt, v->server_public_key, 32);
+	memcpy(salt + 32, v->beacon_public_key, 32);
+	eddy_hkdf_sha256(salt, sizeof(salt), secret, sizeof(secret), NULL, 0, okm, sizeof(okm));
+	failed += check_(verbose, "EID identity key", memcmp(okm, v->identity_key, sizeof(v->identity_key)) == 0);
+
+	/* EIDFrame::genTemporaryKey() then updateFromTemporaryKey() */
+	Aes128Backend::init(&ctx);
+	Aes128Backend::setKeyEnc(&ctx, v->identity_key);
+	memset(block, 0, sizeof(block));
+	block[11] = 0xff;
+	block[14] = (v->beacon_time_secs >> 24) & 0xff;
+	block[15] = (v->beacon_time_secs >> 16) & 0xff;
+	Aes128Backend::encrypt(&ctx, block, out);
+	failed += check_(verbose, "EID temporary key", memcmp(out, v->temporary_key, sizeof(v->temporary_key)) == 0);
+
+	Aes128Backend::setKeyEnc(&ctx, v->temporary_key);
+	scaled_time = (v->beacon_time_secs >> v->rotation_period_exp) << v->rotation_period_exp;
+	memset(block, 0, sizeof(block));
+	block[11] = v->rotation_period_exp;
+	block[12] = (scaled_time >> 24) & 0xff;
+	block[13] = (scaled_time >> 16) & 0xff;
+	block[14] = (scaled_time >> 8) & 0xff;
+	block[15] = scaled_time & 0xff;
+	Aes128Backend::encrypt(&ctx, block, out);
+	failed += check_(verbose, "EID", memcmp(out, v->eid, sizeof(v->eid)) == 0);
+
+	/* TLMFrame::encryptData(): the nonce is the scaled time and the salt */
+	Aes128Backend::setKeyEnc(&ctx, v->identity_key);
+	nonce[0] = block[12];
+	nonce[1] = block[13];
+	nonce[2] = block[14];
+	nonce[3] = block[15];
+	nonce[4] = v->etlm_data[12];
+	nonce[5] = v->etlm_data[13];
+	eddy_aes_authcrypt_eax(&ctx, MBEDTLS_AES_ENCRYPT, nonce, sizeof(nonce), NULL, 0,
+	                       sizeof(v->tlm_data), v->tlm_data, out, out + 14, 2);
+	failed += check_(verbose, "ETLM encryption", memcmp(out, v->etlm_data, 12) == 0 && memcmp(out + 14, v->etlm_data + 14, 2) == 0);
+
+	memcpy(block, v->etlm_data, sizeof(block));
+	failed += check_(verbose, "ETLM decryption",
+	                 eddy_aes_authcrypt_eax(&ctx, MBEDTLS_AES_DECRYPT, nonce, sizeof(nonce), NULL, 0,
+	                                        sizeof(v->tlm_data), block, out, block + 14, 2) == 0 &&
+	                 memcmp(out, v->tlm_data, sizeof(v->tlm_data)) == 0);
+	Aes128Backend::free(&ctx);
+
+	memset(secret, 0, sizeof(secret));
+	memset(okm, 0, sizeof(okm));
+	return failed;
+}
+
+int eddy_crypto_self_test( int verbose )
+{
+	int failed = 0;
+
+	failed += eddy_aes_self_test(verbose);
+	failed += eddy_eax_self_test(verbose);
+	failed += eddy_x25519_self_test(verbose);
+	failed += eddy_hkdf_sha256_self_test(verbose);
+	failed += eddy_eid_self_test(verbose);
+	if (verbose != 0)
+		printf("Crypto self test: %d failed\r\n", failed);
+	return failed;
+}
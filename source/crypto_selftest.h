@@ -0,0 +1,65 @@
+#if !defined(CRYPTO_SELFTEST_H__INCLUDED__)
+#define CRYPTO_SELFTEST_H__INCLUDED__
+/*
+ * Copyright (c) 2016, Google Inc, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Known answer tests of the crypto the beacon relies on, in the manner of the
+ * mbedtls *_self_test() functions: AES-128 (FIPS-197), EAX (the vectors of
+ * the EAX paper), X25519 (RFC 7748), HKDF-SHA256 (RFC 5869), and an
+ * Eddystone vector that chains them the way EIDFrame and TLMFrame do. AES
+ * runs on the backend selected in Aes128Backend.h, so the tests cover it. The
+ * same file builds on the host (tools/CryptoBench) and on the target
+ * (CRYPTO_BENCHMARK, see Eddystone_config.h).
+ */
+
+/*
+ * One EID registration and the frames that follow, computed with an
+ * independent implementation (OpenSSL). The beacon and server keys are the
+ * Alice and Bob keys of RFC 7748 section 6.1; all keys are little endian,
+ * as on the wire.
+ */
+typedef struct {
+    unsigned char beacon_private_key[32];
+    unsigned char beacon_public_key[32];
+    unsigned char server_public_key[32];
+    unsigned char identity_key[16];     /* HKDF(server public | beacon public, shared secret), truncated */
+    unsigned char rotation_period_exp;
+    unsigned long beacon_time_secs;
+    unsigned char temporary_key[16];
+    unsigned char eid[8];
+    unsigned char tlm_data[12];         /* Plain TLM from the battery voltage */
+    unsigned char etlm_data[16];        /* Ciphertext, salt, MIC as written by TLMFrame::encryptData() */
+} eddy_eid_test_vector;
+
+extern const eddy_eid_test_vector eddy_eid_test_vector_1;
+
+int eddy_aes_self_test( int verbose );
+
+int eddy_eax_self_test( int verbose );
+
+int eddy_x25519_self_test( int verbose );
+
+int eddy_hkdf_sha256_self_test( int verbose );
+
+/* Identity key, temporary key, EID and ETLM of eddy_eid_test_vector_1 */
+int eddy_eid_self_test( int verbose );
+
+/* All of the above: returns the number of failed tests */
+int eddy_crypto_self_test( int verbose );
+
+#endif /* defined(CRYPTO_SELFTEST_H__INCLUDED__) */
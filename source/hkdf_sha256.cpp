@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) 2016, Google Inc, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+
+#include "hkdf_sha256.h"
+
+#define HMAC_BLOCK_LEN_    64
+
+void eddy_hmac_sha256_starts( eddy_hmac_sha256_context *ctx,
+                              const unsigned char *key,
+                              size_t key_length )
+{
+	unsigned char ipad_key[HMAC_BLOCK_LEN_];
+	size_t i;
+
+	memset(ctx->opad_key, 0, sizeof(ctx->opad_key));
+	mbedtls_sha256_init(&ctx->sha);
+	if (key_length > HMAC_BLOCK_LEN_) {
+		/* Keys longer than a block are hashed first */
+		mbedtls_sha256_starts(&ctx->sha, 0);
+		mbedtls_sha256_update(&ctx->sha, key, key_length);
+		mbedtls_sha256_finish(&ctx->sha, ctx->opad_key);
+	} else if (key_length > 0) {
+		memcpy(ctx->opad_key, key, key_length);
+	}
+	for (i = 0; i < HMAC_BLOCK_LEN_; i++) {
+		ipad_key[i] = ctx->opad_key[i] ^ 0x36;
+		ctx->opad_key[i] ^= 0x5c;
+	}
+	mbedtls_sha256_starts(&ctx->sha, 0);
+	mbedtls_sha256_update(&ctx->sha, ipad_key, sizeof(ipad_key));
+	memset(ipad_key, 0, sizeof(ipad_key));
+}
+
+void eddy_hmac_sha256_update( eddy_hmac_sha256_context *ctx,
+                              const unsigned char *input,
+                              size_t length )
+{
+	mbedtls_sha256_update(&ctx->sha, input, length);
+}
+
+void eddy_hmac_sha256_finish( eddy_hmac_sha256_context *ctx,
+                              unsigned char mac[EDDY_SHA256_LEN] )
+{
+	unsigned char inner[EDDY_SHA256_LEN];
+
+	mbedtls_sha256_finish(&ctx->sha, inner);
+	mbedtls_sha256_starts(&ctx->sha, 0);
+	mbedtls_sha256_update(&ctx->sha, ctx->opad_key, sizeof(ctx->opad_key));
+	mbedtls_sha256_update(&ctx->sha, inner, sizeof(inner));
+	mbedtls_sha256_finish(&ctx->sha, mac);
+
+	mbedtls_sha256_free(&ctx->sha);
+	memset(ctx->opad_key, 0, sizeof(ctx->opad_key));
+	memset(inner, 0, sizeof(inner));
+}
+
+void eddy_hkdf_sha256_extract( const unsigned char *salt,
+                               size_t salt_length,
+                               const unsigned char *ikm,
+                               size_t ikm_length,
+                               unsigned char prk[EDDY_SHA256_LEN] )
+{
+	eddy_hmac_sha256_context ctx;
+	/* An absent salt is a string of HashLen zeros, which HMAC pads to the same key as an empty one */
+	eddy_hmac_sha256_starts(&ctx, salt, salt_length);
+	eddy_hmac_sha256_update(&ctx, ikm, ikm_length);
+	eddy_hmac_sha256_finish(&ctx, prk);
+}
+
+int eddy_hkdf_sha256_expand( const unsigned char prk[EDDY_SHA256_LEN],
+                             const unsigned char *info,
+                             size_t info_length,
+                             unsigned char *okm,
+                             size_t okm_length )
+{
+	eddy_hmac_sha256_context ctx;
+	unsigned char t[EDDY_SHA256_LEN];
+	unsigned char counter;
+	size_t t_length = 0;
+	size_t n;
+
+	if (okm_length > 255 * EDDY_SHA256_LEN)
+		return EDDY_ERR_HKDF_BAD_LENGTH;
+
+	for (counter = 1; okm_length > 0; counter++) {
+		/* T(i) = HMAC(PRK, T(i - 1) | info | i) */
+		eddy_hmac_sha256_starts(&ctx, prk, EDDY_SHA256_LEN);
+		eddy_hmac_sha256_update(&ctx, t, t_length);
+		eddy_hmac_sha256_update(&ctx, info, info_length);
+		eddy_hmac_sha256_update(&ctx, &counter, 1);
+		eddy_hmac_sha256_finish(&ctx, t);
+		t_length = EDDY_SHA256_LEN;
+
+		n = (okm_length < EDDY_SHA256_LEN) ? okm_length : EDDY_SHA256_LEN;
+		memcpy(okm, t, n);
+		okm += n;
+		okm_length -= n;
+	}
+	memset(t, 0, sizeof(t));
+	return 0;
+}
+
+int eddy_hkdf_sha256( const unsigned char *salt,
+                      size_t salt_length,
+                      const unsigned char *ikm,
+                      size_t ikm_length,
+                      const unsigned char *info,
+                      size_t info_length,
+                      unsigned char *okm,
+                      size_t okm_length )
+{
+	unsigned char prk[EDDY_SHA256_LEN];
+	int ret;
+
+	eddy_hkdf_sha256_extract(salt, salt_length, ikm, ikm_length, prk);
+	ret = eddy_hkdf_sha256_expand(prk, info, info_length, okm, okm_length);
+	memset(prk, 0, sizeof(prk));
+	return ret;
+}
@@ -0,0 +1,73 @@
+#if !defined(HKDF_SHA256_H__INCLUDED__)
+#define HKDF_SHA256_H__INCLUDED__
+/*
+ * Copyright (c) 2016, Google Inc, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * HMAC-SHA256 (RFC 2104) and HKDF-SHA256 (RFC 5869) on top of mbedtls_sha256,
+ * without the mbedtls md layer: all state lives in the caller's context or
+ * on the stack, nothing is allocated.
+ */
+
+#include <stddef.h>
+#include "mbedtls/sha256.h"
+
+#define EDDY_SHA256_LEN                32
+#define EDDY_ERR_HKDF_BAD_LENGTH       -0x0011 /**< Requested more than 255 * 32 bytes of output. */
+
+typedef struct {
+    mbedtls_sha256_context sha;         /* Inner hash while streaming */
+    unsigned char opad_key[64];         /* Key ^ opad, for the outer hash */
+} eddy_hmac_sha256_context;
+
+void eddy_hmac_sha256_starts( eddy_hmac_sha256_context *ctx,
+                              const unsigned char *key,
+                              size_t key_length );
+
+void eddy_hmac_sha256_update( eddy_hmac_sha256_context *ctx,
+                              const unsigned char *input,
+                              size_t length );
+
+/* Also wipes the context */
+void eddy_hmac_sha256_finish( eddy_hmac_sha256_context *ctx,
+                              unsigned char mac[EDDY_SHA256_LEN] );
+
+/* PRK = HMAC(salt, ikm) */
+void eddy_hkdf_sha256_extract( const unsigned char *salt,
+                               size_t salt_length,
+                               const unsigned char *ikm,
+                               size_t ikm_length,
+                               unsigned char prk[EDDY_SHA256_LEN] );
+
+/* OKM = T(1) | T(2) | ... truncated to okm_length (at most 255 * 32) */
+int eddy_hkdf_sha256_expand( const unsigned char prk[EDDY_SHA256_LEN],
+                             const unsigned char *info,
+                             size_t info_length,
+                             unsigned char *okm,
+                             size_t okm_length );
+
+/* Extract then expand */
+int eddy_hkdf_sha256( const unsigned char *salt,
+                      size_t salt_length,
+                      const unsigned char *ikm,
+                      size_t ikm_length,
+                      const unsigned char *info,
+                      size_t info_length,
+                      unsigned char *okm,
+                      size_t okm_length );
+
+#endif /* defined(HKDF_SHA256_H__INCLUDED__) */
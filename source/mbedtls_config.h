@@ -54,25 +54,27 @@
 #undef  MBEDTLS_ASN1_PARSE_C
 #undef  MBEDTLS_ASN1_WRITE_C
 #undef  MBEDTLS_BASE64_C
-#define MBEDTLS_BIGNUM_C
+#undef  MBEDTLS_BIGNUM_C   /* X25519 is done by x25519.cpp */
 #undef  MBEDTLS_CCM_C
 #undef  MBEDTLS_CERTS_C
 #undef  MBEDTLS_CIPHER_C
 #define MBEDTLS_CTR_DRBG_C
 #undef  MBEDTLS_DEBUG_C
-#define MBEDTLS_ECDH_C
+#undef  MBEDTLS_ECDH_C     /* X25519 is done by x25519.cpp */
 #undef  MBEDTLS_ECDSA_C
-#define MBEDTLS_ECP_C
+#undef  MBEDTLS_ECP_C      /* X25519 is done by x25519.cpp */
 #define MBEDTLS_ENTROPY_C
 #undef  MBEDTLS_ERROR_C
 #undef  MBEDTLS_GCM_C
+#undef  MBEDTLS_HKDF_C
 #undef  MBEDTLS_HMAC_DRBG_C
-#define MBEDTLS_MD_C
+#undef  MBEDTLS_MD_C       /* HMAC/HKDF are done by hkdf_sha256.cpp */
 #undef  MBEDTLS_OID_C
 #undef  MBEDTLS_PEM_PARSE_C
 #undef  MBEDTLS_PK_C
 #undef  MBEDTLS_PK_PARSE_C
 #undef  MBEDTLS_PK_WRITE_C
+#undef  MBEDTLS_PKCS5_C
 #undef  MBEDTLS_PLATFORM_C
 #undef  MBEDTLS_RSA_C
 #define MBEDTLS_SHA256_C
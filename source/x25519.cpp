@@ -0,0 +1,297 @@
+/*
+ * Copyright (c) 2016, Google Inc, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "x25519.h"
+
+/*
+ * Field elements are little endian 8 x 32-bit limbs holding any value below
+ * 2^256; they are only reduced below p = 2^255 - 19 when encoded. Reduction
+ * uses 2^256 = 38 (mod p).
+ */
+typedef uint32_t fe25519_[8];
+
+static const uint32_t p25519_[8] = {
+	0xffffffed, 0xffffffff, 0xffffffff, 0xffffffff,
+	0xffffffff, 0xffffffff, 0xffffffff, 0x7fffffff
+};
+
+static void fe_copy_( fe25519_ r, const fe25519_ a )
+{
+	memcpy(r, a, sizeof(fe25519_));
+}
+
+static void fe_set_( fe25519_ r, uint32_t v )
+{
+	memset(r, 0, sizeof(fe25519_));
+	r[0] = v;
+}
+
+/* Fold a carry out of bit 256 (c * 2^256 = c * 38) back into r */
+static void fe_fold_( fe25519_ r, uint64_t c )
+{
+	int i;
+	c *= 38;
+	for (i = 0; i < 8; i++) {
+		c += r[i];
+		r[i] = (uint32_t)c;
+		c >>= 32;
+	}
+	/* A second carry leaves r below 38, so this cannot overflow */
+	r[0] += (uint32_t)c * 38;
+}
+
+static void fe_add_( fe25519_ r, const fe25519_ a, const fe25519_ b )
+{
+	uint64_t c = 0;
+	int i;
+	for (i = 0; i < 8; i++) {
+		c += (uint64_t)a[i] + b[i];
+		r[i] = (uint32_t)c;
+		c >>= 32;
+	}
+	fe_fold_(r, c);
+}
+
+static void fe_sub_( fe25519_ r, const fe25519_ a, const fe25519_ b )
+{
+	int64_t c = 0;
+	uint32_t borrow;
+	int i;
+	for (i = 0; i < 8; i++) {
+		c += (int64_t)a[i] - b[i];
+		r[i] = (uint32_t)c;
+		c >>= 32;
+	}
+	/* On borrow r holds a - b + 2^256 = a - b + 38 (mod p): take 38 off */
+	borrow = (uint32_t)c & 1;
+	c = -(int64_t)(borrow * 38);
+	for (i = 0; i < 8; i++) {
+		c += r[i];
+		r[i] = (uint32_t)c;
+		c >>= 32;
+	}
+	/* A second borrow leaves r above 2^256 - 38, so this cannot underflow */
+	r[0] -= ((uint32_t)c & 1) * 38;
+}
+
+static void fe_mul_( fe25519_ r, const fe25519_ a, const fe25519_ b )
+{
+	uint32_t t[16];
+	uint64_t c;
+	int i, j;
+	memset(t, 0, sizeof(t));
+	for (i = 0; i < 8; i++) {
+		c = 0;
+		for (j = 0; j < 8; j++) {
+			c += (uint64_t)a[i] * b[j] + t[i + j];
+			t[i + j] = (uint32_t)c;
+			c >>= 32;
+		}
+		t[i + 8] = (uint32_t)c;
+	}
+	c = 0;
+	for (i = 0; i < 8; i++) {
+		c += (uint64_t)t[i + 8] * 38 + t[i];
+		r[i] = (uint32_t)c;
+		c >>= 32;
+	}
+	fe_fold_(r, c);
+}
+
+static void fe_sq_( fe25519_ r, const fe25519_ a )
+{
+	fe_mul_(r, a, a);
+}
+
+static void fe_mul_small_( fe25519_ r, const fe25519_ a, uint32_t b )
+{
+	uint64_t c = 0;
+	int i;
+	for (i = 0; i < 8; i++) {
+		c += (uint64_t)a[i] * b;
+		r[i] = (uint32_t)c;
+		c >>= 32;
+	}
+	fe_fold_(r, c);
+}
+
+/* Swap a and b if swap is 1, without branching on it */
+static void fe_cswap_( fe25519_ a, fe25519_ b, uint32_t swap )
+{
+	uint32_t mask = 0 - swap;
+	uint32_t x;
+	int i;
+	for (i = 0; i < 8; i++) {
+		x = mask & (a[i] ^ b[i]);
+		a[i] ^= x;
+		b[i] ^= x;
+	}
+}
+
+/* Square a n times into r */
+static void fe_sq_n_( fe25519_ r, const fe25519_ a, int n )
+{
+	int i;
+	fe_sq_(r, a);
+	for (i = 1; i < n; i++)
+		fe_sq_(r, r);
+}
+
+/* r = a^(p - 2) = 1/a, with the usual 254 squarings and 11 multiplications */
+static void fe_invert_( fe25519_ r, const fe25519_ a )
+{
+	fe25519_ t0, t1, t2, t3;
+
+	fe_sq_(t0, a);                  /* 2 */
+	fe_sq_n_(t1, t0, 2);            /* 8 */
+	fe_mul_(t1, a, t1);             /* 9 */
+	fe_mul_(t0, t0, t1);            /* 11 */
+	fe_sq_(t2, t0);                 /* 22 */
+	fe_mul_(t1, t1, t2);            /* 2^5 - 1 */
+	fe_sq_n_(t2, t1, 5);
+	fe_mul_(t1, t2, t1);            /* 2^10 - 1 */
+	fe_sq_n_(t2, t1, 10);
+	fe_mul_(t2, t2, t1);            /* 2^20 - 1 */
+	fe_sq_n_(t3, t2, 20);
+	fe_mul_(t2, t3, t2);            /* 2^40 - 1 */
+	fe_sq_n_(t2, t2, 10);
+	fe_mul_(t1, t2, t1);            /* 2^50 - 1 */
+	fe_sq_n_(t2, t1, 50);
+	fe_mul_(t2, t2, t1);            /* 2^100 - 1 */
+	fe_sq_n_(t3, t2, 100);
+	fe_mul_(t2, t3, t2);            /* 2^200 - 1 */
+	fe_sq_n_(t2, t2, 50);
+	fe_mul_(t1, t2, t1);            /* 2^250 - 1 */
+	fe_sq_n_(t1, t1, 5);
+	fe_mul_(r, t1, t0);             /* 2^255 - 21 */
+}
+
+/* Subtract p if r >= p, without branching */
+static void fe_reduce_once_( fe25519_ r )
+{
+	uint32_t t[8];
+	uint32_t mask;
+	int64_t c = 0;
+	int i;
+	for (i = 0; i < 8; i++) {
+		c += (int64_t)r[i] - p25519_[i];
+		t[i] = (uint32_t)c;
+		c >>= 32;
+	}
+	/* mask is all ones if r < p (keep r) */
+	mask = (uint32_t)c;
+	for (i = 0; i < 8; i++)
+		r[i] = (r[i] & mask) | (t[i] & ~mask);
+}
+
+static void fe_decode_( fe25519_ r, const unsigned char in[32] )
+{
+	int i;
+	for (i = 0; i < 8; i++) {
+		r[i] = (uint32_t)in[4 * i] | ((uint32_t)in[4 * i + 1] << 8) |
+		       ((uint32_t)in[4 * i + 2] << 16) | ((uint32_t)in[4 * i + 3] << 24);
+	}
+	r[7] &= 0x7fffffff;
+}
+
+static void fe_encode_( unsigned char out[32], const fe25519_ a )
+{
+	fe25519_ t;
+	int i;
+	fe_copy_(t, a);
+	/* t < 2^256 = 2p + 38, so two conditional subtractions reach t < p */
+	fe_reduce_once_(t);
+	fe_reduce_once_(t);
+	for (i = 0; i < 8; i++) {
+		out[4 * i]     = (unsigned char)t[i];
+		out[4 * i + 1] = (unsigned char)(t[i] >> 8);
+		out[4 * i + 2] = (unsigned char)(t[i] >> 16);
+		out[4 * i + 3] = (unsigned char)(t[i] >> 24);
+	}
+}
+
+int eddy_x25519( unsigned char out[32],
+                 const unsigned char scalar[32],
+                 const unsigned char u[32] )
+{
+	unsigned char k[32];
+	fe25519_ x1, x2, z2, x3, z3, a, b, c, d, e;
+	uint32_t swap = 0;
+	uint32_t bit;
+	unsigned char nz = 0;
+	int t;
+
+	memcpy(k, scalar, sizeof(k));
+	k[0] &= 248;
+	k[31] &= 127;
+	k[31] |= 64;
+
+	fe_decode_(x1, u);
+	fe_set_(x2, 1);
+	fe_set_(z2, 0);
+	fe_copy_(x3, x1);
+	fe_set_(z3, 1);
+
+	/* RFC 7748 section 5 ladder step, arranged to need five temporaries */
+	for (t = 254; t >= 0; t--) {
+		bit = (k[t >> 3] >> (t & 7)) & 1;
+		swap ^= bit;
+		fe_cswap_(x2, x3, swap);
+		fe_cswap_(z2, z3, swap);
+		swap = bit;
+
+		fe_add_(a, x2, z2);             /* A */
+		fe_sub_(b, x2, z2);             /* B */
+		fe_add_(c, x3, z3);             /* C */
+		fe_sub_(d, x3, z3);             /* D */
+		fe_mul_(d, d, a);               /* DA */
+		fe_mul_(c, c, b);               /* CB */
+		fe_sq_(a, a);                   /* AA */
+		fe_sq_(b, b);                   /* BB */
+		fe_add_(e, d, c);
+		fe_sq_(x3, e);                  /* x3 = (DA + CB)^2 */
+		fe_sub_(e, d, c);
+		fe_sq_(e, e);
+		fe_mul_(z3, e, x1);             /* z3 = x1 * (DA - CB)^2 */
+		fe_mul_(x2, a, b);              /* x2 = AA * BB */
+		fe_sub_(e, a, b);               /* E */
+		fe_mul_small_(c, e, 121665);
+		fe_add_(c, c, a);
+		fe_mul_(z2, e, c);              /* z2 = E * (AA + a24 * E) */
+	}
+	fe_cswap_(x2, x3, swap);
+	fe_cswap_(z2, z3, swap);
+
+	fe_invert_(z2, z2);
+	fe_mul_(x2, x2, z2);
+	fe_encode_(out, x2);
+
+	memset(k, 0, sizeof(k));
+	for (t = 0; t < 32; t++)
+		nz |= out[t];
+	return nz ? 0 : EDDY_ERR_X25519_ZERO_SECRET;
+}
+
+int eddy_x25519_base( unsigned char out[32],
+                      const unsigned char scalar[32] )
+{
+	static const unsigned char base_point[32] = { 9 };
+	return eddy_x25519(out, scalar, base_point);
+}
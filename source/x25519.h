@@ -0,0 +1,44 @@
+#if !defined(X25519_H__INCLUDED__)
+#define X25519_H__INCLUDED__
+/*
+ * Copyright (c) 2016, Google Inc, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * X25519 (RFC 7748) for the EID key exchange: Montgomery ladder over
+ * GF(2^255 - 19) on eight 32-bit limbs. Constant time (no branch or memory
+ * access depends on the scalar or the point), no heap, under 700 bytes of
+ * stack. All keys are little endian, as on the wire.
+ */
+
+#define EDDY_ERR_X25519_ZERO_SECRET    -0x0010 /**< The shared secret is zero (low order point). */
+
+/*
+ * out = X25519(scalar, u). The scalar is clamped and the top bit of u
+ * masked as required by RFC 7748. Returns EDDY_ERR_X25519_ZERO_SECRET if the
+ * result is all zeros, 0 otherwise.
+ */
+int eddy_x25519( unsigned char out[32],
+                 const unsigned char scalar[32],
+                 const unsigned char u[32] );
+
+/*
+ * out = X25519(scalar, 9): the public key of a private scalar.
+ */
+int eddy_x25519_base( unsigned char out[32],
+                      const unsigned char scalar[32] );
+
+#endif /* defined(X25519_H__INCLUDED__) */
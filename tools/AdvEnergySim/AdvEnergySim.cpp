@@ -0,0 +1,178 @@
+/*
+ * Copyright (c) 2016, Google Inc, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Host energy simulator for the adaptive advertising interval policy.
+ *
+ * Discharges a coin cell through the beacon's slot schedule, once with the
+ * static configured intervals and once with AdvIntervalPolicy (tuned by the
+ * EDDYSTONE_ADV_INTERVAL_* values of Eddystone_config.h), sampling the
+ * battery like EddystoneService does, and reports battery life and frames
+ * sent while activity was signalled.
+ *
+ * Usage: AdvEnergySim [capacityMah] [chargePerFrameUc] [sleepUa] [activityPerHour] [interval...]
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include "Eddystone_config.h"
+#include "AdvIntervalPolicy.h"
+
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+namespace {
+
+/* CR2032 style discharge curve: battery voltage (mV) against depth of discharge */
+struct CurvePoint {
+    double   depth;
+    uint16_t voltageMv;
+};
+
+const CurvePoint dischargeCurve[] = {
+    { 0.00, 3000 }, { 0.10, 2900 }, { 0.50, 2850 }, { 0.80, 2750 },
+    { 0.90, 2600 }, { 0.95, 2400 }, { 1.00, 2000 },
+};
+
+uint16_t batteryVoltageMv(double depth)
+{
+    const size_t points = sizeof(dischargeCurve) / sizeof(dischargeCurve[0]);
+    for (size_t i = 1; i < points; i++) {
+        if (depth <= dischargeCurve[i].depth) {
+            const CurvePoint &a = dischargeCurve[i - 1];
+            const CurvePoint &b = dischargeCurve[i];
+            return (uint16_t)(a.voltageMv + (b.voltageMv - a.voltageMv) * (depth - a.depth) / (b.depth - a.depth));
+        }
+    }
+    return dischargeCurve[points - 1].voltageMv;
+}
+
+struct Result {
+    double   days;
+    double   frames;
+    double   activeFrames;
+    double   activeSeconds;
+    double   daysPerStep[AdvIntervalPolicy::MAX_BATTERY_STEPS + 1];
+};
+
+Result simulate(bool adaptive, double capacityMah, double chargePerFrameUc, double sleepUa,
+                double activityPerHour, const std::vector<uint16_t> &intervals)
+{
+    static const uint16_t levels[] = EDDYSTONE_ADV_INTERVAL_BATTERY_LEVELS_MV;
+    static const uint16_t scales[] = EDDYSTONE_ADV_INTERVAL_BATTERY_SCALES;
+    AdvIntervalPolicy policy(levels, scales, sizeof(levels) / sizeof(levels[0]),
+                             EDDYSTONE_ADV_INTERVAL_BATTERY_HYSTERESIS_MV,
+                             EDDYSTONE_ADV_INTERVAL_ACTIVITY_SCALE, EDDYSTONE_ADV_INTERVAL_ACTIVITY_MS);
+
+    std::mt19937 rng(42);
+    std::bernoulli_distribution activity(activityPerHour / 3600.0);
+
+    const double capacityUc = capacityMah * 3600.0 * 1000.0;
+    const uint32_t stepMs = 1000;
+    double usedUc = 0;
+    uint64_t nowMs = 0;
+    Result result = {};
+    std::vector<double> pendingFrames(intervals.size(), 0.0);
+
+    for (;;) {
+        double depth = usedUc / capacityUc;
+        uint16_t voltage = batteryVoltageMv(depth);
+        if (depth >= 1.0 || voltage <= dischargeCurve[sizeof(dischargeCurve) / sizeof(dischargeCurve[0]) - 1].voltageMv) {
+            break;
+        }
+        /* EddystoneService samples the battery every EDDYSTONE_ADV_INTERVAL_BATTERY_SAMPLE_MS */
+        if (nowMs % EDDYSTONE_ADV_INTERVAL_BATTERY_SAMPLE_MS == 0) {
+            policy.updateBatteryVoltage(voltage);
+        }
+        if (activity(rng)) {
+            policy.signalActivity((uint32_t)nowMs);
+        }
+        bool active = policy.isActivityActive((uint32_t)nowMs);
+
+        double frames = 0;
+        for (size_t slot = 0; slot < intervals.size(); slot++) {
+            uint16_t interval = adaptive ? policy.getIntervalMs(intervals[slot], (uint32_t)nowMs) : intervals[slot];
+            /* Same limits as EddystoneService::correctAdvertisementPeriod() on the nRF5x */
+            if (interval < 100) {
+                interval = 100;
+            }
+            pendingFrames[slot] += (double)stepMs / interval;
+            double whole = (double)(uint64_t)pendingFrames[slot];
+            pendingFrames[slot] -= whole;
+            frames += whole;
+        }
+
+        usedUc += frames * chargePerFrameUc + sleepUa * stepMs / 1000.0;
+        result.frames += frames;
+        if (active) {
+            result.activeFrames += frames;
+            result.activeSeconds += stepMs / 1000.0;
+        }
+        result.daysPerStep[adaptive ? policy.getBatteryStep() : 0] += stepMs / 86400000.0;
+        nowMs += stepMs;
+    }
+    result.days = nowMs / 86400000.0;
+    return result;
+}
+
+void printResult(const char *name, const Result &r)
+{
+    printf("%-10s %8.1f days %12.0f frames, %6.2f frames/s while active, days per battery step:",
+           name, r.days, r.frames, r.activeSeconds ? r.activeFrames / r.activeSeconds : 0.0);
+    for (int i = 0; i <= AdvIntervalPolicy::MAX_BATTERY_STEPS; i++) {
+        printf(" %.1f", r.daysPerStep[i]);
+    }
+    printf("\n");
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    double capacityMah      = (argc > 1) ? atof(argv[1]) : 230.0;
+    double chargePerFrameUc = (argc > 2) ? atof(argv[2]) : 12.0;
+    double sleepUa          = (argc > 3) ? atof(argv[3]) : 4.0;
+    double activityPerHour  = (argc > 4) ? atof(argv[4]) : 2.0;
+    std::vector<uint16_t> intervals;
+    for (int i = 5; i < argc; i++) {
+        intervals.push_back(strtoul(argv[i], NULL, 0));
+    }
+    if (intervals.empty()) {
+        static const uint16_t defaults[] = EDDYSTONE_DEFAULT_SLOT_INTERVALS;
+        for (size_t i = 0; i < sizeof(defaults) / sizeof(defaults[0]); i++) {
+            if (defaults[i]) {
+                intervals.push_back(defaults[i]);
+            }
+        }
+    }
+    if (capacityMah <= 0 || intervals.empty()) {
+        fprintf(stderr, "Usage: %s [capacityMah] [chargePerFrameUc] [sleepUa] [activityPerHour] [interval...]\n", argv[0]);
+        return 1;
+    }
+
+    printf("%.0f mAh, %.1f uC/frame, %.1f uA sleep, %.1f activity/hour, intervals", capacityMah, chargePerFrameUc,
+           sleepUa, activityPerHour);
+    for (size_t i = 0; i < intervals.size(); i++) {
+        printf(" %u", intervals[i]);
+    }
+    printf(" ms\n\n");
+
+    printResult("static", simulate(false, capacityMah, chargePerFrameUc, sleepUa, activityPerHour, intervals));
+    printResult("adaptive", simulate(true, capacityMah, chargePerFrameUc, sleepUa, activityPerHour, intervals));
+    return 0;
+}
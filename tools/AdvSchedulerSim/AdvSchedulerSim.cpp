@@ -0,0 +1,165 @@
+/*
+ * Copyright (c) 2016, Google Inc, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Host simulator for the slot scheduler of EddystoneService.
+ *
+ * Runs a group of beacons that boot within a few milliseconds of each other
+ * through the same offset/jitter code as the firmware (source/AdvScheduling.h)
+ * and reports how often a frame becomes due in the same tick as another
+ * frame of the same beacon (the frames then queue behind each other in
+ * manageRadio()) or of a neighbouring beacon (the frames may collide on air).
+ *
+ * Usage: AdvSchedulerSim [beacons] [seconds] [jitterMs] [tickMs] [interval...]
+ */
+
+#include "AdvScheduling.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+namespace {
+
+struct Event {
+    uint32_t timeMs;
+    uint16_t beacon;
+    uint8_t  slot;
+    bool operator<(const Event &other) const { return timeMs < other.timeMs; }
+};
+
+struct Mode {
+    const char *name;
+    bool        fixedOffsets;
+    bool        randomOffsets;
+    bool        jitter;
+};
+
+struct Result {
+    uint64_t frames;
+    uint64_t sameBeacon;
+    uint64_t otherBeacon;
+};
+
+/*
+ * Mirrors startEddystoneBeaconAdvertisements() / scheduleNextFrame(): the
+ * schedule of a slot advances by one interval plus a fresh jitter per frame.
+ * The previous scheduler (post_every started in one loop) is the mode with
+ * no offsets and no jitter.
+ */
+Result simulate(const Mode &mode, unsigned beacons, uint32_t durationMs, uint16_t jitterMs,
+                uint32_t tickMs, const std::vector<uint16_t> &intervals, std::mt19937 &rng)
+{
+    std::vector<Event> events;
+    std::uniform_int_distribution<uint32_t> bootSkew(0, 5);
+    std::uniform_int_distribution<uint32_t> seedDist(1, 0xFFFFFFFFu);
+
+    for (unsigned b = 0; b < beacons; b++) {
+        uint32_t state = seedDist(rng);
+        uint32_t bootMs = bootSkew(rng);
+        for (size_t slot = 0; slot < intervals.size(); slot++) {
+            uint16_t interval = intervals[slot];
+            /* Fixed offsets spread the slots evenly over the shortest interval */
+            uint16_t fixedOffset = mode.fixedOffsets ? (uint16_t)(slot * intervals[0] / intervals.size()) : 0;
+            uint16_t offset = eddystoneAdvSlotOffsetMs(state, fixedOffset, interval, mode.randomOffsets);
+            uint32_t due = bootMs + offset;
+            while (due < durationMs) {
+                events.push_back(Event{due, (uint16_t)b, (uint8_t)slot});
+                due += interval + eddystoneAdvJitterMs(state, mode.jitter ? jitterMs : 0);
+            }
+        }
+    }
+
+    std::sort(events.begin(), events.end());
+
+    Result result = {events.size(), 0, 0};
+    size_t begin = 0;
+    while (begin < events.size()) {
+        uint32_t tick = events[begin].timeMs / tickMs;
+        size_t end = begin;
+        while (end < events.size() && events[end].timeMs / tickMs == tick) {
+            end++;
+        }
+        for (size_t i = begin; i < end; i++) {
+            bool sameBeacon = false;
+            bool otherBeacon = false;
+            for (size_t j = begin; j < end; j++) {
+                if (i == j) {
+                    continue;
+                }
+                if (events[i].beacon == events[j].beacon) {
+                    sameBeacon = true;
+                } else {
+                    otherBeacon = true;
+                }
+            }
+            result.sameBeacon += sameBeacon;
+            result.otherBeacon += otherBeacon;
+        }
+        begin = end;
+    }
+    return result;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    unsigned beacons   = (argc > 1) ? strtoul(argv[1], NULL, 0) : 8;
+    uint32_t seconds   = (argc > 2) ? strtoul(argv[2], NULL, 0) : 600;
+    uint16_t jitterMs  = (argc > 3) ? strtoul(argv[3], NULL, 0) : 10;
+    uint32_t tickMs    = (argc > 4) ? strtoul(argv[4], NULL, 0) : 1;
+    std::vector<uint16_t> intervals;
+    for (int i = 5; i < argc; i++) {
+        intervals.push_back(strtoul(argv[i], NULL, 0));
+    }
+    if (intervals.empty()) {
+        /* Equal and harmonically related intervals: the worst case for the old scheduler */
+        intervals.push_back(700);
+        intervals.push_back(700);
+        intervals.push_back(1400);
+    }
+    if (beacons == 0 || seconds == 0 || tickMs == 0 ||
+        std::find(intervals.begin(), intervals.end(), 0) != intervals.end()) {
+        fprintf(stderr, "Usage: %s [beacons] [seconds] [jitterMs] [tickMs] [interval...]\n", argv[0]);
+        return 1;
+    }
+
+    const Mode modes[] = {
+        { "no offset, no jitter",     false, false, false },
+        { "fixed offsets",            true,  false, false },
+        { "jitter",                   false, false, true  },
+        { "fixed offsets + jitter",   true,  false, true  },
+        { "random offsets + jitter",  false, true,  true  },
+    };
+
+    printf("%u beacons, %u s, jitter <= %u ms, tick %u ms, intervals", beacons, seconds, jitterMs, tickMs);
+    for (size_t i = 0; i < intervals.size(); i++) {
+        printf(" %u", intervals[i]);
+    }
+    printf(" ms\n\n%-26s %10s %14s %14s\n", "mode", "frames", "same beacon", "other beacon");
+
+    for (size_t m = 0; m < sizeof(modes) / sizeof(modes[0]); m++) {
+        std::mt19937 rng(1234);
+        Result r = simulate(modes[m], beacons, seconds * 1000, jitterMs, tickMs, intervals, rng);
+        printf("%-26s %10llu %13.2f%% %13.2f%%\n", modes[m].name, (unsigned long long)r.frames,
+               100.0 * r.sameBeacon / r.frames, 100.0 * r.otherBeacon / r.frames);
+    }
+    return 0;
+}
@@ -0,0 +1,300 @@
+/*
+ * Copyright (c) 2016, Google Inc, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Host check of the advertising-set backend of EddystoneService.
+ *
+ * Builds EddystoneService as it is, with USE_ADV_SETS and the software sets
+ * of ADV_SETS_HOST_STUB (source/AdvertisingSets/AdvertisingSets.cpp), on a
+ * host BLE API and event queue that run in virtual time (host/). Each
+ * scenario starts the beacon advertisements, runs the queue and checks what
+ * startAdvertisingSets() and refreshAdvertisingSet() left in the sets:
+ *
+ *   mapping   one set per enabled slot, with the slot's frame, corrected
+ *             interval and radio TX power, and only the first connectable
+ *   tlm       the PDU count of a plain TLM frame follows the PDUs estimated
+ *             from the set intervals
+ *   eid       each EID set gets a new payload once per rotation, also when
+ *             another EID slot on the same boundary rotated it first
+ *             (slotEidPayloadsPending), and never in between
+ *   fallback  a set that fails to start leaves no set advertising and the
+ *             legacy advertiser running
+ *
+ * Usage: AdvSetsHostCheck
+ */
+
+#include "EddystoneService.h"
+#include "AdvertisingSets/AdvertisingSets.h"
+#include "PersistentStorageHelper/ConfigParamsPersistence.h"
+#include "HostEventQueue.h"
+
+#include <cstdio>
+
+/* Nothing is persisted on the host */
+void saveEddystoneTimeParams(const TimeParams_t *timeP)
+{
+    (void)timeP;
+}
+
+namespace {
+
+/* Offsets in a set payload: flags (3), service UUID list (4), service data header (2), Eddystone UUID (2) */
+const size_t PAYLOAD_FRAME_TYPE = 11;
+const size_t PAYLOAD_TLM_PDU_COUNT = PAYLOAD_FRAME_TYPE + 6;
+
+/* Eddystone frame type byte of each EddystoneFrameTypes::FrameType */
+const uint8_t FRAME_TYPE_BYTES[] = { 0x00, 0x10, 0x20, 0x30 };
+
+struct SlotSetup {
+    uint8_t  frameType;
+    uint16_t intervalMs;
+    int8_t   radioTxPower;
+};
+
+const PowerLevels_t advTxPowerLevels = EDDYSTONE_DEFAULT_ADV_TX_POWER_LEVELS;
+const PowerLevels_t radioTxPowerLevels = EDDYSTONE_DEFAULT_RADIO_TX_POWER_LEVELS;
+
+unsigned checks = 0;
+unsigned failures = 0;
+
+void check(bool ok, const char *scenario, const char *what, int slot = -1)
+{
+    checks++;
+    if (!ok) {
+        failures++;
+        if (slot >= 0) {
+            printf("FAIL %s: %s (slot %d)\n", scenario, what, slot);
+        } else {
+            printf("FAIL %s: %s\n", scenario, what);
+        }
+    }
+}
+
+uint16_t correctedInterval(uint16_t intervalMs)
+{
+    const Gap &gap = BLE::Instance().gap();
+    if (intervalMs < gap.getMinNonConnectableAdvertisingInterval()) {
+        return gap.getMinNonConnectableAdvertisingInterval();
+    }
+    return (intervalMs > gap.getMaxAdvertisingInterval()) ? gap.getMaxAdvertisingInterval() : intervalMs;
+}
+
+/*
+ * A beacon rebooted into a slot configuration: the parameters of a first
+ * boot service with the slots replaced, as loaded from storage on a later
+ * boot. The services are never deleted, events they posted may still run.
+ */
+EddystoneService *bootBeacon(HostEventQueue &queue, const SlotSetup (&slots)[MAX_ADV_SLOTS])
+{
+    static EddystoneService *factory = new EddystoneService(BLE::Instance(), advTxPowerLevels, radioTxPowerLevels, queue);
+    EddystoneService::EddystoneParams_t params;
+    factory->getEddystoneParams(params);
+
+    const uint8_t uid[16] = { 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F };
+    params.timeParams.timeInPriorBoots = 0;
+    params.timeParams.timeSinceLastBoot = 0;
+    /* Remain connectable (REMAIN_CONNECTABLE_SET), so one set has to be */
+    params.remainConnectable = 0x01;
+    for (int slot = 0; slot < MAX_ADV_SLOTS; slot++) {
+        uint8_t *frame = &params.slotStorage[slot * sizeof(Slot_t)];
+        params.slotFrameTypes[slot] = slots[slot].frameType;
+        params.slotAdvIntervals[slot] = slots[slot].intervalMs;
+        params.slotRadioTxPowerLevels[slot] = slots[slot].radioTxPower;
+        switch (slots[slot].frameType) {
+            case EddystoneFrameTypes::EDDYSTONE_FRAME_UID: {
+                UIDFrame uidFrame;
+                uidFrame.setData(frame, params.slotAdvTxPowerLevels[slot], uid);
+                break;
+            }
+            case EddystoneFrameTypes::EDDYSTONE_FRAME_URL: {
+                URLFrame urlFrame;
+                urlFrame.setUnencodedUrlData(frame, params.slotAdvTxPowerLevels[slot], "https://www.mbed.com/");
+                break;
+            }
+            case EddystoneFrameTypes::EDDYSTONE_FRAME_TLM: {
+                TLMFrame tlmFrame;
+                tlmFrame.setTLMData(TLMFrame::DEFAULT_TLM_VERSION);
+                tlmFrame.setData(frame);
+                break;
+            }
+            default:
+                /* EID frames are computed by the service */
+                break;
+        }
+    }
+    return new EddystoneService(BLE::Instance(), params, radioTxPowerLevels, queue);
+}
+
+/* Every enabled slot has its own set with its settings, disabled slots have none */
+void checkMapping(const char *scenario, const SlotSetup (&slots)[MAX_ADV_SLOTS])
+{
+    bool connectableSeen = false;
+    for (int slot = 0; slot < MAX_ADV_SLOTS; slot++) {
+        const AdvSetStubState_t *set = eddystoneAdvSetStubState(slot);
+        if (!slots[slot].intervalMs) {
+            check(!set->configured && !set->advertising, scenario, "disabled slot has a set", slot);
+            continue;
+        }
+        check(set->configured && set->advertising, scenario, "set not advertising", slot);
+        check(set->intervalMs == correctedInterval(slots[slot].intervalMs), scenario, "set interval", slot);
+        check(set->radioTxPower == slots[slot].radioTxPower, scenario, "set radio TX power", slot);
+        check((set->payloadLen > PAYLOAD_FRAME_TYPE) &&
+              (set->payload[PAYLOAD_FRAME_TYPE] == FRAME_TYPE_BYTES[slots[slot].frameType]),
+              scenario, "set payload is not the slot frame", slot);
+        check(set->connectable == !connectableSeen, scenario, "only the first set is connectable", slot);
+        connectableSeen = true;
+    }
+}
+
+void checkTlm(HostEventQueue &queue)
+{
+    const char *scenario = "tlm";
+    const SlotSetup slots[MAX_ADV_SLOTS] = {
+        { EddystoneFrameTypes::EDDYSTONE_FRAME_URL, 500, -4 },
+        { EddystoneFrameTypes::EDDYSTONE_FRAME_UID, 50, -16 },  /* below the controller minimum */
+        { EddystoneFrameTypes::EDDYSTONE_FRAME_TLM, 2000, 4 },
+    };
+    const int tlmSlot = 2;
+    const uint64_t runMs = 60000;
+
+    eddystoneAdvSetStubReset();
+    EddystoneService *beacon = bootBeacon(queue, slots);
+    uint64_t startMs = hostClockMs();
+    check(beacon->startEddystoneBeaconAdvertisements() == EddystoneService::EDDYSTONE_ERROR_NONE, scenario, "start");
+    checkMapping("mapping", slots);
+
+    /* The TLM set is refreshed on its interval, the others never change */
+    queue.run(startMs + runMs);
+    uint64_t expectedPdus = 0;
+    for (int slot = 0; slot < MAX_ADV_SLOTS; slot++) {
+        expectedPdus += runMs / correctedInterval(slots[slot].intervalMs);
+    }
+    const AdvSetStubState_t *set = eddystoneAdvSetStubState(tlmSlot);
+    const uint8_t *pdus = &set->payload[PAYLOAD_TLM_PDU_COUNT];
+    uint32_t pduCount = ((uint32_t)pdus[0] << 24) | ((uint32_t)pdus[1] << 16) | ((uint32_t)pdus[2] << 8) | pdus[3];
+    printf("tlm: PDU count %lu after %lu ms, estimated %lu\n", (unsigned long)pduCount, (unsigned long)runMs,
+           (unsigned long)expectedPdus);
+    check(pduCount == expectedPdus, scenario, "TLM PDU count");
+    check(set->payloadUpdates == 1 + runMs / slots[tlmSlot].intervalMs, scenario, "TLM payload refreshes");
+    check(eddystoneAdvSetStubState(0)->payloadUpdates == 1, scenario, "static set payload rewritten", 0);
+    check(eddystoneAdvSetStubState(1)->payloadUpdates == 1, scenario, "static set payload rewritten", 1);
+
+    beacon->stopEddystoneBeaconAdvertisements();
+    for (int slot = 0; slot < MAX_ADV_SLOTS; slot++) {
+        check(!eddystoneAdvSetStubState(slot)->advertising, scenario, "set still advertising after stop", slot);
+    }
+}
+
+void checkEid(HostEventQueue &queue)
+{
+    const char *scenario = "eid";
+    /* Two EID slots on the same rotation period (EDDYSTONE_DEFAULT_SLOT_EID_ROTATION_PERIOD_EXPS) */
+    const SlotSetup slots[MAX_ADV_SLOTS] = {
+        { EddystoneFrameTypes::EDDYSTONE_FRAME_UID, 1000, -8 },
+        { EddystoneFrameTypes::EDDYSTONE_FRAME_EID, 1000, -4 },
+        { EddystoneFrameTypes::EDDYSTONE_FRAME_EID, 1500, 0 },
+    };
+    const uint8_t rotationPeriodExps[] = EDDYSTONE_DEFAULT_SLOT_EID_ROTATION_PERIOD_EXPS;
+    const uint64_t runMs = 3000000;
+
+    eddystoneAdvSetStubReset();
+    EddystoneService *beacon = bootBeacon(queue, slots);
+    uint64_t startMs = hostClockMs();
+    check(beacon->startEddystoneBeaconAdvertisements() == EddystoneService::EDDYSTONE_ERROR_NONE, scenario, "start");
+    checkMapping("mapping", slots);
+
+    /* Count the EID changes seen in each set after every event */
+    uint8_t lastPayloads[MAX_ADV_SLOTS][31];
+    uint32_t changes[MAX_ADV_SLOTS] = { 0 };
+    for (int slot = 0; slot < MAX_ADV_SLOTS; slot++) {
+        memcpy(lastPayloads[slot], eddystoneAdvSetStubState(slot)->payload, sizeof(lastPayloads[slot]));
+    }
+    queue.run(startMs + runMs, [&]() {
+        for (int slot = 0; slot < MAX_ADV_SLOTS; slot++) {
+            const AdvSetStubState_t *set = eddystoneAdvSetStubState(slot);
+            if (memcmp(lastPayloads[slot], set->payload, sizeof(lastPayloads[slot])) != 0) {
+                memcpy(lastPayloads[slot], set->payload, sizeof(lastPayloads[slot]));
+                changes[slot]++;
+            }
+        }
+    });
+
+    for (int slot = 0; slot < MAX_ADV_SLOTS; slot++) {
+        const AdvSetStubState_t *set = eddystoneAdvSetStubState(slot);
+        if (slots[slot].frameType != EddystoneFrameTypes::EDDYSTONE_FRAME_EID) {
+            check(set->payloadUpdates == 1, scenario, "static set payload rewritten", slot);
+            continue;
+        }
+        /* The beacon time started with the run, the first rotation came with the start */
+        uint32_t rotations = (uint32_t)((startMs + runMs) / 1000 >> rotationPeriodExps[slot]) -
+                             (uint32_t)(startMs / 1000 >> rotationPeriodExps[slot]);
+        uint32_t refreshes = runMs / slots[slot].intervalMs;
+        printf("eid: slot %d, %lu refreshes, %lu payload updates, %lu EID changes, %lu rotations due\n", slot,
+               (unsigned long)refreshes, (unsigned long)(set->payloadUpdates - 1), (unsigned long)changes[slot],
+               (unsigned long)rotations);
+        check(changes[slot] == rotations, scenario, "EID changes in the set", slot);
+        check(set->payloadUpdates == 1 + rotations, scenario, "EID payload written between rotations", slot);
+    }
+    beacon->stopEddystoneBeaconAdvertisements();
+}
+
+void checkFallback(HostEventQueue &queue)
+{
+    const char *scenario = "fallback";
+    const SlotSetup slots[MAX_ADV_SLOTS] = {
+        { EddystoneFrameTypes::EDDYSTONE_FRAME_URL, 500, -4 },
+        { EddystoneFrameTypes::EDDYSTONE_FRAME_UID, 1000, -8 },
+        { EddystoneFrameTypes::EDDYSTONE_FRAME_URL, 0, -8 },
+    };
+
+    eddystoneAdvSetStubReset();
+    eddystoneAdvSetStubFailStart(1, true);
+    EddystoneService *beacon = bootBeacon(queue, slots);
+    Gap &gap = BLE::Instance().gap();
+    uint32_t startCalls = gap.startCalls;
+    check(beacon->startEddystoneBeaconAdvertisements() == EddystoneService::EDDYSTONE_ERROR_NONE, scenario, "start");
+    for (int slot = 0; slot < MAX_ADV_SLOTS; slot++) {
+        check(!eddystoneAdvSetStubState(slot)->advertising, scenario, "set advertising after a failed start", slot);
+    }
+
+    /* The legacy advertiser swaps each frame in as it becomes due */
+    const uint64_t runMs = 5000;
+    queue.run(hostClockMs() + runMs);
+    check(gap.startCalls - startCalls >= runMs / slots[0].intervalMs + runMs / slots[1].intervalMs,
+          scenario, "legacy advertiser not running");
+    beacon->stopEddystoneBeaconAdvertisements();
+    eddystoneAdvSetStubFailStart(1, false);
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    (void)argv;
+    if (argc > 1) {
+        fprintf(stderr, "Usage: AdvSetsHostCheck\n");
+        return 2;
+    }
+
+    HostEventQueue queue;
+    checkTlm(queue);
+    checkEid(queue);
+    checkFallback(queue);
+
+    printf("%u checks, %u failed\n", checks, failures);
+    return failures ? 1 : 0;
+}
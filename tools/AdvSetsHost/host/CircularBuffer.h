@@ -0,0 +1,61 @@
+/*
+ * Copyright (c) 2016, Google Inc, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __ADV_SETS_HOST_CIRCULARBUFFER_H__
+#define __ADV_SETS_HOST_CIRCULARBUFFER_H__
+
+#include <stdint.h>
+
+/** Host stand-in for mbed's CircularBuffer (drops the oldest item when full) */
+template<typename T, uint32_t BufferSize>
+class CircularBuffer {
+public:
+    CircularBuffer() : head(0), tail(0), isFull(false) { }
+
+    void push(const T &data)
+    {
+        if (isFull) {
+            tail = (tail + 1) % BufferSize;
+        }
+        pool[head] = data;
+        head = (head + 1) % BufferSize;
+        isFull = (head == tail);
+    }
+
+    bool pop(T &data)
+    {
+        if (empty()) {
+            return false;
+        }
+        data = pool[tail];
+        tail = (tail + 1) % BufferSize;
+        isFull = false;
+        return true;
+    }
+
+    bool empty(void) const { return (head == tail) && !isFull; }
+    bool full(void) const { return isFull; }
+    void reset(void) { head = tail = 0; isFull = false; }
+
+private:
+    T        pool[BufferSize];
+    uint32_t head;
+    uint32_t tail;
+    bool     isFull;
+};
+
+#endif /* __ADV_SETS_HOST_CIRCULARBUFFER_H__ */
@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) 2016, Google Inc, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __ADV_SETS_HOST_EVENTQUEUE_H__
+#define __ADV_SETS_HOST_EVENTQUEUE_H__
+
+#include "EventQueue/EventQueue.h"
+#include "mbed.h"
+
+#include <stdint.h>
+#include <list>
+
+/*
+ * Event queue in virtual time: run() moves hostClockMs() from event to
+ * event, in due time order and in posting order for events due together.
+ */
+class HostEventQueue : public eq::EventQueue {
+public:
+    HostEventQueue() : nextId(1) { }
+
+    virtual bool cancel(event_handle_t handle)
+    {
+        for (std::list<Event>::iterator it = events.begin(); it != events.end(); ++it) {
+            if (it->id == handle) {
+                events.erase(it);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /** Run the events due up to @p untilMs, calling @p observe after each */
+    template<typename Observer>
+    void run(uint64_t untilMs, Observer observe)
+    {
+        for (;;) {
+            std::list<Event>::iterator next = events.end();
+            for (std::list<Event>::iterator it = events.begin(); it != events.end(); ++it) {
+                if ((next == events.end()) || (it->dueMs < next->dueMs)) {
+                    next = it;
+                }
+            }
+            if ((next == events.end()) || (next->dueMs > untilMs)) {
+                break;
+            }
+            hostClockMs() = next->dueMs;
+            function_t fn = next->fn;
+            if (next->periodMs) {
+                /* Requeue before the call, so the event may cancel itself */
+                Event again = *next;
+                again.dueMs += again.periodMs;
+                events.erase(next);
+                events.push_back(again);
+            } else {
+                events.erase(next);
+            }
+            fn();
+            observe();
+        }
+        hostClockMs() = untilMs;
+    }
+
+    void run(uint64_t untilMs)
+    {
+        run(untilMs, []() { });
+    }
+
+private:
+    struct Event {
+        function_t     fn;
+        uint64_t       dueMs;
+        ms_time_t      periodMs;
+        event_handle_t id;
+    };
+
+    virtual event_handle_t do_post(const function_t &fn, ms_time_t msDelay, bool repeat)
+    {
+        Event event = { fn, hostClockMs() + msDelay, repeat ? msDelay : 0, reinterpret_cast<event_handle_t>(nextId++) };
+        events.push_back(event);
+        return event.id;
+    }
+
+    std::list<Event> events;
+    uintptr_t        nextId;
+};
+
+#endif /* __ADV_SETS_HOST_EVENTQUEUE_H__ */
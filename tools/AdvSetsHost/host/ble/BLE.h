@@ -0,0 +1,301 @@
+/*
+ * Copyright (c) 2016, Google Inc, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Host stand-in for the BLE API used by EddystoneService, for
+ * AdvSetsHostCheck. GATT calls are accepted and dropped; the legacy
+ * advertiser records its state so the fallback from advertising sets can
+ * be checked.
+ */
+
+#ifndef __ADV_SETS_HOST_BLE_H__
+#define __ADV_SETS_HOST_BLE_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+typedef int ble_error_t;
+enum {
+    BLE_ERROR_NONE               = 0,
+    BLE_ERROR_BUFFER_OVERFLOW    = 1,
+    BLE_ERROR_NOT_IMPLEMENTED    = 2,
+    BLE_ERROR_PARAM_OUT_OF_RANGE = 3,
+    BLE_ERROR_INVALID_STATE      = 6
+};
+
+enum GattAuthCallbackReply_t {
+    AUTH_CALLBACK_REPLY_SUCCESS,
+    AUTH_CALLBACK_REPLY_ATTERR_INVALID_OFFSET,
+    AUTH_CALLBACK_REPLY_ATTERR_READ_NOT_PERMITTED,
+    AUTH_CALLBACK_REPLY_ATTERR_WRITE_NOT_PERMITTED,
+    AUTH_CALLBACK_REPLY_ATTERR_INSUF_AUTHORIZATION,
+    AUTH_CALLBACK_REPLY_ATTERR_INVALID_ATT_VAL_LENGTH,
+    AUTH_CALLBACK_REPLY_ATTERR_UNLIKELY_ERROR
+};
+
+struct GattWriteAuthCallbackParams {
+    uint16_t                connHandle;
+    uint16_t                handle;
+    uint16_t                offset;
+    uint16_t                len;
+    const uint8_t          *data;
+    GattAuthCallbackReply_t authorizationReply;
+};
+
+struct GattReadAuthCallbackParams {
+    uint16_t                connHandle;
+    uint16_t                handle;
+    uint16_t                offset;
+    uint16_t                len;
+    uint8_t                *data;
+    GattAuthCallbackReply_t authorizationReply;
+};
+
+struct GattWriteCallbackParams {
+    uint16_t       connHandle;
+    uint16_t       handle;
+    int            writeOp;
+    uint16_t       offset;
+    uint16_t       len;
+    const uint8_t *data;
+};
+
+namespace BLEProtocol {
+    struct AddressType {
+        enum Type { PUBLIC, RANDOM_STATIC };
+    };
+}
+
+class GapAdvertisingData {
+public:
+    enum Flags {
+        LE_GENERAL_DISCOVERABLE = 0x02,
+        BREDR_NOT_SUPPORTED     = 0x04
+    };
+    enum DataType {
+        FLAGS                            = 0x01,
+        COMPLETE_LIST_16BIT_SERVICE_IDS  = 0x03,
+        COMPLETE_LIST_128BIT_SERVICE_IDS = 0x07,
+        COMPLETE_LOCAL_NAME              = 0x09,
+        TX_POWER_LEVEL                   = 0x0A,
+        SERVICE_DATA                     = 0x16
+    };
+    enum Appearance {
+        GENERIC_TAG = 512
+    };
+    static const unsigned GAP_ADVERTISING_DATA_MAX_PAYLOAD = 31;
+};
+
+class GapAdvertisingParams {
+public:
+    enum AdvertisingType_t {
+        ADV_CONNECTABLE_UNDIRECTED,
+        ADV_SCANNABLE_UNDIRECTED,
+        ADV_NON_CONNECTABLE_UNDIRECTED
+    };
+};
+
+class Gap {
+public:
+    struct GapState_t {
+        unsigned advertising : 1;
+        unsigned connected   : 1;
+    };
+
+    Gap() : advertising(false), startCalls(0), txPower(0) { }
+
+    ble_error_t accumulateAdvertisingPayload(uint8_t flags) { (void) flags; return BLE_ERROR_NONE; }
+    ble_error_t accumulateAdvertisingPayload(GapAdvertisingData::Appearance app) { (void) app; return BLE_ERROR_NONE; }
+    ble_error_t accumulateAdvertisingPayload(GapAdvertisingData::DataType type, const uint8_t *data, uint8_t len)
+    {
+        (void) type;
+        (void) data;
+        (void) len;
+        return BLE_ERROR_NONE;
+    }
+    ble_error_t accumulateScanResponse(GapAdvertisingData::DataType type, const uint8_t *data, uint8_t len)
+    {
+        (void) type;
+        (void) data;
+        (void) len;
+        return BLE_ERROR_NONE;
+    }
+    void clearAdvertisingPayload(void) { }
+    void clearScanResponse(void) { }
+
+    uint16_t getMaxAdvertisingInterval(void) const { return 10240; }
+    uint16_t getMinAdvertisingInterval(void) const { return 20; }
+    uint16_t getMinNonConnectableAdvertisingInterval(void) const { return 100; }
+
+    GapState_t getState(void) const
+    {
+        GapState_t state = { advertising, 0 };
+        return state;
+    }
+
+    void setAdvertisingInterval(uint16_t intervalMs) { (void) intervalMs; }
+    void setAdvertisingType(GapAdvertisingParams::AdvertisingType_t type) { (void) type; }
+    ble_error_t setDeviceName(const uint8_t *name) { (void) name; return BLE_ERROR_NONE; }
+    ble_error_t setTxPower(int8_t txPowerIn) { txPower = txPowerIn; return BLE_ERROR_NONE; }
+
+    ble_error_t startAdvertising(void) { advertising = true; startCalls++; return BLE_ERROR_NONE; }
+    ble_error_t stopAdvertising(void) { advertising = false; return BLE_ERROR_NONE; }
+
+    /* Recorded for the check */
+    bool     advertising;
+    uint32_t startCalls;
+    int8_t   txPower;
+};
+
+class GattAttribute {
+public:
+    typedef uint16_t Handle_t;
+};
+
+class GattCharacteristic {
+public:
+    enum Properties_t {
+        BLE_GATT_CHAR_PROPERTIES_READ  = 0x02,
+        BLE_GATT_CHAR_PROPERTIES_WRITE = 0x08
+    };
+
+    GattCharacteristic(const uint8_t *uuid, uint8_t *valuePtr, uint16_t len, uint16_t maxLen, uint8_t props)
+    {
+        (void) uuid;
+        (void) valuePtr;
+        (void) len;
+        (void) maxLen;
+        (void) props;
+    }
+    virtual ~GattCharacteristic() { }
+
+    template<class T>
+    void setReadAuthorizationCallback(T *object, void (T::*member)(GattReadAuthCallbackParams *))
+    {
+        (void) object;
+        (void) member;
+    }
+
+    template<class T>
+    void setWriteAuthorizationCallback(T *object, void (T::*member)(GattWriteAuthCallbackParams *))
+    {
+        (void) object;
+        (void) member;
+    }
+
+    GattAttribute::Handle_t getValueHandle(void) const { return 0; }
+};
+
+template<class T>
+class ReadOnlyGattCharacteristic : public GattCharacteristic {
+public:
+    ReadOnlyGattCharacteristic(const uint8_t *uuid, T *valuePtr) :
+        GattCharacteristic(uuid, reinterpret_cast<uint8_t *>(valuePtr), sizeof(T), sizeof(T), BLE_GATT_CHAR_PROPERTIES_READ) { }
+};
+
+template<class T>
+class WriteOnlyGattCharacteristic : public GattCharacteristic {
+public:
+    WriteOnlyGattCharacteristic(const uint8_t *uuid, T *valuePtr) :
+        GattCharacteristic(uuid, reinterpret_cast<uint8_t *>(valuePtr), sizeof(T), sizeof(T), BLE_GATT_CHAR_PROPERTIES_WRITE) { }
+};
+
+template<class T>
+class ReadWriteGattCharacteristic : public GattCharacteristic {
+public:
+    ReadWriteGattCharacteristic(const uint8_t *uuid, T *valuePtr) :
+        GattCharacteristic(uuid, reinterpret_cast<uint8_t *>(valuePtr), sizeof(T), sizeof(T),
+                           BLE_GATT_CHAR_PROPERTIES_READ | BLE_GATT_CHAR_PROPERTIES_WRITE) { }
+};
+
+template<class T, unsigned NUM_ELEMENTS>
+class ReadOnlyArrayGattCharacteristic : public GattCharacteristic {
+public:
+    ReadOnlyArrayGattCharacteristic(const uint8_t *uuid, T valuePtr[NUM_ELEMENTS]) :
+        GattCharacteristic(uuid, reinterpret_cast<uint8_t *>(valuePtr), sizeof(T) * NUM_ELEMENTS,
+                           sizeof(T) * NUM_ELEMENTS, BLE_GATT_CHAR_PROPERTIES_READ) { }
+};
+
+template<class T, unsigned NUM_ELEMENTS>
+class ReadWriteArrayGattCharacteristic : public GattCharacteristic {
+public:
+    ReadWriteArrayGattCharacteristic(const uint8_t *uuid, T valuePtr[NUM_ELEMENTS]) :
+        GattCharacteristic(uuid, reinterpret_cast<uint8_t *>(valuePtr), sizeof(T) * NUM_ELEMENTS,
+                           sizeof(T) * NUM_ELEMENTS, BLE_GATT_CHAR_PROPERTIES_READ | BLE_GATT_CHAR_PROPERTIES_WRITE) { }
+};
+
+class GattService {
+public:
+    GattService(const uint8_t *uuid, GattCharacteristic *characteristics[], unsigned numCharacteristics)
+    {
+        (void) uuid;
+        (void) characteristics;
+        (void) numCharacteristics;
+    }
+};
+
+class GattServer {
+public:
+    ble_error_t addService(GattService &service) { (void) service; return BLE_ERROR_NONE; }
+
+    template<class T>
+    void onDataWritten(T *object, void (T::*member)(const GattWriteCallbackParams *))
+    {
+        (void) object;
+        (void) member;
+    }
+
+    ble_error_t write(GattAttribute::Handle_t handle, const uint8_t *value, uint16_t size)
+    {
+        (void) handle;
+        (void) value;
+        (void) size;
+        return BLE_ERROR_NONE;
+    }
+};
+
+class BLE {
+public:
+    struct InitializationCompleteCallbackContext {
+        BLE        &ble;
+        ble_error_t error;
+    };
+
+    static BLE &Instance(void)
+    {
+        static BLE instance;
+        return instance;
+    }
+
+    Gap &gap(void) { return gapInstance; }
+    const Gap &gap(void) const { return gapInstance; }
+    GattServer &gattServer(void) { return gattServerInstance; }
+
+    ble_error_t setAddress(BLEProtocol::AddressType::Type type, const uint8_t *address)
+    {
+        (void) type;
+        (void) address;
+        return BLE_ERROR_NONE;
+    }
+
+private:
+    Gap        gapInstance;
+    GattServer gattServerInstance;
+};
+
+#endif /* __ADV_SETS_HOST_BLE_H__ */
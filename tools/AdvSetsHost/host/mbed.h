@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) 2016, Google Inc, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Host stand-in for the parts of mbed.h used by EddystoneService, for
+ * AdvSetsHostCheck. Time is virtual: Timer reads hostClockMs(), which the
+ * check advances along with its event queue.
+ */
+
+#ifndef __ADV_SETS_HOST_MBED_H__
+#define __ADV_SETS_HOST_MBED_H__
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/** The virtual time (ms) seen by every Timer */
+inline uint64_t &hostClockMs(void)
+{
+    static uint64_t nowMs = 0;
+    return nowMs;
+}
+
+class Timer {
+public:
+    Timer() : running(false), startMs(0) { }
+    void start(void) { if (!running) { running = true; startMs = hostClockMs(); } }
+    void stop(void) { running = false; }
+    void reset(void) { startMs = hostClockMs(); }
+    int read_ms(void) { return running ? (int)(hostClockMs() - startMs) : 0; }
+    int read_us(void) { return read_ms() * 1000; }
+
+private:
+    bool     running;
+    uint64_t startMs;
+};
+
+inline uint32_t us_ticker_read(void)
+{
+    return (uint32_t)(hostClockMs() * 1000);
+}
+
+inline void error(const char *format, ...)
+{
+    fprintf(stderr, "error: %s\n", format);
+    exit(1);
+}
+
+#endif /* __ADV_SETS_HOST_MBED_H__ */
@@ -0,0 +1,168 @@
+/*
+ * Copyright (c) 2016, Google Inc, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Check and benchmark for Aes128Batch.
+ *
+ * Every backend the CPU supports is checked block for block against
+ * HostAes128, and EIDs computed in two batched passes (temporary keys, then
+ * EIDs) against eidCompute(). Then blocks per second are reported for
+ * HostAes128 (one key expansion and one block at a time) and each backend,
+ * with keys expanded on the fly and pre-expanded, as well as EIDs per
+ * second.
+ *
+ * Usage: Aes128BatchBench [blocks]
+ */
+
+#include "Aes128Batch.h"
+#include "EidCompute.h"
+#include "HostAes128.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+double secondsSince(Clock::time_point start)
+{
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+struct Data {
+    std::vector<uint8_t>                   keys;
+    std::vector<uint8_t>                   blocks;
+    std::vector<Aes128Batch::Key>          expanded;
+    std::vector<const Aes128Batch::Key *>  keyPtrs;
+    std::vector<uint8_t>                   out;
+};
+
+Data makeData(size_t n, std::mt19937 &rng)
+{
+    Data d;
+    d.keys.resize(16 * n);
+    d.blocks.resize(16 * n);
+    d.out.resize(16 * n);
+    for (size_t i = 0; i < 16 * n; i++) {
+        d.keys[i] = (uint8_t)rng();
+        d.blocks[i] = (uint8_t)rng();
+    }
+    d.expanded.resize(n);
+    Aes128Batch::expandKeys(d.keys.data(), d.expanded.data(), n);
+    for (size_t i = 0; i < n; i++) {
+        d.keyPtrs.push_back(&d.expanded[i]);
+    }
+    return d;
+}
+
+/* Returns the number of blocks that differ from HostAes128 */
+size_t check(std::mt19937 &rng)
+{
+    size_t wrong = 0;
+    static const size_t sizes[] = { 1, 7, 8, 9, 63, 64, 65, 1000 };
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        size_t n = sizes[s];
+        Data d = makeData(n, rng);
+        std::vector<uint8_t> expandedOut(16 * n);
+        Aes128Batch::encryptWithKeys(d.keys.data(), d.blocks.data(), d.out.data(), n);
+        Aes128Batch::encrypt(d.keyPtrs.data(), d.blocks.data(), expandedOut.data(), n);
+        for (size_t i = 0; i < n; i++) {
+            uint8_t ref[16];
+            HostAes128(&d.keys[16 * i]).encrypt(&d.blocks[16 * i], ref);
+            wrong += memcmp(ref, &d.out[16 * i], 16) != 0;
+            wrong += memcmp(ref, &expandedOut[16 * i], 16) != 0;
+        }
+    }
+    return wrong;
+}
+
+/* n EIDs as EidResolver computes them; returns the number that differ from eidCompute() */
+size_t eidBatch(const Data &d, size_t n, const uint8_t *exps, const uint32_t *times, bool verify)
+{
+    std::vector<uint8_t> blocks(16 * n), tmpKeys(16 * n);
+    for (size_t i = 0; i < n; i++) {
+        eidTemporaryKeyBlock(times[i], &blocks[16 * i]);
+    }
+    Aes128Batch::encryptWithKeys(d.keys.data(), blocks.data(), tmpKeys.data(), n);
+    for (size_t i = 0; i < n; i++) {
+        eidBlock(exps[i], times[i], &blocks[16 * i]);
+    }
+    Aes128Batch::encryptWithKeys(tmpKeys.data(), blocks.data(), blocks.data(), n);
+    size_t wrong = 0;
+    for (size_t i = 0; verify && i < n; i++) {
+        wrong += eidFromEncryptedBlock(&blocks[16 * i]) != eidCompute(&d.keys[16 * i], exps[i], times[i]);
+    }
+    return wrong;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    size_t n = (argc > 1) ? strtoul(argv[1], NULL, 0) : 1000000;
+    if (n == 0) {
+        fprintf(stderr, "Usage: %s [blocks]\n", argv[0]);
+        return 1;
+    }
+
+    std::mt19937 rng(7);
+    Data d = makeData(n, rng);
+    std::vector<uint8_t> exps(n);
+    std::vector<uint32_t> times(n);
+    for (size_t i = 0; i < n; i++) {
+        exps[i] = rng() % 16;
+        times[i] = rng();
+    }
+
+    Clock::time_point start = Clock::now();
+    for (size_t i = 0; i < n; i++) {
+        HostAes128(&d.keys[16 * i]).encrypt(&d.blocks[16 * i], &d.out[16 * i]);
+    }
+    printf("%-10s %14s %14s %14s %8s\n", "backend", "blocks/s", "blocks/s", "EIDs/s", "check");
+    printf("%-10s %14s %14s %14s\n", "", "(key each)", "(expanded)", "");
+    printf("%-10s %14.0f\n", "HostAes128", n / secondsSince(start));
+
+    int status = 0;
+    static const Aes128Batch::Backend backends[] = { Aes128Batch::BACKEND_AESNI, Aes128Batch::BACKEND_BITSLICED };
+    for (size_t b = 0; b < sizeof(backends) / sizeof(backends[0]); b++) {
+        if (!Aes128Batch::setBackend(backends[b])) {
+            printf("%-10s not supported by this CPU\n", Aes128Batch::getBackendName(backends[b]));
+            continue;
+        }
+        size_t wrong = check(rng);
+        wrong += eidBatch(d, n < 100000 ? n : 100000, exps.data(), times.data(), true);
+        status |= wrong ? 2 : 0;
+
+        start = Clock::now();
+        Aes128Batch::encryptWithKeys(d.keys.data(), d.blocks.data(), d.out.data(), n);
+        double withKeys = n / secondsSince(start);
+        start = Clock::now();
+        Aes128Batch::encrypt(d.keyPtrs.data(), d.blocks.data(), d.out.data(), n);
+        double expanded = n / secondsSince(start);
+        start = Clock::now();
+        eidBatch(d, n, exps.data(), times.data(), false);
+        double eids = n / secondsSince(start);
+        printf("%-10s %14.0f %14.0f %14.0f %8s\n", Aes128Batch::getBackendName(backends[b]),
+               withKeys, expanded, eids, wrong ? "FAIL" : "ok");
+    }
+    return status;
+}
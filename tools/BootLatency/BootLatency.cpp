@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) 2016, Google Inc, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Host measurement of the time from boot to the first advertisement.
+ *
+ * Runs what bleInitComplete() in main.cpp does, on the host BLE API and
+ * event queue of tools/AdvSetsHost/host: the EddystoneService constructor
+ * (first boot, then a later boot from the saved parameters), the config
+ * service and the config advertisements, up to the first startAdvertising().
+ * It then runs the work the service left posted on the event queue (the
+ * beacon key generation, when GEN_BEACON_KEYS_AT_INIT is defined in
+ * Eddystone_config.h), which runs after the first advertisement is out.
+ * The median and 90th percentile of both are reported for each boot.
+ *
+ * Usage: BootLatency [boots]
+ */
+
+#include "EddystoneService.h"
+#include "PersistentStorageHelper/ConfigParamsPersistence.h"
+#include "HostEventQueue.h"
+
+#include <stdlib.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+/* Nothing is persisted on the host */
+void saveEddystoneTimeParams(const TimeParams_t *timeP)
+{
+    (void)timeP;
+}
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+const PowerLevels_t advTxPowerLevels = EDDYSTONE_DEFAULT_ADV_TX_POWER_LEVELS;
+const PowerLevels_t radioTxPowerLevels = EDDYSTONE_DEFAULT_RADIO_TX_POWER_LEVELS;
+
+double elapsedUs(Clock::time_point start, Clock::time_point end)
+{
+    return std::chrono::duration<double, std::micro>(end - start).count();
+}
+
+void report(const char *what, std::vector<double> &samplesUs)
+{
+    std::sort(samplesUs.begin(), samplesUs.end());
+    printf("%-34s median %8.1f us  p90 %8.1f us\n", what, samplesUs[samplesUs.size() / 2],
+           samplesUs[samplesUs.size() * 9 / 10]);
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    int boots = (argc > 1) ? atoi(argv[1]) : 200;
+    if (boots <= 0) {
+        fprintf(stderr, "Usage: BootLatency [boots]\n");
+        return 2;
+    }
+
+#ifdef GEN_BEACON_KEYS_AT_INIT
+    printf("GEN_BEACON_KEYS_AT_INIT defined, %d boots of each kind\n", boots);
+#else
+    printf("GEN_BEACON_KEYS_AT_INIT not defined, %d boots of each kind\n", boots);
+#endif
+
+    /* Index 0: first boot (factory values), 1: later boot (saved parameters) */
+    std::vector<double> firstAdvUs[2];
+    std::vector<double> postedWorkUs[2];
+    EddystoneService::EddystoneParams_t params;
+    Gap &gap = BLE::Instance().gap();
+    for (int i = 0; i < boots; i++) {
+        for (int boot = 0; boot < 2; boot++) {
+            /* A service per boot, as on the beacon they are never deleted */
+            HostEventQueue *queue = new HostEventQueue;
+            uint32_t startCalls = gap.startCalls;
+            Clock::time_point start = Clock::now();
+            EddystoneService *service = (boot == 0) ?
+                new EddystoneService(BLE::Instance(), advTxPowerLevels, radioTxPowerLevels, *queue) :
+                new EddystoneService(BLE::Instance(), params, radioTxPowerLevels, *queue);
+            service->getEddystoneParams(params);
+            service->startEddystoneConfigService();
+            service->startEddystoneConfigAdvertisements();
+            Clock::time_point firstAdv = Clock::now();
+            if (gap.startCalls == startCalls) {
+                fprintf(stderr, "No advertisement started\n");
+                return 1;
+            }
+            queue->run(hostClockMs());
+            Clock::time_point idle = Clock::now();
+            firstAdvUs[boot].push_back(elapsedUs(start, firstAdv));
+            postedWorkUs[boot].push_back(elapsedUs(firstAdv, idle));
+        }
+    }
+
+    report("first boot: to first advertisement", firstAdvUs[0]);
+    report("first boot: posted work after it", postedWorkUs[0]);
+    report("later boot: to first advertisement", firstAdvUs[1]);
+    report("later boot: posted work after it", postedWorkUs[1]);
+    return 0;
+}
@@ -0,0 +1,237 @@
+/*
+ * Copyright (c) 2016, Google Inc, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Host build of the beacon's crypto: runs the known answer tests of
+ * source/crypto_selftest.cpp, then times each primitive the firmware uses
+ * and reports its cost per call, its stack high-water mark and the heap it
+ * holds afterwards. The firmware sources are compiled as they are, against
+ * the mbed TLS of the mbed-os checkout (see README), so a speedup of any of
+ * them can be checked and measured here before it goes on target, where
+ * CRYPTO_BENCHMARK (Eddystone_config.h) reports the same figures.
+ *
+ * Cycles are time stamp counter ticks on x86 and are not printed
+ * elsewhere. Stack figures are x86-64 (or host) frames, larger than on
+ * Cortex-M, but show which primitive is deepest and how a change moves it.
+ *
+ * AES runs on the backend of Aes128Backend.h: build with
+ * -DAES128_BACKEND_CT, or -maes -DAES128_BACKEND_AESNI, to compare them.
+ *
+ * Usage: CryptoBench [iterations]
+ */
+
+#include "crypto_selftest.h"
+#include "aes_eax.h"
+#include "x25519.h"
+#include "hkdf_sha256.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_TSC
+#endif
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+const size_t  STACK_SIZE = 256 * 1024;
+const uint8_t STACK_PAINT = 0xA5;
+
+long heapInUse(void)
+{
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+    return (long)mallinfo2().uordblks;
+#else
+    return 0;
+#endif
+}
+
+void *runJob(void *job)
+{
+    (*static_cast<std::function<void()> *>(job))();
+    return NULL;
+}
+
+/* Deepest stack used by @p f, run on a painted thread stack */
+size_t stackUsed(std::function<void()> f)
+{
+    void *stack;
+    if (posix_memalign(&stack, 4096, STACK_SIZE) != 0) {
+        return 0;
+    }
+    memset(stack, STACK_PAINT, STACK_SIZE);
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setstack(&attr, stack, STACK_SIZE);
+    pthread_t thread;
+    size_t used = 0;
+    if (pthread_create(&thread, &attr, runJob, &f) == 0) {
+        pthread_join(thread, NULL);
+        const uint8_t *p = static_cast<const uint8_t *>(stack);
+        size_t untouched = 0;
+        while (untouched < STACK_SIZE && p[untouched] == STACK_PAINT) {
+            untouched++;
+        }
+        used = STACK_SIZE - untouched;
+    }
+    pthread_attr_destroy(&attr);
+    free(stack);
+    return used;
+}
+
+size_t threadOverhead;
+
+void bench(const char *name, int iterations, std::function<void()> f)
+{
+    size_t stack = stackUsed(f);
+    long heapStart = heapInUse();
+    Clock::time_point start = Clock::now();
+#ifdef HAVE_TSC
+    uint64_t ticksStart = __rdtsc();
+#endif
+    for (int i = 0; i < iterations; i++) {
+        f();
+    }
+#ifdef HAVE_TSC
+    double ticks = (double)(__rdtsc() - ticksStart) / iterations;
+#endif
+    double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / iterations;
+    long heap = heapInUse() - heapStart;
+
+    printf("%-24s %10.0f ns", name, ns);
+#ifdef HAVE_TSC
+    printf(" %10.0f cycles", ticks);
+#endif
+    printf(" %6zu B stack %5ld B heap\n", stack > threadOverhead ? stack - threadOverhead : 0, heap);
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    int iterations = (argc > 1) ? atoi(argv[1]) : 1000;
+    if (iterations <= 0) {
+        fprintf(stderr, "Usage: %s [iterations]\n", argv[0]);
+        return 1;
+    }
+    printf("AES-128 backend: %s\n", Aes128Backend::getName());
+    int failed = eddy_crypto_self_test(1);
+    if (failed) {
+        return 2;
+    }
+
+    /* What the thread itself uses, subtracted from every figure */
+    threadOverhead = stackUsed([]() {});
+
+    const eddy_eid_test_vector *v = &eddy_eid_test_vector_1;
+    const uint8_t *key = v->identity_key;
+    const uint32_t timeSecs = v->beacon_time_secs;
+    const uint8_t exp = v->rotation_period_exp;
+    uint8_t block[16] = { 0 };
+    uint8_t out[32];
+
+    Aes128Context keyCtx;
+    Aes128Backend::init(&keyCtx);
+    Aes128Backend::setKeyEnc(&keyCtx, key);
+    Aes128Context tmpKeyCtx;
+    Aes128Backend::init(&tmpKeyCtx);
+    Aes128Backend::setKeyEnc(&tmpKeyCtx, v->temporary_key);
+    eddy_eax_context eax;
+    eddy_eax_setup(&eax, &keyCtx);
+
+    /* EIDFrame::genTemporaryKey() and updateFromTemporaryKey() blocks */
+    uint8_t ds1[16] = { 0 };
+    ds1[11] = 0xff;
+    ds1[14] = (uint8_t)(timeSecs >> 24);
+    ds1[15] = (uint8_t)(timeSecs >> 16);
+    uint32_t scaledTime = (timeSecs >> exp) << exp;
+    uint8_t ds2[16] = { 0 };
+    ds2[11] = exp;
+    ds2[12] = (uint8_t)(scaledTime >> 24);
+    ds2[13] = (uint8_t)(scaledTime >> 16);
+    ds2[14] = (uint8_t)(scaledTime >> 8);
+    ds2[15] = (uint8_t)scaledTime;
+    const uint8_t nonce[6] = { ds2[12], ds2[13], ds2[14], ds2[15], 0xbe, 0xef };
+
+    printf("\n%d iterations\n", iterations);
+    bench("AES-128 key expansion", iterations, [&]() {
+        Aes128Context ctx;
+        Aes128Backend::init(&ctx);
+        Aes128Backend::setKeyEnc(&ctx, key);
+        Aes128Backend::free(&ctx);
+    });
+    bench("AES-128 block", iterations, [&]() {
+        Aes128Backend::encrypt(&keyCtx, block, block);
+    });
+    bench("EID", iterations, [&]() {
+        Aes128Context ctx;
+        Aes128Backend::init(&ctx);
+        Aes128Backend::setKeyEnc(&ctx, key);
+        uint8_t tmpKey[16];
+        Aes128Backend::encrypt(&ctx, ds1, tmpKey);
+        Aes128Backend::setKeyEnc(&ctx, tmpKey);
+        Aes128Backend::encrypt(&ctx, ds2, out);
+        Aes128Backend::free(&ctx);
+    });
+    bench("EID (temporary key)", iterations, [&]() {
+        Aes128Backend::encrypt(&tmpKeyCtx, ds2, out);
+    });
+    bench("ETLM", iterations, [&]() {
+        Aes128Context ctx;
+        Aes128Backend::init(&ctx);
+        Aes128Backend::setKeyEnc(&ctx, key);
+        eddy_aes_authcrypt_eax(&ctx, MBEDTLS_AES_ENCRYPT, nonce, sizeof(nonce), NULL, 0, sizeof(v->tlm_data),
+                               v->tlm_data, out, out + 14, 2);
+        Aes128Backend::free(&ctx);
+    });
+    bench("ETLM (cached EAX)", iterations, [&]() {
+        eddy_eax_authcrypt(&eax, MBEDTLS_AES_ENCRYPT, nonce, sizeof(nonce), NULL, 0, sizeof(v->tlm_data),
+                           v->tlm_data, out, out + 14, 2);
+    });
+
+    int ecdhIterations = iterations / 10 ? iterations / 10 : 1;
+    bench("X25519 public key", ecdhIterations, [&]() {
+        eddy_x25519_base(out, v->beacon_private_key);
+    });
+    bench("X25519 shared secret", ecdhIterations, [&]() {
+        eddy_x25519(out, v->beacon_private_key, v->server_public_key);
+    });
+    uint8_t salt[64];
+    memcpy(salt, v->server_public_key, 32);
+    memcpy(salt + 32, v->beacon_public_key, 32);
+    bench("HKDF-SHA256", iterations, [&]() {
+        eddy_hkdf_sha256(salt, sizeof(salt), v->beacon_private_key, 32, NULL, 0, out, 32);
+    });
+    bench("Shared identity key", ecdhIterations, [&]() {
+        uint8_t secret[32];
+        eddy_x25519(secret, v->beacon_private_key, v->server_public_key);
+        eddy_hkdf_sha256(salt, sizeof(salt), secret, sizeof(secret), NULL, 0, out, 32);
+    });
+
+    Aes128Backend::free(&keyCtx);
+    Aes128Backend::free(&tmpKeyCtx);
+    return 0;
+}
@@ -0,0 +1,26 @@
+#ifndef MBEDTLS_HOST_CONFIG_H
+#define MBEDTLS_HOST_CONFIG_H
+
+/*
+ * mbed TLS configuration for CryptoBench and UnlockLatency: the modules the
+ * beacon uses, with the AES implementation of the target (ROM tables, no
+ * AES-NI), so the host figures compare with the ones CRYPTO_BENCHMARK
+ * prints. The entropy source is the tool's own (no platform entropy).
+ */
+
+#define MBEDTLS_CIPHER_MODE_CBC
+#define MBEDTLS_CIPHER_MODE_CTR
+
+#define MBEDTLS_AES_C
+#define MBEDTLS_SHA256_C
+#define MBEDTLS_CTR_DRBG_C
+#define MBEDTLS_ENTROPY_C
+
+#define MBEDTLS_NO_PLATFORM_ENTROPY
+#define MBEDTLS_ENTROPY_FORCE_SHA256
+
+#define MBEDTLS_AES_ROM_TABLES
+
+#include "mbedtls/check_config.h"
+
+#endif /* MBEDTLS_HOST_CONFIG_H */
@@ -0,0 +1,256 @@
+/*
+ * Copyright (c) 2016, Google Inc, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Server side EID registration of a batch of beacons.
+ *
+ * Reads the beacons' public keys (one "id,publicKeyHex,exp" line each, the
+ * key as read from the Public ECDH Key characteristic), registers them on
+ * all cores, and writes the ADV Slot Data writes ("id,slotDataHex") and the
+ * resolver records ("id,identityKeyHex,exp", created readable by the owner
+ * only). The known answer of the firmware's EID test vector is checked
+ * first. With --bench, registers generated beacons instead, checks every
+ * identity key against the beacon side derivation, and reports the
+ * registrations per second.
+ *
+ * Usage: EidRegister <requests.csv> <writes.csv> <records.csv> [threads]
+ *        EidRegister --bench [beacons] [threads]
+ */
+
+#include "EidRegistration.h"
+#include "crypto_selftest.h"
+#include "x25519.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+double secondsSince(Clock::time_point start)
+{
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+/* RFC 7748 section 6.1, Bob: the server of eddy_eid_test_vector_1 */
+const uint8_t KAT_SERVER_PRIVATE_KEY[32] = {
+    0x5d, 0xab, 0x08, 0x7e, 0x62, 0x4a, 0x8a, 0x4b, 0x79, 0xe1, 0x7f, 0x8b, 0x83, 0x80, 0x0e, 0xe6,
+    0x6f, 0x3b, 0xb1, 0x29, 0x26, 0x18, 0xb6, 0xfd, 0x1c, 0x2f, 0x8b, 0x27, 0xff, 0x88, 0xe0, 0xeb
+};
+
+bool knownAnswer(void)
+{
+    const eddy_eid_test_vector &v = eddy_eid_test_vector_1;
+    EidRegistrationRequest request;
+    request.beaconId = 1;
+    memcpy(request.beaconPublicKey, v.beacon_public_key, sizeof(request.beaconPublicKey));
+    request.rotationPeriodExp = v.rotation_period_exp;
+
+    EidRegistrationResult result;
+    return EidRegistrar::registerWithKey(request, KAT_SERVER_PRIVATE_KEY, result) == EidRegistrar::OK &&
+           result.slotDataWrite[0] == EidRegistrar::FRAME_TYPE_EID &&
+           memcmp(result.slotDataWrite + 1, v.server_public_key, 32) == 0 &&
+           result.slotDataWrite[33] == v.rotation_period_exp &&
+           memcmp(result.identityKey, v.identity_key, 16) == 0;
+}
+
+void printHex(FILE *file, const uint8_t *data, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        fprintf(file, "%02x", data[i]);
+    }
+}
+
+bool parseHex(const char *hex, size_t hexLen, uint8_t *data, size_t len)
+{
+    if (hexLen != 2 * len) {
+        return false;
+    }
+    for (size_t i = 0; i < len; i++) {
+        unsigned byte;
+        if (sscanf(hex + 2 * i, "%2x", &byte) != 1) {
+            return false;
+        }
+        data[i] = (uint8_t)byte;
+    }
+    return true;
+}
+
+bool readRequests(const char *path, std::vector<EidRegistrationRequest> &requests)
+{
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        return false;
+    }
+    char line[256];
+    unsigned lineNumber = 0;
+    bool ok = true;
+    while (ok && fgets(line, sizeof(line), file)) {
+        lineNumber++;
+        if (line[0] == '\n' || line[0] == '#') {
+            continue;
+        }
+        EidRegistrationRequest request;
+        char *key = strchr(line, ',');
+        char *exp = key ? strchr(key + 1, ',') : NULL;
+        unsigned long id = strtoul(line, NULL, 0);
+        unsigned long rotationPeriodExp = exp ? strtoul(exp + 1, NULL, 0) : 0;
+        if (!exp || !parseHex(key + 1, exp - key - 1, request.beaconPublicKey, 32) || rotationPeriodExp > 255) {
+            fprintf(stderr, "%s:%u: expected id,publicKeyHex,exp\n", path, lineNumber);
+            ok = false;
+            break;
+        }
+        request.beaconId = (uint32_t)id;
+        request.rotationPeriodExp = (uint8_t)rotationPeriodExp;
+        requests.push_back(request);
+    }
+    fclose(file);
+    return ok;
+}
+
+/* The records hold the identity keys: readable by the owner only */
+FILE *createPrivate(const char *path)
+{
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0) {
+        return NULL;
+    }
+    FILE *file = fdopen(fd, "w");
+    if (!file) {
+        close(fd);
+    }
+    return file;
+}
+
+int runRegister(const char *requestsPath, const char *writesPath, const char *recordsPath, unsigned threads)
+{
+    std::vector<EidRegistrationRequest> requests;
+    if (!readRequests(requestsPath, requests)) {
+        fprintf(stderr, "Cannot read %s\n", requestsPath);
+        return 1;
+    }
+
+    EidRegistrar registrar(threads);
+    std::vector<EidRegistrationResult> results;
+    Clock::time_point start = Clock::now();
+    size_t failed = registrar.registerBatch(requests, results);
+    double registerSecs = secondsSince(start);
+
+    FILE *writes = fopen(writesPath, "w");
+    FILE *records = createPrivate(recordsPath);
+    if (!writes || !records) {
+        fprintf(stderr, "Cannot write %s\n", writes ? recordsPath : writesPath);
+        return 1;
+    }
+    for (size_t i = 0; i < results.size(); i++) {
+        const EidRegistrationResult &result = results[i];
+        if (result.status != EidRegistrar::OK) {
+            fprintf(stderr, "beacon %u: error %d\n", result.beaconId, result.status);
+            continue;
+        }
+        fprintf(writes, "%u,", result.beaconId);
+        printHex(writes, result.slotDataWrite, sizeof(result.slotDataWrite));
+        fprintf(writes, "\n");
+        fprintf(records, "%u,", result.beaconId);
+        printHex(records, result.identityKey, sizeof(result.identityKey));
+        fprintf(records, ",%u\n", result.rotationPeriodExp);
+    }
+    bool written = (fclose(writes) == 0) & (fclose(records) == 0);
+    memset(&results[0], 0, results.size() * sizeof(results[0]));
+
+    printf("%zu beacons registered in %.3f s, %zu failed\n", requests.size() - failed, registerSecs, failed);
+    return (failed || !written) ? 1 : 0;
+}
+
+int runBench(size_t numBeacons, unsigned threads)
+{
+    std::mt19937_64 rng(42);
+    std::vector<uint8_t> beaconPrivateKeys(numBeacons * 32);
+    std::vector<EidRegistrationRequest> requests(numBeacons);
+    for (size_t i = 0; i < numBeacons; i++) {
+        for (int j = 0; j < 32; j++) {
+            beaconPrivateKeys[i * 32 + j] = (uint8_t)rng();
+        }
+        eddy_x25519_base(requests[i].beaconPublicKey, &beaconPrivateKeys[i * 32]);
+        requests[i].beaconId = (uint32_t)i;
+        requests[i].rotationPeriodExp = 8 + rng() % 8;
+    }
+
+    EidRegistrar single(1);
+    EidRegistrar parallel(threads);
+    std::vector<EidRegistrationResult> results;
+    Clock::time_point start = Clock::now();
+    size_t failed = single.registerBatch(requests, results);
+    double singleSecs = secondsSince(start);
+    start = Clock::now();
+    failed += parallel.registerBatch(requests, results);
+    double parallelSecs = secondsSince(start);
+
+    /* Every beacon must derive the same identity key from its write */
+    size_t wrong = 0;
+    start = Clock::now();
+    for (size_t i = 0; i < numBeacons; i++) {
+        uint8_t identityKey[16];
+        if (results[i].status != EidRegistrar::OK ||
+            EidRegistrar::beaconIdentityKey(&beaconPrivateKeys[i * 32], requests[i].beaconPublicKey,
+                                            results[i].slotDataWrite + 1, identityKey) != EidRegistrar::OK ||
+            memcmp(identityKey, results[i].identityKey, 16) != 0 ||
+            results[i].slotDataWrite[33] != requests[i].rotationPeriodExp) {
+            wrong++;
+        }
+    }
+    double beaconSecs = secondsSince(start);
+
+    printf("%zu beacons\n", numBeacons);
+    printf("1 thread:  %9.3f s (%.0f registrations/s, %.1f us each)\n",
+           singleSecs, numBeacons / singleSecs, singleSecs * 1e6 / numBeacons);
+    printf("parallel:  %9.3f s (%.0f registrations/s) on %u threads\n",
+           parallelSecs, numBeacons / parallelSecs, threads ? threads : std::thread::hardware_concurrency());
+    printf("beacon:    %9.3f s to derive the identity keys on the beacon side, %zu wrong, %zu failed\n",
+           beaconSecs, wrong, failed);
+    return (wrong || failed) ? 1 : 0;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    bool bench = (argc > 1) && strcmp(argv[1], "--bench") == 0;
+    if (!bench && argc < 4) {
+        fprintf(stderr, "Usage: %s <requests.csv> <writes.csv> <records.csv> [threads]\n"
+                        "       %s --bench [beacons] [threads]\n", argv[0], argv[0]);
+        return 1;
+    }
+    if (!knownAnswer()) {
+        fprintf(stderr, "EID registration known answer test failed\n");
+        return 1;
+    }
+    if (bench) {
+        size_t   numBeacons = (argc > 2) ? strtoul(argv[2], NULL, 0) : 100000;
+        unsigned threads    = (argc > 3) ? strtoul(argv[3], NULL, 0) : 0;
+        return numBeacons ? runBench(numBeacons, threads) : 1;
+    }
+    return runRegister(argv[1], argv[2], argv[3], (argc > 4) ? strtoul(argv[4], NULL, 0) : 0);
+}
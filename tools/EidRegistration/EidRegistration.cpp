@@ -0,0 +1,129 @@
+/*
+ * Copyright (c) 2016, Google Inc, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "EidRegistration.h"
+#include "ParallelFor.h"
+#include "x25519.h"
+#include "hkdf_sha256.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+
+namespace {
+
+/* Server keys read from the random source at once, per worker */
+const size_t RANDOM_BATCH = 256;
+
+void deriveIdentityKey(const uint8_t secret[32], const uint8_t serverPublicKey[32],
+                       const uint8_t beaconPublicKey[32], uint8_t identityKey[16])
+{
+    uint8_t salt[64];
+    uint8_t okm[32];
+    memcpy(salt, serverPublicKey, 32);
+    memcpy(salt + 32, beaconPublicKey, 32);
+    eddy_hkdf_sha256(salt, sizeof(salt), secret, 32, NULL, 0, okm, sizeof(okm));
+    memcpy(identityKey, okm, 16);
+    memset(okm, 0, sizeof(okm));
+}
+
+} // namespace
+
+EidRegistrar::EidRegistrar(unsigned threadsIn) :
+    threads(threadsIn ? threadsIn : std::thread::hardware_concurrency())
+{
+    if (threads == 0) {
+        threads = 1;
+    }
+}
+
+int EidRegistrar::registerWithKey(const EidRegistrationRequest &request, const uint8_t serverPrivateKey[32],
+                                  EidRegistrationResult &result)
+{
+    memset(&result, 0, sizeof(result));
+    result.beaconId = request.beaconId;
+    result.rotationPeriodExp = request.rotationPeriodExp;
+    if (request.rotationPeriodExp > MAX_ROTATION_PERIOD_EXP) {
+        result.status = ERR_BAD_EXPONENT;
+        return result.status;
+    }
+
+    uint8_t serverPublicKey[32];
+    uint8_t secret[32];
+    eddy_x25519_base(serverPublicKey, serverPrivateKey);
+    if (eddy_x25519(secret, serverPrivateKey, request.beaconPublicKey) == EDDY_ERR_X25519_ZERO_SECRET) {
+        result.status = ERR_ZERO_SECRET;
+        return result.status;
+    }
+    deriveIdentityKey(secret, serverPublicKey, request.beaconPublicKey, result.identityKey);
+    memset(secret, 0, sizeof(secret));
+
+    result.slotDataWrite[0] = FRAME_TYPE_EID;
+    memcpy(result.slotDataWrite + 1, serverPublicKey, sizeof(serverPublicKey));
+    result.slotDataWrite[33] = request.rotationPeriodExp;
+    result.status = OK;
+    return OK;
+}
+
+size_t EidRegistrar::registerBatch(const std::vector<EidRegistrationRequest> &requests,
+                                   std::vector<EidRegistrationResult> &results) const
+{
+    results.resize(requests.size());
+    std::vector<size_t> failures(threads, 0);
+    parallelFor(threads, requests.size(), [&](unsigned t, size_t begin, size_t end) {
+        FILE *random = fopen("/dev/urandom", "rb");
+        uint8_t keys[RANDOM_BATCH][32];
+        for (size_t i = begin; i < end; i++) {
+            size_t k = (i - begin) % RANDOM_BATCH;
+            if (k == 0 && (!random || fread(keys, 32, RANDOM_BATCH, random) != RANDOM_BATCH)) {
+                for (size_t j = i; j < end; j++) {
+                    memset(&results[j], 0, sizeof(results[j]));
+                    results[j].beaconId = requests[j].beaconId;
+                    results[j].status = ERR_RANDOM;
+                    failures[t]++;
+                }
+                break;
+            }
+            if (registerWithKey(requests[i], keys[k], results[i]) != OK) {
+                failures[t]++;
+            }
+            memset(keys[k], 0, sizeof(keys[k]));
+        }
+        memset(keys, 0, sizeof(keys));
+        if (random) {
+            fclose(random);
+        }
+    });
+
+    size_t failed = 0;
+    for (size_t t = 0; t < failures.size(); t++) {
+        failed += failures[t];
+    }
+    return failed;
+}
+
+int EidRegistrar::beaconIdentityKey(const uint8_t beaconPrivateKey[32], const uint8_t beaconPublicKey[32],
+                                    const uint8_t serverPublicKey[32], uint8_t identityKey[16])
+{
+    uint8_t secret[32];
+    if (eddy_x25519(secret, beaconPrivateKey, serverPublicKey) == EDDY_ERR_X25519_ZERO_SECRET) {
+        return ERR_ZERO_SECRET;
+    }
+    deriveIdentityKey(secret, serverPublicKey, beaconPublicKey, identityKey);
+    memset(secret, 0, sizeof(secret));
+    return OK;
+}
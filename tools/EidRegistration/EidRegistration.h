@@ -0,0 +1,110 @@
+/*
+ * Copyright (c) 2016, Google Inc, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __EID_REGISTRATION_H__
+#define __EID_REGISTRATION_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+/**
+ * Server half of the EID registration, for provisioning many beacons.
+ *
+ * The beacon publishes its X25519 public key on the Public ECDH Key
+ * characteristic. The server picks a key pair, writes its public key and
+ * the rotation exponent to the ADV Slot Data characteristic (frame type
+ * 0x30, 34 bytes), and both sides derive the identity key as
+ * EIDFrame::genEcdhSharedKey() does:
+ *
+ *   secret      = X25519(server private key, beacon public key)
+ *   identityKey = HKDF-SHA256(salt = server public | beacon public,
+ *                             ikm = secret, no info), first 16 bytes
+ *
+ * The X25519 and HKDF code is the firmware's (source/x25519.cpp,
+ * source/hkdf_sha256.cpp). All keys are little endian, as on the wire.
+ */
+
+/**
+ * A beacon to register.
+ */
+struct EidRegistrationRequest {
+    uint32_t beaconId;              /**< The caller's beacon id, carried to the result. */
+    uint8_t  beaconPublicKey[32];   /**< As read from the Public ECDH Key characteristic. */
+    uint8_t  rotationPeriodExp;     /**< 0 to 15. */
+};
+
+/**
+ * What a registration produces: the write for the beacon and the record
+ * for the resolver (which keeps the identity key secret).
+ */
+struct EidRegistrationResult {
+    uint32_t beaconId;
+    int      status;                /**< EidRegistrar::OK or an error. */
+    uint8_t  slotDataWrite[34];     /**< To write to the ADV Slot Data characteristic. */
+    uint8_t  identityKey[16];
+    uint8_t  rotationPeriodExp;
+};
+
+class EidRegistrar
+{
+public:
+    static const uint8_t FRAME_TYPE_EID = 0x30;
+    static const uint8_t MAX_ROTATION_PERIOD_EXP = 15;
+
+    enum Status {
+        OK               = 0,
+        ERR_BAD_EXPONENT = -1,  /**< The rotation exponent is above 15. */
+        ERR_ZERO_SECRET  = -2,  /**< The beacon key is a low order point. */
+        ERR_RANDOM       = -3   /**< No randomness for the server key. */
+    };
+
+    /**
+     * @param[in] threads
+     *              Worker threads for registerBatch(), 0 for one per core.
+     */
+    explicit EidRegistrar(unsigned threads = 0);
+
+    /**
+     * Register one beacon with a given server private key (clamped as
+     * RFC 7748 requires), e.g. to check a known answer.
+     */
+    static int registerWithKey(const EidRegistrationRequest &request, const uint8_t serverPrivateKey[32],
+                               EidRegistrationResult &result);
+
+    /**
+     * Register a batch, with a fresh server key pair per beacon drawn from
+     * the operating system's random source. The server private keys are
+     * wiped once used: nothing but the identity keys needs to be kept.
+     *
+     * @return The number of failed registrations (see each status).
+     */
+    size_t registerBatch(const std::vector<EidRegistrationRequest> &requests,
+                         std::vector<EidRegistrationResult> &results) const;
+
+    /**
+     * The beacon half, as EIDFrame::genEcdhSharedKey() computes it, to
+     * check a registration against a simulated beacon.
+     */
+    static int beaconIdentityKey(const uint8_t beaconPrivateKey[32], const uint8_t beaconPublicKey[32],
+                                 const uint8_t serverPublicKey[32], uint8_t identityKey[16]);
+
+private:
+    unsigned threads;
+};
+
+#endif // __EID_REGISTRATION_H__
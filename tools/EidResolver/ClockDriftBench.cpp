@@ -0,0 +1,216 @@
+/*
+ * Copyright (c) 2016, Google Inc, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Benchmark for the clock tracking of EidResolver.
+ *
+ * Simulates a fleet whose clocks drift (up to maxDriftPpm either way) and
+ * reset (stepping back to the last checkpoint, plus the time spent off)
+ * over several days. Each beacon is heard at random, every refresh period
+ * the index is refreshed and the EIDs heard are resolved. It compares a
+ * resolver searching the adjacent windows only, one searching a radius
+ * wide enough for the worst clock error in the fleet, and the same radius
+ * with clock tracking, and reports for each the share of EIDs resolved,
+ * the AES evaluations per resolution and the EIDs indexed per beacon.
+ *
+ * Usage: ClockDriftBench [beacons] [days] [sightingsPerHour] [maxDriftPpm] [resetsPerDay]
+ */
+
+#include "EidResolver.h"
+#include "EidCompute.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+const int64_t START_SECS = 1500000000;
+const int64_t REFRESH_SECS = 60;
+const int64_t MAX_AGE_SECS = 365 * 86400;
+const uint32_t MAX_DOWNTIME_SECS = 300;
+const uint8_t MIN_EXP = 8;
+
+struct Beacon {
+    uint8_t identityKey[16];
+    uint8_t rotationPeriodExp;
+    int64_t bootTimeSecs;
+    double  driftPpm;
+    double  errorSecs;          /* Beacon time - nominal time at START_SECS, resets included */
+    double  nextSightingSecs;
+};
+
+struct Result {
+    uint64_t sightings;
+    uint64_t resolved;
+    uint64_t wrong;
+    uint64_t aesEvaluations;
+    uint64_t buildAesEvaluations;
+    double   eidsPerBeacon;
+    double   seconds;
+};
+
+double beaconTime(const Beacon &beacon, double serverSecs)
+{
+    return serverSecs - beacon.bootTimeSecs + beacon.errorSecs + beacon.driftPpm * 1e-6 * (serverSecs - START_SECS);
+}
+
+Result simulate(std::vector<Beacon> fleet, unsigned radius, bool track, double days,
+                double sightingsPerHour, double resetsPerDay, uint64_t seed, EidResolver *&resolverOut)
+{
+    std::mt19937_64 rng(seed);
+    std::uniform_real_distribution<double> uniform(0, 1);
+    std::exponential_distribution<double> gap(sightingsPerHour / 3600);
+
+    ClockTracker::Config config;
+    config.horizonSecs = REFRESH_SECS;
+    EidResolver *resolver = new EidResolver(radius, 0, track, config);
+    for (size_t b = 0; b < fleet.size(); b++) {
+        resolver->addBeacon(fleet[b].identityKey, fleet[b].rotationPeriodExp, fleet[b].bootTimeSecs);
+        fleet[b].nextSightingSecs = START_SECS + gap(rng);
+    }
+
+    Result result = Result();
+    Clock::time_point start = Clock::now();
+    double eidsSum = 0;
+    uint64_t refreshes = 0;
+    int64_t endSecs = START_SECS + (int64_t)(days * 86400);
+    for (int64_t t = START_SECS; t < endSecs; t += REFRESH_SECS) {
+        resolver->refresh(t);
+        if (t == START_SECS) {
+            result.buildAesEvaluations = resolver->getAesEvaluations();
+        }
+        eidsSum += resolver->getNumEids();
+        refreshes++;
+
+        for (size_t b = 0; b < fleet.size(); b++) {
+            Beacon &beacon = fleet[b];
+            if (uniform(rng) < resetsPerDay * REFRESH_SECS / 86400) {
+                beacon.errorSecs -= uniform(rng) * (1u << beacon.rotationPeriodExp) + uniform(rng) * MAX_DOWNTIME_SECS;
+            }
+            while (beacon.nextSightingSecs < t + REFRESH_SECS) {
+                double heardSecs = floor(beacon.nextSightingSecs);
+                beacon.nextSightingSecs += gap(rng);
+                double timeSecs = beaconTime(beacon, heardSecs - 2 * uniform(rng));
+                if (timeSecs < 0) {
+                    continue;
+                }
+                uint64_t eid = eidCompute(beacon.identityKey, beacon.rotationPeriodExp, (uint32_t)timeSecs);
+                result.sightings++;
+                EidResolver::Match match;
+                if (!resolver->resolve(eid, match)) {
+                    continue;
+                }
+                if (match.beacon != b) {
+                    result.wrong++;
+                    continue;
+                }
+                result.resolved++;
+                resolver->track(match, (int64_t)heardSecs);
+            }
+        }
+    }
+    result.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    result.aesEvaluations = resolver->getAesEvaluations();
+    result.eidsPerBeacon = eidsSum / refreshes / fleet.size();
+    resolverOut = resolver;
+    return result;
+}
+
+void report(const char *name, const Result &r)
+{
+    double resolved = r.resolved ? (double)r.resolved : 1;
+    printf("%-16s %9.3f%% %9.2f %9.2f %9.2f %8zu %7.1f\n", name,
+           r.sightings ? 100.0 * r.resolved / r.sightings : 0.0,
+           r.aesEvaluations / resolved, (r.aesEvaluations - r.buildAesEvaluations) / resolved,
+           r.eidsPerBeacon, (size_t)r.wrong, r.seconds);
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    size_t numBeacons       = (argc > 1) ? strtoul(argv[1], NULL, 0) : 10000;
+    double days             = (argc > 2) ? atof(argv[2]) : 7;
+    double sightingsPerHour = (argc > 3) ? atof(argv[3]) : 2;
+    double maxDriftPpm      = (argc > 4) ? atof(argv[4]) : 40;
+    double resetsPerDay     = (argc > 5) ? atof(argv[5]) : 0.05;
+    if (numBeacons == 0 || days <= 0 || sightingsPerHour <= 0) {
+        fprintf(stderr, "Usage: %s [beacons] [days] [sightingsPerHour] [maxDriftPpm] [resetsPerDay]\n", argv[0]);
+        return 1;
+    }
+
+    /* Beacons registered up to a year ago, whose clocks have drifted and reset since */
+    std::mt19937_64 rng(42);
+    std::uniform_real_distribution<double> uniform(0, 1);
+    std::vector<Beacon> fleet(numBeacons);
+    for (size_t i = 0; i < numBeacons; i++) {
+        Beacon &beacon = fleet[i];
+        for (int j = 0; j < 16; j++) {
+            beacon.identityKey[j] = (uint8_t)rng();
+        }
+        beacon.rotationPeriodExp = MIN_EXP + rng() % 8;
+        int64_t ageSecs = 86400 + (int64_t)(uniform(rng) * MAX_AGE_SECS);
+        beacon.bootTimeSecs = START_SECS - ageSecs;
+        beacon.driftPpm = (2 * uniform(rng) - 1) * maxDriftPpm;
+        beacon.errorSecs = beacon.driftPpm * 1e-6 * ageSecs - uniform(rng) * MAX_DOWNTIME_SECS;
+    }
+
+    /* The radius for the worst clock error, at the shortest rotation period */
+    double worstSecs = maxDriftPpm * 1e-6 * (MAX_AGE_SECS + 86400 + days * 86400) + MAX_DOWNTIME_SECS +
+                       resetsPerDay * days * ((1u << 15) + MAX_DOWNTIME_SECS);
+    unsigned radius = (unsigned)ceil(worstSecs / (1u << MIN_EXP)) + 1;
+
+    printf("%zu beacons, %.1f days, %.1f sightings/hour, drift up to %.0f ppm, %.2f resets/day, wide radius %u\n",
+           numBeacons, days, sightingsPerHour, maxDriftPpm, resetsPerDay, radius);
+    printf("%-16s %10s %9s %9s %9s %8s %7s\n", "resolver", "resolved", "AES/res", "steady", "EIDs/bcn", "wrong", "secs");
+
+    EidResolver *resolver;
+    Result adjacent = simulate(fleet, 1, false, days, sightingsPerHour, resetsPerDay, 7, resolver);
+    delete resolver;
+    report("adjacent", adjacent);
+    Result wide = simulate(fleet, radius, false, days, sightingsPerHour, resetsPerDay, 7, resolver);
+    delete resolver;
+    report("wide", wide);
+    Result tracked = simulate(fleet, radius, true, days, sightingsPerHour, resetsPerDay, 7, resolver);
+    report("wide + tracking", tracked);
+
+    /* How well the drift was learnt, for the beacons whose drift is known to 10 ppm */
+    double errorSum = 0;
+    size_t modelled = 0, learnt = 0;
+    for (size_t b = 0; b < numBeacons; b++) {
+        double driftPpm, uncertaintyPpm;
+        if (!resolver->getClockTracker().getDriftPpm((uint32_t)b, driftPpm, uncertaintyPpm)) {
+            continue;
+        }
+        modelled++;
+        if (uncertaintyPpm <= 10) {
+            errorSum += fabs(driftPpm - fleet[b].driftPpm);
+            learnt++;
+        }
+    }
+    printf("tracking: %zu beacons modelled, drift learnt for %zu (%.1f%%, mean error %.2f ppm), %llu clock jumps detected\n",
+           modelled, learnt, modelled ? 100.0 * learnt / modelled : 0.0, learnt ? errorSum / learnt : 0.0,
+           (unsigned long long)resolver->getClockTracker().getRestarts());
+    delete resolver;
+    return 0;
+}
@@ -0,0 +1,161 @@
+/*
+ * Copyright (c) 2016, Google Inc, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ClockTracker.h"
+
+#include <algorithm>
+
+ClockTracker::ClockTracker(const Config &configIn) :
+    config(configIn),
+    restarts(0)
+{
+}
+
+void ClockTracker::resize(size_t count)
+{
+    Estimate none = Estimate();
+    none.valid = false;
+    none.inheritedDrift = false;
+    estimates.resize(count, none);
+}
+
+void ClockTracker::start(Estimate &estimate, int64_t nowSecs, double lo, double hi, double driftMin, double driftMax,
+                         bool inheritedDrift)
+{
+    estimate.valid = true;
+    estimate.inheritedDrift = inheritedDrift;
+    estimate.refSecs = nowSecs;
+    estimate.anchorSecs = nowSecs;
+    estimate.region.clear();
+    Vertex corners[] = { { lo, driftMin }, { hi, driftMin }, { hi, driftMax }, { lo, driftMax } };
+    estimate.region.assign(corners, corners + 4);
+}
+
+/* Keep the part of a convex region where a * offset + b * drift <= c */
+void ClockTracker::clip(const std::vector<Vertex> &region, double a, double b, double c, std::vector<Vertex> &clipped)
+{
+    clipped.clear();
+    for (size_t i = 0; i < region.size(); i++) {
+        const Vertex &p = region[i];
+        const Vertex &q = region[(i + 1) % region.size()];
+        double fp = a * p.offset + b * p.drift - c;
+        double fq = a * q.offset + b * q.drift - c;
+        if (fp <= 0) {
+            clipped.push_back(p);
+        }
+        if ((fp < 0 && fq > 0) || (fp > 0 && fq < 0)) {
+            double u = fp / (fp - fq);
+            Vertex cut = { p.offset + u * (q.offset - p.offset), p.drift + u * (q.drift - p.drift) };
+            clipped.push_back(cut);
+        }
+    }
+}
+
+/* Interval of e at nowSecs allowed by the region */
+void ClockTracker::errorBounds(const Estimate &estimate, int64_t nowSecs, double &lo, double &hi) const
+{
+    double dt = (double)(nowSecs - estimate.anchorSecs);
+    lo = hi = estimate.region[0].offset + estimate.region[0].drift * dt;
+    for (size_t i = 1; i < estimate.region.size(); i++) {
+        double e = estimate.region[i].offset + estimate.region[i].drift * dt;
+        lo = std::min(lo, e);
+        hi = std::max(hi, e);
+    }
+}
+
+void ClockTracker::driftBounds(const Estimate &estimate, double &driftLo, double &driftHi) const
+{
+    driftLo = driftHi = estimate.region[0].drift;
+    for (size_t i = 1; i < estimate.region.size(); i++) {
+        driftLo = std::min(driftLo, estimate.region[i].drift);
+        driftHi = std::max(driftHi, estimate.region[i].drift);
+    }
+}
+
+void ClockTracker::observe(uint32_t beacon, int64_t nowSecs, int64_t nominalSecs, uint8_t exp, uint32_t window)
+{
+    Estimate &estimate = estimates[beacon];
+
+    /* The EID was advertised up to latencySecs ago, somewhere in the window */
+    double lo = (double)((int64_t)window << exp) - nominalSecs;
+    double hi = (double)(((int64_t)window + 1) << exp) - nominalSecs + config.latencySecs;
+    double maxDrift = config.maxDriftPpm * 1e-6;
+    if (!estimate.valid) {
+        start(estimate, nowSecs, lo, hi, -maxDrift, maxDrift, false);
+        return;
+    }
+
+    /* Most observations fall inside the region and teach nothing new */
+    double errorLo, errorHi;
+    errorBounds(estimate, nowSecs, errorLo, errorHi);
+    if (lo <= errorLo && errorHi <= hi) {
+        estimate.refSecs = nowSecs;
+        return;
+    }
+
+    /* lo <= offset + drift * dt <= hi */
+    double dt = (double)(nowSecs - estimate.anchorSecs);
+    clip(estimate.region, 1, dt, hi, scratch);
+    clip(scratch, -1, -dt, -lo, clipped);
+    if (clipped.empty()) {
+        /* The clock jumped, most likely a reset back to the last checkpoint:
+         * the offset starts over, the drift (the crystal's) still holds.
+         * Unless the region already started from those drift bounds: they
+         * predate a jump too small to notice, learn the drift again */
+        restarts++;
+        if (estimate.inheritedDrift) {
+            start(estimate, nowSecs, lo, hi, -maxDrift, maxDrift, false);
+        } else {
+            double driftLo, driftHi;
+            driftBounds(estimate, driftLo, driftHi);
+            double wander = config.wanderPpm * 1e-6;
+            start(estimate, nowSecs, lo, hi, std::max(driftLo - wander, -maxDrift), std::min(driftHi + wander, maxDrift), true);
+        }
+        return;
+    }
+    estimate.region.swap(clipped);
+    estimate.refSecs = nowSecs;
+}
+
+bool ClockTracker::predict(uint32_t beacon, int64_t nowSecs, int64_t nominalSecs, double &loSecs, double &hiSecs) const
+{
+    const Estimate &estimate = estimates[beacon];
+    if (!estimate.valid || nowSecs - estimate.refSecs > (int64_t)config.staleSecs) {
+        return false;
+    }
+    /* The drift may have wandered since the last observation */
+    double lo, hi, driftLo, driftHi;
+    errorBounds(estimate, nowSecs, lo, hi);
+    driftBounds(estimate, driftLo, driftHi);
+    double wanderSecs = config.wanderPpm * 1e-6 * (double)(nowSecs - estimate.refSecs);
+    loSecs = nominalSecs + lo - wanderSecs;
+    hiSecs = nominalSecs + hi + wanderSecs + config.horizonSecs * (1 + driftHi + config.wanderPpm * 1e-6);
+    return true;
+}
+
+bool ClockTracker::getDriftPpm(uint32_t beacon, double &driftPpm, double &uncertaintyPpm) const
+{
+    const Estimate &estimate = estimates[beacon];
+    if (!estimate.valid) {
+        return false;
+    }
+    double driftLo, driftHi;
+    driftBounds(estimate, driftLo, driftHi);
+    driftPpm = (driftLo + driftHi) / 2 * 1e6;
+    uncertaintyPpm = (driftHi - driftLo) / 2 * 1e6;
+    return true;
+}
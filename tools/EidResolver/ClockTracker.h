@@ -0,0 +1,154 @@
+/*
+ * Copyright (c) 2016, Google Inc, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __CLOCK_TRACKER_H__
+#define __CLOCK_TRACKER_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+/**
+ * Per beacon estimate of the beacon clock, learnt from resolved EIDs.
+ *
+ * The beacon time comes from getTimeSinceFirstBootSecs(), a Timer that
+ * drifts (tens of ppm), and a reset brings it back to the last time
+ * checkpoint in flash, so it falls behind the nominal time (server time
+ * minus boot time) as the beacon ages. The tracker models the error of the
+ * beacon time, e = beacon time - nominal time, as e0 + drift * t.
+ *
+ * Each resolution says the beacon time was in window W (2^K seconds) when
+ * the EID was heard: a strip of the (e0, drift) plane. The tracker keeps
+ * the convex region of the plane consistent with all observations since
+ * the last jump (set membership), so every window boundary crossing heard
+ * bounds the drift against every earlier one, however far apart, and
+ * nothing is lost to widening the bounds between observations. The region
+ * gives the drift bounds and, at any time, the interval of e. An
+ * observation outside the region means the clock jumped (a reset): the
+ * region starts over, the drift bounds are kept.
+ *
+ * The drift can only be learnt to the precision the window boundaries
+ * allow: about 2^K seconds over the number of sightings, divided by the
+ * time they span.
+ *
+ * predict() gives the range of beacon times to search, which EidResolver
+ * turns into the windows to index for the beacon.
+ */
+class ClockTracker
+{
+public:
+    struct Config {
+        double   maxDriftPpm;   /**< Bound on the drift of any beacon clock. */
+        double   wanderPpm;     /**< Floor of the drift uncertainty: the drift changes with temperature. */
+        uint32_t latencySecs;   /**< Bound on the delay between hearing an EID and resolving it. */
+        uint32_t staleSecs;     /**< No prediction for beacons unresolved for this long. */
+        uint32_t resetWindows;  /**< Windows searched below the prediction, to find a beacon again after a reset. */
+        uint32_t horizonSecs;   /**< Time a prediction must hold, e.g. the refresh period of the index. */
+
+        Config() : maxDriftPpm(100), wanderPpm(2), latencySecs(2), staleSecs(6 * 3600), resetWindows(1),
+                   horizonSecs(60) {}
+    };
+
+    explicit ClockTracker(const Config &config = Config());
+
+    const Config &getConfig(void) const { return config; }
+
+    /**
+     * Make room for beacons 0 to @p count - 1; new beacons have no model.
+     */
+    void resize(size_t count);
+
+    /**
+     * Learn from a resolution.
+     *
+     * @param[in] beacon
+     *              The beacon number.
+     * @param[in] nowSecs
+     *              Server time of the resolution.
+     * @param[in] nominalSecs
+     *              The beacon time if its clock were exact.
+     * @param[in] rotationPeriodExp
+     *              The rotation period exponent K of the beacon.
+     * @param[in] window
+     *              The rotation window the EID belonged to.
+     */
+    void observe(uint32_t beacon, int64_t nowSecs, int64_t nominalSecs, uint8_t rotationPeriodExp, uint32_t window);
+
+    /**
+     * Predict the beacon time from @p nowSecs to Config::horizonSecs later.
+     *
+     * @param[in] beacon
+     *              The beacon number.
+     * @param[in] nowSecs
+     *              Server time.
+     * @param[in] nominalSecs
+     *              The beacon time if its clock were exact.
+     * @param[out] loSecs, hiSecs
+     *              Bounds of the beacon time.
+     *
+     * @return false, and no bounds, if the beacon has no model or was not
+     *         resolved for Config::staleSecs.
+     */
+    bool predict(uint32_t beacon, int64_t nowSecs, int64_t nominalSecs, double &loSecs, double &hiSecs) const;
+
+    /**
+     * Estimated drift of a beacon clock.
+     *
+     * @param[in] beacon
+     *              The beacon number.
+     * @param[out] driftPpm
+     *              The estimate in ppm.
+     * @param[out] uncertaintyPpm
+     *              Half the width of the drift interval, in ppm.
+     *
+     * @return false, and no estimate, if the beacon has no model.
+     */
+    bool getDriftPpm(uint32_t beacon, double &driftPpm, double &uncertaintyPpm) const;
+
+    /**
+     * Number of clock jumps detected.
+     */
+    uint64_t getRestarts(void) const { return restarts; }
+
+private:
+    /* A vertex of the region: error e at anchorSecs (seconds) and drift */
+    struct Vertex {
+        double offset;
+        double drift;
+    };
+
+    struct Estimate {
+        bool                valid;
+        bool                inheritedDrift; /* Region started from the drift bounds before a jump */
+        int64_t             refSecs;        /* Server time of the last observation */
+        int64_t             anchorSecs;     /* Server time the region's offsets refer to */
+        std::vector<Vertex> region;
+    };
+
+    void start(Estimate &estimate, int64_t nowSecs, double lo, double hi, double driftMin, double driftMax,
+               bool inheritedDrift);
+    void errorBounds(const Estimate &estimate, int64_t nowSecs, double &lo, double &hi) const;
+    void driftBounds(const Estimate &estimate, double &driftLo, double &driftHi) const;
+    static void clip(const std::vector<Vertex> &region, double a, double b, double c, std::vector<Vertex> &clipped);
+
+    Config                config;
+    std::vector<Estimate> estimates;
+    std::vector<Vertex>   scratch, clipped;   /* Regions being clipped by observe() */
+    uint64_t              restarts;
+};
+
+#endif // __CLOCK_TRACKER_H__
@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2016, Google Inc, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "EidFilter.h"
+
+EidFilter::EidFilter(void) :
+    mask(0),
+    capacity(0),
+    kickState(0x9E3779B9)
+{
+    reset(0);
+}
+
+void EidFilter::reset(size_t count)
+{
+    /* Power of two buckets, at most 95% of the slots used */
+    size_t numBuckets = 1;
+    while (numBuckets * SLOTS * 95 / 100 < count) {
+        numBuckets *= 2;
+    }
+    Bucket empty = { { 0, 0, 0, 0 } };
+    std::vector<Bucket>(numBuckets, empty).swap(buckets);   /* Also gives back a larger allocation */
+    mask = numBuckets - 1;
+    capacity = numBuckets * SLOTS * 95 / 100;
+}
+
+bool EidFilter::bucketAdd(Bucket &bucket, uint16_t fp)
+{
+    for (unsigned s = 0; s < SLOTS; s++) {
+        if (bucket.fp[s] == 0) {
+            bucket.fp[s] = fp;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool EidFilter::insert(uint64_t eid)
+{
+    uint16_t fp = fingerprint(eid);
+    size_t i = primaryIndex(eid);
+    if (bucketAdd(buckets[i], fp)) {
+        return true;
+    }
+    i = alternateIndex(i, fp);
+    if (bucketAdd(buckets[i], fp)) {
+        return true;
+    }
+
+    /* Kick a random entry to its other bucket, and so on */
+    for (unsigned kick = 0; kick < MAX_KICKS; kick++) {
+        kickState ^= kickState << 13;
+        kickState ^= kickState >> 17;
+        kickState ^= kickState << 5;
+        uint16_t &slot = buckets[i].fp[kickState % SLOTS];
+        uint16_t victim = slot;
+        slot = fp;
+        fp = victim;
+        i = alternateIndex(i, fp);
+        if (bucketAdd(buckets[i], fp)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void EidFilter::remove(uint64_t eid)
+{
+    uint16_t fp = fingerprint(eid);
+    size_t i1 = primaryIndex(eid);
+    size_t i2 = alternateIndex(i1, fp);
+    for (unsigned s = 0; s < SLOTS; s++) {
+        if (buckets[i1].fp[s] == fp) {
+            buckets[i1].fp[s] = 0;
+            return;
+        }
+    }
+    for (unsigned s = 0; s < SLOTS; s++) {
+        if (buckets[i2].fp[s] == fp) {
+            buckets[i2].fp[s] = 0;
+            return;
+        }
+    }
+}
@@ -0,0 +1,114 @@
+/*
+ * Copyright (c) 2016, Google Inc, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __EID_FILTER_H__
+#define __EID_FILTER_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+/**
+ * Cuckoo filter over EIDs: tells in at most two 8-byte buckets that an EID
+ * is not indexed, so unknown EIDs (other operators' beacons) are rejected
+ * without touching the much larger index.
+ *
+ * Each EID is a 16-bit fingerprint in one of two buckets of 4; the second
+ * bucket is derived from the first and the fingerprint, so entries can be
+ * moved (cuckoo kicks) and removed, which lets the resolver update the
+ * filter as windows roll instead of rebuilding it. With at most 95% of
+ * the slots used, a lookup of an unknown EID passes with probability below
+ * 8 / 2^16. EIDs are AES output, so their bits are used directly as hash.
+ */
+class EidFilter
+{
+public:
+    EidFilter(void);
+
+    /**
+     * Empty the filter and size it for @p count EIDs.
+     */
+    void reset(size_t count);
+
+    /**
+     * Whether @p count EIDs fit without reset() to a larger size.
+     */
+    bool fits(size_t count) const { return count <= capacity; }
+
+    /**
+     * Add an EID.
+     *
+     * @return false if the filter is too full; it may then miss an EID
+     *         already added, and must be reset() larger and filled again.
+     */
+    bool insert(uint64_t eid);
+
+    /**
+     * Remove an EID that was added.
+     */
+    void remove(uint64_t eid);
+
+    /**
+     * Test an EID.
+     *
+     * @return false if the EID was not added, true if it probably was.
+     */
+    bool mayContain(uint64_t eid) const
+    {
+        uint16_t fp = fingerprint(eid);
+        size_t i1 = primaryIndex(eid);
+        return bucketHas(buckets[i1], fp) || bucketHas(buckets[alternateIndex(i1, fp)], fp);
+    }
+
+    size_t getBytes(void) const { return buckets.size() * sizeof(Bucket); }
+
+private:
+    static const unsigned SLOTS = 4;
+    static const unsigned MAX_KICKS = 500;
+
+    struct Bucket {
+        uint16_t fp[SLOTS];     /* 0 marks a free slot */
+    };
+
+    static uint16_t fingerprint(uint64_t eid)
+    {
+        uint16_t fp = (uint16_t)eid;
+        return fp ? fp : 1;
+    }
+
+    /* Bits 16 and up, below the top bits EidResolver shards on */
+    size_t primaryIndex(uint64_t eid) const { return (size_t)(eid >> 16) & mask; }
+
+    size_t alternateIndex(size_t index, uint16_t fp) const
+    {
+        return (index ^ (size_t)(fp * 0x5bd1e995u)) & mask;
+    }
+
+    static bool bucketHas(const Bucket &bucket, uint16_t fp)
+    {
+        return (bucket.fp[0] == fp) | (bucket.fp[1] == fp) | (bucket.fp[2] == fp) | (bucket.fp[3] == fp);
+    }
+
+    static bool bucketAdd(Bucket &bucket, uint16_t fp);
+
+    std::vector<Bucket> buckets;
+    size_t              mask;
+    size_t              capacity;
+    uint32_t            kickState;
+};
+
+#endif // __EID_FILTER_H__
@@ -0,0 +1,414 @@
+/*
+ * Copyright (c) 2016, Google Inc, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "EidResolver.h"
+#include "EidCompute.h"
+#include "Aes128Batch.h"
+#include "ParallelFor.h"
+
+#include <algorithm>
+#include <math.h>
+#include <string.h>
+#include <thread>
+
+EidResolver::EidResolver(unsigned windowRadiusIn, unsigned threadsIn, bool trackClocksIn,
+                         const ClockTracker::Config &clockConfig, size_t prefilterMaxEidsIn) :
+    windowRadius(windowRadiusIn),
+    threads(threadsIn ? threadsIn : std::thread::hardware_concurrency()),
+    trackClocks(trackClocksIn),
+    prefilterMaxEids(prefilterMaxEidsIn),
+    prefilter(true),
+    prefilterSet(false),
+    clockTracker(clockConfig),
+    aesEvaluations(0),
+    shards(NUM_SHARDS)
+{
+    if (threads == 0) {
+        threads = 1;
+    }
+    for (unsigned s = 0; s < NUM_SHARDS; s++) {
+        shards[s].slots.assign(16, Entry{0, NO_BEACON, 0});
+        shards[s].count = 0;
+    }
+}
+
+uint32_t EidResolver::addBeacon(const uint8_t identityKey[16], uint8_t rotationPeriodExp, int64_t bootTimeSecs)
+{
+    Beacon beacon;
+    memcpy(beacon.identityKey, identityKey, sizeof(beacon.identityKey));
+    beacon.rotationPeriodExp = rotationPeriodExp;
+    beacon.indexed = false;
+    beacon.window = 0;
+    beacon.lo = 0;
+    beacon.hi = 0;
+    beacon.bootTimeSecs = bootTimeSecs;
+    beacons.push_back(beacon);
+    beaconEids.resize(beacons.size() * (2 * windowRadius + 1));
+    clockTracker.resize(beacons.size());
+    return (uint32_t)(beacons.size() - 1);
+}
+
+size_t EidResolver::refresh(int64_t nowSecs)
+{
+    std::vector<WorkerOps> ops(threads);
+    parallelFor(threads, beacons.size(), [&](unsigned t, size_t begin, size_t end) {
+        updateBeacons(begin, end, nowSecs, ops[t]);
+    });
+
+    /* Decide on the prefilter from the size after the updates, so a dropped filter is not updated first */
+    bool wantPrefilter = prefilter;
+    if (!prefilterSet) {
+        size_t eids = getNumEids();
+        for (size_t t = 0; t < ops.size(); t++) {
+            for (unsigned s = 0; s < NUM_SHARDS; s++) {
+                eids += ops[t].insertions[s].size() - ops[t].removals[s].size();
+            }
+        }
+        wantPrefilter = eids <= prefilterMaxEids;
+        if (!wantPrefilter) {
+            enablePrefilter(false);
+        }
+    }
+    parallelFor(threads, NUM_SHARDS, [&](unsigned, size_t begin, size_t end) {
+        for (size_t s = begin; s < end; s++) {
+            applyOps((unsigned)s, ops);
+        }
+    });
+    if (wantPrefilter) {
+        enablePrefilter(true);
+    }
+
+    size_t rolled = 0;
+    for (size_t t = 0; t < ops.size(); t++) {
+        rolled += ops[t].rolled;
+        aesEvaluations += ops[t].aesBlocks;
+    }
+    return rolled;
+}
+
+void EidResolver::track(const Match &match, int64_t nowSecs)
+{
+    if (!trackClocks) {
+        return;
+    }
+    const Beacon &beacon = beacons[match.beacon];
+    clockTracker.observe(match.beacon, nowSecs, nowSecs - beacon.bootTimeSecs, beacon.rotationPeriodExp, match.window);
+}
+
+void EidResolver::updateBeacons(size_t begin, size_t end, int64_t nowSecs, WorkerOps &ops)
+{
+    const uint32_t span = 2 * windowRadius + 1;
+    ops.rolled = 0;
+    ops.aesBlocks = 0;
+
+    /*
+     * The EIDs of the windows entering the range are queued and computed in
+     * batches: first all the temporary keys, then all the EIDs.
+     */
+    std::vector<uint8_t>  tmpKeyInputs, tmpKeyBlocks, tmpKeys, eidKeys, eidBlocks;
+    std::vector<uint32_t> pendingBeacons, pendingWindows, pendingTmpKeys;
+    auto flush = [&]() {
+        size_t numTmpKeys = tmpKeyBlocks.size() / 16;
+        size_t numEids = pendingBeacons.size();
+        tmpKeys.resize(16 * numTmpKeys);
+        Aes128Batch::encryptWithKeys(tmpKeyInputs.data(), tmpKeyBlocks.data(), tmpKeys.data(), numTmpKeys);
+        eidKeys.resize(16 * numEids);
+        for (size_t i = 0; i < numEids; i++) {
+            memcpy(&eidKeys[16 * i], &tmpKeys[16 * pendingTmpKeys[i]], 16);
+        }
+        Aes128Batch::encryptWithKeys(eidKeys.data(), eidBlocks.data(), eidBlocks.data(), numEids);
+        ops.aesBlocks += numTmpKeys + numEids;
+        for (size_t i = 0; i < numEids; i++) {
+            uint64_t eid = eidFromEncryptedBlock(&eidBlocks[16 * i]);
+            beaconEids[(size_t)pendingBeacons[i] * span + pendingWindows[i] % span] = eid;
+            ops.insertions[shardOf(eid)].push_back(Entry{eid, pendingBeacons[i], pendingWindows[i]});
+        }
+        tmpKeyInputs.clear();
+        tmpKeyBlocks.clear();
+        eidBlocks.clear();
+        pendingBeacons.clear();
+        pendingWindows.clear();
+        pendingTmpKeys.clear();
+    };
+
+    for (size_t b = begin; b < end; b++) {
+        Beacon &beacon = beacons[b];
+        uint8_t exp = beacon.rotationPeriodExp;
+        int64_t nominalSecs = nowSecs - beacon.bootTimeSecs;
+        uint32_t timeSecs = (nominalSecs > 0) ? (uint32_t)nominalSecs : 0;
+        uint32_t window = timeSecs >> exp;
+        uint32_t lastWindow = 0xFFFFFFFFu >> exp;
+        uint32_t lo, hi;
+        if (!beaconWindows((uint32_t)b, nowSecs, nominalSecs, window, lo, hi)) {
+            lo = (window > windowRadius) ? window - windowRadius : 0;
+            hi = (lastWindow - window > windowRadius) ? window + windowRadius : lastWindow;
+        }
+        if (beacon.indexed && lo == beacon.lo && hi == beacon.hi) {
+            beacon.window = window;
+            continue;
+        }
+        ops.rolled++;
+        const uint64_t *eids = &beaconEids[b * span];
+
+        /* Windows that leave the range */
+        uint32_t oldLo = 1, oldHi = 0;
+        if (beacon.indexed) {
+            oldLo = beacon.lo;
+            oldHi = beacon.hi;
+            for (uint64_t w = oldLo; w <= oldHi; w++) {
+                if (w < lo || w > hi) {
+                    uint64_t eid = eids[w % span];
+                    ops.removals[shardOf(eid)].push_back(Entry{eid, (uint32_t)b, (uint32_t)w});
+                }
+            }
+        }
+
+        /* Windows that enter it; the temporary key is derived once per 2^16 s */
+        bool tmpKeyQueued = false;
+        uint32_t tmpKeyEpoch = 0;
+        for (uint64_t w = lo; w <= hi; w++) {
+            if (w >= oldLo && w <= oldHi) {
+                continue;
+            }
+            uint32_t windowSecs = (uint32_t)(w << exp);
+            if (!tmpKeyQueued || (windowSecs >> 16) != tmpKeyEpoch) {
+                size_t n = tmpKeyBlocks.size();
+                tmpKeyInputs.insert(tmpKeyInputs.end(), beacon.identityKey, beacon.identityKey + 16);
+                tmpKeyBlocks.resize(n + 16);
+                eidTemporaryKeyBlock(windowSecs, &tmpKeyBlocks[n]);
+                tmpKeyEpoch = windowSecs >> 16;
+                tmpKeyQueued = true;
+            }
+            size_t n = eidBlocks.size();
+            eidBlocks.resize(n + 16);
+            eidBlock(exp, windowSecs, &eidBlocks[n]);
+            pendingBeacons.push_back((uint32_t)b);
+            pendingWindows.push_back((uint32_t)w);
+            pendingTmpKeys.push_back((uint32_t)(tmpKeyBlocks.size() / 16 - 1));
+        }
+
+        beacon.window = window;
+        beacon.lo = lo;
+        beacon.hi = hi;
+        beacon.indexed = true;
+        if (pendingBeacons.size() >= BATCH_EIDS) {
+            flush();
+        }
+    }
+    flush();
+}
+
+bool EidResolver::beaconWindows(uint32_t b, int64_t nowSecs, int64_t nominalSecs, uint32_t &window,
+                                uint32_t &lo, uint32_t &hi) const
+{
+    double loSecs, hiSecs;
+    if (!trackClocks || !clockTracker.predict(b, nowSecs, nominalSecs, loSecs, hiSecs)) {
+        return false;
+    }
+    const double lastSecs = 4294967295.0;
+    uint8_t exp = beacons[b].rotationPeriodExp;
+    int64_t loWindow = (int64_t)floor(std::min(std::max(loSecs, 0.0), lastSecs)) >> exp;
+    int64_t hiWindow = (int64_t)floor(std::min(std::max(hiSecs, 0.0), lastSecs)) >> exp;
+    window = (uint32_t)((loWindow + hiWindow) / 2);
+
+    /* Too uncertain: the caller indexes the full radius around the prediction */
+    loWindow = std::max<int64_t>(loWindow - clockTracker.getConfig().resetWindows, 0);
+    if (hiWindow - loWindow >= 2 * (int64_t)windowRadius + 1) {
+        return false;
+    }
+    lo = (uint32_t)loWindow;
+    hi = (uint32_t)hiWindow;
+    return true;
+}
+
+void EidResolver::applyOps(unsigned s, const std::vector<WorkerOps> &ops)
+{
+    Shard &shard = shards[s];
+    size_t insertions = 0;
+    for (size_t t = 0; t < ops.size(); t++) {
+        const std::vector<Entry> &removals = ops[t].removals[s];
+        for (size_t i = 0; i < removals.size(); i++) {
+            if (remove(shard, removals[i]) && prefilter) {
+                shard.filter.remove(removals[i].eid);
+            }
+        }
+        insertions += ops[t].insertions[s].size();
+    }
+    grow(shard, shard.count + insertions);
+
+    /* The filter follows incrementally, unless it has to grow; without a prefilter there is none */
+    bool filterOk = !prefilter || shard.filter.fits(shard.count + insertions);
+    for (size_t t = 0; t < ops.size(); t++) {
+        const std::vector<Entry> &entries = ops[t].insertions[s];
+        for (size_t i = 0; i < entries.size(); i++) {
+            insert(shard, entries[i]);
+            filterOk = filterOk && (!prefilter || shard.filter.insert(entries[i].eid));
+        }
+    }
+    if (!filterOk) {
+        rebuildFilter(shard);
+    }
+}
+
+void EidResolver::setPrefilter(bool enabled)
+{
+    prefilterSet = true;
+    enablePrefilter(enabled);
+}
+
+void EidResolver::enablePrefilter(bool enabled)
+{
+    if (enabled == prefilter) {
+        return;
+    }
+    parallelFor(threads, NUM_SHARDS, [&](unsigned, size_t begin, size_t end) {
+        for (size_t s = begin; s < end; s++) {
+            if (enabled) {
+                rebuildFilter(shards[s]);
+            } else {
+                shards[s].filter.reset(0);
+            }
+        }
+    });
+    prefilter = enabled;
+}
+
+void EidResolver::rebuildFilter(Shard &shard)
+{
+    for (size_t size = shard.count; ; size = 2 * size + 1) {
+        shard.filter.reset(size);
+        bool ok = true;
+        for (size_t i = 0; i < shard.slots.size() && ok; i++) {
+            if (shard.slots[i].beacon != NO_BEACON) {
+                ok = shard.filter.insert(shard.slots[i].eid);
+            }
+        }
+        if (ok) {
+            return;
+        }
+    }
+}
+
+void EidResolver::insert(Shard &shard, const Entry &entry)
+{
+    size_t mask = shard.slots.size() - 1;
+    size_t i = entry.eid & mask;
+    while (shard.slots[i].beacon != NO_BEACON) {
+        i = (i + 1) & mask;
+    }
+    shard.slots[i] = entry;
+    shard.count++;
+}
+
+bool EidResolver::remove(Shard &shard, const Entry &entry)
+{
+    size_t mask = shard.slots.size() - 1;
+    size_t i = entry.eid & mask;
+    for (;;) {
+        const Entry &slot = shard.slots[i];
+        if (slot.beacon == NO_BEACON) {
+            return false;
+        }
+        if (slot.eid == entry.eid && slot.beacon == entry.beacon && slot.window == entry.window) {
+            break;
+        }
+        i = (i + 1) & mask;
+    }
+
+    /* Backward shift deletion: pull later entries of the cluster into the hole */
+    size_t j = i;
+    for (;;) {
+        j = (j + 1) & mask;
+        if (shard.slots[j].beacon == NO_BEACON) {
+            break;
+        }
+        size_t home = shard.slots[j].eid & mask;
+        bool homeInHoleToJ = (i <= j) ? (home > i && home <= j) : (home > i || home <= j);
+        if (!homeInHoleToJ) {
+            shard.slots[i] = shard.slots[j];
+            i = j;
+        }
+    }
+    shard.slots[i].beacon = NO_BEACON;
+    shard.count--;
+    return true;
+}
+
+void EidResolver::grow(Shard &shard, size_t count)
+{
+    size_t capacity = shard.slots.size();
+    while (capacity < 2 * count) {
+        capacity *= 2;
+    }
+    if (capacity == shard.slots.size()) {
+        return;
+    }
+    std::vector<Entry> old(capacity, Entry{0, NO_BEACON, 0});
+    old.swap(shard.slots);
+    shard.count = 0;
+    for (size_t i = 0; i < old.size(); i++) {
+        if (old[i].beacon != NO_BEACON) {
+            insert(shard, old[i]);
+        }
+    }
+}
+
+bool EidResolver::resolve(uint64_t eid, Match &match) const
+{
+    const Shard &shard = shards[shardOf(eid)];
+    if (prefilter && !shard.filter.mayContain(eid)) {
+        return false;
+    }
+    size_t mask = shard.slots.size() - 1;
+    for (size_t i = eid & mask; shard.slots[i].beacon != NO_BEACON; i = (i + 1) & mask) {
+        const Entry &slot = shard.slots[i];
+        if (slot.eid == eid) {
+            match.beacon = slot.beacon;
+            match.window = slot.window;
+            match.windowOffset = (int32_t)(slot.window - beacons[slot.beacon].window);
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t EidResolver::getNumEids(void) const
+{
+    size_t count = 0;
+    for (size_t s = 0; s < shards.size(); s++) {
+        count += shards[s].count;
+    }
+    return count;
+}
+
+size_t EidResolver::getFilterBytes(void) const
+{
+    size_t bytes = 0;
+    for (size_t s = 0; s < shards.size(); s++) {
+        bytes += shards[s].filter.getBytes();
+    }
+    return bytes;
+}
+
+size_t EidResolver::getTableBytes(void) const
+{
+    size_t bytes = 0;
+    for (size_t s = 0; s < shards.size(); s++) {
+        bytes += shards[s].slots.size() * sizeof(Entry);
+    }
+    return bytes;
+}
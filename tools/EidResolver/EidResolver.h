@@ -0,0 +1,267 @@
+/*
+ * Copyright (c) 2016, Google Inc, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __EID_RESOLVER_H__
+#define __EID_RESOLVER_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include "ClockTracker.h"
+#include "EidFilter.h"
+
+/**
+ * Server side index from observed EIDs back to registered beacons.
+ *
+ * For every beacon the resolver precomputes the EIDs (see EidCompute.h,
+ * the same derivation as EIDFrame::update()) of its current rotation window
+ * and of windowRadius windows on each side, and keeps them in a hash table,
+ * so a lookup is a single probe sequence whatever the fleet size.
+ *
+ * refresh() brings the index to a new time: only beacons whose current
+ * window changed are touched, and only the windows that enter the range are
+ * computed, in batches through Aes128Batch. The AES work is split across
+ * threads by beacon, the table updates by shard (top EID bits), so no locks
+ * are taken. resolve() may be called from several threads, but not
+ * concurrently with refresh() or addBeacon().
+ *
+ * Beacon time is the server time minus the time the beacon booted, as
+ * recorded at registration. Rotation exponents are 0 to 15, as for the
+ * firmware: a window then never spans two temporary keys.
+ *
+ * Beacon clocks drift and step back on resets, which windowRadius has to
+ * cover. With clock tracking, resolutions passed to track() teach a
+ * ClockTracker each beacon's clock error and drift, and refresh() indexes
+ * only the windows its predicted beacon time spans (plus
+ * ClockTracker::Config::resetWindows below), up to 2 * windowRadius + 1.
+ * Beacons without a usable model get the full radius, around the
+ * predicted window when there is one.
+ *
+ * Each shard also keeps an EidFilter over its EIDs, updated with the same
+ * insertions and removals. While the index is small, resolve() checks it
+ * first, so most unknown EIDs are rejected without a probe of the (much
+ * larger) table. Past prefilterMaxEids the filter no longer pays for its
+ * own cache misses: it is dropped, no longer maintained, and resolve() goes
+ * straight to the table.
+ */
+class EidResolver
+{
+public:
+    /**
+     * Beacon number that marks a free table entry.
+     */
+    static const uint32_t NO_BEACON = 0xFFFFFFFF;
+
+    /**
+     * Default prefilterMaxEids. EidResolverBench with 90% unknown EIDs, on
+     * a host with 2 MB of L2: the filter gives 1.2 to 2x the resolutions
+     * per second up to 85000 beacons (255000 EIDs, an 8.8 MB table). From
+     * 100000 beacons (16.8 MB table) it is at best even, and down to 0.7x
+     * where the table has just doubled and probes are short. Hosts with
+     * other caches should measure their own crossover.
+     */
+    static const size_t DEFAULT_PREFILTER_MAX_EIDS = 1u << 18;
+
+    /**
+     * Result of a successful lookup.
+     */
+    struct Match {
+        uint32_t beacon;        /**< Beacon number, as returned by addBeacon(). */
+        uint32_t window;        /**< Rotation window (beacon time >> K) the EID belongs to. */
+        int32_t  windowOffset;  /**< Window relative to the beacon's current window at the last refresh(). */
+    };
+
+    /**
+     * Construct an empty resolver.
+     *
+     * @param[in] windowRadius
+     *              Number of windows indexed on each side of the current one.
+     * @param[in] threads
+     *              Worker threads for refresh(), 0 for one per core.
+     * @param[in] trackClocks
+     *              Narrow the indexed windows with the clock estimates.
+     * @param[in] clockConfig
+     *              The clock tracker configuration.
+     * @param[in] prefilterMaxEids
+     *              Largest index, in EIDs, for which refresh() keeps the
+     *              prefilter, unless setPrefilter() was called.
+     */
+    EidResolver(unsigned windowRadius = 1, unsigned threads = 0, bool trackClocks = false,
+                const ClockTracker::Config &clockConfig = ClockTracker::Config(),
+                size_t prefilterMaxEids = DEFAULT_PREFILTER_MAX_EIDS);
+
+    /**
+     * Register a beacon. It is indexed by the next refresh().
+     *
+     * @param[in] identityKey
+     *              The beacon's EID identity key.
+     * @param[in] rotationPeriodExp
+     *              The rotation period exponent K of the beacon's EID slot.
+     * @param[in] bootTimeSecs
+     *              Server time at which the beacon time was 0.
+     *
+     * @return The beacon number.
+     */
+    uint32_t addBeacon(const uint8_t identityKey[16], uint8_t rotationPeriodExp, int64_t bootTimeSecs);
+
+    /**
+     * Bring the index to @p nowSecs. The first call builds the whole index.
+     *
+     * @param[in] nowSecs
+     *              Server time.
+     *
+     * @return The number of beacons whose windows were recomputed.
+     */
+    size_t refresh(int64_t nowSecs);
+
+    /**
+     * Look up an observed EID.
+     *
+     * @param[in] eid
+     *              The 8 EID bytes, first byte most significant.
+     * @param[out] match
+     *              The beacon and window, when found.
+     *
+     * @return true if the EID is in the index.
+     */
+    bool resolve(uint64_t eid, Match &match) const;
+
+    /**
+     * Test an EID against the prefilter only.
+     *
+     * @return false if the EID is not in the index, true if it may be
+     *         (always, while there is no prefilter).
+     */
+    bool mayContain(uint64_t eid) const { return !prefilter || shards[shardOf(eid)].filter.mayContain(eid); }
+
+    /**
+     * Keep the prefilter and check it in resolve(), or drop it and go
+     * straight to the table, e.g. to measure what the filter saves.
+     * Enabling it rebuilds it from the table. This overrides the default,
+     * which refresh() sets from the index size (see prefilterMaxEids). Not
+     * concurrently with resolve() or refresh().
+     */
+    void setPrefilter(bool enabled);
+
+    /**
+     * Whether resolve() checks the prefilter.
+     */
+    bool getPrefilter(void) const { return prefilter; }
+
+    /**
+     * Learn the beacon clock from a resolution, when tracking clocks. The
+     * next refresh() applies it. Not concurrently with refresh().
+     *
+     * @param[in] match
+     *              The result of resolve().
+     * @param[in] nowSecs
+     *              Server time at which the EID was heard.
+     */
+    void track(const Match &match, int64_t nowSecs);
+
+    size_t getNumBeacons(void) const { return beacons.size(); }
+
+    /**
+     * Number of EIDs currently in the index.
+     */
+    size_t getNumEids(void) const;
+
+    unsigned getWindowRadius(void) const { return windowRadius; }
+
+    /**
+     * Number of AES blocks encrypted by refresh() so far: temporary keys and
+     * EIDs.
+     */
+    uint64_t getAesEvaluations(void) const { return aesEvaluations; }
+
+    const ClockTracker &getClockTracker(void) const { return clockTracker; }
+
+    /**
+     * Memory used by the prefilter, and by the table.
+     */
+    size_t getFilterBytes(void) const;
+    size_t getTableBytes(void) const;
+
+private:
+    static const unsigned SHARD_BITS = 6;
+    static const unsigned NUM_SHARDS = 1u << SHARD_BITS;
+
+    /* EIDs computed per Aes128Batch call */
+    static const size_t BATCH_EIDS = 1024;
+
+    struct Beacon {
+        uint8_t  identityKey[16];
+        uint8_t  rotationPeriodExp;
+        bool     indexed;
+        uint32_t window;            /* Current window at the last refresh */
+        uint32_t lo, hi;            /* Indexed windows */
+        int64_t  bootTimeSecs;
+    };
+
+    struct Entry {
+        uint64_t eid;
+        uint32_t beacon;
+        uint32_t window;
+    };
+
+    /* Linear probing table, at most half full */
+    struct Shard {
+        std::vector<Entry> slots;
+        size_t             count;
+        EidFilter          filter;
+    };
+
+    /* Table updates produced by one worker, by shard */
+    struct WorkerOps {
+        std::vector<Entry> removals[NUM_SHARDS];
+        std::vector<Entry> insertions[NUM_SHARDS];
+        size_t             rolled;
+        uint64_t           aesBlocks;
+    };
+
+    void updateBeacons(size_t begin, size_t end, int64_t nowSecs, WorkerOps &ops);
+    bool beaconWindows(uint32_t b, int64_t nowSecs, int64_t nominalSecs, uint32_t &window,
+                       uint32_t &lo, uint32_t &hi) const;
+    void applyOps(unsigned shard, const std::vector<WorkerOps> &ops);
+
+    static void insert(Shard &shard, const Entry &entry);
+    static bool remove(Shard &shard, const Entry &entry);
+    static void grow(Shard &shard, size_t count);
+    static void rebuildFilter(Shard &shard);
+    void enablePrefilter(bool enabled);
+
+    static unsigned shardOf(uint64_t eid) { return (unsigned)(eid >> (64 - SHARD_BITS)); }
+
+    unsigned              windowRadius;
+    unsigned              threads;
+    bool                  trackClocks;
+    size_t                prefilterMaxEids;
+    bool                  prefilter;        /* The shard filters are kept up to date */
+    bool                  prefilterSet;     /* By setPrefilter(), not from the index size */
+    ClockTracker          clockTracker;
+    uint64_t              aesEvaluations;
+    std::vector<Beacon>   beacons;
+
+    /**
+     * The EIDs of the indexed windows, room for 2 * windowRadius + 1 per
+     * beacon, stored at window % (2 * windowRadius + 1).
+     */
+    std::vector<uint64_t> beaconEids;
+    std::vector<Shard>    shards;
+};
+
+#endif // __EID_RESOLVER_H__
@@ -0,0 +1,175 @@
+/*
+ * Copyright (c) 2016, Google Inc, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Benchmark for EidResolver.
+ *
+ * Registers a fleet of beacons with random identity keys, rotation
+ * exponents 8 to 15 and boot times up to two years back, builds the index,
+ * then reports resolutions per second for a mix of known EIDs (computed
+ * independently with eidCompute()) and unknown ones, and the time of the
+ * incremental refresh as the clock advances. It then measures the
+ * prefilter: its size, its false positive rate, whether resolve() checks it
+ * by default, and the resolutions per second with and without it when most
+ * EIDs heard are unknown.
+ *
+ * Usage: EidResolverBench [beacons] [lookups] [threads] [windowRadius]
+ */
+
+#include "EidResolver.h"
+#include "EidCompute.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+double secondsSince(Clock::time_point start)
+{
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+struct Beacon {
+    uint8_t identityKey[16];
+    uint8_t rotationPeriodExp;
+    int64_t bootTimeSecs;
+};
+
+struct Query {
+    uint64_t eid;
+    uint32_t beacon;    /* EidResolver::NO_BEACON for unknown EIDs */
+};
+
+/* Known EIDs (any indexed window) one in @p knownEvery, random ones otherwise */
+std::vector<Query> makeQueries(const std::vector<Beacon> &fleet, size_t count, unsigned radius,
+                               int64_t nowSecs, std::mt19937_64 &rng, unsigned knownEvery = 2)
+{
+    std::vector<Query> queries(count);
+    for (size_t i = 0; i < count; i++) {
+        if (i % knownEvery) {
+            queries[i].eid = rng();
+            queries[i].beacon = EidResolver::NO_BEACON;
+            continue;
+        }
+        uint32_t b = rng() % fleet.size();
+        const Beacon &beacon = fleet[b];
+        uint32_t window = (uint32_t)(nowSecs - beacon.bootTimeSecs) >> beacon.rotationPeriodExp;
+        window = window - radius + (uint32_t)(rng() % (2 * radius + 1));
+        queries[i].eid = eidCompute(beacon.identityKey, beacon.rotationPeriodExp, window << beacon.rotationPeriodExp);
+        queries[i].beacon = b;
+    }
+    return queries;
+}
+
+/* Returns the number of wrong answers */
+size_t runQueries(const EidResolver &resolver, const std::vector<Query> &queries, double &seconds)
+{
+    size_t wrong = 0;
+    Clock::time_point start = Clock::now();
+    for (size_t i = 0; i < queries.size(); i++) {
+        EidResolver::Match match;
+        bool found = resolver.resolve(queries[i].eid, match);
+        if (found ? (match.beacon != queries[i].beacon) : (queries[i].beacon != EidResolver::NO_BEACON)) {
+            wrong++;
+        }
+    }
+    seconds = secondsSince(start);
+    return wrong;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    size_t   numBeacons = (argc > 1) ? strtoul(argv[1], NULL, 0) : 1000000;
+    size_t   numLookups = (argc > 2) ? strtoul(argv[2], NULL, 0) : 2000000;
+    unsigned threads    = (argc > 3) ? strtoul(argv[3], NULL, 0) : 0;
+    unsigned radius     = (argc > 4) ? strtoul(argv[4], NULL, 0) : 1;
+    if (numBeacons == 0 || numLookups == 0) {
+        fprintf(stderr, "Usage: %s [beacons] [lookups] [threads] [windowRadius]\n", argv[0]);
+        return 1;
+    }
+
+    const int64_t nowSecs = 1500000000;
+    std::mt19937_64 rng(42);
+    std::vector<Beacon> fleet(numBeacons);
+    EidResolver resolver(radius, threads);
+    for (size_t i = 0; i < numBeacons; i++) {
+        for (int j = 0; j < 16; j++) {
+            fleet[i].identityKey[j] = (uint8_t)rng();
+        }
+        fleet[i].rotationPeriodExp = 8 + rng() % 8;
+        fleet[i].bootTimeSecs = nowSecs - (int64_t)(rng() % (2 * 365 * 86400)) - 86400;
+        resolver.addBeacon(fleet[i].identityKey, fleet[i].rotationPeriodExp, fleet[i].bootTimeSecs);
+    }
+
+    Clock::time_point start = Clock::now();
+    resolver.refresh(nowSecs);
+    double buildSecs = secondsSince(start);
+    printf("%zu beacons, %u windows each, %zu EIDs indexed\n", numBeacons, 2 * radius + 1, resolver.getNumEids());
+    printf("build:   %8.3f s (%.0f beacons/s)\n", buildSecs, numBeacons / buildSecs);
+
+    std::vector<Query> queries = makeQueries(fleet, numLookups, radius, nowSecs, rng);
+    double lookupSecs;
+    size_t wrong = runQueries(resolver, queries, lookupSecs);
+    printf("resolve: %8.3f s for %zu lookups (%.0f resolutions/s), %zu wrong\n",
+           lookupSecs, numLookups, numLookups / lookupSecs, wrong);
+
+    /* Roll the clock: beacons with short periods change window first */
+    static const int64_t steps[] = { 60, 300, 3600, 86400 };
+    int64_t t = nowSecs;
+    size_t failed = wrong;
+    for (size_t i = 0; i < sizeof(steps) / sizeof(steps[0]); i++) {
+        t += steps[i];
+        start = Clock::now();
+        size_t rolled = resolver.refresh(t);
+        double refreshSecs = secondsSince(start);
+        std::vector<Query> check = makeQueries(fleet, 100000, radius, t, rng);
+        wrong = runQueries(resolver, check, lookupSecs);
+        printf("refresh: %8.3f s after +%lld s, %zu beacons rolled, %zu EIDs indexed, %zu wrong\n",
+               refreshSecs, (long long)steps[i], rolled, resolver.getNumEids(), wrong);
+        failed += wrong;
+    }
+
+    /* The prefilter: kept up to date by the refreshes above if on by default, built now otherwise */
+    bool prefilterByDefault = resolver.getPrefilter();
+    resolver.setPrefilter(true);
+    size_t passed = 0;
+    const size_t probes = 10000000;
+    for (size_t i = 0; i < probes; i++) {
+        passed += resolver.mayContain(rng());
+    }
+    printf("filter:  %8.1f MB (%.2f bytes/EID) for a %.1f MB table, false positive rate %.2e, %s by default\n",
+           resolver.getFilterBytes() / 1e6, (double)resolver.getFilterBytes() / resolver.getNumEids(),
+           resolver.getTableBytes() / 1e6, (double)passed / probes, prefilterByDefault ? "checked" : "skipped");
+    std::vector<Query> mostlyUnknown = makeQueries(fleet, numLookups, radius, t, rng, 10);
+    /* Untimed pass, so the first timed one does not pay for cold caches */
+    runQueries(resolver, mostlyUnknown, lookupSecs);
+    for (int enabled = 1; enabled >= 0; enabled--) {
+        resolver.setPrefilter(enabled != 0);
+        wrong = runQueries(resolver, mostlyUnknown, lookupSecs);
+        printf("%-8s %8.3f s for %zu lookups, 90%% unknown (%.0f resolutions/s), %zu wrong\n",
+               enabled ? "filter:" : "nofilter:", lookupSecs, numLookups, numLookups / lookupSecs, wrong);
+        failed += wrong;
+    }
+    return failed ? 2 : 0;
+}
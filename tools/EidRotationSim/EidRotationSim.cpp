@@ -0,0 +1,194 @@
+/*
+ * Copyright (c) 2016, Google Inc, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Host simulator for the EID rotation of EddystoneService.
+ *
+ * Runs beacons with several EID slots and a TLM slot (the TLM encrypted as
+ * ETLM) through the slot schedule, and counts the work done by the EID
+ * rotations per hour: EID values recomputed, AES blocks, MAC address changes
+ * and time checkpoints written to flash. It compares the previous rotation,
+ * where each slot rotated on its own when next advertised and scheduled its
+ * next rotation one period later, with the coordinated rotation of
+ * rotateEidSlots() (source/EidRotation.h). It also reports how often an EID
+ * frame went out with the value of an expired window, and how often an ETLM
+ * nonce was in a different window than the EID it was encrypted for.
+ *
+ * Usage: EidRotationSim [beacons] [hours] [intervalMs] [exp...]
+ */
+
+#include "AdvScheduling.h"
+#include "EidRotation.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <queue>
+#include <random>
+#include <vector>
+
+namespace {
+
+/* Temporary keys change every 2^16 s (EIDFrame), the firmware caches one per slot */
+const uint8_t TEMP_KEY_EPOCH_EXP = 16;
+const uint16_t ADV_JITTER_MS = 10;
+
+struct Event {
+    uint64_t timeMs;
+    int      slot;
+    bool operator<(const Event &other) const { return timeMs > other.timeMs; }
+};
+
+struct Result {
+    uint64_t eidUpdates;
+    uint64_t aesBlocks;
+    uint64_t macChanges;
+    uint64_t timeCheckpoints;
+    uint64_t eidFrames;
+    uint64_t staleEidFrames;
+    uint64_t etlmFrames;
+    uint64_t etlmMismatches;
+};
+
+/*
+ * One beacon: EID slots 0..n-1 with the given exponents, then the TLM slot.
+ * Mirrors prepareAdvFrame() for EID and TLM frames; the TLM picks its EID
+ * slot like getEidSlot().
+ */
+void simulateBeacon(bool coordinated, const std::vector<uint8_t> &exps, uint16_t intervalMs,
+                    uint64_t durationMs, std::mt19937 &rng, Result &result)
+{
+    int eidCount = (int)exps.size();
+    int slots = eidCount + 1;
+    std::uniform_int_distribution<uint32_t> seedDist(1, 0xFFFFFFFFu);
+    std::uniform_int_distribution<uint32_t> priorDist(0, 1u << 24);
+    uint32_t state = seedDist(rng);
+    uint32_t timeInPriorBoots = priorDist(rng);
+
+    std::vector<uint32_t> nextRotationTimes(eidCount, 0);
+    std::vector<uint32_t> advertisedWindows(eidCount);
+    std::vector<uint32_t> tempKeyEpochs(eidCount);
+    uint32_t eidSlots = (1u << eidCount) - 1;
+    int nextEidSlot = eidCount - 1;
+
+    /* The constructor computes every EID frame, with a fresh temporary key */
+    for (int slot = 0; slot < eidCount; slot++) {
+        advertisedWindows[slot] = timeInPriorBoots >> exps[slot];
+        tempKeyEpochs[slot] = timeInPriorBoots >> TEMP_KEY_EPOCH_EXP;
+    }
+
+    std::priority_queue<Event> events;
+    for (int slot = 0; slot < slots; slot++) {
+        Event e = { eddystoneAdvSlotOffsetMs(state, 0, intervalMs, true), slot };
+        events.push(e);
+    }
+
+    while (!events.empty() && events.top().timeMs < durationMs) {
+        Event e = events.top();
+        events.pop();
+        uint32_t timeSecs = timeInPriorBoots + (uint32_t)(e.timeMs / 1000);
+
+        if (e.slot < eidCount) {
+            uint32_t dueSlots = 0;
+            if (timeSecs >= nextRotationTimes[e.slot]) {
+                dueSlots = coordinated ? eddystoneEidDueSlots(eidSlots, &nextRotationTimes[0], eidCount, timeSecs)
+                                       : (1u << e.slot);
+            }
+            for (int slot = 0; slot < eidCount; slot++) {
+                if (!(dueSlots & (1u << slot))) {
+                    continue;
+                }
+                uint32_t epoch = timeSecs >> TEMP_KEY_EPOCH_EXP;
+                if (epoch != tempKeyEpochs[slot]) {
+                    tempKeyEpochs[slot] = epoch;
+                    result.aesBlocks++;
+                }
+                advertisedWindows[slot] = timeSecs >> exps[slot];
+                nextRotationTimes[slot] = coordinated ? eddystoneEidNextRotationTime(timeSecs, exps[slot])
+                                                      : timeSecs + (1u << exps[slot]);
+                result.eidUpdates++;
+                result.aesBlocks++;
+            }
+            if (dueSlots) {
+                result.macChanges++;
+                result.timeCheckpoints++;
+            }
+            result.eidFrames++;
+            if (advertisedWindows[e.slot] != (timeSecs >> exps[e.slot])) {
+                result.staleEidFrames++;
+            }
+        } else {
+            int slot = nextEidSlot;
+            nextEidSlot = (nextEidSlot + eidCount - 1) % eidCount;
+            result.etlmFrames++;
+            if (advertisedWindows[slot] != (timeSecs >> exps[slot])) {
+                result.etlmMismatches++;
+            }
+        }
+
+        e.timeMs += intervalMs + eddystoneAdvJitterMs(state, ADV_JITTER_MS);
+        events.push(e);
+    }
+}
+
+void report(const char *name, const Result &r, double hours)
+{
+    printf("%-12s %10.1f %10.1f %10.1f %10.1f %9.3f%% %9.3f%%\n", name,
+           r.eidUpdates / hours, r.aesBlocks / hours, r.macChanges / hours, r.timeCheckpoints / hours,
+           r.eidFrames ? 100.0 * r.staleEidFrames / r.eidFrames : 0.0,
+           r.etlmFrames ? 100.0 * r.etlmMismatches / r.etlmFrames : 0.0);
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    unsigned beacons = (argc > 1) ? atoi(argv[1]) : 20;
+    double hours = (argc > 2) ? atof(argv[2]) : 24;
+    uint16_t intervalMs = (argc > 3) ? atoi(argv[3]) : 1000;
+    std::vector<uint8_t> exps;
+    for (int i = 4; i < argc; i++) {
+        exps.push_back((uint8_t)atoi(argv[i]));
+    }
+    if (exps.empty()) {
+        exps.push_back(10);
+        exps.push_back(10);
+        exps.push_back(12);
+    }
+    if (beacons == 0 || hours <= 0 || intervalMs == 0 || exps.size() > 31) {
+        fprintf(stderr, "Usage: %s [beacons] [hours] [intervalMs] [exp...]\n", argv[0]);
+        return 1;
+    }
+
+    printf("%u beacons, %.1f h, %u ms interval, EID exponents:", beacons, hours, intervalMs);
+    for (size_t i = 0; i < exps.size(); i++) {
+        printf(" %u", exps[i]);
+    }
+    printf(", per beacon and hour:\n");
+    printf("%-12s %10s %10s %10s %10s %10s %10s\n", "rotation", "EIDs", "AES blocks", "MAC", "flash", "stale EID", "ETLM skew");
+
+    uint64_t durationMs = (uint64_t)(hours * 3600000);
+    const char *names[2] = { "per slot", "coordinated" };
+    for (int mode = 0; mode < 2; mode++) {
+        std::mt19937 rng(12345);
+        Result result = Result();
+        for (unsigned b = 0; b < beacons; b++) {
+            simulateBeacon(mode == 1, exps, intervalMs, durationMs, rng, result);
+        }
+        report(names[mode], result, hours * beacons);
+    }
+    return 0;
+}
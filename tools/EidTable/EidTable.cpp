@@ -0,0 +1,559 @@
+/*
+ * Copyright (c) 2016, Google Inc, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "EidTable.h"
+#include "EidCompute.h"
+#include "Aes128Batch.h"
+#include "ParallelFor.h"
+
+#include <algorithm>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <utility>
+
+namespace {
+
+const char FILE_MAGIC[8] = { 'E', 'I', 'D', 'T', 'A', 'B', 'L', 'E' };
+const uint32_t SECTION_MAGIC = 0x54434553; /* "SECT" little endian */
+const uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+/* EIDs computed per Aes128Batch call, and held in memory per append() chunk */
+const size_t BATCH_EIDS = 1024;
+const size_t CHUNK_EIDS = 16 * 1024 * 1024;
+
+uint64_t align8(uint64_t n)
+{
+    return (n + 7) & ~(uint64_t)7;
+}
+
+/* First window of a beacon that starts at or after the start of an epoch (may be negative) */
+int64_t firstWindowOfEpoch(int64_t bootTimeSecs, uint8_t exp, int64_t epoch)
+{
+    int64_t fromBoot = (epoch << exp) - bootTimeSecs;
+    return -((-fromBoot) >> exp);
+}
+
+size_t bucketsBytes(uint8_t bucketBits)
+{
+    return (size_t)align8(((1ull << bucketBits) + 1) * sizeof(uint32_t));
+}
+
+bool writeAll(int fd, const void *data, size_t size, uint64_t offset)
+{
+    const uint8_t *p = (const uint8_t *)data;
+    while (size) {
+        ssize_t n = pwrite(fd, p, size, (off_t)offset);
+        if (n <= 0) {
+            return false;
+        }
+        p += n;
+        size -= (size_t)n;
+        offset += (uint64_t)n;
+    }
+    return true;
+}
+
+bool readAll(int fd, void *data, size_t size, uint64_t offset)
+{
+    return pread(fd, data, size, (off_t)offset) == (ssize_t)size;
+}
+
+bool checkHeader(const EidTable::FileHeader &header, uint64_t fileSize)
+{
+    return memcmp(header.magic, FILE_MAGIC, sizeof(FILE_MAGIC)) == 0 &&
+           header.version == EidTable::VERSION &&
+           header.byteOrder == BYTE_ORDER_MARK &&
+           header.headerSize == sizeof(EidTable::FileHeader) &&
+           header.beaconsOffset + (uint64_t)header.numBeacons * sizeof(EidTable::FileBeacon) <= header.sectionsOffset &&
+           header.sectionsOffset <= header.endOffset &&
+           header.endOffset <= fileSize;
+}
+
+bool checkSection(const EidTable::SectionHeader &section, uint64_t offset, uint64_t endOffset)
+{
+    return section.magic == SECTION_MAGIC &&
+           section.rotationPeriodExp < 16 &&
+           section.bucketBits < 32 &&
+           section.size % 8 == 0 &&
+           section.size >= sizeof(EidTable::SectionHeader) + bucketsBytes(section.bucketBits) + 12 * section.count &&
+           offset + section.size <= endOffset;
+}
+
+/*
+ * Build a section: the (EID, beacon) pairs sorted by EID, bucketed by
+ * their top bits, about 4 EIDs per bucket.
+ */
+void buildSection(uint8_t exp, int64_t epoch, std::vector<std::pair<uint64_t, uint32_t> > &pairs,
+                  std::vector<uint8_t> &out)
+{
+    std::sort(pairs.begin(), pairs.end());
+    uint64_t count = pairs.size();
+    uint8_t bucketBits = 0;
+    while (bucketBits < 24 && (4ull << bucketBits) < count) {
+        bucketBits++;
+    }
+
+    EidTable::SectionHeader section;
+    memset(&section, 0, sizeof(section));
+    section.magic = SECTION_MAGIC;
+    section.rotationPeriodExp = exp;
+    section.bucketBits = bucketBits;
+    section.epoch = epoch;
+    section.count = count;
+    size_t eidsAt = sizeof(section) + bucketsBytes(bucketBits);
+    size_t beaconsAt = eidsAt + 8 * count;
+    section.size = align8(beaconsAt + 4 * count);
+
+    out.assign(section.size, 0);
+    memcpy(&out[0], &section, sizeof(section));
+    uint32_t *buckets = (uint32_t *)&out[sizeof(section)];
+    uint64_t *eids = (uint64_t *)&out[eidsAt];
+    uint32_t *beacons = (uint32_t *)&out[beaconsAt];
+    size_t numBuckets = (size_t)1 << bucketBits;
+    size_t i = 0;
+    for (size_t b = 0; b < numBuckets; b++) {
+        buckets[b] = (uint32_t)i;
+        while (i < count && (bucketBits == 0 || (size_t)(pairs[i].first >> (64 - bucketBits)) == b)) {
+            i++;
+        }
+    }
+    buckets[numBuckets] = (uint32_t)count;
+    for (i = 0; i < count; i++) {
+        eids[i] = pairs[i].first;
+        beacons[i] = pairs[i].second;
+    }
+}
+
+/*
+ * The EIDs of @p numEpochs consecutive windows of each beacon in
+ * [begin, end) of @p members, starting with the first window of epoch
+ * @p epoch: eids[j * numEpochs + i], valid[...] false before boot.
+ */
+void computeEids(const std::vector<EidTableBeacon> &fleet, const std::vector<uint32_t> &members,
+                 size_t begin, size_t end, uint8_t exp, int64_t epoch, size_t numEpochs,
+                 uint64_t *eids, uint8_t *valid)
+{
+    const int64_t lastWindow = 0xFFFFFFFFu >> exp;
+    std::vector<uint8_t>  tmpKeyInputs, tmpKeyBlocks, tmpKeys, eidKeys, eidBlocks;
+    std::vector<uint32_t> pendingSlots, pendingTmpKeys;
+    auto flush = [&]() {
+        size_t numTmpKeys = tmpKeyBlocks.size() / 16;
+        size_t numEids = pendingSlots.size();
+        tmpKeys.resize(16 * numTmpKeys);
+        Aes128Batch::encryptWithKeys(tmpKeyInputs.data(), tmpKeyBlocks.data(), tmpKeys.data(), numTmpKeys);
+        eidKeys.resize(16 * numEids);
+        for (size_t i = 0; i < numEids; i++) {
+            memcpy(&eidKeys[16 * i], &tmpKeys[16 * pendingTmpKeys[i]], 16);
+        }
+        Aes128Batch::encryptWithKeys(eidKeys.data(), eidBlocks.data(), eidBlocks.data(), numEids);
+        for (size_t i = 0; i < numEids; i++) {
+            eids[pendingSlots[i]] = eidFromEncryptedBlock(&eidBlocks[16 * i]);
+        }
+        tmpKeyInputs.clear();
+        tmpKeyBlocks.clear();
+        eidBlocks.clear();
+        pendingSlots.clear();
+        pendingTmpKeys.clear();
+    };
+
+    for (size_t j = begin; j < end; j++) {
+        const EidTableBeacon &beacon = fleet[members[j]];
+        int64_t firstWindow = firstWindowOfEpoch(beacon.bootTimeSecs, exp, epoch);
+        bool tmpKeyQueued = false;
+        uint32_t tmpKeyEpoch = 0;
+        for (size_t i = 0; i < numEpochs; i++) {
+            int64_t w = firstWindow + (int64_t)i;
+            size_t slot = j * numEpochs + i;
+            valid[slot] = (w >= 0 && w <= lastWindow);
+            if (!valid[slot]) {
+                continue;
+            }
+            /* The temporary key is derived once per 2^16 s */
+            uint32_t windowSecs = (uint32_t)(w << exp);
+            if (!tmpKeyQueued || (windowSecs >> 16) != tmpKeyEpoch) {
+                size_t n = tmpKeyBlocks.size();
+                tmpKeyInputs.insert(tmpKeyInputs.end(), beacon.identityKey, beacon.identityKey + 16);
+                tmpKeyBlocks.resize(n + 16);
+                eidTemporaryKeyBlock(windowSecs, &tmpKeyBlocks[n]);
+                tmpKeyEpoch = windowSecs >> 16;
+                tmpKeyQueued = true;
+            }
+            size_t n = eidBlocks.size();
+            eidBlocks.resize(n + 16);
+            eidBlock(exp, windowSecs, &eidBlocks[n]);
+            pendingSlots.push_back((uint32_t)slot);
+            pendingTmpKeys.push_back((uint32_t)(tmpKeyBlocks.size() / 16 - 1));
+        }
+        if (pendingSlots.size() >= BATCH_EIDS) {
+            flush();
+        }
+    }
+    flush();
+}
+
+} // namespace
+
+EidTable::EidTable(void) :
+    fd(-1),
+    base(NULL),
+    mappedBytes(0),
+    header(NULL),
+    beacons(NULL),
+    indexedOffset(0),
+    numSections(0),
+    numEids(0)
+{
+}
+
+EidTable::~EidTable(void)
+{
+    close();
+}
+
+bool EidTable::open(const char *path)
+{
+    close();
+    fd = ::open(path, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    if (!map()) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool EidTable::map(void)
+{
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(FileHeader)) {
+        return false;
+    }
+    void *p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED) {
+        return false;
+    }
+    base = (const uint8_t *)p;
+    mappedBytes = (size_t)st.st_size;
+    header = (const FileHeader *)base;
+    if (!checkHeader(*header, mappedBytes)) {
+        return false;
+    }
+    beacons = (const FileBeacon *)(base + header->beaconsOffset);
+    for (unsigned k = 0; k < NUM_EXPS; k++) {
+        exps[k].sections.clear();
+    }
+    numSections = 0;
+    numEids = 0;
+    indexSections(header->sectionsOffset);
+    return true;
+}
+
+void EidTable::indexSections(uint64_t offset)
+{
+    uint64_t endOffset = std::min<uint64_t>(header->endOffset, mappedBytes);
+    while (offset + sizeof(SectionHeader) <= endOffset) {
+        const SectionHeader *section = (const SectionHeader *)(base + offset);
+        if (!checkSection(*section, offset, endOffset)) {
+            break;
+        }
+        ExpSections &exp = exps[section->rotationPeriodExp];
+        if (exp.sections.empty()) {
+            exp.firstEpoch = section->epoch;
+        } else if (section->epoch < exp.firstEpoch) {
+            exp.sections.insert(exp.sections.begin(), (size_t)(exp.firstEpoch - section->epoch), NULL);
+            exp.firstEpoch = section->epoch;
+        }
+        size_t index = (size_t)(section->epoch - exp.firstEpoch);
+        if (index >= exp.sections.size()) {
+            exp.sections.resize(index + 1, NULL);
+        }
+        exp.sections[index] = section;
+        numSections++;
+        numEids += section->count;
+        offset += section->size;
+    }
+    indexedOffset = offset;
+}
+
+bool EidTable::reload(void)
+{
+    if (!header) {
+        return false;
+    }
+    if (header->endOffset == indexedOffset) {
+        return true;
+    }
+    if (header->endOffset <= mappedBytes) {
+        indexSections(indexedOffset);
+        return true;
+    }
+    munmap((void *)base, mappedBytes);
+    base = NULL;
+    header = NULL;
+    return map();
+}
+
+void EidTable::close(void)
+{
+    if (base) {
+        munmap((void *)base, mappedBytes);
+    }
+    if (fd >= 0) {
+        ::close(fd);
+    }
+    fd = -1;
+    base = NULL;
+    mappedBytes = 0;
+    header = NULL;
+    beacons = NULL;
+    indexedOffset = 0;
+    for (unsigned k = 0; k < NUM_EXPS; k++) {
+        exps[k].sections.clear();
+    }
+    numSections = 0;
+    numEids = 0;
+}
+
+const EidTable::SectionHeader *EidTable::findSection(uint8_t exp, int64_t epoch) const
+{
+    const ExpSections &sections = exps[exp];
+    if (sections.sections.empty() || epoch < sections.firstEpoch ||
+        epoch - sections.firstEpoch >= (int64_t)sections.sections.size()) {
+        return NULL;
+    }
+    return sections.sections[(size_t)(epoch - sections.firstEpoch)];
+}
+
+bool EidTable::findInSection(const SectionHeader *section, uint64_t eid, uint32_t &beacon)
+{
+    const uint8_t *p = (const uint8_t *)section + sizeof(SectionHeader);
+    const uint32_t *buckets = (const uint32_t *)p;
+    const uint64_t *eids = (const uint64_t *)(p + bucketsBytes(section->bucketBits));
+    const uint32_t *beaconsOfEids = (const uint32_t *)(eids + section->count);
+    size_t b = section->bucketBits ? (size_t)(eid >> (64 - section->bucketBits)) : 0;
+    const uint64_t *first = eids + buckets[b];
+    const uint64_t *last = eids + buckets[b + 1];
+    const uint64_t *it = std::lower_bound(first, last, eid);
+    if (it == last || *it != eid) {
+        return false;
+    }
+    beacon = beaconsOfEids[it - eids];
+    return true;
+}
+
+bool EidTable::resolve(uint64_t eid, int64_t nowSecs, Match &match) const
+{
+    if (!header) {
+        return false;
+    }
+    int64_t radius = header->radius;
+    for (unsigned k = 0; k < NUM_EXPS; k++) {
+        if (exps[k].sections.empty()) {
+            continue;
+        }
+        /* The window heard now started in this epoch or the previous one */
+        int64_t epoch = nowSecs >> k;
+        for (int64_t e = epoch - 1 - radius; e <= epoch + radius; e++) {
+            const SectionHeader *section = findSection((uint8_t)k, e);
+            uint32_t beacon;
+            if (section && findInSection(section, eid, beacon) && beacon < header->numBeacons) {
+                match.beacon = beacon;
+                match.window = (uint32_t)firstWindowOfEpoch(beacons[beacon].bootTimeSecs, (uint8_t)k, e);
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+int64_t EidTable::getCoveredUntilSecs(void) const
+{
+    int64_t until = INT64_MAX;
+    bool any = false;
+    for (unsigned k = 0; k < NUM_EXPS; k++) {
+        const ExpSections &sections = exps[k];
+        if (sections.sections.empty()) {
+            continue;
+        }
+        int64_t lastEpoch = sections.firstEpoch + (int64_t)sections.sections.size() - 1;
+        until = std::min(until, (lastEpoch + 1) << k);
+        any = true;
+    }
+    return any ? until : INT64_MIN;
+}
+
+uint64_t EidTable::fleetHash(const std::vector<EidTableBeacon> &fleet)
+{
+    /* FNV-1a */
+    uint64_t hash = 14695981039346656037ull;
+    auto mix = [&hash](const void *data, size_t size) {
+        const uint8_t *p = (const uint8_t *)data;
+        for (size_t i = 0; i < size; i++) {
+            hash = (hash ^ p[i]) * 1099511628211ull;
+        }
+    };
+    for (size_t i = 0; i < fleet.size(); i++) {
+        mix(fleet[i].identityKey, sizeof(fleet[i].identityKey));
+        mix(&fleet[i].rotationPeriodExp, sizeof(fleet[i].rotationPeriodExp));
+        mix(&fleet[i].bootTimeSecs, sizeof(fleet[i].bootTimeSecs));
+    }
+    return hash;
+}
+
+bool EidTable::create(const char *path, const std::vector<EidTableBeacon> &fleet, unsigned radius)
+{
+    FileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, FILE_MAGIC, sizeof(FILE_MAGIC));
+    header.version = VERSION;
+    header.byteOrder = BYTE_ORDER_MARK;
+    header.headerSize = sizeof(FileHeader);
+    header.radius = radius;
+    header.numBeacons = (uint32_t)fleet.size();
+    header.fleetHash = fleetHash(fleet);
+    header.beaconsOffset = sizeof(FileHeader);
+    header.sectionsOffset = align8(header.beaconsOffset + fleet.size() * sizeof(FileBeacon));
+    header.endOffset = header.sectionsOffset;
+
+    std::vector<FileBeacon> fileBeacons(fleet.size());
+    for (size_t i = 0; i < fleet.size(); i++) {
+        memset(&fileBeacons[i], 0, sizeof(FileBeacon));
+        fileBeacons[i].bootTimeSecs = fleet[i].bootTimeSecs;
+        fileBeacons[i].rotationPeriodExp = fleet[i].rotationPeriodExp;
+    }
+
+    int fd = ::open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    bool ok = writeAll(fd, &header, sizeof(header), 0) &&
+              (fileBeacons.empty() || writeAll(fd, &fileBeacons[0], fileBeacons.size() * sizeof(FileBeacon), header.beaconsOffset)) &&
+              ftruncate(fd, (off_t)header.endOffset) == 0 &&
+              fsync(fd) == 0;
+    ::close(fd);
+    return ok;
+}
+
+bool EidTable::append(const char *path, const std::vector<EidTableBeacon> &fleet, int64_t fromSecs,
+                      int64_t untilSecs, unsigned threads, size_t *sectionsAdded)
+{
+    if (sectionsAdded) {
+        *sectionsAdded = 0;
+    }
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    int fd = ::open(path, O_RDWR);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    FileHeader header;
+    if (fstat(fd, &st) != 0 || !readAll(fd, &header, sizeof(header), 0) || !checkHeader(header, (uint64_t)st.st_size) ||
+        header.numBeacons != fleet.size() || header.fleetHash != fleetHash(fleet)) {
+        ::close(fd);
+        return false;
+    }
+
+    /* The last epoch held for each exponent */
+    bool held[NUM_EXPS] = { false };
+    int64_t lastEpochs[NUM_EXPS] = { 0 };
+    for (uint64_t offset = header.sectionsOffset; offset + sizeof(SectionHeader) <= header.endOffset; ) {
+        SectionHeader section;
+        if (!readAll(fd, &section, sizeof(section), offset) || !checkSection(section, offset, header.endOffset)) {
+            ::close(fd);
+            return false;
+        }
+        uint8_t k = section.rotationPeriodExp;
+        lastEpochs[k] = held[k] ? std::max(lastEpochs[k], section.epoch) : section.epoch;
+        held[k] = true;
+        offset += section.size;
+    }
+
+    std::vector<uint32_t> members[NUM_EXPS];
+    for (size_t i = 0; i < fleet.size(); i++) {
+        if (fleet[i].rotationPeriodExp < NUM_EXPS) {
+            members[fleet[i].rotationPeriodExp].push_back((uint32_t)i);
+        }
+    }
+
+    bool ok = true;
+    int64_t radius = header.radius;
+    std::vector<uint64_t> eids;
+    std::vector<uint8_t> valid;
+    for (unsigned k = 0; k < NUM_EXPS && ok; k++) {
+        size_t m = members[k].size();
+        if (m == 0) {
+            continue;
+        }
+        int64_t firstEpoch = (fromSecs >> k) - 1 - radius;
+        if (held[k]) {
+            firstEpoch = std::max(firstEpoch, lastEpochs[k] + 1);
+        }
+        int64_t lastEpoch = (untilSecs >> k) + radius;
+
+        /* Chunks of epochs: compute their EIDs, write their sections, commit */
+        size_t chunkEpochs = std::max<size_t>(1, CHUNK_EIDS / m);
+        for (int64_t epoch = firstEpoch; epoch <= lastEpoch && ok; epoch += (int64_t)chunkEpochs) {
+            size_t n = (size_t)std::min<int64_t>((int64_t)chunkEpochs, lastEpoch - epoch + 1);
+            eids.resize(m * n);
+            valid.resize(m * n);
+            parallelFor(threads, m, [&](unsigned, size_t begin, size_t end) {
+                computeEids(fleet, members[k], begin, end, (uint8_t)k, epoch, n, &eids[0], &valid[0]);
+            });
+
+            std::vector<std::vector<uint8_t> > sections(n);
+            parallelFor(threads, n, [&](unsigned, size_t begin, size_t end) {
+                std::vector<std::pair<uint64_t, uint32_t> > pairs;
+                for (size_t i = begin; i < end; i++) {
+                    pairs.clear();
+                    for (size_t j = 0; j < m; j++) {
+                        if (valid[j * n + i]) {
+                            pairs.push_back(std::make_pair(eids[j * n + i], members[k][j]));
+                        }
+                    }
+                    buildSection((uint8_t)k, epoch + (int64_t)i, pairs, sections[i]);
+                }
+            });
+
+            uint64_t offset = header.endOffset;
+            for (size_t i = 0; i < n && ok; i++) {
+                ok = writeAll(fd, &sections[i][0], sections[i].size(), offset);
+                offset += sections[i].size();
+            }
+            /* The sections reach the disk before the header points at them */
+            ok = ok && fdatasync(fd) == 0;
+            if (ok) {
+                header.endOffset = offset;
+                ok = writeAll(fd, &header, sizeof(header), 0) && fdatasync(fd) == 0;
+            }
+            if (ok && sectionsAdded) {
+                *sectionsAdded += n;
+            }
+        }
+    }
+    /* Drop what an interrupted append left past the last complete section */
+    ok = ok && ftruncate(fd, (off_t)header.endOffset) == 0;
+    ::close(fd);
+    return ok;
+}
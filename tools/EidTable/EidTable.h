@@ -0,0 +1,195 @@
+/*
+ * Copyright (c) 2016, Google Inc, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __EID_TABLE_H__
+#define __EID_TABLE_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+/**
+ * A beacon as registered with the resolver. Beacon numbers are indexes in
+ * the fleet vector.
+ */
+struct EidTableBeacon {
+    uint8_t identityKey[16];
+    uint8_t rotationPeriodExp;
+    int64_t bootTimeSecs;       /**< Server time at which the beacon time was 0. */
+};
+
+/**
+ * Precomputed EIDs on disk, for a resolver that has to answer right after
+ * a restart instead of recomputing the EIDs of the whole fleet.
+ *
+ * The file is used in place through mmap: open() checks the header and
+ * walks the section headers, lookups then read the mapped records. All
+ * fields are in host byte order (checked through FileHeader::byteOrder)
+ * and naturally aligned. Layout:
+ *
+ *   FileHeader
+ *   FileBeacon[numBeacons]             boot time and exponent, no keys
+ *   sections, back to back up to FileHeader::endOffset, each:
+ *     SectionHeader
+ *     uint32_t buckets[2^bucketBits + 1]   first record of each bucket,
+ *                                          by the top bucketBits EID bits
+ *     uint64_t eids[count]                 sorted
+ *     uint32_t beacons[count]              beacon of each EID
+ *
+ * A section covers one rotation exponent K and one epoch: the server time
+ * slice [epoch << K, (epoch + 1) << K). It holds the EID of every beacon
+ * with exponent K whose rotation window starts in that slice, so every
+ * window is stored once, and the window is found again from the section
+ * and the beacon's boot time. A lookup probes, for each exponent, the
+ * sections of the windows heard now give or take FileHeader::radius.
+ *
+ * append() adds the sections of upcoming windows: it writes them after the
+ * last complete one, syncs, then moves endOffset, so a reader (or a crash)
+ * never sees a partial section. Readers pick them up with reload().
+ */
+class EidTable
+{
+public:
+    static const uint32_t VERSION = 1;
+
+    struct FileHeader {
+        char     magic[8];          /* "EIDTABLE" */
+        uint32_t version;
+        uint32_t byteOrder;         /* 0x01020304 as written */
+        uint32_t headerSize;
+        uint32_t radius;            /* Windows of clock error covered either side */
+        uint32_t numBeacons;
+        uint32_t reserved;
+        uint64_t fleetHash;         /* fleetHash() of the registrations */
+        uint64_t beaconsOffset;
+        uint64_t sectionsOffset;
+        uint64_t endOffset;         /* End of the last complete section */
+    };
+
+    struct FileBeacon {
+        int64_t  bootTimeSecs;
+        uint8_t  rotationPeriodExp;
+        uint8_t  reserved[7];
+    };
+
+    struct SectionHeader {
+        uint32_t magic;             /* "SECT" */
+        uint8_t  rotationPeriodExp;
+        uint8_t  bucketBits;
+        uint16_t reserved;
+        int64_t  epoch;
+        uint64_t count;
+        uint64_t size;              /* Bytes, header included, multiple of 8 */
+    };
+
+    struct Match {
+        uint32_t beacon;
+        uint32_t window;            /**< Rotation window (beacon time >> K) of the EID. */
+    };
+
+    EidTable(void);
+    ~EidTable(void);
+
+    /**
+     * Map a table file.
+     *
+     * @return false if the file cannot be mapped or is not a table of this
+     *         version and byte order.
+     */
+    bool open(const char *path);
+
+    /**
+     * Pick up the sections appended since open() or the last reload().
+     * Not concurrently with resolve().
+     */
+    bool reload(void);
+
+    void close(void);
+
+    /**
+     * Look up an EID heard at @p nowSecs.
+     *
+     * @return true if it is in a section around @p nowSecs.
+     */
+    bool resolve(uint64_t eid, int64_t nowSecs, Match &match) const;
+
+    /**
+     * Server time up to which every exponent of the fleet has sections,
+     * i.e. until which resolve() finds current windows.
+     */
+    int64_t getCoveredUntilSecs(void) const;
+
+    uint64_t getFleetHash(void) const { return header ? header->fleetHash : 0; }
+    size_t getNumSections(void) const { return numSections; }
+    uint64_t getNumEids(void) const { return numEids; }
+    size_t getMappedBytes(void) const { return mappedBytes; }
+
+    /**
+     * Hash of the registrations (keys included), stored in the header so a
+     * table is not used with another fleet.
+     */
+    static uint64_t fleetHash(const std::vector<EidTableBeacon> &fleet);
+
+    /**
+     * Write a table with the fleet and no sections.
+     *
+     * @param[in] radius
+     *              Windows of clock error covered on each side.
+     */
+    static bool create(const char *path, const std::vector<EidTableBeacon> &fleet, unsigned radius);
+
+    /**
+     * Append the sections needed to resolve the EIDs heard from @p fromSecs
+     * to @p untilSecs that the file does not hold yet. Meant to run in the
+     * background, ahead of time.
+     *
+     * @param[in] threads
+     *              Worker threads computing the EIDs, 0 for one per core.
+     * @param[out] sectionsAdded
+     *              The number of sections written, may be NULL.
+     *
+     * @return false on an I/O error or if the file is not a table of @p fleet.
+     */
+    static bool append(const char *path, const std::vector<EidTableBeacon> &fleet, int64_t fromSecs,
+                       int64_t untilSecs, unsigned threads, size_t *sectionsAdded);
+
+private:
+    static const unsigned NUM_EXPS = 16;
+
+    /* The sections of one exponent, by epoch; NULL where there is none */
+    struct ExpSections {
+        int64_t                            firstEpoch;
+        std::vector<const SectionHeader *> sections;
+    };
+
+    bool map(void);
+    void indexSections(uint64_t fromOffset);
+    const SectionHeader *findSection(uint8_t exp, int64_t epoch) const;
+    static bool findInSection(const SectionHeader *section, uint64_t eid, uint32_t &beacon);
+
+    int                 fd;
+    const uint8_t      *base;
+    size_t              mappedBytes;
+    const FileHeader   *header;
+    const FileBeacon   *beacons;
+    uint64_t            indexedOffset;
+    ExpSections         exps[NUM_EXPS];
+    size_t              numSections;
+    uint64_t            numEids;
+};
+
+#endif // __EID_TABLE_H__
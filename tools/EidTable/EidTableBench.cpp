@@ -0,0 +1,190 @@
+/*
+ * Copyright (c) 2016, Google Inc, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Benchmark for EidTable.
+ *
+ * Registers a fleet like EidResolverBench does, then compares the cold
+ * start of EidResolver (computing the EIDs of the whole fleet) with
+ * mapping a table file written ahead of time. It reports the time and size
+ * of the table, the time to open it and resolve the first EID, the
+ * resolutions per second, and resolutions while a background thread
+ * appends the next windows.
+ *
+ * Usage: EidTableBench [beacons] [file] [horizonSecs] [threads]
+ */
+
+#include "EidTable.h"
+#include "EidResolver.h"
+#include "EidCompute.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+double secondsSince(Clock::time_point start)
+{
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+struct Query {
+    uint64_t eid;
+    uint32_t beacon;    /* EidTable::NO_BEACON for unknown EIDs */
+    uint32_t window;
+};
+
+const uint32_t NO_BEACON = 0xFFFFFFFF;
+
+/* Half EIDs of the current or adjacent windows at nowSecs, half random ones */
+std::vector<Query> makeQueries(const std::vector<EidTableBeacon> &fleet, size_t count, int64_t nowSecs,
+                               std::mt19937_64 &rng)
+{
+    std::vector<Query> queries(count);
+    for (size_t i = 0; i < count; i++) {
+        if (i % 2) {
+            queries[i].eid = rng();
+            queries[i].beacon = NO_BEACON;
+            continue;
+        }
+        uint32_t b = rng() % fleet.size();
+        const EidTableBeacon &beacon = fleet[b];
+        uint32_t window = (uint32_t)(nowSecs - beacon.bootTimeSecs) >> beacon.rotationPeriodExp;
+        window = window - 1 + (uint32_t)(rng() % 3);
+        queries[i].eid = eidCompute(beacon.identityKey, beacon.rotationPeriodExp, window << beacon.rotationPeriodExp);
+        queries[i].beacon = b;
+        queries[i].window = window;
+    }
+    return queries;
+}
+
+/* Returns the number of wrong answers */
+size_t runQueries(const EidTable &table, const std::vector<Query> &queries, int64_t nowSecs)
+{
+    size_t wrong = 0;
+    for (size_t i = 0; i < queries.size(); i++) {
+        EidTable::Match match;
+        bool found = table.resolve(queries[i].eid, nowSecs, match);
+        if (found ? (match.beacon != queries[i].beacon || match.window != queries[i].window)
+                  : (queries[i].beacon != NO_BEACON)) {
+            wrong++;
+        }
+    }
+    return wrong;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    size_t      numBeacons  = (argc > 1) ? strtoul(argv[1], NULL, 0) : 1000000;
+    const char *path        = (argc > 2) ? argv[2] : "eids.table";
+    int64_t     horizonSecs = (argc > 3) ? strtoll(argv[3], NULL, 0) : 3600;
+    unsigned    threads     = (argc > 4) ? strtoul(argv[4], NULL, 0) : 0;
+    if (numBeacons == 0 || horizonSecs <= 0) {
+        fprintf(stderr, "Usage: %s [beacons] [file] [horizonSecs] [threads]\n", argv[0]);
+        return 1;
+    }
+
+    const int64_t nowSecs = 1500000000;
+    std::mt19937_64 rng(42);
+    std::vector<EidTableBeacon> fleet(numBeacons);
+    for (size_t i = 0; i < numBeacons; i++) {
+        for (int j = 0; j < 16; j++) {
+            fleet[i].identityKey[j] = (uint8_t)rng();
+        }
+        fleet[i].rotationPeriodExp = 8 + rng() % 8;
+        fleet[i].bootTimeSecs = nowSecs - (int64_t)(rng() % (2 * 365 * 86400)) - 86400;
+    }
+
+    /* Cold start by recomputation */
+    {
+        EidResolver resolver(1, threads);
+        for (size_t i = 0; i < numBeacons; i++) {
+            resolver.addBeacon(fleet[i].identityKey, fleet[i].rotationPeriodExp, fleet[i].bootTimeSecs);
+        }
+        Clock::time_point start = Clock::now();
+        resolver.refresh(nowSecs);
+        printf("%zu beacons\n", numBeacons);
+        printf("recompute: %9.3f s to index %zu EIDs (EidResolver cold start)\n",
+               secondsSince(start), resolver.getNumEids());
+    }
+
+    /* The table, written ahead of time */
+    Clock::time_point start = Clock::now();
+    size_t sections;
+    if (!EidTable::create(path, fleet, 1) || !EidTable::append(path, fleet, nowSecs, nowSecs + horizonSecs, threads, &sections)) {
+        fprintf(stderr, "Cannot write %s\n", path);
+        return 1;
+    }
+    double writeSecs = secondsSince(start);
+
+    std::vector<Query> queries = makeQueries(fleet, 1000000, nowSecs, rng);
+    start = Clock::now();
+    EidTable table;
+    if (!table.open(path)) {
+        fprintf(stderr, "Cannot map %s\n", path);
+        return 1;
+    }
+    EidTable::Match match;
+    table.resolve(queries[0].eid, nowSecs, match);
+    double openSecs = secondsSince(start);
+    printf("write:     %9.3f s for %zu sections, %llu EIDs, %.1f MB (%.1f bytes/EID), %lld s ahead\n",
+           writeSecs, sections, (unsigned long long)table.getNumEids(), table.getMappedBytes() / 1e6,
+           (double)table.getMappedBytes() / table.getNumEids(), (long long)horizonSecs);
+    printf("open:      %9.3f ms to map and resolve the first EID (table cold start)\n", openSecs * 1e3);
+
+    start = Clock::now();
+    size_t wrong = runQueries(table, queries, nowSecs);
+    double lookupSecs = secondsSince(start);
+    printf("resolve:   %9.3f s for %zu lookups (%.0f resolutions/s), %zu wrong\n",
+           lookupSecs, queries.size(), queries.size() / lookupSecs, wrong);
+
+    /* The next horizon appended in the background while resolving */
+    std::atomic<bool> appending(true);
+    bool appended = false;
+    start = Clock::now();
+    std::thread job([&]() {
+        appended = EidTable::append(path, fleet, nowSecs, nowSecs + 2 * horizonSecs, threads, &sections);
+        appending = false;
+    });
+    size_t lookups = 0;
+    while (appending) {
+        wrong += runQueries(table, queries, nowSecs);
+        lookups += queries.size();
+    }
+    job.join();
+    double appendSecs = secondsSince(start);
+    int64_t laterSecs = nowSecs + horizonSecs + horizonSecs / 2;
+    std::vector<Query> later = makeQueries(fleet, 100000, laterSecs, rng);
+    size_t missedBefore = runQueries(table, later, laterSecs);
+    table.reload();
+    size_t laterWrong = runQueries(table, later, laterSecs);
+    printf("append:    %9.3f s for %zu sections in the background, %zu lookups meanwhile (%.0f/s), %zu wrong\n",
+           appendSecs, sections, lookups, lookups / appendSecs, wrong);
+    printf("reload:    +%lld s: %zu wrong before reload, %zu after, covered until +%lld s\n",
+           (long long)(laterSecs - nowSecs), missedBefore, laterWrong,
+           (long long)(table.getCoveredUntilSecs() - nowSecs));
+    return (appended && wrong == 0 && laterWrong == 0) ? 0 : 2;
+}
@@ -0,0 +1,228 @@
+/*
+ * Copyright (c) 2016, Google Inc, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Check and benchmark for EtlmDecryptor.
+ *
+ * Registers a fleet of beacons with random identity keys, rotation
+ * exponents 8 to 15 and boot times up to two years back, and generates a
+ * stream of ETLM frames encrypted the way TLMFrame::encryptData() does
+ * (EAX as in aes_eax.cpp, written out here on HostAes128 one block at a
+ * time), received up to maxLatency seconds after they were encrypted, so
+ * some cross a window boundary. A share of the frames get a bit flipped.
+ * The stream is then decrypted with every Aes128Batch backend the CPU
+ * supports, checking each plain TLM against the original, and frames per
+ * second and MIC failures are reported. Frames that pass the 16-bit MIC
+ * with the wrong window or after corruption (about one in 65536 tries) are
+ * counted apart from real errors.
+ *
+ * Usage: EtlmDecryptBench [beacons] [frames] [threads] [corruptPerMille] [maxLatency]
+ */
+
+#include "EtlmDecryptor.h"
+#include "Aes128Batch.h"
+#include "HostAes128.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+double secondsSince(Clock::time_point start)
+{
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+struct Beacon {
+    uint8_t identityKey[16];
+    uint8_t rotationPeriodExp;
+    int64_t bootTimeSecs;
+};
+
+void gf128Double(uint8_t block[16])
+{
+    uint8_t carry = block[0] >> 7;
+    for (int i = 0; i < 15; i++) {
+        block[i] = (uint8_t)((block[i] << 1) | (block[i + 1] >> 7));
+    }
+    block[15] = (uint8_t)((block[15] << 1) ^ (carry ? 0x87 : 0));
+}
+
+/* OMAC^t of a message, as eax_omac_() */
+void omac(const HostAes128 &aes, uint8_t t, const uint8_t *input, size_t length, uint8_t mac[16])
+{
+    uint8_t l2[16] = { 0 };
+    aes.encrypt(l2, l2);
+    gf128Double(l2);
+    uint8_t l4[16];
+    memcpy(l4, l2, sizeof(l4));
+    gf128Double(l4);
+
+    uint8_t x[16] = { 0 };
+    x[15] = t;
+    if (length == 0) {
+        for (int i = 0; i < 16; i++) {
+            x[i] ^= l2[i];
+        }
+        aes.encrypt(x, mac);
+        return;
+    }
+    aes.encrypt(x, x);
+    while (length > 16) {
+        for (int i = 0; i < 16; i++) {
+            x[i] ^= input[i];
+        }
+        aes.encrypt(x, x);
+        input += 16;
+        length -= 16;
+    }
+    for (size_t i = 0; i < length; i++) {
+        x[i] ^= input[i];
+    }
+    if (length == 16) {
+        for (int i = 0; i < 16; i++) {
+            x[i] ^= l2[i];
+        }
+    } else {
+        x[length] ^= 0x80;
+        for (int i = 0; i < 16; i++) {
+            x[i] ^= l4[i];
+        }
+    }
+    aes.encrypt(x, mac);
+}
+
+/* TLMFrame::encryptData(), from the frame type byte */
+void encryptEtlm(const Beacon &beacon, uint32_t beaconTimeSecs, const uint8_t tlmData[12], uint16_t salt,
+                 uint8_t frame[EtlmDecryptor::FRAME_LEN])
+{
+    HostAes128 aes(beacon.identityKey);
+    uint32_t scaledTime = (beaconTimeSecs >> beacon.rotationPeriodExp) << beacon.rotationPeriodExp;
+    const uint8_t nonce[6] = { (uint8_t)(scaledTime >> 24), (uint8_t)(scaledTime >> 16),
+                               (uint8_t)(scaledTime >> 8), (uint8_t)scaledTime,
+                               (uint8_t)(salt >> 8), (uint8_t)salt };
+    uint8_t nonceMac[16], headerMac[16], dataMac[16], keyStream[16];
+    omac(aes, 0, nonce, sizeof(nonce), nonceMac);
+    omac(aes, 1, NULL, 0, headerMac);
+    aes.encrypt(nonceMac, keyStream);
+
+    frame[0] = EtlmDecryptor::FRAME_TYPE_TLM;
+    frame[1] = EtlmDecryptor::ETLM_VERSION;
+    for (int i = 0; i < 12; i++) {
+        frame[2 + i] = tlmData[i] ^ keyStream[i];
+    }
+    omac(aes, 2, frame + 2, 12, dataMac);
+    frame[14] = nonce[4];
+    frame[15] = nonce[5];
+    for (int i = 0; i < 2; i++) {
+        frame[16 + i] = headerMac[i] ^ nonceMac[i] ^ dataMac[i];
+    }
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    size_t   numBeacons   = (argc > 1) ? strtoul(argv[1], NULL, 0) : 100000;
+    size_t   numFrames    = (argc > 2) ? strtoul(argv[2], NULL, 0) : 2000000;
+    unsigned threads      = (argc > 3) ? strtoul(argv[3], NULL, 0) : 0;
+    unsigned corruptPerMille = (argc > 4) ? strtoul(argv[4], NULL, 0) : 10;
+    unsigned maxLatency   = (argc > 5) ? strtoul(argv[5], NULL, 0) : 20;
+    if (numBeacons == 0 || numFrames == 0) {
+        fprintf(stderr, "Usage: %s [beacons] [frames] [threads] [corruptPerMille] [maxLatency]\n", argv[0]);
+        return 1;
+    }
+
+    const int64_t nowSecs = 1500000000;
+    std::mt19937_64 rng(42);
+    std::vector<Beacon> fleet(numBeacons);
+    EtlmDecryptor decryptor(threads, maxLatency + 1);
+    for (size_t i = 0; i < numBeacons; i++) {
+        for (int j = 0; j < 16; j++) {
+            fleet[i].identityKey[j] = (uint8_t)rng();
+        }
+        fleet[i].rotationPeriodExp = 8 + rng() % 8;
+        fleet[i].bootTimeSecs = nowSecs - (int64_t)(rng() % (2 * 365 * 86400)) - 86400;
+        decryptor.addBeacon(fleet[i].identityKey, fleet[i].rotationPeriodExp, fleet[i].bootTimeSecs);
+    }
+
+    /* One hour of traffic */
+    std::vector<EtlmDecryptor::Record> records(numFrames);
+    std::vector<uint8_t> plain(numFrames * EtlmDecryptor::TLM_DATA_LEN);
+    std::vector<bool> corrupted(numFrames);
+    size_t numCorrupted = 0;
+    for (size_t i = 0; i < numFrames; i++) {
+        EtlmDecryptor::Record &record = records[i];
+        record.beacon = (uint32_t)(rng() % numBeacons);
+        record.receivedSecs = nowSecs + (int64_t)(rng() % 3600);
+        const Beacon &beacon = fleet[record.beacon];
+        uint32_t beaconTimeSecs = (uint32_t)(record.receivedSecs - beacon.bootTimeSecs - (int64_t)(rng() % (maxLatency + 1)));
+        uint8_t *tlmData = &plain[i * EtlmDecryptor::TLM_DATA_LEN];
+        for (size_t j = 0; j < EtlmDecryptor::TLM_DATA_LEN; j++) {
+            tlmData[j] = (uint8_t)rng();
+        }
+        encryptEtlm(beacon, beaconTimeSecs, tlmData, (uint16_t)rng(), record.frame);
+        if (rng() % 1000 < corruptPerMille) {
+            /* Any bit the MIC covers: ciphertext, salt or MIC */
+            unsigned bit = (unsigned)(rng() % (8 * (EtlmDecryptor::FRAME_LEN - 2)));
+            record.frame[2 + bit / 8] ^= (uint8_t)(1u << (bit % 8));
+            corrupted[i] = true;
+            numCorrupted++;
+        }
+    }
+    printf("%zu beacons, %zu frames, %zu corrupted, up to %u s latency\n", numBeacons, numFrames, numCorrupted, maxLatency);
+
+    int rc = 0;
+    std::vector<EtlmDecryptor::Result> results(numFrames);
+    static const Aes128Batch::Backend backends[] = { Aes128Batch::BACKEND_AESNI, Aes128Batch::BACKEND_BITSLICED };
+    for (size_t b = 0; b < sizeof(backends) / sizeof(backends[0]); b++) {
+        if (!Aes128Batch::setBackend(backends[b])) {
+            printf("%-10s not supported by this CPU\n", Aes128Batch::getBackendName(backends[b]));
+            continue;
+        }
+        Clock::time_point start = Clock::now();
+        EtlmDecryptor::Stats stats = decryptor.decrypt(&records[0], &results[0], numFrames);
+        double secs = secondsSince(start);
+
+        size_t wrong = 0, collisions = 0;
+        for (size_t i = 0; i < numFrames; i++) {
+            bool ok = results[i].status == EtlmDecryptor::STATUS_OK;
+            if (corrupted[i]) {
+                collisions += ok;
+            } else if (!ok) {
+                wrong++;
+            } else if (memcmp(results[i].tlmData, &plain[i * EtlmDecryptor::TLM_DATA_LEN],
+                              EtlmDecryptor::TLM_DATA_LEN) != 0) {
+                collisions++;
+            }
+        }
+        printf("%-10s %8.3f s (%.0f frames/s), %zu decrypted (%zu with the previous window), "
+               "%zu MIC failures, %zu MIC collisions, %zu wrong\n",
+               Aes128Batch::getBackendName(backends[b]), secs, numFrames / secs, stats.decrypted,
+               stats.previousWindow, stats.micFailures, collisions, wrong);
+        if (wrong) {
+            rc = 2;
+        }
+    }
+    return rc;
+}
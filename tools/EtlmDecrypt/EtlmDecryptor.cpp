@@ -0,0 +1,244 @@
+/*
+ * Copyright (c) 2016, Google Inc, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "EtlmDecryptor.h"
+#include "HostAes128.h"
+#include "ParallelFor.h"
+
+#include <string.h>
+#include <thread>
+
+namespace {
+
+/* Offsets in Record::frame, see TLMFrame::encryptData() */
+const size_t FRAME_TYPE_OFFSET = 0;
+const size_t VERSION_OFFSET = 1;
+const size_t DATA_OFFSET = 2;
+const size_t SALT_OFFSET = DATA_OFFSET + 12;
+const size_t MIC_OFFSET = DATA_OFFSET + 14;
+
+const size_t NONCE_LEN = 6;
+
+/* Multiplication by x in GF(2^128), as gf128_double_() in aes_eax.cpp */
+void gf128Double(uint8_t block[16])
+{
+    uint8_t carry = block[0] >> 7;
+    for (int i = 0; i < 15; i++) {
+        block[i] = (uint8_t)((block[i] << 1) | (block[i + 1] >> 7));
+    }
+    block[15] = (uint8_t)((block[15] << 1) ^ (carry ? 0x87 : 0));
+}
+
+} // namespace
+
+struct EtlmDecryptor::Scratch {
+    std::vector<uint8_t>                   blocks;
+    std::vector<const Aes128Batch::Key *>  keys;
+    std::vector<uint32_t>                  ok;
+
+    Scratch() : blocks(2 * 16 * BATCH_FRAMES), keys(2 * BATCH_FRAMES), ok(BATCH_FRAMES) {}
+};
+
+EtlmDecryptor::EtlmDecryptor(unsigned threadsIn, uint32_t maxLatencySecsIn) :
+    threads(threadsIn ? threadsIn : std::thread::hardware_concurrency()),
+    maxLatencySecs(maxLatencySecsIn)
+{
+    if (threads == 0) {
+        threads = 1;
+    }
+}
+
+uint32_t EtlmDecryptor::addBeacon(const uint8_t identityKey[16], uint8_t rotationPeriodExp, int64_t bootTimeSecs)
+{
+    Beacon beacon;
+    Aes128Batch::expandKeys(identityKey, &beacon.key, 1);
+    beacon.rotationPeriodExp = rotationPeriodExp;
+    beacon.bootTimeSecs = bootTimeSecs;
+
+    /* The constants of eddy_eax_setup(), folded for one block messages */
+    HostAes128 aes(identityKey);
+    uint8_t l2[16] = { 0 };
+    aes.encrypt(l2, l2);
+    gf128Double(l2);
+    uint8_t l4[16];
+    memcpy(l4, l2, sizeof(l4));
+    gf128Double(l4);
+
+    uint8_t block[16] = { 0 };
+    aes.encrypt(block, beacon.nonceMacBlock);
+    block[15] = 2;
+    aes.encrypt(block, beacon.dataMacBlock);
+    for (int i = 0; i < 16; i++) {
+        beacon.nonceMacBlock[i] ^= l4[i];
+        beacon.dataMacBlock[i] ^= l4[i];
+    }
+
+    /* Empty header: the tweak block itself is the last, complete block */
+    block[15] = 1;
+    for (int i = 0; i < 16; i++) {
+        block[i] ^= l2[i];
+    }
+    aes.encrypt(block, block);
+    memcpy(beacon.headerMac, block, sizeof(beacon.headerMac));
+
+    beacons.push_back(beacon);
+    return (uint32_t)(beacons.size() - 1);
+}
+
+EtlmDecryptor::Stats EtlmDecryptor::decrypt(const Record *records, Result *results, size_t n) const
+{
+    std::vector<Stats> workerStats(threads, Stats());
+    parallelFor(threads, n, [&](unsigned t, size_t begin, size_t end) {
+        decryptRange(records + begin, results + begin, end - begin, workerStats[t]);
+    });
+
+    Stats stats = Stats();
+    for (size_t t = 0; t < workerStats.size(); t++) {
+        stats.frames += workerStats[t].frames;
+        stats.decrypted += workerStats[t].decrypted;
+        stats.micFailures += workerStats[t].micFailures;
+        stats.unknownBeacons += workerStats[t].unknownBeacons;
+        stats.badFrames += workerStats[t].badFrames;
+        stats.previousWindow += workerStats[t].previousWindow;
+    }
+    return stats;
+}
+
+void EtlmDecryptor::decryptRange(const Record *records, Result *results, size_t n, Stats &stats) const
+{
+    uint32_t pending[BATCH_FRAMES];
+    uint32_t retries[BATCH_FRAMES];
+    Scratch scratch;
+    stats.frames += n;
+
+    for (size_t base = 0; base < n; base += BATCH_FRAMES) {
+        size_t count = (n - base < BATCH_FRAMES) ? n - base : BATCH_FRAMES;
+        size_t numPending = 0;
+        for (size_t i = base; i < base + count; i++) {
+            const Record &record = records[i];
+            if (record.beacon >= beacons.size()) {
+                results[i].status = STATUS_UNKNOWN_BEACON;
+                stats.unknownBeacons++;
+            } else if (record.frame[FRAME_TYPE_OFFSET] != FRAME_TYPE_TLM ||
+                       record.frame[VERSION_OFFSET] != ETLM_VERSION) {
+                results[i].status = STATUS_BAD_FRAME;
+                stats.badFrames++;
+            } else {
+                pending[numPending++] = (uint32_t)i;
+            }
+        }
+        decryptBatch(records, results, pending, numPending, false, scratch);
+
+        size_t numRetries = 0;
+        for (size_t j = 0; j < numPending; j++) {
+            uint32_t i = pending[j];
+            if (results[i].status == STATUS_OK) {
+                stats.decrypted++;
+            } else if (inWindowStart(records[i])) {
+                retries[numRetries++] = i;
+            } else {
+                stats.micFailures++;
+            }
+        }
+        decryptBatch(records, results, retries, numRetries, true, scratch);
+
+        for (size_t j = 0; j < numRetries; j++) {
+            if (results[retries[j]].status == STATUS_OK) {
+                stats.decrypted++;
+                stats.previousWindow++;
+            } else {
+                stats.micFailures++;
+            }
+        }
+    }
+}
+
+bool EtlmDecryptor::inWindowStart(const Record &record) const
+{
+    const Beacon &beacon = beacons[record.beacon];
+    uint32_t beaconTimeSecs = (uint32_t)(record.receivedSecs - beacon.bootTimeSecs);
+    uint32_t period = 1u << beacon.rotationPeriodExp;
+    return beaconTimeSecs >= period && (beaconTimeSecs & (period - 1)) < maxLatencySecs;
+}
+
+void EtlmDecryptor::decryptBatch(const Record *records, Result *results, const uint32_t *index, size_t n,
+                                 bool previousWindow, Scratch &scratch) const
+{
+    uint8_t *blocks = &scratch.blocks[0];
+    const Aes128Batch::Key **keys = &scratch.keys[0];
+    uint32_t *ok = &scratch.ok[0];
+
+    /* Step 1: OMAC of the nonce (block 2j) and of the ciphertext (block 2j + 1) */
+    for (size_t j = 0; j < n; j++) {
+        const Record &record = records[index[j]];
+        const Beacon &beacon = beacons[record.beacon];
+        uint32_t beaconTimeSecs = (uint32_t)(record.receivedSecs - beacon.bootTimeSecs);
+        uint32_t scaledTime = (beaconTimeSecs >> beacon.rotationPeriodExp) << beacon.rotationPeriodExp;
+        if (previousWindow) {
+            scaledTime -= 1u << beacon.rotationPeriodExp;
+        }
+        const uint8_t nonce[NONCE_LEN] = { (uint8_t)(scaledTime >> 24), (uint8_t)(scaledTime >> 16),
+                                           (uint8_t)(scaledTime >> 8), (uint8_t)scaledTime,
+                                           record.frame[SALT_OFFSET], record.frame[SALT_OFFSET + 1] };
+
+        uint8_t *nonceBlock = blocks + 32 * j;
+        memcpy(nonceBlock, beacon.nonceMacBlock, 16);
+        for (size_t i = 0; i < NONCE_LEN; i++) {
+            nonceBlock[i] ^= nonce[i];
+        }
+        nonceBlock[NONCE_LEN] ^= 0x80;
+
+        uint8_t *dataBlock = blocks + 32 * j + 16;
+        memcpy(dataBlock, beacon.dataMacBlock, 16);
+        for (size_t i = 0; i < TLM_DATA_LEN; i++) {
+            dataBlock[i] ^= record.frame[DATA_OFFSET + i];
+        }
+        dataBlock[TLM_DATA_LEN] ^= 0x80;
+
+        keys[2 * j] = keys[2 * j + 1] = &beacon.key;
+    }
+    Aes128Batch::encrypt(keys, blocks, blocks, 2 * n);
+
+    /* MIC = (nonce OMAC ^ header OMAC ^ ciphertext OMAC), truncated; the nonce OMAC is the CTR block */
+    size_t numOk = 0;
+    for (size_t j = 0; j < n; j++) {
+        const Record &record = records[index[j]];
+        const Beacon &beacon = beacons[record.beacon];
+        uint8_t diff = 0;
+        for (size_t i = 0; i < sizeof(beacon.headerMac); i++) {
+            diff |= blocks[32 * j + i] ^ beacon.headerMac[i] ^ blocks[32 * j + 16 + i] ^ record.frame[MIC_OFFSET + i];
+        }
+        if (diff) {
+            results[index[j]].status = STATUS_MIC_FAILED;
+            continue;
+        }
+        memmove(blocks + 16 * numOk, blocks + 32 * j, 16);
+        keys[numOk] = &beacon.key;
+        ok[numOk++] = index[j];
+    }
+
+    /* Step 2: one CTR block decrypts the 12 data bytes */
+    Aes128Batch::encrypt(keys, blocks, blocks, numOk);
+    for (size_t j = 0; j < numOk; j++) {
+        Result &result = results[ok[j]];
+        const uint8_t *ciphertext = records[ok[j]].frame + DATA_OFFSET;
+        for (size_t i = 0; i < TLM_DATA_LEN; i++) {
+            result.tlmData[i] = ciphertext[i] ^ blocks[16 * j + i];
+        }
+        result.status = STATUS_OK;
+    }
+}
@@ -0,0 +1,168 @@
+/*
+ * Copyright (c) 2016, Google Inc, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __ETLM_DECRYPTOR_H__
+#define __ETLM_DECRYPTOR_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include "Aes128Batch.h"
+
+/**
+ * Gateway side decryption of Eddystone-ETLM frames, as produced by
+ * TLMFrame::encryptData(): EAX under the beacon's EID identity key, with an
+ * empty header, a 2-byte MIC and a 48-bit nonce made of the start of the
+ * beacon's current rotation window (4 bytes) and the 2-byte salt carried in
+ * the frame.
+ *
+ * With a 12-byte message and a 6-byte nonce, each OMAC is a single block,
+ * so a frame costs three AES blocks: the nonce OMAC and the ciphertext OMAC
+ * (independent, checked against the MIC), then one CTR block for the frames
+ * whose MIC matched. Each of the two steps is run over a batch of frames
+ * through Aes128Batch, and batches are split across worker threads. The
+ * per key EAX constants (subkeys, tweak blocks and the empty header OMAC)
+ * are computed once, in addBeacon().
+ *
+ * The frame does not carry the window, so it is rebuilt from the time the
+ * frame was received. A frame received less than maxLatencySecs after the
+ * window rolled is retried with the previous window when its MIC fails.
+ * As the MIC is 16 bits, a frame tried against a key or window it was not
+ * encrypted with still passes once in 65536 tries: such a frame decrypts
+ * to garbage with STATUS_OK.
+ */
+class EtlmDecryptor
+{
+public:
+    /**
+     * Bytes of an ETLM frame, from the frame type to the MIC
+     * (TLMFrame::FRAME_SIZE_ETLM).
+     */
+    static const size_t FRAME_LEN = 18;
+
+    /**
+     * Bytes of the decrypted TLM data: battery voltage, beacon temperature,
+     * advertising PDU count and time since power-on, as in an unencrypted
+     * TLM frame from offset 2.
+     */
+    static const size_t TLM_DATA_LEN = 12;
+
+    static const uint8_t FRAME_TYPE_TLM = 0x20;
+    static const uint8_t ETLM_VERSION = 0x01;
+
+    /**
+     * A frame forwarded by a gateway.
+     */
+    struct Record {
+        uint32_t beacon;                /**< Beacon number, as returned by addBeacon(). */
+        int64_t  receivedSecs;          /**< Server time the frame was received at. */
+        uint8_t  frame[FRAME_LEN];      /**< Service data after the Eddystone UUID. */
+    };
+
+    enum Status {
+        STATUS_OK,
+        STATUS_MIC_FAILED,
+        STATUS_UNKNOWN_BEACON,
+        STATUS_BAD_FRAME                /**< Not an ETLM frame (type or version). */
+    };
+
+    struct Result {
+        Status  status;
+        uint8_t tlmData[TLM_DATA_LEN];  /**< Plain TLM data, when status is STATUS_OK. */
+    };
+
+    /**
+     * Counters of a decrypt() call.
+     */
+    struct Stats {
+        size_t frames;
+        size_t decrypted;
+        size_t micFailures;
+        size_t unknownBeacons;
+        size_t badFrames;
+        size_t previousWindow;          /**< Decrypted with the previous window. */
+    };
+
+    /**
+     * Construct a decryptor with no beacon.
+     *
+     * @param[in] threads
+     *              Worker threads for decrypt(), 0 for one per core.
+     * @param[in] maxLatencySecs
+     *              How long after a window rolled a frame may still have been
+     *              encrypted with the previous one.
+     */
+    EtlmDecryptor(unsigned threads = 0, uint32_t maxLatencySecs = 60);
+
+    /**
+     * Register a beacon.
+     *
+     * @param[in] identityKey
+     *              The beacon's EID identity key.
+     * @param[in] rotationPeriodExp
+     *              The rotation period exponent K of the beacon's EID slot.
+     * @param[in] bootTimeSecs
+     *              Server time at which the beacon time was 0.
+     *
+     * @return The beacon number.
+     */
+    uint32_t addBeacon(const uint8_t identityKey[16], uint8_t rotationPeriodExp, int64_t bootTimeSecs);
+
+    /**
+     * Decrypt and verify @p n records. May be called from several threads,
+     * but not concurrently with addBeacon().
+     *
+     * @param[in] records
+     *              The frames.
+     * @param[out] results
+     *              One result per record.
+     * @param[in] n
+     *              The number of records.
+     *
+     * @return The counters for these records.
+     */
+    Stats decrypt(const Record *records, Result *results, size_t n) const;
+
+    size_t getNumBeacons(void) const { return beacons.size(); }
+
+private:
+    /* Frames per Aes128Batch call */
+    static const size_t BATCH_FRAMES = 512;
+
+    struct Beacon {
+        Aes128Batch::Key key;
+        uint8_t  nonceMacBlock[16];     /* Tweak 0 ^ L4: XOR the padded nonce and encrypt */
+        uint8_t  dataMacBlock[16];      /* Tweak 2 ^ L4: XOR the padded ciphertext and encrypt */
+        uint8_t  headerMac[2];          /* OMAC of the empty header, MIC bytes only */
+        uint8_t  rotationPeriodExp;
+        int64_t  bootTimeSecs;
+    };
+
+    /* Per worker buffers of decryptBatch() */
+    struct Scratch;
+
+    void decryptRange(const Record *records, Result *results, size_t n, Stats &stats) const;
+    void decryptBatch(const Record *records, Result *results, const uint32_t *index, size_t n,
+                      bool previousWindow, Scratch &scratch) const;
+    bool inWindowStart(const Record &record) const;
+
+    unsigned            threads;
+    uint32_t            maxLatencySecs;
+    std::vector<Beacon> beacons;
+};
+
+#endif // __ETLM_DECRYPTOR_H__
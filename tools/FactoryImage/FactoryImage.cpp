@@ -0,0 +1,245 @@
+/*
+ * Copyright (c) 2016, Google Inc, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "FactoryImage.h"
+#include "ParallelFor.h"
+#include "UIDFrame.h"
+#include "URLFrame.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+
+namespace {
+
+/* The names EDDYSTONE_DEFAULT_SLOT_TYPES uses, as in EddystoneService */
+const uint8_t EDDYSTONE_FRAME_UID = EddystoneFrameTypes::EDDYSTONE_FRAME_UID;
+const uint8_t EDDYSTONE_FRAME_URL = EddystoneFrameTypes::EDDYSTONE_FRAME_URL;
+const uint8_t EDDYSTONE_FRAME_TLM = EddystoneFrameTypes::EDDYSTONE_FRAME_TLM;
+const uint8_t EDDYSTONE_FRAME_EID = EddystoneFrameTypes::EDDYSTONE_FRAME_EID;
+
+/* Gap::getMinNonConnectableAdvertisingInterval() and getMaxAdvertisingInterval() on the nRF5x */
+const uint16_t MIN_ADV_INTERVAL_MS = 100;
+const uint16_t MAX_ADV_INTERVAL_MS = 10240;
+
+/* EddystoneService::REMAIN_CONNECTABLE_SET */
+const uint8_t REMAIN_CONNECTABLE_SET = 0x01;
+
+const uint64_t MAX_INSTANCE = (1ULL << (8 * UID_INSTANCEID_SIZE)) - 1;
+
+/* Devices per read from the random source, per worker */
+const size_t RANDOM_BATCH = 256;
+
+/* EddystoneService::correctAdvertisementPeriod() */
+uint16_t correctAdvertisementPeriod(uint16_t beaconPeriodIn)
+{
+    if (beaconPeriodIn != 0) {
+        if (beaconPeriodIn < MIN_ADV_INTERVAL_MS) {
+            return MIN_ADV_INTERVAL_MS;
+        } else if (beaconPeriodIn > MAX_ADV_INTERVAL_MS) {
+            return MAX_ADV_INTERVAL_MS;
+        }
+    }
+    return beaconPeriodIn;
+}
+
+/* EddystoneService::radioTxPowerToIndex() */
+uint8_t radioTxPowerToIndex(const PowerLevels_t radioTxPowerLevels, int8_t txPower)
+{
+    uint8_t size = sizeof(PowerLevels_t);
+    for (uint8_t i = 0; i < size; i++) {
+        if (txPower <= radioTxPowerLevels[i]) {
+            return i;
+        }
+    }
+    return size - 1;
+}
+
+uint8_t *slotToFrame(PersistentParams_t &image, int slot)
+{
+    return image.params.slotStorage + slot * sizeof(Slot_t);
+}
+
+} // namespace
+
+FactoryImageConfig::FactoryImageConfig(void) :
+    lockState(LOCKED),
+    remainConnectable(REMAIN_CONNECTABLE_SET),
+    firstInstance(0)
+{
+    const uint8_t uids[MAX_ADV_SLOTS][16] = EDDYSTONE_DEFAULT_SLOT_UIDS;
+    const char *urls[MAX_ADV_SLOTS] = EDDYSTONE_DEFAULT_SLOT_URLS;
+    const uint8_t types[] = EDDYSTONE_DEFAULT_SLOT_TYPES;
+    const uint16_t intervals[] = EDDYSTONE_DEFAULT_SLOT_INTERVALS;
+    const int8_t powers[] = EDDYSTONE_DEFAULT_SLOT_TX_POWERS;
+    const uint8_t exps[] = EDDYSTONE_DEFAULT_SLOT_EID_ROTATION_PERIOD_EXPS;
+    const PowerLevels_t radioLevels = EDDYSTONE_DEFAULT_RADIO_TX_POWER_LEVELS;
+    const PowerLevels_t advLevels = EDDYSTONE_DEFAULT_ADV_TX_POWER_LEVELS;
+
+    memcpy(slotUids, uids, sizeof(slotUids));
+    memcpy(slotUrls, urls, sizeof(slotUrls));
+    memcpy(slotFrameTypes, types, sizeof(slotFrameTypes));
+    memcpy(slotAdvIntervals, intervals, sizeof(slotAdvIntervals));
+    memcpy(slotRadioTxPowerLevels, powers, sizeof(slotRadioTxPowerLevels));
+    memcpy(slotEidRotationPeriodExps, exps, sizeof(slotEidRotationPeriodExps));
+    memcpy(radioTxPowerLevels, radioLevels, sizeof(radioTxPowerLevels));
+    memcpy(advTxPowerLevels, advLevels, sizeof(advTxPowerLevels));
+}
+
+const char *FactoryImageGenerator::check(const FactoryImageConfig &config)
+{
+    for (int slot = 0; slot < MAX_ADV_SLOTS; slot++) {
+        switch (config.slotFrameTypes[slot]) {
+            case EDDYSTONE_FRAME_URL: {
+                uint8_t encodedUrl[URLFrame::ENCODED_BUF_SIZE];
+                if (config.slotUrls[slot] == NULL ||
+                    URLFrame::encodeURL(encodedUrl, config.slotUrls[slot]) > URLFrame::MAX_URL_DATA) {
+                    return "a URL does not fit an Eddystone-URL frame";
+                }
+                break;
+            }
+            case EDDYSTONE_FRAME_EID:
+                if (config.slotEidRotationPeriodExps[slot] > 15) {
+                    return "an EID rotation period exponent is above 15";
+                }
+                break;
+            case EDDYSTONE_FRAME_UID:
+            case EDDYSTONE_FRAME_TLM:
+                break;
+            default:
+                return "unknown slot frame type";
+        }
+    }
+    if (config.lockState > UNLOCKED_AUTO_RELOCK_DISABLED) {
+        return "unknown lock state";
+    }
+    if (config.firstInstance > MAX_INSTANCE) {
+        return "the first UID instance does not fit 6 bytes";
+    }
+    return NULL;
+}
+
+FactoryImageGenerator::FactoryImageGenerator(const FactoryImageConfig &config, unsigned threadsIn) :
+    uidSlots(0),
+    eidSlots(0),
+    firstInstance(config.firstInstance),
+    threads(threadsIn ? threadsIn : std::thread::hardware_concurrency())
+{
+    if (threads == 0) {
+        threads = 1;
+    }
+
+    /* What EddystoneService::doFactoryReset() sets, from the config */
+    EddystoneParams_t &params = base.params;
+    memset(&base, 0, sizeof(base));
+    memcpy(params.capabilities, CAPABILITIES_DEFAULT, CAP_HDR_LEN);
+    memcpy(params.capabilities + CAP_HDR_LEN, config.radioTxPowerLevels, sizeof(PowerLevels_t));
+    params.activeSlot = DEFAULT_SLOT;
+    memcpy(params.radioTxPowerLevels, config.radioTxPowerLevels, sizeof(PowerLevels_t));
+    memcpy(params.advTxPowerLevels, config.advTxPowerLevels, sizeof(PowerLevels_t));
+    for (int slot = 0; slot < MAX_ADV_SLOTS; slot++) {
+        params.slotAdvIntervals[slot] = correctAdvertisementPeriod(config.slotAdvIntervals[slot]);
+        params.slotRadioTxPowerLevels[slot] = config.slotRadioTxPowerLevels[slot];
+        params.slotAdvTxPowerLevels[slot] =
+            config.advTxPowerLevels[radioTxPowerToIndex(config.radioTxPowerLevels, config.slotRadioTxPowerLevels[slot])];
+    }
+    params.lockState = config.lockState;
+    memcpy(params.slotEidRotationPeriodExps, config.slotEidRotationPeriodExps, sizeof(SlotEidRotationPeriodExps_t));
+    memcpy(params.slotFrameTypes, config.slotFrameTypes, sizeof(SlotFrameTypes_t));
+
+    UIDFrame uidFrame;
+    URLFrame urlFrame;
+    for (int slot = 0; slot < MAX_ADV_SLOTS; slot++) {
+        uint8_t *frame = slotToFrame(base, slot);
+        switch (config.slotFrameTypes[slot]) {
+            case EDDYSTONE_FRAME_UID:
+                uidFrame.setData(frame, params.slotAdvTxPowerLevels[slot], config.slotUids[slot]);
+                uidSlots |= 1 << slot;
+                break;
+            case EDDYSTONE_FRAME_URL:
+                urlFrame.setUnencodedUrlData(frame, params.slotAdvTxPowerLevels[slot], config.slotUrls[slot]);
+                break;
+            case EDDYSTONE_FRAME_EID:
+                eidSlots |= 1 << slot;
+                break;
+        }
+    }
+    params.factoryReset = false;
+    params.remainConnectable = config.remainConnectable;
+    base.persistenceSignature = PersistentParams_t::MAGIC;
+}
+
+void FactoryImageGenerator::build(uint64_t index, const uint8_t random[RANDOM_BYTES],
+                                  PersistentParams_t &image, FactoryDeviceRecord &record) const
+{
+    memcpy(&image, &base, sizeof(image));
+    memset(&record, 0, sizeof(record));
+
+    record.instance = firstInstance + index;
+    UIDFrame uidFrame;
+    for (int slot = 0; slot < MAX_ADV_SLOTS; slot++) {
+        if (uidSlots & (1 << slot)) {
+            uint8_t *instance = uidFrame.getUid(slotToFrame(image, slot)) + UID_NAMESPACEID_SIZE;
+            for (size_t i = 0; i < UID_INSTANCEID_SIZE; i++) {
+                instance[i] = (uint8_t)(record.instance >> (8 * (UID_INSTANCEID_SIZE - 1 - i)));
+            }
+        }
+    }
+
+    memcpy(image.params.unlockKey, random, sizeof(Lock_t));
+    memcpy(record.unlockKey, random, sizeof(Lock_t));
+    for (int slot = 0; slot < MAX_ADV_SLOTS; slot++) {
+        if (eidSlots & (1 << slot)) {
+            const uint8_t *key = random + sizeof(Lock_t) + slot * sizeof(EidIdentityKey_t);
+            memcpy(image.params.slotEidIdentityKeys[slot], key, sizeof(EidIdentityKey_t));
+            memcpy(record.slotEidIdentityKeys[slot], key, sizeof(EidIdentityKey_t));
+        }
+    }
+}
+
+bool FactoryImageGenerator::generate(uint64_t first, size_t count, std::vector<PersistentParams_t> &images,
+                                     std::vector<FactoryDeviceRecord> &records) const
+{
+    images.resize(count);
+    records.resize(count);
+    std::vector<char> failed(threads, 0);
+    parallelFor(threads, count, [&](unsigned t, size_t begin, size_t end) {
+        FILE *random = fopen("/dev/urandom", "rb");
+        std::vector<uint8_t> bytes(RANDOM_BATCH * RANDOM_BYTES);
+        for (size_t i = begin; i < end && !failed[t]; i += RANDOM_BATCH) {
+            size_t n = (end - i < RANDOM_BATCH) ? end - i : RANDOM_BATCH;
+            if (!random || fread(&bytes[0], RANDOM_BYTES, n, random) != n) {
+                failed[t] = 1;
+                break;
+            }
+            for (size_t j = 0; j < n; j++) {
+                build(first + i + j, &bytes[j * RANDOM_BYTES], images[i + j], records[i + j]);
+            }
+        }
+        memset(&bytes[0], 0, bytes.size());
+        if (random) {
+            fclose(random);
+        }
+    });
+
+    for (size_t t = 0; t < failed.size(); t++) {
+        if (failed[t]) {
+            return false;
+        }
+    }
+    return true;
+}
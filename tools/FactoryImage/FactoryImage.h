@@ -0,0 +1,121 @@
+/*
+ * Copyright (c) 2016, Google Inc, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __FACTORY_IMAGE_H__
+#define __FACTORY_IMAGE_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include "PersistentStorageHelper/nrfPersistentStorageHelper/nrfPersistentParams.h"
+
+/**
+ * Factory images of the persistent configuration page.
+ *
+ * Provisioning a beacon over GATT takes one characteristic write per
+ * setting and slot. Instead, the production line can program the page that
+ * loadEddystoneServiceConfigParams() reads. The beacon then boots through
+ * the EddystoneService constructor that takes stored params, with the
+ * production configuration already in place.
+ *
+ * The image is a PersistentParams_t, built from the firmware's own headers.
+ * It has no pointers or bit fields, and its members are naturally aligned,
+ * so the host and the Cortex-M lay it out the same way. Each image gets a
+ * unique UID instance, a random unlock key and random EID identity keys.
+ * Everything else comes from a FactoryImageConfig, which defaults to the
+ * factory reset values of Eddystone_config.h. The UID and URL slot frames
+ * are written with UIDFrame and URLFrame. TLM and EID frames are left
+ * empty: the firmware builds them at boot and before each advertisement.
+ */
+
+/**
+ * What every device of a batch shares.
+ */
+struct FactoryImageConfig {
+    uint8_t                     slotUids[MAX_ADV_SLOTS][16];    /**< Namespace and placeholder instance */
+    const char                 *slotUrls[MAX_ADV_SLOTS];        /**< Unencoded */
+    SlotFrameTypes_t            slotFrameTypes;
+    SlotAdvIntervals_t          slotAdvIntervals;               /**< ms, 0 disables the slot */
+    SlotTxPowerLevels_t         slotRadioTxPowerLevels;
+    SlotEidRotationPeriodExps_t slotEidRotationPeriodExps;
+    PowerLevels_t               radioTxPowerLevels;
+    PowerLevels_t               advTxPowerLevels;
+    uint8_t                     lockState;
+    uint8_t                     remainConnectable;
+    uint64_t                    firstInstance;                  /**< UID instance (48 bits) of device 0 */
+
+    /**
+     * The factory reset configuration of Eddystone_config.h, but locked.
+     */
+    FactoryImageConfig(void);
+};
+
+/**
+ * The secrets of one device, for the records of the fleet.
+ */
+struct FactoryDeviceRecord {
+    uint64_t                instance;
+    Lock_t                  unlockKey;
+    SlotEidIdentityKeys_t   slotEidIdentityKeys;    /**< Zero for the non EID slots */
+};
+
+class FactoryImageGenerator
+{
+public:
+    /** Random bytes per device: the unlock key and the identity keys */
+    static const size_t RANDOM_BYTES = sizeof(Lock_t) + sizeof(SlotEidIdentityKeys_t);
+
+    /**
+     * Check a configuration before building images from it.
+     *
+     * @return NULL if it is valid, or what is wrong with it.
+     */
+    static const char *check(const FactoryImageConfig &config);
+
+    /**
+     * @param[in] config
+     *              A configuration that passes check().
+     * @param[in] threads
+     *              Worker threads for generate(), 0 for one per core.
+     */
+    FactoryImageGenerator(const FactoryImageConfig &config, unsigned threads = 0);
+
+    /**
+     * Build the image of device index (UID instance firstInstance + index)
+     * from the given random bytes.
+     */
+    void build(uint64_t index, const uint8_t random[RANDOM_BYTES],
+               PersistentParams_t &image, FactoryDeviceRecord &record) const;
+
+    /**
+     * Build the images of devices first to first + count - 1, on all
+     * threads, with random bytes from the operating system.
+     *
+     * @return false if no random bytes could be read.
+     */
+    bool generate(uint64_t first, size_t count, std::vector<PersistentParams_t> &images,
+                  std::vector<FactoryDeviceRecord> &records) const;
+
+private:
+    PersistentParams_t  base;           /* The image with the per device fields blank */
+    uint8_t             uidSlots;       /* Bitmask of the UID slots */
+    uint8_t             eidSlots;       /* Bitmask of the EID slots */
+    uint64_t            firstInstance;
+    unsigned            threads;
+};
+
+#endif // __FACTORY_IMAGE_H__
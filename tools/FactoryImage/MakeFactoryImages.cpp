@@ -0,0 +1,332 @@
+/*
+ * Copyright (c) 2016, Google Inc, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Generates the factory images of a batch of beacons (see FactoryImage.h).
+ *
+ * Writes the images either into one file of consecutive flash pages (the
+ * image followed by erased 0xFF bytes up to the page size) or, with --hex,
+ * as one Intel HEX file per device at the address of the configuration
+ * page. That address is where fstorage placed the page in the application's
+ * build: the tool cannot guess it. The records file gets each device's UID
+ * instance, unlock key and EID identity keys, and is created readable by its
+ * owner only.
+ *
+ * Usage: MakeFactoryImages <devices> <images.bin|hexDir> <records.csv> [options]
+ *   --first-instance <n>   UID instance of the first device (default 0)
+ *   --namespace <hex>      UID namespace (10 bytes) of every UID slot
+ *   --slot-types <list>    Frame type per slot, e.g. uid,tlm,eid
+ *   --intervals <list>     Interval (ms) per slot, e.g. 1000,10000,1000
+ *   --unlocked             Ship unlocked (default locked)
+ *   --page-size <bytes>    Flash page size (default 1024, 4096 for the nRF52)
+ *   --hex <address>        Intel HEX files in hexDir, at the page address
+ *   --threads <n>          Worker threads (default one per core)
+ */
+
+#include "FactoryImage.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+double secondsSince(Clock::time_point start)
+{
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+/* Devices generated, then written, at a time */
+const size_t CHUNK = 65536;
+
+/* fstorage stores whole words */
+static_assert(sizeof(PersistentParams_t) % 4 == 0, "PersistentParams_t is not a whole number of words");
+
+/* Millions of records: formatted by hand, printf would take most of the run */
+char *appendHex(char *out, const uint8_t *data, size_t len)
+{
+    static const char digits[] = "0123456789abcdef";
+    for (size_t i = 0; i < len; i++) {
+        *out++ = digits[data[i] >> 4];
+        *out++ = digits[data[i] & 0x0f];
+    }
+    return out;
+}
+
+bool parseHex(const char *hex, uint8_t *data, size_t len)
+{
+    if (strlen(hex) != 2 * len) {
+        return false;
+    }
+    for (size_t i = 0; i < len; i++) {
+        unsigned byte;
+        if (sscanf(hex + 2 * i, "%2x", &byte) != 1) {
+            return false;
+        }
+        data[i] = (uint8_t)byte;
+    }
+    return true;
+}
+
+void writeHexRecord(FILE *file, uint8_t type, uint16_t address, const uint8_t *data, size_t len)
+{
+    uint8_t sum = (uint8_t)(len + (address >> 8) + address + type);
+    fprintf(file, ":%02X%04X%02X", (unsigned)len, address, type);
+    for (size_t i = 0; i < len; i++) {
+        fprintf(file, "%02X", data[i]);
+        sum += data[i];
+    }
+    fprintf(file, "%02X\n", (uint8_t)-sum);
+}
+
+/* Intel HEX: extended linear address records, 16 data bytes per record */
+bool writeIntelHex(const char *path, uint32_t address, const uint8_t *data, size_t len)
+{
+    FILE *file = fopen(path, "w");
+    if (!file) {
+        return false;
+    }
+    uint32_t upper = ~0u;
+    size_t n;
+    for (size_t offset = 0; offset < len; offset += n) {
+        uint32_t at = address + (uint32_t)offset;
+        if ((at >> 16) != upper) {
+            upper = at >> 16;
+            uint8_t base[2] = { (uint8_t)(upper >> 8), (uint8_t)upper };
+            writeHexRecord(file, 0x04, 0, base, sizeof(base));
+        }
+        /* Up to 16 bytes, without crossing a 64 kB boundary */
+        n = (len - offset < 16) ? len - offset : 16;
+        if ((at & 0xffff) + n > 0x10000) {
+            n = 0x10000 - (at & 0xffff);
+        }
+        writeHexRecord(file, 0x00, (uint16_t)at, data + offset, n);
+    }
+    writeHexRecord(file, 0x01, 0, NULL, 0);
+    return fclose(file) == 0;
+}
+
+/* The records hold the keys: readable by the owner only */
+FILE *createPrivate(const char *path)
+{
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0) {
+        return NULL;
+    }
+    FILE *file = fdopen(fd, "w");
+    if (!file) {
+        close(fd);
+    }
+    return file;
+}
+
+/* One value per slot, separated by commas: returns false unless there are MAX_ADV_SLOTS */
+bool splitSlots(const char *list, char values[MAX_ADV_SLOTS][16])
+{
+    int slot = 0;
+    while (slot < MAX_ADV_SLOTS) {
+        size_t len = strcspn(list, ",");
+        if (len >= sizeof(values[slot])) {
+            return false;
+        }
+        memcpy(values[slot], list, len);
+        values[slot++][len] = '\0';
+        if (list[len] == '\0') {
+            break;
+        }
+        list += len + 1;
+    }
+    return slot == MAX_ADV_SLOTS;
+}
+
+bool parseFrameType(const char *name, uint8_t &type)
+{
+    const char *names[EddystoneFrameTypes::NUM_EDDYSTONE_FRAMES] = { "uid", "url", "tlm", "eid" };
+    for (int i = 0; i < EddystoneFrameTypes::NUM_EDDYSTONE_FRAMES; i++) {
+        if (strcmp(name, names[i]) == 0) {
+            type = (uint8_t)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+void usage(const char *name)
+{
+    fprintf(stderr, "Usage: %s <devices> <images.bin|hexDir> <records.csv> [--first-instance n] [--namespace hex]\n"
+                    "       [--slot-types list] [--intervals list] [--unlocked] [--page-size bytes] [--hex address]\n"
+                    "       [--threads n]\n", name);
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    if (argc < 4) {
+        usage(argv[0]);
+        return 1;
+    }
+    uint64_t    numDevices  = strtoull(argv[1], NULL, 0);
+    const char *imagesPath  = argv[2];
+    const char *recordsPath = argv[3];
+    size_t      pageSize    = 1024;
+    bool        hex         = false;
+    uint32_t    hexAddress  = 0;
+    unsigned    threads     = 0;
+
+    FactoryImageConfig config;
+    for (int i = 4; i < argc; i++) {
+        const char *value = (i + 1 < argc) ? argv[i + 1] : NULL;
+        if (strcmp(argv[i], "--unlocked") == 0) {
+            config.lockState = UNLOCKED;
+            continue;
+        }
+        if (value == NULL) {
+            usage(argv[0]);
+            return 1;
+        }
+        if (strcmp(argv[i], "--first-instance") == 0) {
+            config.firstInstance = strtoull(value, NULL, 0);
+        } else if (strcmp(argv[i], "--namespace") == 0) {
+            UIDNamespaceID_t uidNamespace;
+            if (!parseHex(value, uidNamespace, sizeof(uidNamespace))) {
+                fprintf(stderr, "The namespace takes %zu hex bytes\n", sizeof(uidNamespace));
+                return 1;
+            }
+            for (int slot = 0; slot < MAX_ADV_SLOTS; slot++) {
+                memcpy(config.slotUids[slot], uidNamespace, sizeof(uidNamespace));
+            }
+        } else if (strcmp(argv[i], "--slot-types") == 0 || strcmp(argv[i], "--intervals") == 0) {
+            char values[MAX_ADV_SLOTS][16];
+            bool types = strcmp(argv[i], "--slot-types") == 0;
+            bool parsed = splitSlots(value, values);
+            for (int slot = 0; parsed && slot < MAX_ADV_SLOTS; slot++) {
+                if (types) {
+                    parsed = parseFrameType(values[slot], config.slotFrameTypes[slot]);
+                } else {
+                    config.slotAdvIntervals[slot] = (uint16_t)strtoul(values[slot], NULL, 0);
+                }
+            }
+            if (!parsed) {
+                fprintf(stderr, "%s takes %d comma separated values\n", argv[i], MAX_ADV_SLOTS);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--page-size") == 0) {
+            pageSize = strtoul(value, NULL, 0);
+        } else if (strcmp(argv[i], "--hex") == 0) {
+            hex = true;
+            hexAddress = strtoul(value, NULL, 0);
+        } else if (strcmp(argv[i], "--threads") == 0) {
+            threads = strtoul(value, NULL, 0);
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+        i++;
+    }
+    const char *error = FactoryImageGenerator::check(config);
+    if (error == NULL && (numDevices == 0 || config.firstInstance + numDevices - 1 > 0xffffffffffffULL)) {
+        error = "the UID instances of the devices do not fit 6 bytes";
+    }
+    if (error == NULL && pageSize < sizeof(PersistentParams_t)) {
+        error = "the image does not fit the page";
+    }
+    if (error) {
+        fprintf(stderr, "Invalid configuration: %s\n", error);
+        return 1;
+    }
+
+    FILE *images = hex ? NULL : fopen(imagesPath, "wb");
+    FILE *records = createPrivate(recordsPath);
+    if ((!hex && !images) || !records) {
+        fprintf(stderr, "Cannot write %s\n", records ? imagesPath : recordsPath);
+        return 1;
+    }
+
+    FactoryImageGenerator generator(config, threads);
+    std::vector<PersistentParams_t> chunkImages;
+    std::vector<FactoryDeviceRecord> chunkRecords;
+    std::vector<uint8_t> page(pageSize, 0xff);
+    double generateSecs = 0;
+    Clock::time_point start = Clock::now();
+    for (uint64_t first = 0; first < numDevices; first += CHUNK) {
+        size_t count = (numDevices - first < CHUNK) ? (size_t)(numDevices - first) : CHUNK;
+        Clock::time_point generateStart = Clock::now();
+        if (!generator.generate(first, count, chunkImages, chunkRecords)) {
+            fprintf(stderr, "Cannot read random bytes\n");
+            return 1;
+        }
+        generateSecs += secondsSince(generateStart);
+
+        for (size_t i = 0; i < count; i++) {
+            const FactoryDeviceRecord &record = chunkRecords[i];
+            const uint8_t *image = reinterpret_cast<const uint8_t *>(&chunkImages[i]);
+            bool written;
+            if (hex) {
+                char path[4096];
+                snprintf(path, sizeof(path), "%s/%012llx.hex", imagesPath, (unsigned long long)record.instance);
+                written = writeIntelHex(path, hexAddress, image, sizeof(PersistentParams_t));
+            } else {
+                memcpy(&page[0], image, sizeof(PersistentParams_t));
+                written = fwrite(&page[0], pageSize, 1, images) == 1;
+            }
+            if (!written) {
+                fprintf(stderr, "Cannot write the image of device %llu\n", (unsigned long long)(first + i));
+                return 1;
+            }
+
+            char line[64 + MAX_ADV_SLOTS * 48];
+            uint8_t instance[UID_INSTANCEID_SIZE];
+            for (size_t j = 0; j < UID_INSTANCEID_SIZE; j++) {
+                instance[j] = (uint8_t)(record.instance >> (8 * (UID_INSTANCEID_SIZE - 1 - j)));
+            }
+            char *end = appendHex(line, instance, sizeof(instance));
+            *end++ = ',';
+            end = appendHex(end, record.unlockKey, sizeof(Lock_t));
+            for (int slot = 0; slot < MAX_ADV_SLOTS; slot++) {
+                if (config.slotFrameTypes[slot] == EddystoneFrameTypes::EDDYSTONE_FRAME_EID) {
+                    end += sprintf(end, ",%d,", slot);
+                    end = appendHex(end, record.slotEidIdentityKeys[slot], sizeof(EidIdentityKey_t));
+                    end += sprintf(end, ",%u", config.slotEidRotationPeriodExps[slot]);
+                }
+            }
+            *end++ = '\n';
+            fwrite(line, 1, end - line, records);
+            memset(line, 0, sizeof(line));
+        }
+        memset(&chunkImages[0], 0, chunkImages.size() * sizeof(chunkImages[0]));
+        memset(&chunkRecords[0], 0, chunkRecords.size() * sizeof(chunkRecords[0]));
+    }
+    bool closed = (!images || fclose(images) == 0) & (fclose(records) == 0);
+    double totalSecs = secondsSince(start);
+    if (!closed) {
+        fprintf(stderr, "Cannot write %s\n", imagesPath);
+        return 1;
+    }
+
+    printf("%llu images of %zu bytes (%s)\n", (unsigned long long)numDevices, sizeof(PersistentParams_t),
+           hex ? "Intel HEX" : "flash pages");
+    printf("generate:  %9.3f s (%.0f images/s)\n", generateSecs, numDevices / generateSecs);
+    printf("total:     %9.3f s (%.0f images/s) with the writes\n", totalSecs, numDevices / totalSecs);
+    return 0;
+}
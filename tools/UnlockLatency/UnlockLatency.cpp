@@ -0,0 +1,274 @@
+/*
+ * Copyright (c) 2016, Google Inc, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Host stub of the beacon side of the unlock round trip: the read of the
+ * unlock characteristic (readUnlockAuthorizationCallback()), then the write
+ * of the token (writeUnlockAuthorizationCallback() and the unlock branch of
+ * onDataWrittenCallback()). The callbacks are mirrored on the firmware's
+ * AesKeyCache, DrbgService and UnlockChallenge, built as they are; the
+ * event queue is a list of posted tasks run in the idle time after each
+ * callback, while the radio and the client take their turn (or never, for
+ * a client that comes back at once).
+ *
+ * Two ways of producing the challenge and token are compared: in the
+ * callbacks, as the firmware used to, and prepared in idle time by
+ * UnlockChallenge, as it does now. For each the time spent in the read
+ * callback and in the write callbacks is reported (median, 99th percentile,
+ * worst), with the idle time work per round trip.
+ *
+ * Usage: UnlockLatency [roundTrips]
+ */
+
+#include "UnlockChallenge.h"
+#include "AesKeyCache.h"
+#include "DrbgService.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+const uint8_t UNLOCK_KEY[16] = {
+    0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99, 0xAA, 0xBB, 0xCC, 0xDD, 0xEE, 0xFF
+};
+
+/* The unlock state of EddystoneService, with its callbacks */
+class BeaconStub
+{
+public:
+    explicit BeaconStub(bool prepared) :
+        prepared(prepared),
+        locked(true),
+        refillPosted(false),
+        challengePosted(false)
+    {
+        memset(challenge, 0, sizeof(challenge));
+        memset(unlockToken, 0, sizeof(unlockToken));
+        /* startEddystoneConfigService() */
+        if (prepared) {
+            scheduleUnlockChallenge();
+        }
+    }
+
+    /* readUnlockAuthorizationCallback(): the challenge the client reads */
+    void readUnlock(uint8_t value[16])
+    {
+        nextChallenge();
+        memcpy(value, challenge, sizeof(challenge));
+    }
+
+    /* writeUnlockAuthorizationCallback(), then onDataWrittenCallback() */
+    bool writeUnlock(const uint8_t token[16])
+    {
+        if (!locked || memcmp(token, unlockToken, sizeof(unlockToken)) != 0) {
+            return false;
+        }
+        locked = false;
+        nextChallenge();
+        return true;
+    }
+
+    /* The client locks the beacon again (not timed) */
+    void relock(void) { locked = true; }
+
+    /* Run the posted tasks, as the event queue does when the beacon is idle */
+    void idle(void)
+    {
+        if (challengePosted) {
+            challengePosted = false;
+            prepareUnlockChallenge();
+        }
+        if (refillPosted) {
+            refillPosted = false;
+            drbg.refill();
+        }
+    }
+
+private:
+    void nextChallenge(void)
+    {
+        if (prepared) {
+            /* nextUnlockChallenge() */
+            if (!unlockChallenge.isReady()) {
+                prepareUnlockChallenge();
+            }
+            unlockChallenge.take(challenge, unlockToken);
+            scheduleUnlockChallenge();
+        } else {
+            /* The former generateRandom() and aes128Encrypt() in the callbacks */
+            drbg.random(challenge, sizeof(challenge));
+            scheduleRandomPoolRefill();
+            Aes128Backend::encrypt(aesKeyCache.get(AesKeyCache::UNLOCK_ENCRYPT_ENTRY, UNLOCK_KEY, MBEDTLS_AES_ENCRYPT),
+                                   challenge, unlockToken);
+        }
+    }
+
+    void prepareUnlockChallenge(void)
+    {
+        if (unlockChallenge.isReady()) {
+            return;
+        }
+        uint8_t random[16];
+        drbg.random(random, sizeof(random));
+        scheduleRandomPoolRefill();
+        unlockChallenge.prepare(random, aesKeyCache.get(AesKeyCache::UNLOCK_ENCRYPT_ENTRY, UNLOCK_KEY, MBEDTLS_AES_ENCRYPT));
+    }
+
+    void scheduleUnlockChallenge(void)
+    {
+        if (!unlockChallenge.isReady()) {
+            challengePosted = true;
+        }
+    }
+
+    void scheduleRandomPoolRefill(void)
+    {
+        if (drbg.isPoolLow()) {
+            refillPosted = true;
+        }
+    }
+
+    bool            prepared;
+    bool            locked;
+    bool            refillPosted;
+    bool            challengePosted;
+    uint8_t         challenge[16];
+    uint8_t         unlockToken[16];
+    DrbgService     drbg;
+    AesKeyCache     aesKeyCache;
+    UnlockChallenge unlockChallenge;
+};
+
+struct Latencies {
+    std::vector<double> read;
+    std::vector<double> write;
+    std::vector<double> idle;
+    unsigned            failures;
+};
+
+double nsSince(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+}
+
+Latencies run(bool prepared, bool idleBetween, int roundTrips)
+{
+    BeaconStub beacon(prepared);
+    Aes128Context clientKey;
+    Aes128Backend::init(&clientKey);
+    Aes128Backend::setKeyEnc(&clientKey, UNLOCK_KEY);
+
+    Latencies l;
+    l.failures = 0;
+    beacon.idle();
+    for (int i = 0; i < roundTrips; i++) {
+        uint8_t value[16];
+        uint8_t token[16];
+
+        Clock::time_point start = Clock::now();
+        beacon.readUnlock(value);
+        l.read.push_back(nsSince(start));
+
+        double idleNs = 0;
+        if (idleBetween) {
+            start = Clock::now();
+            beacon.idle();
+            idleNs += nsSince(start);
+        }
+
+        Aes128Backend::encrypt(&clientKey, value, token);
+
+        start = Clock::now();
+        if (!beacon.writeUnlock(token)) {
+            l.failures++;
+        }
+        l.write.push_back(nsSince(start));
+        beacon.relock();
+
+        if (idleBetween) {
+            start = Clock::now();
+            beacon.idle();
+            idleNs += nsSince(start);
+            l.idle.push_back(idleNs);
+        }
+    }
+    Aes128Backend::free(&clientKey);
+    return l;
+}
+
+double percentile(std::vector<double> v, double p)
+{
+    if (v.empty()) {
+        return 0;
+    }
+    std::sort(v.begin(), v.end());
+    return v[std::min(v.size() - 1, (size_t)(p * v.size()))];
+}
+
+double mean(const std::vector<double> &v)
+{
+    double sum = 0;
+    for (size_t i = 0; i < v.size(); i++) {
+        sum += v[i];
+    }
+    return v.empty() ? 0 : sum / v.size();
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    int roundTrips = (argc > 1) ? atoi(argv[1]) : 10000;
+    if (roundTrips <= 0) {
+        fprintf(stderr, "Usage: %s [roundTrips]\n", argv[0]);
+        return 1;
+    }
+
+    printf("AES-128 backend: %s, %d round trips, ns per callback\n", Aes128Backend::getName(), roundTrips);
+    printf("%-28s %9s %9s %9s   %9s %9s %9s   %9s\n", "", "read p50", "p99", "max",
+           "write p50", "p99", "max", "idle mean");
+    static const struct {
+        const char *name;
+        bool        prepared;
+        bool        idleBetween;
+    } modes[] = {
+        { "in the callbacks",           false, true  },
+        { "prepared in idle time",      true,  true  },
+        { "in the callbacks, no idle",  false, false },
+        { "prepared, no idle",          true,  false },
+    };
+    unsigned failures = 0;
+    for (size_t m = 0; m < sizeof(modes) / sizeof(modes[0]); m++) {
+        Latencies l = run(modes[m].prepared, modes[m].idleBetween, roundTrips);
+        printf("%-28s %9.0f %9.0f %9.0f   %9.0f %9.0f %9.0f   %9.0f\n", modes[m].name,
+               percentile(l.read, 0.5), percentile(l.read, 0.99), percentile(l.read, 1.0),
+               percentile(l.write, 0.5), percentile(l.write, 0.99), percentile(l.write, 1.0), mean(l.idle));
+        failures += l.failures;
+    }
+    if (failures != 0) {
+        printf("%u unlocks rejected\n", failures);
+        return 2;
+    }
+    return 0;
+}
@@ -0,0 +1,555 @@
+/*
+ * Copyright (c) 2016, Google Inc, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Aes128Batch.h"
+#include "HostAes128.h"
+
+#include <string.h>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define AES128_BATCH_HAVE_AESNI
+#include <emmintrin.h>
+#include <tmmintrin.h>
+#include <wmmintrin.h>
+#define AESNI_TARGET __attribute__((target("aes,ssse3")))
+#endif
+
+namespace {
+
+/*
+ * Bitsliced backend. Bit j of a Slice belongs to lane (block) j; a state
+ * is 16 bytes x 8 bits of slices, in FIPS-197 byte order.
+ */
+typedef uint64_t Slice;
+const unsigned SLICE_LANES = 64;
+
+typedef Slice SlicedBytes[16][8];
+
+/* Transpose an 8x8 bit matrix held in a word, row r in byte r */
+inline uint64_t transpose8x8(uint64_t x)
+{
+    uint64_t t;
+    t = (x ^ (x >> 7)) & 0x00AA00AA00AA00AAull;
+    x ^= t ^ (t << 7);
+    t = (x ^ (x >> 14)) & 0x0000CCCC0000CCCCull;
+    x ^= t ^ (t << 14);
+    t = (x ^ (x >> 28)) & 0x00000000F0F0F0F0ull;
+    x ^= t ^ (t << 28);
+    return x;
+}
+
+/* Bitslice byte p of 64 blocks (or round keys), one pointer per lane */
+void slice(const uint8_t *const *blocks, SlicedBytes &w)
+{
+    for (unsigned p = 0; p < 16; p++) {
+        for (unsigned b = 0; b < 8; b++) {
+            w[p][b] = 0;
+        }
+        for (unsigned g = 0; g < SLICE_LANES / 8; g++) {
+            uint64_t x = 0;
+            for (unsigned k = 0; k < 8; k++) {
+                x |= (uint64_t)blocks[8 * g + k][p] << (8 * k);
+            }
+            x = transpose8x8(x);
+            for (unsigned b = 0; b < 8; b++) {
+                w[p][b] |= ((x >> (8 * b)) & 0xFF) << (8 * g);
+            }
+        }
+    }
+}
+
+void unslice(const SlicedBytes &w, uint8_t *const *blocks)
+{
+    for (unsigned p = 0; p < 16; p++) {
+        for (unsigned g = 0; g < SLICE_LANES / 8; g++) {
+            uint64_t x = 0;
+            for (unsigned b = 0; b < 8; b++) {
+                x |= ((w[p][b] >> (8 * g)) & 0xFF) << (8 * b);
+            }
+            x = transpose8x8(x);
+            for (unsigned k = 0; k < 8; k++) {
+                blocks[8 * g + k][p] = (uint8_t)(x >> (8 * k));
+            }
+        }
+    }
+}
+
+/* The AES S-box as a circuit (Boyar and Peralta), q[b] is bit b of the byte */
+void sliceSbox(Slice *q)
+{
+    Slice x0 = q[7], x1 = q[6], x2 = q[5], x3 = q[4], x4 = q[3], x5 = q[2], x6 = q[1], x7 = q[0];
+
+    /* Top linear transformation */
+    Slice y14 = x3 ^ x5;
+    Slice y13 = x0 ^ x6;
+    Slice y9 = x0 ^ x3;
+    Slice y8 = x0 ^ x5;
+    Slice t0 = x1 ^ x2;
+    Slice y1 = t0 ^ x7;
+    Slice y4 = y1 ^ x3;
+    Slice y12 = y13 ^ y14;
+    Slice y2 = y1 ^ x0;
+    Slice y5 = y1 ^ x6;
+    Slice y3 = y5 ^ y8;
+    Slice t1 = x4 ^ y12;
+    Slice y15 = t1 ^ x5;
+    Slice y20 = t1 ^ x1;
+    Slice y6 = y15 ^ x7;
+    Slice y10 = y15 ^ t0;
+    Slice y11 = y20 ^ y9;
+    Slice y7 = x7 ^ y11;
+    Slice y17 = y10 ^ y11;
+    Slice y19 = y10 ^ y8;
+    Slice y16 = t0 ^ y11;
+    Slice y21 = y13 ^ y16;
+    Slice y18 = x0 ^ y16;
+
+    /* Non-linear section */
+    Slice t2 = y12 & y15;
+    Slice t3 = y3 & y6;
+    Slice t4 = t3 ^ t2;
+    Slice t5 = y4 & x7;
+    Slice t6 = t5 ^ t2;
+    Slice t7 = y13 & y16;
+    Slice t8 = y5 & y1;
+    Slice t9 = t8 ^ t7;
+    Slice t10 = y2 & y7;
+    Slice t11 = t10 ^ t7;
+    Slice t12 = y9 & y11;
+    Slice t13 = y14 & y17;
+    Slice t14 = t13 ^ t12;
+    Slice t15 = y8 & y10;
+    Slice t16 = t15 ^ t12;
+    Slice t17 = t4 ^ t14;
+    Slice t18 = t6 ^ t16;
+    Slice t19 = t9 ^ t14;
+    Slice t20 = t11 ^ t16;
+    Slice t21 = t17 ^ y20;
+    Slice t22 = t18 ^ y19;
+    Slice t23 = t19 ^ y21;
+    Slice t24 = t20 ^ y18;
+    Slice t25 = t21 ^ t22;
+    Slice t26 = t21 & t23;
+    Slice t27 = t24 ^ t26;
+    Slice t28 = t25 & t27;
+    Slice t29 = t28 ^ t22;
+    Slice t30 = t23 ^ t24;
+    Slice t31 = t22 ^ t26;
+    Slice t32 = t31 & t30;
+    Slice t33 = t32 ^ t24;
+    Slice t34 = t23 ^ t33;
+    Slice t35 = t27 ^ t33;
+    Slice t36 = t24 & t35;
+    Slice t37 = t36 ^ t34;
+    Slice t38 = t27 ^ t36;
+    Slice t39 = t29 & t38;
+    Slice t40 = t25 ^ t39;
+    Slice t41 = t40 ^ t37;
+    Slice t42 = t29 ^ t33;
+    Slice t43 = t29 ^ t40;
+    Slice t44 = t33 ^ t37;
+    Slice t45 = t42 ^ t41;
+    Slice z0 = t44 & y15;
+    Slice z1 = t37 & y6;
+    Slice z2 = t33 & x7;
+    Slice z3 = t43 & y16;
+    Slice z4 = t40 & y1;
+    Slice z5 = t29 & y7;
+    Slice z6 = t42 & y11;
+    Slice z7 = t45 & y17;
+    Slice z8 = t41 & y10;
+    Slice z9 = t44 & y12;
+    Slice z10 = t37 & y3;
+    Slice z11 = t33 & y4;
+    Slice z12 = t43 & y13;
+    Slice z13 = t40 & y5;
+    Slice z14 = t29 & y2;
+    Slice z15 = t42 & y9;
+    Slice z16 = t45 & y14;
+    Slice z17 = t41 & y8;
+
+    /* Bottom linear transformation */
+    Slice t46 = z15 ^ z16;
+    Slice t47 = z10 ^ z11;
+    Slice t48 = z5 ^ z13;
+    Slice t49 = z9 ^ z10;
+    Slice t50 = z2 ^ z12;
+    Slice t51 = z2 ^ z5;
+    Slice t52 = z7 ^ z8;
+    Slice t53 = z0 ^ z3;
+    Slice t54 = z6 ^ z7;
+    Slice t55 = z16 ^ z17;
+    Slice t56 = z12 ^ t48;
+    Slice t57 = t50 ^ t53;
+    Slice t58 = z4 ^ t46;
+    Slice t59 = z3 ^ t54;
+    Slice t60 = t46 ^ t57;
+    Slice t61 = z14 ^ t57;
+    Slice t62 = t52 ^ t58;
+    Slice t63 = t49 ^ t58;
+    Slice t64 = z4 ^ t59;
+    Slice t65 = t61 ^ t62;
+    Slice t66 = z1 ^ t63;
+    Slice s0 = t59 ^ t63;
+    Slice s6 = t56 ^ ~t62;
+    Slice s7 = t48 ^ ~t60;
+    Slice t67 = t64 ^ t65;
+    Slice s3 = t53 ^ t66;
+    Slice s4 = t51 ^ t66;
+    Slice s5 = t47 ^ t65;
+    Slice s1 = t64 ^ ~s3;
+    Slice s2 = t55 ^ ~t67;
+
+    q[7] = s0;
+    q[6] = s1;
+    q[5] = s2;
+    q[4] = s3;
+    q[3] = s4;
+    q[2] = s5;
+    q[1] = s6;
+    q[0] = s7;
+}
+
+void sliceAddRoundKey(SlicedBytes &s, const SlicedBytes &k)
+{
+    for (unsigned p = 0; p < 16; p++) {
+        for (unsigned b = 0; b < 8; b++) {
+            s[p][b] ^= k[p][b];
+        }
+    }
+}
+
+/* SubBytes then ShiftRows: byte r + 4c takes byte r + 4((c + r) % 4) */
+void sliceSubShift(SlicedBytes &s)
+{
+    SlicedBytes t;
+    for (unsigned p = 0; p < 16; p++) {
+        sliceSbox(s[p]);
+    }
+    memcpy(t, s, sizeof(t));
+    for (unsigned r = 0; r < 4; r++) {
+        for (unsigned c = 0; c < 4; c++) {
+            memcpy(s[r + 4 * c], t[r + 4 * ((c + r) % 4)], sizeof(s[0]));
+        }
+    }
+}
+
+/* b_r = 2(a_r ^ a_r+1) ^ a_r+1 ^ a_r+2 ^ a_r+3 */
+void sliceMixColumns(SlicedBytes &s)
+{
+    for (unsigned c = 0; c < 4; c++) {
+        Slice a[4][8];
+        memcpy(a, s[4 * c], sizeof(a));
+        for (unsigned r = 0; r < 4; r++) {
+            const Slice *a0 = a[r], *a1 = a[(r + 1) % 4], *a2 = a[(r + 2) % 4], *a3 = a[(r + 3) % 4];
+            Slice t[8];
+            for (unsigned b = 0; b < 8; b++) {
+                t[b] = a0[b] ^ a1[b];
+            }
+            Slice x[8] = { t[7], t[0] ^ t[7], t[1], t[2] ^ t[7], t[3] ^ t[7], t[4], t[5], t[6] };
+            for (unsigned b = 0; b < 8; b++) {
+                s[4 * c + r][b] = x[b] ^ a1[b] ^ a2[b] ^ a3[b];
+            }
+        }
+    }
+}
+
+/* Advance a bitsliced round key to the next round */
+void sliceNextRoundKey(SlicedBytes &k, uint8_t rcon)
+{
+    Slice t[4][8];
+    memcpy(t[0], k[13], sizeof(t[0]));
+    memcpy(t[1], k[14], sizeof(t[0]));
+    memcpy(t[2], k[15], sizeof(t[0]));
+    memcpy(t[3], k[12], sizeof(t[0]));
+    for (unsigned i = 0; i < 4; i++) {
+        sliceSbox(t[i]);
+    }
+    for (unsigned b = 0; b < 8; b++) {
+        if (rcon & (1 << b)) {
+            t[0][b] = ~t[0][b];
+        }
+    }
+    for (unsigned p = 0; p < 16; p++) {
+        const Slice *prev = (p < 4) ? t[p] : k[p - 4];
+        for (unsigned b = 0; b < 8; b++) {
+            k[p][b] ^= prev[b];
+        }
+    }
+}
+
+const uint8_t rcons[10] = { 0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80, 0x1B, 0x36 };
+
+/* 64 lanes; either raw keys (expanded on the fly) or expanded keys */
+void bitslicedEncrypt64(const uint8_t *const *keys, const Aes128Batch::Key *const *expanded,
+                        const uint8_t *const *in, uint8_t *const *out)
+{
+    SlicedBytes s, k;
+    const uint8_t *roundKeys[SLICE_LANES];
+
+    slice(in, s);
+    if (keys) {
+        slice(keys, k);
+    } else {
+        for (unsigned j = 0; j < SLICE_LANES; j++) {
+            roundKeys[j] = expanded[j]->roundKeys[0];
+        }
+        slice(roundKeys, k);
+    }
+    sliceAddRoundKey(s, k);
+    for (unsigned round = 1; round <= 10; round++) {
+        sliceSubShift(s);
+        if (round < 10) {
+            sliceMixColumns(s);
+        }
+        if (keys) {
+            sliceNextRoundKey(k, rcons[round - 1]);
+        } else {
+            for (unsigned j = 0; j < SLICE_LANES; j++) {
+                roundKeys[j] = expanded[j]->roundKeys[round];
+            }
+            slice(roundKeys, k);
+        }
+        sliceAddRoundKey(s, k);
+    }
+    unslice(s, out);
+}
+
+/* Feed n <= 64 blocks to the bitsliced core, padding the unused lanes */
+void bitslicedEncrypt(const uint8_t *keys, const Aes128Batch::Key *const *expanded,
+                      const uint8_t *in, uint8_t *out, size_t n)
+{
+    static const uint8_t zero[16] = { 0 };
+    static const Aes128Batch::Key zeroKey = {};
+    uint8_t scratch[16];
+    const uint8_t *keyPtrs[SLICE_LANES];
+    const Aes128Batch::Key *expandedPtrs[SLICE_LANES];
+    const uint8_t *inPtrs[SLICE_LANES];
+    uint8_t *outPtrs[SLICE_LANES];
+
+    for (size_t done = 0; done < n; done += SLICE_LANES) {
+        for (unsigned j = 0; j < SLICE_LANES; j++) {
+            size_t i = done + j;
+            bool used = i < n;
+            keyPtrs[j] = (keys && used) ? keys + 16 * i : zero;
+            expandedPtrs[j] = (expanded && used) ? expanded[i] : &zeroKey;
+            inPtrs[j] = used ? in + 16 * i : zero;
+            outPtrs[j] = used ? out + 16 * i : scratch;
+        }
+        bitslicedEncrypt64(keys ? keyPtrs : NULL, expandedPtrs, inPtrs, outPtrs);
+    }
+}
+
+#ifdef AES128_BATCH_HAVE_AESNI
+
+/*
+ * aeskeygenassist is microcoded on most cores and would dominate when every
+ * block has its own key. SubWord(RotWord(w3)) ^ rcon is computed with
+ * aesenclast instead: with w3 rotated into every column, ShiftRows is a no-op
+ * and each column gets the result.
+ */
+AESNI_TARGET inline __m128i aesniNextRoundKey(__m128i key, uint8_t rcon)
+{
+    const __m128i rotWord = _mm_set_epi8(12, 15, 14, 13, 12, 15, 14, 13, 12, 15, 14, 13, 12, 15, 14, 13);
+    __m128i t = _mm_aesenclast_si128(_mm_shuffle_epi8(key, rotWord), _mm_set1_epi32(rcon));
+    key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+    key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+    key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+    return _mm_xor_si128(key, t);
+}
+
+/*
+ * The lanes are written out so they stay in registers, which is what hides
+ * the aesenc latency.
+ */
+const unsigned AESNI_LANES = 8;
+#define AESNI_FOR_LANES(X, arg) X(0, arg) X(1, arg) X(2, arg) X(3, arg) X(4, arg) X(5, arg) X(6, arg) X(7, arg)
+
+#define AESNI_LOAD_KEY_LANE(i, unused)                                                  \
+    k[i] = _mm_loadu_si128((const __m128i *)(keys + 16 * i));                           \
+    s[i] = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(in + 16 * i)), k[i]);
+#define AESNI_EXPAND_LANE(i, rcon)                                                      \
+    k[i] = aesniNextRoundKey(k[i], rcon);                                               \
+    s[i] = _mm_aesenc_si128(s[i], k[i]);
+#define AESNI_EXPAND_LAST_LANE(i, rcon)                                                 \
+    k[i] = aesniNextRoundKey(k[i], rcon);                                               \
+    s[i] = _mm_aesenclast_si128(s[i], k[i]);
+#define AESNI_STORE_LANE(i, unused)                                                     \
+    _mm_storeu_si128((__m128i *)(out + 16 * i), s[i]);
+
+/* 8 blocks interleaved, keys expanded in the same pipeline */
+AESNI_TARGET void aesniEncryptWithKeys8(const uint8_t *keys, const uint8_t *in, uint8_t *out)
+{
+    __m128i k[AESNI_LANES], s[AESNI_LANES];
+    AESNI_FOR_LANES(AESNI_LOAD_KEY_LANE, 0)
+    AESNI_FOR_LANES(AESNI_EXPAND_LANE, 0x01)
+    AESNI_FOR_LANES(AESNI_EXPAND_LANE, 0x02)
+    AESNI_FOR_LANES(AESNI_EXPAND_LANE, 0x04)
+    AESNI_FOR_LANES(AESNI_EXPAND_LANE, 0x08)
+    AESNI_FOR_LANES(AESNI_EXPAND_LANE, 0x10)
+    AESNI_FOR_LANES(AESNI_EXPAND_LANE, 0x20)
+    AESNI_FOR_LANES(AESNI_EXPAND_LANE, 0x40)
+    AESNI_FOR_LANES(AESNI_EXPAND_LANE, 0x80)
+    AESNI_FOR_LANES(AESNI_EXPAND_LANE, 0x1B)
+    AESNI_FOR_LANES(AESNI_EXPAND_LAST_LANE, 0x36)
+    AESNI_FOR_LANES(AESNI_STORE_LANE, 0)
+}
+
+#define AESNI_LOAD_LANE(i, unused)                                                      \
+    s[i] = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(in + 16 * i)),               \
+                         _mm_loadu_si128((const __m128i *)keys[i]->roundKeys[0]));
+#define AESNI_ROUND_LANE(i, round)                                                      \
+    s[i] = _mm_aesenc_si128(s[i], _mm_loadu_si128((const __m128i *)keys[i]->roundKeys[round]));
+#define AESNI_LAST_ROUND_LANE(i, unused)                                                \
+    s[i] = _mm_aesenclast_si128(s[i], _mm_loadu_si128((const __m128i *)keys[i]->roundKeys[10]));
+
+AESNI_TARGET void aesniEncrypt8(const Aes128Batch::Key *const *keys, const uint8_t *in, uint8_t *out)
+{
+    __m128i s[AESNI_LANES];
+    AESNI_FOR_LANES(AESNI_LOAD_LANE, 0)
+    for (unsigned round = 1; round < 10; round++) {
+        AESNI_FOR_LANES(AESNI_ROUND_LANE, round)
+    }
+    AESNI_FOR_LANES(AESNI_LAST_ROUND_LANE, 0)
+    AESNI_FOR_LANES(AESNI_STORE_LANE, 0)
+}
+
+AESNI_TARGET void aesniExpandKey(const uint8_t *key, Aes128Batch::Key &expanded)
+{
+    __m128i k = _mm_loadu_si128((const __m128i *)key);
+    _mm_storeu_si128((__m128i *)expanded.roundKeys[0], k);
+#define AESNI_STORE_ROUND(round, rcon)                                                  \
+    k = aesniNextRoundKey(k, rcon);                                                     \
+    _mm_storeu_si128((__m128i *)expanded.roundKeys[round], k);
+    AESNI_STORE_ROUND(1, 0x01)
+    AESNI_STORE_ROUND(2, 0x02)
+    AESNI_STORE_ROUND(3, 0x04)
+    AESNI_STORE_ROUND(4, 0x08)
+    AESNI_STORE_ROUND(5, 0x10)
+    AESNI_STORE_ROUND(6, 0x20)
+    AESNI_STORE_ROUND(7, 0x40)
+    AESNI_STORE_ROUND(8, 0x80)
+    AESNI_STORE_ROUND(9, 0x1B)
+    AESNI_STORE_ROUND(10, 0x36)
+#undef AESNI_STORE_ROUND
+}
+
+bool cpuHasAesni(void)
+{
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("aes");
+}
+
+#else
+
+bool cpuHasAesni(void)
+{
+    return false;
+}
+
+#endif // AES128_BATCH_HAVE_AESNI
+
+Aes128Batch::Backend backend = cpuHasAesni() ? Aes128Batch::BACKEND_AESNI : Aes128Batch::BACKEND_BITSLICED;
+
+} // namespace
+
+void Aes128Batch::encryptWithKeys(const uint8_t *keys, const uint8_t *in, uint8_t *out, size_t n)
+{
+#ifdef AES128_BATCH_HAVE_AESNI
+    if (backend == BACKEND_AESNI) {
+        size_t i = 0;
+        for (; i + AESNI_LANES <= n; i += AESNI_LANES) {
+            aesniEncryptWithKeys8(keys + 16 * i, in + 16 * i, out + 16 * i);
+        }
+        if (i < n) {
+            /* Pad the last group */
+            uint8_t tailKeys[16 * AESNI_LANES] = { 0 };
+            uint8_t tail[16 * AESNI_LANES] = { 0 };
+            memcpy(tailKeys, keys + 16 * i, 16 * (n - i));
+            memcpy(tail, in + 16 * i, 16 * (n - i));
+            aesniEncryptWithKeys8(tailKeys, tail, tail);
+            memcpy(out + 16 * i, tail, 16 * (n - i));
+        }
+        return;
+    }
+#endif
+    bitslicedEncrypt(keys, NULL, in, out, n);
+}
+
+void Aes128Batch::expandKeys(const uint8_t *keys, Key *expanded, size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+#ifdef AES128_BATCH_HAVE_AESNI
+        if (backend == BACKEND_AESNI) {
+            aesniExpandKey(keys + 16 * i, expanded[i]);
+            continue;
+        }
+#endif
+        HostAes128 aes(keys + 16 * i);
+        const uint32_t *rk = aes.roundKeys();
+        for (unsigned w = 0; w < 44; w++) {
+            uint8_t *p = &expanded[i].roundKeys[w / 4][4 * (w % 4)];
+            p[0] = rk[w] >> 24;
+            p[1] = rk[w] >> 16;
+            p[2] = rk[w] >> 8;
+            p[3] = rk[w];
+        }
+    }
+}
+
+void Aes128Batch::encrypt(const Key *const *keys, const uint8_t *in, uint8_t *out, size_t n)
+{
+#ifdef AES128_BATCH_HAVE_AESNI
+    if (backend == BACKEND_AESNI) {
+        size_t i = 0;
+        for (; i + AESNI_LANES <= n; i += AESNI_LANES) {
+            aesniEncrypt8(keys + i, in + 16 * i, out + 16 * i);
+        }
+        if (i < n) {
+            const Key *tailKeys[AESNI_LANES];
+            uint8_t tail[16 * AESNI_LANES] = { 0 };
+            for (unsigned j = 0; j < AESNI_LANES; j++) {
+                tailKeys[j] = keys[(i + j < n) ? i + j : i];
+            }
+            memcpy(tail, in + 16 * i, 16 * (n - i));
+            aesniEncrypt8(tailKeys, tail, tail);
+            memcpy(out + 16 * i, tail, 16 * (n - i));
+        }
+        return;
+    }
+#endif
+    bitslicedEncrypt(NULL, keys, in, out, n);
+}
+
+Aes128Batch::Backend Aes128Batch::getBackend(void)
+{
+    return backend;
+}
+
+bool Aes128Batch::setBackend(Backend newBackend)
+{
+    if (newBackend == BACKEND_AESNI && !cpuHasAesni()) {
+        return false;
+    }
+    backend = newBackend;
+    return true;
+}
+
+const char *Aes128Batch::getBackendName(Backend which)
+{
+    return (which == BACKEND_AESNI) ? "AES-NI" : "bitsliced";
+}
@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) 2016, Google Inc, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __AES128_BATCH_H__
+#define __AES128_BATCH_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * AES-128 encryption of many independent blocks, each under its own key,
+ * for the host tools. An EID or an ETLM frame is only a few dependent AES
+ * blocks, so the speed comes from running many of them side by side:
+ *
+ * - BACKEND_AESNI (x86 with AES-NI, picked at run time) runs 8 blocks
+ *   interleaved so the aesenc latency is hidden, expanding the keys with
+ *   aeskeygenassist in the same pipeline.
+ * - BACKEND_BITSLICED is portable and constant time: 64 blocks are
+ *   transposed into 128 64-bit words (one word per state bit) and every
+ *   round, key schedule included, is boolean logic on those words. As the
+ *   round keys are bitsliced too, each lane has its own key at no cost.
+ *
+ * Both produce exactly the blocks HostAes128 produces.
+ */
+class Aes128Batch
+{
+public:
+    enum Backend {
+        BACKEND_AESNI,
+        BACKEND_BITSLICED
+    };
+
+    /**
+     * Expanded key for encrypt(): 11 round keys in FIPS-197 byte order.
+     */
+    struct Key {
+        uint8_t roundKeys[11][16];
+    };
+
+    /**
+     * Encrypt @p n blocks, block i under key i. The keys are expanded on
+     * the fly, which is the cheapest when each key is used once (EID
+     * temporary keys and EIDs).
+     *
+     * @param[in] keys
+     *              n keys of 16 bytes.
+     * @param[in] in
+     *              n blocks of 16 bytes.
+     * @param[out] out
+     *              n blocks of 16 bytes, may be @p in.
+     * @param[in] n
+     *              The number of blocks.
+     */
+    static void encryptWithKeys(const uint8_t *keys, const uint8_t *in, uint8_t *out, size_t n);
+
+    /**
+     * Expand @p n keys for encrypt().
+     */
+    static void expandKeys(const uint8_t *keys, Key *expanded, size_t n);
+
+    /**
+     * Encrypt @p n blocks, block i under the expanded key keys[i] (several
+     * blocks may share a key, as the EAX blocks of one ETLM frame do).
+     */
+    static void encrypt(const Key *const *keys, const uint8_t *in, uint8_t *out, size_t n);
+
+    /**
+     * The backend in use: AES-NI when the CPU has it, unless overridden.
+     */
+    static Backend getBackend(void);
+
+    /**
+     * Force a backend, e.g. to compare them.
+     *
+     * @return false if the CPU does not support @p backend.
+     */
+    static bool setBackend(Backend backend);
+
+    static const char *getBackendName(Backend backend);
+};
+
+#endif // __AES128_BATCH_H__
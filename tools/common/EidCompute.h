@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) 2016, Google Inc, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __EID_COMPUTE_H__
+#define __EID_COMPUTE_H__
+
+#include <stdint.h>
+#include "HostAes128.h"
+
+/**
+ * Host side EID computation, block for block the same as
+ * EIDFrame::genTemporaryKey() and EIDFrame::updateFromTemporaryKey().
+ * An EID is returned as a 64-bit integer whose most significant byte is
+ * the first EID byte of the frame.
+ */
+
+/**
+ * Salt of the temporary key block (EIDFrame::SALT).
+ */
+static const uint8_t EID_TEMP_KEY_SALT = 0xFF;
+
+/**
+ * Build the block encrypted under the identity key to derive the temporary
+ * key, which changes every 2^16 seconds (only the top 16 bits of
+ * @p timeSecs are used).
+ */
+inline void eidTemporaryKeyBlock(uint32_t timeSecs, uint8_t block[16])
+{
+    const uint8_t ds1[16] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, EID_TEMP_KEY_SALT, 0, 0,
+                              (uint8_t)(timeSecs >> 24), (uint8_t)(timeSecs >> 16) };
+    for (int i = 0; i < 16; i++) {
+        block[i] = ds1[i];
+    }
+}
+
+/**
+ * Build the block encrypted under the temporary key to get the EID of the
+ * rotation window (2^K seconds) that contains @p timeSecs.
+ */
+inline void eidBlock(uint8_t rotationPeriodExp, uint32_t timeSecs, uint8_t block[16])
+{
+    uint32_t scaledTime = (timeSecs >> rotationPeriodExp) << rotationPeriodExp;
+    const uint8_t ds2[16] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, rotationPeriodExp,
+                              (uint8_t)(scaledTime >> 24), (uint8_t)(scaledTime >> 16),
+                              (uint8_t)(scaledTime >> 8), (uint8_t)scaledTime };
+    for (int i = 0; i < 16; i++) {
+        block[i] = ds2[i];
+    }
+}
+
+/**
+ * The EID is the first 8 bytes of the encrypted eidBlock().
+ */
+inline uint64_t eidFromEncryptedBlock(const uint8_t encrypted[16])
+{
+    uint64_t value = 0;
+    for (int i = 0; i < 8; i++) {
+        value = (value << 8) | encrypted[i];
+    }
+    return value;
+}
+
+/**
+ * Derive the temporary key.
+ *
+ * @param[in] identityKey
+ *              The beacon's identity key, expanded.
+ * @param[in] timeSecs
+ *              Beacon time.
+ * @param[out] tmpKey
+ *              The temporary key.
+ */
+inline void eidTemporaryKey(const HostAes128 &identityKey, uint32_t timeSecs, uint8_t tmpKey[16])
+{
+    uint8_t block[16];
+    eidTemporaryKeyBlock(timeSecs, block);
+    identityKey.encrypt(block, tmpKey);
+}
+
+/**
+ * Compute the EID of the rotation window that contains @p timeSecs.
+ *
+ * @param[in] tmpKey
+ *              The temporary key for @p timeSecs, expanded.
+ * @param[in] rotationPeriodExp
+ *              The rotation period exponent K (the window is 2^K seconds).
+ * @param[in] timeSecs
+ *              Beacon time.
+ *
+ * @return The 8-byte EID.
+ */
+inline uint64_t eidFromTemporaryKey(const HostAes128 &tmpKey, uint8_t rotationPeriodExp, uint32_t timeSecs)
+{
+    uint8_t block[16];
+    eidBlock(rotationPeriodExp, timeSecs, block);
+    tmpKey.encrypt(block, block);
+    return eidFromEncryptedBlock(block);
+}
+
+/**
+ * Compute an EID from scratch, as EIDFrame::update() does.
+ */
+inline uint64_t eidCompute(const uint8_t identityKey[16], uint8_t rotationPeriodExp, uint32_t timeSecs)
+{
+    uint8_t tmpKey[16];
+    eidTemporaryKey(HostAes128(identityKey), timeSecs, tmpKey);
+    return eidFromTemporaryKey(HostAes128(tmpKey), rotationPeriodExp, timeSecs);
+}
+
+#endif // __EID_COMPUTE_H__
@@ -0,0 +1,128 @@
+/*
+ * Copyright (c) 2016, Google Inc, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "HostAes128.h"
+
+namespace {
+
+/* S-box and combined SubBytes/MixColumns tables, built once at startup */
+struct Tables {
+    uint8_t  sbox[256];
+    uint32_t te[4][256];
+
+    Tables()
+    {
+        /* Walk the multiplicative group with generator 3 to get inverses */
+        uint8_t p = 1, q = 1;
+        do {
+            p = p ^ (uint8_t)(p << 1) ^ ((p & 0x80) ? 0x1B : 0);
+            q ^= q << 1;
+            q ^= q << 2;
+            q ^= q << 4;
+            if (q & 0x80) {
+                q ^= 0x09;
+            }
+            uint8_t x = q ^ rotl8(q, 1) ^ rotl8(q, 2) ^ rotl8(q, 3) ^ rotl8(q, 4);
+            sbox[p] = x ^ 0x63;
+        } while (p != 1);
+        sbox[0] = 0x63;
+
+        for (int i = 0; i < 256; i++) {
+            uint8_t s = sbox[i];
+            uint8_t s2 = (uint8_t)(s << 1) ^ ((s & 0x80) ? 0x1B : 0);
+            uint8_t s3 = s2 ^ s;
+            uint32_t t = ((uint32_t)s2 << 24) | ((uint32_t)s << 16) | ((uint32_t)s << 8) | s3;
+            for (int j = 0; j < 4; j++) {
+                te[j][i] = t;
+                t = (t >> 8) | (t << 24);
+            }
+        }
+    }
+
+    static uint8_t rotl8(uint8_t x, int n) { return (uint8_t)((x << n) | (x >> (8 - n))); }
+};
+
+const Tables tables;
+
+inline uint32_t load32(const uint8_t *p)
+{
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+inline void store32(uint8_t *p, uint32_t v)
+{
+    p[0] = v >> 24;
+    p[1] = v >> 16;
+    p[2] = v >> 8;
+    p[3] = v;
+}
+
+inline uint32_t subWord(uint32_t w)
+{
+    return ((uint32_t)tables.sbox[w >> 24] << 24) | ((uint32_t)tables.sbox[(w >> 16) & 0xFF] << 16) |
+           ((uint32_t)tables.sbox[(w >> 8) & 0xFF] << 8) | tables.sbox[w & 0xFF];
+}
+
+} // namespace
+
+void HostAes128::setKey(const uint8_t key[16])
+{
+    static const uint8_t rcon[10] = { 0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80, 0x1B, 0x36 };
+    for (int i = 0; i < 4; i++) {
+        rk[i] = load32(key + 4 * i);
+    }
+    for (int i = 4; i < 44; i++) {
+        uint32_t t = rk[i - 1];
+        if (i % 4 == 0) {
+            t = subWord((t << 8) | (t >> 24)) ^ ((uint32_t)rcon[i / 4 - 1] << 24);
+        }
+        rk[i] = rk[i - 4] ^ t;
+    }
+}
+
+void HostAes128::encrypt(const uint8_t in[16], uint8_t out[16]) const
+{
+    const uint32_t (*te)[256] = tables.te;
+    const uint8_t *sbox = tables.sbox;
+    uint32_t s0 = load32(in) ^ rk[0];
+    uint32_t s1 = load32(in + 4) ^ rk[1];
+    uint32_t s2 = load32(in + 8) ^ rk[2];
+    uint32_t s3 = load32(in + 12) ^ rk[3];
+
+    for (int round = 1; round < 10; round++) {
+        const uint32_t *k = rk + 4 * round;
+        uint32_t t0 = te[0][s0 >> 24] ^ te[1][(s1 >> 16) & 0xFF] ^ te[2][(s2 >> 8) & 0xFF] ^ te[3][s3 & 0xFF] ^ k[0];
+        uint32_t t1 = te[0][s1 >> 24] ^ te[1][(s2 >> 16) & 0xFF] ^ te[2][(s3 >> 8) & 0xFF] ^ te[3][s0 & 0xFF] ^ k[1];
+        uint32_t t2 = te[0][s2 >> 24] ^ te[1][(s3 >> 16) & 0xFF] ^ te[2][(s0 >> 8) & 0xFF] ^ te[3][s1 & 0xFF] ^ k[2];
+        uint32_t t3 = te[0][s3 >> 24] ^ te[1][(s0 >> 16) & 0xFF] ^ te[2][(s1 >> 8) & 0xFF] ^ te[3][s2 & 0xFF] ^ k[3];
+        s0 = t0;
+        s1 = t1;
+        s2 = t2;
+        s3 = t3;
+    }
+
+    /* Last round: no MixColumns */
+    const uint32_t *k = rk + 40;
+    uint32_t w[4] = { s0, s1, s2, s3 };
+    for (int i = 0; i < 4; i++) {
+        uint32_t v = ((uint32_t)sbox[w[i] >> 24] << 24) |
+                     ((uint32_t)sbox[(w[(i + 1) % 4] >> 16) & 0xFF] << 16) |
+                     ((uint32_t)sbox[(w[(i + 2) % 4] >> 8) & 0xFF] << 8) |
+                     sbox[w[(i + 3) % 4] & 0xFF];
+        store32(out + 4 * i, v ^ k[i]);
+    }
+}
@@ -0,0 +1,57 @@
+/*
+ * Copyright (c) 2016, Google Inc, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __HOST_AES128_H__
+#define __HOST_AES128_H__
+
+#include <stdint.h>
+
+/**
+ * Portable AES-128 encryption (FIPS-197, table based) for the host tools,
+ * which do not link mbed TLS. Only encryption is needed: the EID, the EID
+ * temporary key and EAX (CTR + OMAC) all run the cipher forwards.
+ */
+class HostAes128
+{
+public:
+    HostAes128() {}
+
+    /**
+     * Construct and expand @p key.
+     */
+    explicit HostAes128(const uint8_t key[16]) { setKey(key); }
+
+    /**
+     * Expand a new key.
+     */
+    void setKey(const uint8_t key[16]);
+
+    /**
+     * Encrypt one block. @p in and @p out may overlap.
+     */
+    void encrypt(const uint8_t in[16], uint8_t out[16]) const;
+
+    /**
+     * The expanded key, 11 round keys of 4 big endian words.
+     */
+    const uint32_t *roundKeys(void) const { return rk; }
+
+private:
+    uint32_t rk[44];
+};
+
+#endif // __HOST_AES128_H__
@@ -0,0 +1,42 @@
+/*
+ * Copyright (c) 2016, Google Inc, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * The host entropy source, in place of the nRF TRNG of
+ * source/EntropySource/, for the host programs that link the firmware's
+ * DrbgService (AdvSetsHostCheck, BootLatency, UnlockLatency).
+ */
+
+#include "EntropySource/EntropySource.h"
+
+#include <random>
+
+int eddystoneEntropyPoll(void *data, unsigned char *output, size_t len, size_t *olen)
+{
+    (void)data;
+    static std::random_device device;
+    for (size_t i = 0; i < len; i++) {
+        output[i] = (unsigned char)device();
+    }
+    *olen = len;
+    return 0;
+}
+
+int eddystoneRegisterEntropySource(mbedtls_entropy_context *ctx)
+{
+    return mbedtls_entropy_add_source(ctx, eddystoneEntropyPoll, NULL, 32, MBEDTLS_ENTROPY_SOURCE_STRONG);
+}
@@ -0,0 +1,46 @@
+/*
+ * Copyright (c) 2016, Google Inc, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __PARALLEL_FOR_H__
+#define __PARALLEL_FOR_H__
+
+#include <stddef.h>
+#include <thread>
+#include <vector>
+
+/**
+ * Run f(worker, begin, end) over [0, n) split in @p threads contiguous
+ * ranges, one std::thread each, and wait for them. Runs inline when there
+ * is a single thread or fewer items than threads.
+ */
+template <typename F>
+void parallelFor(unsigned threads, size_t n, F f)
+{
+    if (threads <= 1 || n < threads) {
+        f(0, 0, n);
+        return;
+    }
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < threads; t++) {
+        workers.push_back(std::thread(f, t, n * t / threads, n * (t + 1) / threads));
+    }
+    for (size_t t = 0; t < workers.size(); t++) {
+        workers[t].join();
+    }
+}
+
+#endif // __PARALLEL_FOR_H__